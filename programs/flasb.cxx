@@ -0,0 +1,182 @@
+// flasb.cxx - Standalone pipelined runner of the Falaise ASB plugin
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Standard libraries :
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/logger.h>
+#include <datatools/properties.h>
+#include <datatools/service_manager.h>
+#include <datatools/utils.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/pipeline_runner.h>
+
+void usage(std::ostream &out_) {
+  out_ << "Usage: flasb [options]" << std::endl;
+  out_ << "Options:" << std::endl;
+  out_ << "  -h, --help               : print this help" << std::endl;
+  out_ << "  -c, --config FILE        : configuration of the analog signal builder module"
+       << std::endl;
+  out_ << "  -s, --services FILE      : configuration of the service manager" << std::endl;
+  out_ << "  -i, --input FILE         : input file with simulated data (SD)" << std::endl;
+  out_ << "  -o, --output FILE        : output file with simulated signal data (SSD)"
+       << std::endl;
+  out_ << "  -j, --workers N          : number of compute workers (default: 1)" << std::endl;
+  out_ << "  -q, --queue-capacity N   : capacity of the queues between stages (default: 16)"
+       << std::endl;
+  out_ << "  -n, --max-records N      : maximum number of records to process" << std::endl;
+  out_ << "  --write-buffer N         : records per buffer of the background writer (default: 16)"
+       << std::endl;
+  out_ << "  --split-threshold N      : split events with more than N step hits in per-driver"
+       << std::endl;
+  out_ << "                             tasks (default: 0, never)" << std::endl;
+  out_ << "  --shard I/K              : process only the records whose index modulo K is I"
+       << std::endl;
+  out_ << "  -P, --logging-priority P : logging priority (default: fatal)" << std::endl;
+  return;
+}
+
+// Parse the non-negative integer value of an option
+std::size_t parse_count(const std::string &option_, const std::string &value_) {
+  errno = 0;
+  char *end = nullptr;
+  const unsigned long long count = std::strtoull(value_.c_str(), &end, 10);
+  DT_THROW_IF(!std::isdigit(static_cast<unsigned char>(value_[0])) || *end != '\0' ||
+                  errno == ERANGE,
+              std::logic_error,
+              "Invalid value '" << value_ << "' for option '" << option_
+                                << "'; expected a non-negative integer!");
+  return static_cast<std::size_t>(count);
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  datatools::logger::priority logging = datatools::logger::PRIO_FATAL;
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::string module_config_filename;
+    std::string services_config_filename;
+    std::string input_filename;
+    std::string output_filename;
+    std::size_t number_of_workers = 1;
+    std::size_t queue_capacity = 16;
+    std::size_t max_records = 0;
+    std::size_t split_threshold = 0;
+    std::size_t write_buffer_capacity = 16;
+    std::size_t shard_index = 0;
+    std::size_t number_of_shards = 1;
+
+    // Parsing arguments
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      DT_THROW_IF(arg != "-h" && arg != "--help" && iarg + 1 >= argc_, std::logic_error,
+                  "Missing value for option '" << arg << "'!");
+      if (arg == "-h" || arg == "--help") {
+        usage(std::cout);
+        falaise::terminate();
+        return EXIT_SUCCESS;
+      } else if (arg == "-c" || arg == "--config") {
+        module_config_filename = argv_[++iarg];
+      } else if (arg == "-s" || arg == "--services") {
+        services_config_filename = argv_[++iarg];
+      } else if (arg == "-i" || arg == "--input") {
+        input_filename = argv_[++iarg];
+      } else if (arg == "-o" || arg == "--output") {
+        output_filename = argv_[++iarg];
+      } else if (arg == "-j" || arg == "--workers") {
+        number_of_workers = parse_count(arg, argv_[++iarg]);
+      } else if (arg == "-q" || arg == "--queue-capacity") {
+        queue_capacity = parse_count(arg, argv_[++iarg]);
+      } else if (arg == "-n" || arg == "--max-records") {
+        max_records = parse_count(arg, argv_[++iarg]);
+      } else if (arg == "--write-buffer") {
+        write_buffer_capacity = parse_count(arg, argv_[++iarg]);
+      } else if (arg == "--split-threshold") {
+        split_threshold = parse_count(arg, argv_[++iarg]);
+      } else if (arg == "--shard") {
+        const std::string shard = argv_[++iarg];
+        const std::size_t slash = shard.find('/');
+        DT_THROW_IF(slash == std::string::npos, std::logic_error,
+                    "Invalid shard '" << shard << "'; expected I/K!");
+        shard_index = parse_count(arg, shard.substr(0, slash));
+        number_of_shards = parse_count(arg, shard.substr(slash + 1));
+      } else if (arg == "-P" || arg == "--logging-priority") {
+        logging = datatools::logger::get_priority(argv_[++iarg]);
+        DT_THROW_IF(logging == datatools::logger::PRIO_UNDEFINED, std::logic_error,
+                    "Invalid logging priority '" << argv_[iarg] << "'!");
+      } else {
+        DT_THROW(std::logic_error, "Unknown option '" << arg << "'!");
+      }
+      iarg++;
+    }
+
+    DT_THROW_IF(module_config_filename.empty(), std::logic_error,
+                "Missing module configuration file!");
+    DT_THROW_IF(services_config_filename.empty(), std::logic_error,
+                "Missing services configuration file!");
+    datatools::fetch_path_with_env(module_config_filename);
+    datatools::fetch_path_with_env(services_config_filename);
+
+    datatools::properties module_config;
+    module_config.read_configuration(module_config_filename);
+
+    datatools::properties services_config;
+    services_config.read_configuration(services_config_filename);
+    datatools::service_manager services("ASBServices", "Services of the ASB runner");
+    services.initialize(services_config);
+
+    snemo::asb::pipeline_runner runner;
+    runner.set_logging_priority(logging);
+    runner.set_input_filename(input_filename);
+    runner.set_output_filename(output_filename);
+    runner.set_module_config(module_config);
+    runner.set_service_manager(services);
+    runner.set_number_of_workers(number_of_workers);
+    runner.set_queue_capacity(queue_capacity);
+    runner.set_write_buffer_capacity(write_buffer_capacity);
+    runner.set_max_records(max_records);
+    runner.set_split_threshold(split_threshold);
+    runner.set_shard(shard_index, number_of_shards);
+    runner.run();
+    runner.print_report(std::clog);
+
+    services.reset();
+  } catch (std::exception &error) {
+    DT_LOG_FATAL(logging, error.what());
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    DT_LOG_FATAL(logging, "Unexpected error!");
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return error_code;
+}
@@ -0,0 +1,90 @@
+// flasb_merge.cxx - Merge the outputs of a sharded run of the Falaise ASB plugin
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/logger.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/shard_merger.h>
+
+void usage(std::ostream &out_) {
+  out_ << "Usage: flasb_merge [options] SHARD_0 SHARD_1 ... SHARD_K-1" << std::endl;
+  out_ << "Options:" << std::endl;
+  out_ << "  -h, --help               : print this help" << std::endl;
+  out_ << "  -o, --output FILE        : merged output file" << std::endl;
+  out_ << "  -P, --logging-priority P : logging priority (default: fatal)" << std::endl;
+  out_ << "The shard files must be given in shard index order." << std::endl;
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  datatools::logger::priority logging = datatools::logger::PRIO_FATAL;
+  int error_code = EXIT_SUCCESS;
+  try {
+    snemo::asb::shard_merger merger;
+    std::string output_filename;
+
+    // Parsing arguments
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-h" || arg == "--help") {
+        usage(std::cout);
+        falaise::terminate();
+        return EXIT_SUCCESS;
+      } else if (arg == "-o" || arg == "--output") {
+        DT_THROW_IF(iarg + 1 >= argc_, std::logic_error, "Missing output file!");
+        output_filename = argv_[++iarg];
+      } else if (arg == "-P" || arg == "--logging-priority") {
+        DT_THROW_IF(iarg + 1 >= argc_, std::logic_error, "Missing logging priority!");
+        logging = datatools::logger::get_priority(argv_[++iarg]);
+        DT_THROW_IF(logging == datatools::logger::PRIO_UNDEFINED, std::logic_error,
+                    "Invalid logging priority '" << argv_[iarg] << "'!");
+      } else {
+        merger.add_shard_filename(arg);
+      }
+      iarg++;
+    }
+
+    merger.set_logging_priority(logging);
+    merger.set_output_filename(output_filename);
+    const std::size_t merged_records = merger.merge();
+    std::clog << "Merged records : " << merged_records << std::endl;
+  } catch (std::exception &error) {
+    DT_LOG_FATAL(logging, error.what());
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    DT_LOG_FATAL(logging, "Unexpected error!");
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return error_code;
+}
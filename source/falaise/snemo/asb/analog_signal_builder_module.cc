@@ -22,17 +22,24 @@
 #include <snemo/asb/analog_signal_builder_module.h>
 
 // Standard library:
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <random>
 
 // Third party:
 // - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
 #include <bayeux/datatools/handle.h>
 #include <bayeux/datatools/service_manager.h>
 // - Bayeux/geomtools:
 #include <bayeux/geomtools/geometry_service.h>
 
 // This project:
+#include <falaise/snemo/asb/signal_index.h>
+#include <falaise/snemo/asb/utils.h>
 #include <falaise/snemo/datamodels/data_model.h>
+#include <falaise/snemo/datamodels/event_header.h>
 #include <falaise/snemo/processing/services.h>
 
 namespace snemo {
@@ -52,6 +59,8 @@ struct analog_signal_builder_module::driver_entry {
   bool is_driver_initialized() const;
   base_signal_generator_driver &grab_driver();
   const base_signal_generator_driver &get_driver() const;
+  const std::string &get_name() const;
+  uint64_t get_config_hash() const;
 
  private:
   void _initialize_();
@@ -62,6 +71,7 @@ struct analog_signal_builder_module::driver_entry {
   std::string _name_;
   std::string _type_id_;
   datatools::properties _config_;
+  uint64_t _config_hash_;
   datatools::handle<base_signal_generator_driver> _handle_;
 };
 
@@ -70,6 +80,8 @@ analog_signal_builder_module::driver_entry::driver_entry(analog_signal_builder_m
                                                          const std::string &type_id_,
                                                          const datatools::properties &config_)
     : _parent_(parent_), _name_(name_), _type_id_(type_id_), _config_(config_) {
+  _config_hash_ = hash_utils::update(hash_utils::offset_basis, _type_id_);
+  _config_hash_ = hash_utils::hash_properties(_config_, _config_hash_);
   return;
 }
 
@@ -98,6 +110,10 @@ void analog_signal_builder_module::driver_entry::_initialize_() {
     if (_parent_.has_geometry_manager()) {
       _handle_.grab().set_geo_manager(_parent_.get_geometry_manager());
     }
+    if (_parent_.has_channel_map()) {
+      _handle_.grab().set_channel_map(_parent_.get_channel_map());
+    }
+    _handle_.grab().set_span_recorder(_parent_._span_recorder_.get());
     // if (_parent_.has_database_manager()) {
     //   _handle_.grab().set_database_manager(_parent_.get_database_manager());
     // }
@@ -124,6 +140,17 @@ const base_signal_generator_driver &analog_signal_builder_module::driver_entry::
   return const_cast<base_signal_generator_driver &>(mutable_driver);
 }
 
+const std::string &analog_signal_builder_module::driver_entry::get_name() const { return _name_; }
+
+uint64_t analog_signal_builder_module::driver_entry::get_config_hash() const {
+  // A driver switched to degraded mode by the memory budget produces
+  // another output from the same configuration:
+  if (is_driver_initialized() && _handle_.get().is_degraded_mode()) {
+    return hash_utils::update(_config_hash_, std::string("degraded"));
+  }
+  return _config_hash_;
+}
+
 base_signal_generator_driver &analog_signal_builder_module::driver_entry::grab_driver() {
   _initialize_();
   return _handle_.grab();
@@ -136,9 +163,34 @@ void analog_signal_builder_module::_set_defaults_() {
   _SSD_label_.clear();
   _Geo_label_.clear();
   _Db_label_.clear();
+  _EH_label_.clear();
   _abort_at_missing_input_ = true;
   _abort_at_former_output_ = false;
   _preserve_former_output_ = false;
+  _incremental_mode_ = false;
+  _stream_mode_ = false;
+  _stream_event_period_ = 1.0 * CLHEP::millisecond;
+  _stream_random_spacing_ = true;
+  _stream_use_sd_time_ = false;
+  _stream_seed_ = 314159;
+  _stream_last_event_time_ = 0.0;
+  _cache_input_digest_.clear();
+  _trace_filename_.clear();
+  _trigger_enabled_ = false;
+  _TP_label_ = "TP";
+  _index_enabled_ = false;
+  _compact_shapes_ = false;
+  _fixed_point_enabled_ = false;
+  _memory_accounting_ = false;
+  _memory_budget_ = 0;
+  _memory_skip_policy_ = false;
+  _degraded_drivers_.clear();
+  _skipped_drivers_.clear();
+  _driver_memory_peaks_.clear();
+  _bank_memory_peak_ = 0;
+  _over_budget_events_ = 0;
+  _event_counter_ = 0;
+  _current_event_number_ = -1;
   return;
 }
 
@@ -186,6 +238,17 @@ void analog_signal_builder_module::initialize(const datatools::properties &confi
     _SSD_label_ = snemo::datamodel::data_info::default_simulated_signal_data_label();
   }
 
+  /// Input event header bank:
+  if (_EH_label_.empty()) {
+    if (config_.has_key("EH_label")) {
+      _EH_label_ = config_.fetch_string("EH_label");
+    }
+  }
+  // Default label:
+  if (_EH_label_.empty()) {
+    _EH_label_ = snemo::datamodel::data_info::default_event_header_label();
+  }
+
   /*if (_db_manager_ == nullptr) */ {
     /// Db service:
     if (_Db_label_.empty()) {
@@ -239,7 +302,142 @@ void analog_signal_builder_module::initialize(const datatools::properties &confi
     set_preserve_former_output(config_.fetch_boolean("preserve_former_output"));
   }
 
-  _init_drivers_(config_, service_manager_);
+  if (config_.has_key("incremental_mode")) {
+    set_incremental_mode(config_.fetch_boolean("incremental_mode"));
+  }
+
+  if (config_.has_key("stream_mode")) {
+    set_stream_mode(config_.fetch_boolean("stream_mode"));
+  }
+
+  DT_THROW_IF(is_stream_mode() && is_incremental_mode(), std::logic_error,
+              "Module '" << get_name() << "' cannot run both stream and incremental modes !");
+  DT_THROW_IF(is_abort_at_former_output() && is_incremental_mode(), std::logic_error,
+              "Module '" << get_name()
+                         << "' cannot abort at former output in incremental mode, which "
+                            "reprocesses it !");
+
+  if (is_stream_mode()) {
+    if (config_.has_key("stream.window")) {
+      double window = config_.fetch_real("stream.window");
+      if (!config_.has_explicit_unit("stream.window")) {
+        window *= CLHEP::ns;
+      }
+      _stream_buffer_.set_window(window);
+    }
+
+    if (config_.has_key("stream.event_period")) {
+      _stream_event_period_ = config_.fetch_real("stream.event_period");
+      if (!config_.has_explicit_unit("stream.event_period")) {
+        _stream_event_period_ *= CLHEP::ns;
+      }
+      DT_THROW_IF(_stream_event_period_ <= 0.0, std::domain_error,
+                  "Module '" << get_name() << "' has an invalid stream event period !");
+    }
+
+    if (config_.has_key("stream.random_spacing")) {
+      _stream_random_spacing_ = config_.fetch_boolean("stream.random_spacing");
+    }
+
+    if (config_.has_key("stream.seed")) {
+      _stream_seed_ = config_.fetch_integer("stream.seed");
+    }
+
+    if (config_.has_key("stream.use_sd_time")) {
+      _stream_use_sd_time_ = config_.fetch_boolean("stream.use_sd_time");
+    }
+
+    _stream_buffer_.reset();
+    _stream_prng_.seed(_stream_seed_);
+    _stream_last_event_time_ = 0.0;
+  }
+
+  if (config_.has_key("cache.enabled") && config_.fetch_boolean("cache.enabled")) {
+    _cache_.set_logging_priority(get_logging_priority());
+    if (config_.has_key("cache.directory")) {
+      _cache_.set_directory(config_.fetch_path("cache.directory"));
+    }
+    if (config_.has_key("cache.max_size")) {
+      const int max_size_mb = config_.fetch_integer("cache.max_size");
+      DT_THROW_IF(max_size_mb <= 0, std::domain_error,
+                  "Module '" << get_name() << "' has an invalid cache size !");
+      _cache_.set_max_size(static_cast<std::size_t>(max_size_mb) * 1024 * 1024);
+    }
+    if (config_.has_key("cache.input_digest")) {
+      _cache_input_digest_ = config_.fetch_string("cache.input_digest");
+    }
+    _cache_.initialize();
+  }
+
+  if (config_.has_key("channel_map.enabled") && config_.fetch_boolean("channel_map.enabled")) {
+    _channel_map_.set_logging_priority(get_logging_priority());
+    if (config_.has_key("channel_map.cache_directory")) {
+      const std::string cache_directory = config_.fetch_path("channel_map.cache_directory");
+      const bool loaded = _channel_map_.load_or_build(*_geometry_manager_, cache_directory);
+      DT_LOG_DEBUG(get_logging_priority(),
+                   "Channel map " << (loaded ? "loaded from" : "built and saved in") << " '"
+                                  << cache_directory << "'.");
+    } else {
+      _channel_map_.build(*_geometry_manager_);
+    }
+  }
+
+  if (config_.has_key("trigger.enabled") && config_.fetch_boolean("trigger.enabled")) {
+    _trigger_enabled_ = true;
+    if (config_.has_key("trigger.bank_label")) {
+      _TP_label_ = config_.fetch_string("trigger.bank_label");
+    }
+    datatools::properties trigger_config;
+    config_.export_and_rename_starting_with(trigger_config, "trigger.", "");
+    _trigger_builder_.set_logging_priority(get_logging_priority());
+    _trigger_builder_.initialize(trigger_config);
+  }
+
+  if (config_.has_key("index.enabled")) {
+    _index_enabled_ = config_.fetch_boolean("index.enabled");
+  }
+
+  if (config_.has_key("compact_shapes")) {
+    _compact_shapes_ = config_.fetch_boolean("compact_shapes");
+  }
+
+  if (config_.has_key("fixed_point.enabled") && config_.fetch_boolean("fixed_point.enabled")) {
+    _fixed_point_enabled_ = true;
+    datatools::properties fixed_point_config;
+    config_.export_and_rename_starting_with(fixed_point_config, "fixed_point.", "");
+    _fixed_point_codec_.initialize(fixed_point_config);
+  }
+
+  if (config_.has_key("memory.accounting")) {
+    _memory_accounting_ = config_.fetch_boolean("memory.accounting");
+  }
+  if (config_.has_key("memory.budget")) {
+    const int budget_mb = config_.fetch_integer("memory.budget");
+    DT_THROW_IF(budget_mb < 0, std::domain_error,
+                "Module '" << get_name() << "' has invalid memory budget (" << budget_mb
+                           << " MB) !");
+    _memory_budget_ = static_cast<std::size_t>(budget_mb) * 1024 * 1024;
+    if (_memory_budget_ > 0) {
+      // The budget relies on the accounting:
+      _memory_accounting_ = true;
+    }
+  }
+  if (config_.has_key("memory.policy")) {
+    const std::string policy = config_.fetch_string("memory.policy");
+    DT_THROW_IF(policy != "degrade" && policy != "skip", std::logic_error,
+                "Module '" << get_name() << "' has invalid memory policy '" << policy << "' !");
+    _memory_skip_policy_ = (policy == "skip");
+  }
+
+  if (config_.has_key("trace.filename")) {
+    _trace_filename_ = config_.fetch_path("trace.filename");
+    _span_recorder_.reset(new span_recorder);
+  }
+
+  {
+    span_recorder::scope span(_span_recorder_.get(), "initialize drivers", "module");
+    _init_drivers_(config_, service_manager_);
+  }
 
   _set_initialized(true);
   return;
@@ -276,7 +474,42 @@ void analog_signal_builder_module::reset() {
   DT_THROW_IF(!is_initialized(), std::logic_error,
               "Module '" << get_name() << "' is not initialized !");
   _set_initialized(false);
+  if (_stream_buffer_.get_number_of_pulses() > 0) {
+    DT_LOG_WARNING(get_logging_priority(),
+                   "Module '" << get_name() << "' discards "
+                              << _stream_buffer_.get_number_of_pulses()
+                              << " signals from unclosed stream frames (see flush_stream) !");
+  }
+  _stream_buffer_.reset();
+  if (_cache_.is_initialized()) {
+    _cache_.reset();
+  }
+  _active_drivers_.clear();
+  if (has_memory_accounting() && get_logging_priority() >= datatools::logger::PRIO_NOTICE) {
+    print_memory_report(std::clog);
+  }
+  _trigger_builder_.reset();
+  _shape_prototypes_.clear();
+  if (_fixed_point_enabled_ && _fixed_point_codec_.get_number_of_overflows() > 0) {
+    DT_LOG_WARNING(get_logging_priority(),
+                   "Module '" << get_name() << "' kept "
+                              << _fixed_point_codec_.get_number_of_overflows()
+                              << " out-of-range shape parameters at full precision !");
+  }
+  _fixed_point_codec_ = fixed_point_codec();
   _drivers_.clear();
+  _channel_map_.reset();
+  if (_span_recorder_) {
+    try {
+      _span_recorder_->write_json_file(_trace_filename_);
+      DT_LOG_NOTICE(get_logging_priority(),
+                    "Module '" << get_name() << "' wrote " << _span_recorder_->get_number_of_spans()
+                               << " spans in trace file '" << _trace_filename_ << "'.");
+    } catch (std::exception &error) {
+      DT_LOG_ERROR(get_logging_priority(), error.what());
+    }
+    _span_recorder_.reset();
+  }
   _geometry_manager_ = nullptr;
   // _database_manager_ = nullptr;
   _set_defaults_();
@@ -352,6 +585,14 @@ void analog_signal_builder_module::set_geometry_manager(const geomtools::manager
   return;
 }
 
+bool analog_signal_builder_module::has_channel_map() const { return _channel_map_.is_valid(); }
+
+const channel_map &analog_signal_builder_module::get_channel_map() const {
+  DT_THROW_IF(!has_channel_map(), std::logic_error,
+              "Module '" << get_name() << "' has no channel map !");
+  return _channel_map_;
+}
+
 const geomtools::manager &analog_signal_builder_module::get_geometry_manager() const {
   DT_THROW_IF(!is_initialized(), std::logic_error,
               "Module '" << get_name() << "' is not initialized ! ");
@@ -385,6 +626,58 @@ void analog_signal_builder_module::set_preserve_former_output(bool p_) {
   return;
 }
 
+bool analog_signal_builder_module::has_cache() const { return _cache_.is_initialized(); }
+
+const result_cache &analog_signal_builder_module::get_cache() const { return _cache_; }
+
+bool analog_signal_builder_module::is_incremental_mode() const { return _incremental_mode_; }
+
+void analog_signal_builder_module::set_incremental_mode(bool i_) {
+  DT_THROW_IF(is_initialized(), std::logic_error,
+              "Module '" << get_name() << "' is already initialized ! ");
+  _incremental_mode_ = i_;
+  return;
+}
+
+void analog_signal_builder_module::set_driver_executor(const driver_executor_type &executor_) {
+  _driver_executor_ = executor_;
+  return;
+}
+
+bool analog_signal_builder_module::has_memory_accounting() const { return _memory_accounting_; }
+
+void analog_signal_builder_module::print_memory_report(std::ostream &out_) const {
+  out_ << "Memory report of module '" << get_name() << "' :" << std::endl;
+  out_ << "|-- Budget : ";
+  if (_memory_budget_ > 0) {
+    out_ << _memory_budget_ / 1024 << " kB (policy: '"
+         << (_memory_skip_policy_ ? "skip" : "degrade") << "')";
+  } else {
+    out_ << "none";
+  }
+  out_ << std::endl;
+  out_ << "|-- Events over budget : " << _over_budget_events_ << std::endl;
+  for (const auto &peak : _driver_memory_peaks_) {
+    out_ << "|-- Driver '" << peak.first << "' high-water mark : " << peak.second / 1024 << " kB"
+         << std::endl;
+  }
+  out_ << "`-- Output bank high-water mark : " << _bank_memory_peak_ / 1024 << " kB" << std::endl;
+  return;
+}
+
+bool analog_signal_builder_module::is_stream_mode() const { return _stream_mode_; }
+
+void analog_signal_builder_module::set_stream_mode(bool s_) {
+  DT_THROW_IF(is_initialized(), std::logic_error,
+              "Module '" << get_name() << "' is already initialized ! ");
+  _stream_mode_ = s_;
+  return;
+}
+
+const signal_stream_buffer &analog_signal_builder_module::get_stream_buffer() const {
+  return _stream_buffer_;
+}
+
 bool analog_signal_builder_module::has_driver(const std::string &name_) const {
   return _drivers_.count(name_);
 }
@@ -435,6 +728,36 @@ dpp::base_module::process_status analog_signal_builder_module::process(
   const mctools::simulated_data &the_simulated_data =
       data_record_.get<mctools::simulated_data>(_SD_label_);
 
+  // Identify the event:
+  _current_event_number_ = _event_counter_++;
+  if (data_record_.has(_EH_label_) &&
+      data_record_.is_a<snemo::datamodel::event_header>(_EH_label_)) {
+    const snemo::datamodel::event_header &the_event_header =
+        data_record_.get<snemo::datamodel::event_header>(_EH_label_);
+    _current_event_number_ = the_event_header.get_id().get_event_number();
+  }
+
+  span_recorder::scope event_span(
+      _span_recorder_.get(),
+      _span_recorder_ ? "event #" + std::to_string(_current_event_number_) : std::string(),
+      "module");
+
+  // Pre-filter: only the drivers with some input step hits are run, and an
+  // event with nothing to do does not get an output bank:
+  _select_active_drivers_(the_simulated_data);
+  if (_active_drivers_.empty() && !is_stream_mode() && !data_record_.has(_SSD_label_)) {
+    DT_LOG_TRACE(get_logging_priority(),
+                 "Event #" << _current_event_number_ << " has no input step hits; skip it.");
+    // All the events get a trigger summary, empty here:
+    if (_trigger_enabled_) {
+      _export_trigger_summary_(mctools::signal::signal_data(), data_record_);
+    }
+    return dpp::base_module::PROCESS_SUCCESS;
+  }
+  if (has_memory_accounting()) {
+    _apply_memory_budget_(the_simulated_data);
+  }
+
   /////////////////////////////////
   // Check simulated signal data //
   /////////////////////////////////
@@ -451,7 +774,7 @@ dpp::base_module::process_status analog_signal_builder_module::process(
   {
     std::vector<std::string> signal_categories;
     the_signal_data.build_list_of_categories(signal_categories);
-    if (signal_categories.size()) {
+    if (signal_categories.size() && !is_incremental_mode()) {
       DT_THROW_IF(is_abort_at_former_output(), std::logic_error,
                   "Already has processed simulated signal data !");
       if (!is_preserve_former_output()) {
@@ -460,30 +783,370 @@ dpp::base_module::process_status analog_signal_builder_module::process(
     }
   }
 
+  // Signals preserved from a former processing are restored to full
+  // precision, and refer to the shape prototypes of another run:
+  fixed_point_codec::decode(the_signal_data);
+  shape_prototype_dictionary::expand(the_signal_data);
+
   /********************
    * Process the data *
    ********************/
 
   // Main processing method :
   try {
-    _process_(the_simulated_data, the_signal_data);
+    if (is_stream_mode()) {
+      _process_stream_(the_simulated_data, the_signal_data);
+    } else if (is_incremental_mode()) {
+      _process_incremental_(the_simulated_data, the_signal_data);
+    } else {
+      _process_(the_simulated_data, the_signal_data);
+    }
   } catch (std::exception &error) {
     DT_LOG_ERROR(get_logging_priority(), error.what());
     return dpp::base_module::PROCESS_ERROR;
   }
 
+  _finalize_output_(the_signal_data, data_record_);
+
   return dpp::base_module::PROCESS_SUCCESS;
 }
 
+std::size_t analog_signal_builder_module::flush_stream(datatools::things &data_record_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error,
+              "Module '" << get_name() << "' is not initialized !");
+  DT_THROW_IF(!is_stream_mode(), std::logic_error,
+              "Module '" << get_name() << "' does not run the stream mode !");
+  mctools::signal::signal_data &the_signal_data =
+      data_record_.has(_SSD_label_)
+          ? data_record_.grab<mctools::signal::signal_data>(_SSD_label_)
+          : data_record_.add<mctools::signal::signal_data>(_SSD_label_);
+  const std::size_t number_of_signals = _stream_buffer_.flush(the_signal_data);
+  _finalize_output_(the_signal_data, data_record_);
+  return number_of_signals;
+}
+
+void analog_signal_builder_module::_finalize_output_(
+    mctools::signal::signal_data &sim_signal_data_, datatools::things &data_record_) {
+  // Trigger primitives, computed analytically from the signal shapes:
+  if (_trigger_enabled_) {
+    span_recorder::scope span(_span_recorder_.get(), "trigger primitives", "module");
+    _export_trigger_summary_(sim_signal_data_, data_record_);
+  }
+
+  // Signals sorted by channel and start time, with their index:
+  if (_index_enabled_) {
+    span_recorder::scope span(_span_recorder_.get(), "indexing", "module");
+    signal_index::build(sim_signal_data_);
+  }
+
+  // Compact signals referring to the shape prototypes of the run:
+  if (_compact_shapes_) {
+    span_recorder::scope span(_span_recorder_.get(), "shape compaction", "module");
+    _shape_prototypes_.compact(sim_signal_data_);
+  }
+
+  // Reduced-precision storage of the shape parameters:
+  if (_fixed_point_enabled_) {
+    span_recorder::scope span(_span_recorder_.get(), "fixed-point encoding", "module");
+    _fixed_point_codec_.encode(sim_signal_data_);
+  }
+
+  if (has_memory_accounting()) {
+    _account_memory_(sim_signal_data_);
+  }
+
+  return;
+}
+
+void analog_signal_builder_module::_export_trigger_summary_(
+    const mctools::signal::signal_data &sim_signal_data_, datatools::things &data_record_) {
+  _trigger_builder_.build(sim_signal_data_);
+  datatools::properties &trigger_summary =
+      data_record_.has(_TP_label_) ? data_record_.grab<datatools::properties>(_TP_label_)
+                                   : data_record_.add<datatools::properties>(_TP_label_);
+  trigger_summary.clear();
+  _trigger_builder_.export_summary(trigger_summary);
+  return;
+}
+
 void analog_signal_builder_module::_process_(const mctools::simulated_data &sim_data_,
                                              mctools::signal::signal_data &sim_signal_data_) {
-  // Loop on embedded signal generator drivers:
+  if (_driver_executor_) {
+    // Each driver fills its own partial signal data, possibly concurrently,
+    // then stages it without locking:
+    if (_staging_bank_.get_number_of_producers() != _drivers_.size()) {
+      _staging_bank_.set_number_of_producers(_drivers_.size());
+    }
+    std::vector<std::function<void()>> jobs;
+    std::size_t iproducer = 0;
+    for (driver_entry *active_driver : _active_drivers_) {
+      driver_entry &de = *active_driver;
+      signal_staging_bank::producer_buffer &staging = _staging_bank_.grab_producer(iproducer++);
+      jobs.push_back([this, &de, &sim_data_, &staging]() {
+        mctools::signal::signal_data partial;
+        _process_driver_(de, sim_data_, partial);
+        staging.absorb(partial);
+        return;
+      });
+    }
+    _driver_executor_(sim_data_, jobs);
+    // Single merge in driver order, as filled by the sequential loop below:
+    _staging_bank_.merge(sim_signal_data_);
+    return;
+  }
+  // Loop on embedded signal generator drivers with some input:
+  for (driver_entry *active_driver : _active_drivers_) {
+    _process_driver_(*active_driver, sim_data_, sim_signal_data_);
+  }
+  return;
+}
+
+void analog_signal_builder_module::_select_active_drivers_(
+    const mctools::simulated_data &sim_data_) {
+  _active_drivers_.clear();
   for (driver_dict_type::iterator idriver = _drivers_.begin(); idriver != _drivers_.end();
        idriver++) {
     driver_entry &de = idriver->second;
-    base_signal_generator_driver &sgd = de.grab_driver();
+    if (de.grab_driver().has_input(sim_data_)) {
+      _active_drivers_.push_back(&de);
+    }
+  }
+  return;
+}
+
+void analog_signal_builder_module::_apply_memory_budget_(
+    const mctools::simulated_data &sim_data_) {
+  _degraded_drivers_.clear();
+  _skipped_drivers_.clear();
+  for (driver_entry *active_driver : _active_drivers_) {
+    active_driver->grab_driver().set_degraded_mode(false);
+  }
+  if (_memory_budget_ == 0) {
+    return;
+  }
+  std::size_t estimated_bytes = 0;
+  for (const driver_entry *active_driver : _active_drivers_) {
+    estimated_bytes += active_driver->get_driver().estimate_event_memory(sim_data_);
+  }
+  if (estimated_bytes <= _memory_budget_) {
+    return;
+  }
+  _over_budget_events_++;
+  DT_LOG_WARNING(get_logging_priority(),
+                 "Event #" << _current_event_number_ << " needs about " << estimated_bytes / 1024
+                           << " kB, over the budget of " << _memory_budget_ / 1024 << " kB !");
+  std::vector<driver_entry *> kept_drivers;
+  kept_drivers.reserve(_active_drivers_.size());
+  for (driver_entry *active_driver : _active_drivers_) {
+    base_signal_generator_driver &sgd = active_driver->grab_driver();
+    if (sgd.has_degraded_mode()) {
+      sgd.set_degraded_mode(true);
+      _degraded_drivers_.push_back(active_driver->get_name());
+    } else if (_memory_skip_policy_) {
+      _skipped_drivers_.push_back(active_driver->get_name());
+      continue;
+    }
+    kept_drivers.push_back(active_driver);
+  }
+  _active_drivers_.swap(kept_drivers);
+  return;
+}
+
+void analog_signal_builder_module::_account_memory_(
+    mctools::signal::signal_data &sim_signal_data_) {
+  std::vector<std::string> output_categories;
+  for (driver_dict_type::const_iterator idriver = _drivers_.begin(); idriver != _drivers_.end();
+       idriver++) {
+    // Drivers never run are not instantiated:
+    if (!idriver->second.is_driver_initialized()) continue;
+    const base_signal_generator_driver &sgd = idriver->second.get_driver();
+    std::size_t driver_bytes = sgd.get_working_memory();
+    output_categories.clear();
+    sgd.build_list_of_output_categories(output_categories);
+    for (const auto &category : output_categories) {
+      driver_bytes += signal_utils::estimate_memory(sim_signal_data_, category);
+    }
+    std::size_t &peak = _driver_memory_peaks_[idriver->first];
+    peak = std::max(peak, driver_bytes);
+  }
+  const std::size_t bank_bytes = signal_utils::estimate_memory(sim_signal_data_);
+  _bank_memory_peak_ = std::max(_bank_memory_peak_, bank_bytes);
+  datatools::properties &bank_aux = sim_signal_data_.grab_auxiliaries();
+  // Stored as a real, as large banks may exceed the range of integer properties:
+  bank_aux.store_real("asb.memory.bank_bytes", static_cast<double>(bank_bytes));
+  if (_degraded_drivers_.size()) {
+    bank_aux.store("asb.memory.degraded_drivers", _degraded_drivers_);
+  }
+  if (_skipped_drivers_.size()) {
+    bank_aux.store("asb.memory.skipped_drivers", _skipped_drivers_);
+  }
+  return;
+}
+
+void analog_signal_builder_module::_process_driver_(
+    driver_entry &de_, const mctools::simulated_data &sim_data_,
+    mctools::signal::signal_data &sim_signal_data_) {
+  base_signal_generator_driver &sgd = de_.grab_driver();
+  span_recorder::scope span(_span_recorder_.get(), de_.get_name(), "driver");
+  if (!has_cache()) {
     sgd.process(sim_data_, sim_signal_data_);
+    return;
+  }
+  std::vector<std::string> input_categories;
+  sgd.build_list_of_input_categories(input_categories);
+  const uint64_t input_hash = hash_utils::hash_step_hits(sim_data_, input_categories);
+  // The step hits identify the event, whatever its position in the run or shard:
+  const std::string key =
+      result_cache::make_key(_cache_input_digest_, de_.get_config_hash(), input_hash);
+  std::vector<std::string> output_categories;
+  sgd.build_list_of_output_categories(output_categories);
+  if (_cache_.load(key, output_categories, sim_signal_data_)) {
+    return;
+  }
+  mctools::signal::signal_data driver_signal_data;
+  sgd.process(sim_data_, driver_signal_data);
+  _cache_.store(key, driver_signal_data);
+  for (const auto &category : output_categories) {
+    signal_utils::copy_signals(driver_signal_data, category, sim_signal_data_);
+  }
+  return;
+}
+
+void analog_signal_builder_module::_process_incremental_(
+    const mctools::simulated_data &sim_data_, mctools::signal::signal_data &sim_signal_data_) {
+  datatools::properties &bank_aux = sim_signal_data_.grab_auxiliaries();
+  static const std::string driver_prefix = "asb.driver.";
+  static const std::string config_hash_suffix = ".config_hash";
+
+  // Remove the output of the drivers of a former processing which are not
+  // configured anymore:
+  std::vector<std::string> former_keys;
+  bank_aux.keys_starting_with(former_keys, driver_prefix);
+  for (const auto &key : former_keys) {
+    if (key.size() <= driver_prefix.size() + config_hash_suffix.size() ||
+        key.compare(key.size() - config_hash_suffix.size(), config_hash_suffix.size(),
+                    config_hash_suffix) != 0) {
+      continue;
+    }
+    const std::string name =
+        key.substr(driver_prefix.size(),
+                   key.size() - driver_prefix.size() - config_hash_suffix.size());
+    if (has_driver(name)) continue;
+    DT_LOG_DEBUG(get_logging_priority(),
+                 "Driver '" << name << "' was removed; drop its former output.");
+    _drop_former_driver_output_(name, sim_signal_data_);
+  }
+
+  // The drivers left out by the pre-filter or the memory budget have no
+  // output, as in the other modes:
+  for (driver_dict_type::iterator idriver = _drivers_.begin(); idriver != _drivers_.end();
+       idriver++) {
+    if (std::find(_active_drivers_.begin(), _active_drivers_.end(), &idriver->second) !=
+        _active_drivers_.end()) {
+      continue;
+    }
+    _drop_former_driver_output_(idriver->first, sim_signal_data_);
+  }
+
+  for (driver_entry *active_driver : _active_drivers_) {
+    driver_entry &de = *active_driver;
+    base_signal_generator_driver &sgd = de.grab_driver();
+    std::vector<std::string> input_categories;
+    sgd.build_list_of_input_categories(input_categories);
+    const std::string config_hash = hash_utils::to_hex(de.get_config_hash());
+    const std::string input_hash =
+        hash_utils::to_hex(hash_utils::hash_step_hits(sim_data_, input_categories));
+    const std::string key_prefix = driver_prefix + de.get_name() + ".";
+    const std::string config_hash_key = key_prefix + "config_hash";
+    const std::string input_hash_key = key_prefix + "input_hash";
+    const std::string output_categories_key = key_prefix + "output_categories";
+    if (bank_aux.has_key(config_hash_key) && bank_aux.has_key(input_hash_key) &&
+        bank_aux.fetch_string(config_hash_key) == config_hash &&
+        bank_aux.fetch_string(input_hash_key) == input_hash) {
+      DT_LOG_DEBUG(get_logging_priority(),
+                   "Driver '" << de.get_name() << "' is unchanged; skip it.");
+      continue;
+    }
+    // Replace the former output of this driver only:
+    std::vector<std::string> output_categories;
+    sgd.build_list_of_output_categories(output_categories);
+    for (const auto &category : output_categories) {
+      if (sim_signal_data_.has_signals(category)) {
+        sim_signal_data_.grab_signals(category).clear();
+      }
+    }
+    _process_driver_(de, sim_data_, sim_signal_data_);
+    bank_aux.update_string(config_hash_key, config_hash);
+    bank_aux.update_string(input_hash_key, input_hash);
+    if (bank_aux.has_key(output_categories_key)) {
+      bank_aux.erase(output_categories_key);
+    }
+    bank_aux.store(output_categories_key, output_categories);
+  }
+  return;
+}
+
+void analog_signal_builder_module::_drop_former_driver_output_(
+    const std::string &driver_name_, mctools::signal::signal_data &sim_signal_data_) {
+  datatools::properties &bank_aux = sim_signal_data_.grab_auxiliaries();
+  const std::string key_prefix = "asb.driver." + driver_name_ + ".";
+  const std::string output_categories_key = key_prefix + "output_categories";
+  if (bank_aux.has_key(output_categories_key)) {
+    std::vector<std::string> former_categories;
+    bank_aux.fetch(output_categories_key, former_categories);
+    for (const auto &category : former_categories) {
+      if (sim_signal_data_.has_signals(category)) {
+        sim_signal_data_.grab_signals(category).clear();
+      }
+    }
   }
+  // Without digests, the driver is run again as soon as it is selected:
+  bank_aux.erase_all_starting_with(key_prefix);
+  return;
+}
+
+double analog_signal_builder_module::_compute_stream_event_time_(
+    const mctools::simulated_data &sim_data_) {
+  double event_time;
+  if (_stream_use_sd_time_ && sim_data_.has_time()) {
+    event_time = sim_data_.get_time();
+  } else if (_stream_random_spacing_) {
+    std::exponential_distribution<double> spacing(1.0 / _stream_event_period_);
+    event_time = _stream_last_event_time_ + spacing(_stream_prng_);
+  } else {
+    event_time = _stream_last_event_time_ + _stream_event_period_;
+  }
+  if (event_time < _stream_last_event_time_) {
+    DT_LOG_WARNING(get_logging_priority(),
+                   "Module '" << get_name() << "' received an event out of time order !");
+  }
+  _stream_last_event_time_ = event_time;
+  return event_time;
+}
+
+void analog_signal_builder_module::_process_stream_(
+    const mctools::simulated_data &sim_data_, mctools::signal::signal_data &sim_signal_data_) {
+  // Build the signals of the current event in a local bank:
+  mctools::signal::signal_data event_signal_data;
+  _process_(sim_data_, event_signal_data);
+
+  // Place them on the absolute timeline:
+  const double event_time = _compute_stream_event_time_(sim_data_);
+  std::vector<std::string> categories;
+  event_signal_data.build_list_of_categories(categories);
+  for (const auto &category : categories) {
+    for (std::size_t isig = 0; isig < event_signal_data.get_number_of_signals(category); isig++) {
+      const mctools::signal::base_signal &signal = event_signal_data.get_signal(category, isig);
+      double time_ref = signal.get_time_ref();
+      if (!datatools::is_valid(time_ref)) {
+        time_ref = 0.0;
+      }
+      _stream_buffer_.push(signal, event_time + time_ref);
+    }
+  }
+
+  // Emit the frames closed by the current event:
+  _stream_buffer_.advance(event_time, sim_signal_data_);
   return;
 }
 
@@ -7,7 +7,13 @@
 #define FALAISE_ASB_PLUGIN_SNEMO_ASB_ANALOG_SIGNAL_BUILDER_MODULE_H
 
 // Standard library:
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 // Third party:
 // - Bayeux/datatools:
@@ -20,6 +26,14 @@
 
 // This project:
 #include <falaise/snemo/asb/base_signal_generator_driver.h>
+#include <falaise/snemo/asb/channel_map.h>
+#include <falaise/snemo/asb/fixed_point_codec.h>
+#include <falaise/snemo/asb/result_cache.h>
+#include <falaise/snemo/asb/shape_prototype_dictionary.h>
+#include <falaise/snemo/asb/signal_staging_bank.h>
+#include <falaise/snemo/asb/signal_stream_buffer.h>
+#include <falaise/snemo/asb/span_recorder.h>
+#include <falaise/snemo/asb/trigger_primitive_builder.h>
 
 namespace snemo {
 
@@ -33,6 +47,15 @@ class analog_signal_builder_module : public dpp::base_module {
   struct driver_entry;
   typedef std::map<std::string, driver_entry> driver_dict_type;
 
+  /// Executor of the per-driver jobs of an event
+  ///
+  /// The executor receives the simulated data of the event and one job per
+  /// driver; it must run all the jobs, in any order and possibly
+  /// concurrently, before returning.
+  typedef std::function<void(const mctools::simulated_data &,
+                             std::vector<std::function<void()>> &)>
+      driver_executor_type;
+
   /// Constructor
   analog_signal_builder_module(datatools::logger::priority = datatools::logger::PRIO_FATAL);
 
@@ -45,29 +68,85 @@ class analog_signal_builder_module : public dpp::base_module {
   /// \code
   /// SD_label  : string = "SD"
   /// SSD_label : string = "SSD"
+  /// EH_label  : string = "EH"
   /// Geo_label : string = "Geo"
   /// abort_at_missing_input : boolean = true
   /// abort_at_former_output : boolean = false
   /// preserve_former_output : boolean = false
+  /// incremental_mode : boolean = false
   ///
-  /// drivers : string[4] = "calo" "xcalo" "gveto" "gg"
-  ///
-  /// driver.calo.type_id : string = "snemo::asb::calo_signal_builder"
-  /// driver.calo.config.gain : real = 1.2e5
-  /// driver.calo.config.db_access : boolean = true
+  /// drivers : string[2] = "scin" "gg"
   ///
-  /// driver.xcalo.type_id : string = "snemo::asb::calo_signal_builder"
-  /// driver.xcalo.config.gain : real = 0.95e5
-  /// driver.xcalo.config.db_access : boolean = true
-  ///
-  /// driver.gveto.type_id : string = "snemo::asb::calo_signal_builder"
-  /// driver.gveto.config.gain : real = 0.93e5
-  /// driver.gveto.config.db_access : boolean = true
+  /// # Calorimeter, X-wall and gamma veto processed in a single pass:
+  /// driver.scin.type_id : string = "snemo::asb::scin_signal_generator_driver"
+  /// driver.scin.config.signal_category : string = "scin"
+  /// driver.scin.config.categories : string[3] = "calo" "xcalo" "gveto"
+  /// driver.scin.config.mode : string = "triangle"
   ///
   /// driver.gg.type_id : string = "snemo::asb::tracker_signal_builder"
   /// driver.gg.config.gain : real = 0.93e5
   /// driver.gg.config.db_access : boolean = true
   ///
+  /// # Continuous-stream pile-up mode (the frames still open after the last
+  /// # event are emitted by flush_stream):
+  /// stream_mode : boolean = false
+  /// stream.window : real as time = 1 us
+  /// stream.event_period : real as time = 1 ms
+  /// stream.random_spacing : boolean = true
+  /// stream.seed : integer = 314159
+  /// stream.use_sd_time : boolean = false
+  ///
+  /// # On-disk cache of driver outputs:
+  /// cache.enabled : boolean = false
+  /// cache.directory : string as path = "/tmp/${USER}/asb_cache"
+  /// cache.max_size : integer = 1024 # MB
+  /// # Digest of the input file, part of the keys of the cache entries. The
+  /// # flasb runner computes it from its input file when not set; otherwise
+  /// # the entries are keyed by the driver configurations and step hits only:
+  /// cache.input_digest : string = "Se82_0nubb-source_strips_bulk_SD_10_events"
+  ///
+  /// # Channel map derived from the geometry, handed over to the drivers and
+  /// # memory-mapped from a cache file keyed by a digest of the geometry when
+  /// # available:
+  /// channel_map.enabled : boolean = false
+  /// channel_map.cache_directory : string as path = "/tmp/${USER}/asb_cache"
+  ///
+  /// # Trigger primitives (threshold crossings, peaks and coincidences)
+  /// # stored as a summary properties bank, in all the events:
+  /// trigger.enabled : boolean = false
+  /// trigger.bank_label : string = "TP"
+  /// trigger.threshold : real as electric_potential = 50 mV
+  /// trigger.coincidence_window : real as time = 50 ns
+  /// trigger.multiplicity : integer = 1
+  ///
+  /// # Timeline of the events, drivers and processing phases, written at
+  /// # reset in Chrome trace-event format (chrome://tracing, Perfetto):
+  /// trace.filename : string as path = "asb_trace.json"
+  ///
+  /// # Signals sorted by channel and start time, with a channel and time
+  /// # index stored in the bank auxiliaries (see snemo::asb::signal_index):
+  /// index.enabled : boolean = false
+  ///
+  /// # Compact triangle signals referring to the shape prototypes of the run
+  /// # (stored in the bank auxiliaries) instead of carrying all their
+  /// # constant shape parameters:
+  /// compact_shapes : boolean = false
+  ///
+  /// # Shape times stored as fixed-point integers and amplitudes as signed
+  /// # 16-bit codes of the full scale (codec stored in the bank auxiliaries):
+  /// fixed_point.enabled : boolean = false
+  /// fixed_point.time_resolution : real as time = 10 ps
+  /// fixed_point.amplitude_full_scale : real as electric_potential = 4 V
+  ///
+  /// # Per-event memory accounting of the drivers and of the output bank,
+  /// # with a budget (in MB, 0: no budget) on the estimated memory of the
+  /// # active drivers. Over budget, the drivers switch to their degraded
+  /// # mode when they have one; the others are run anyway ("degrade") or
+  /// # skipped ("skip"):
+  /// memory.accounting : boolean = false
+  /// memory.budget : integer = 512
+  /// memory.policy : string = "degrade"
+  ///
   /// \endcode
   ///
   ///
@@ -123,6 +202,12 @@ class analog_signal_builder_module : public dpp::base_module {
   /// Getting geometry manager
   const geomtools::manager &get_geometry_manager() const;
 
+  /// Check if the channel map is available
+  bool has_channel_map() const;
+
+  /// Return the channel map
+  const channel_map &get_channel_map() const;
+
   bool is_abort_at_missing_input() const;
   void set_abort_at_missing_input(bool);
   bool is_abort_at_former_output() const;
@@ -130,6 +215,52 @@ class analog_signal_builder_module : public dpp::base_module {
   bool is_preserve_former_output() const;
   void set_preserve_former_output(bool);
 
+  /// Check the incremental reprocessing mode
+  ///
+  /// In incremental mode, the configuration and input digests of each driver
+  /// are recorded in the auxiliaries of the output bank, with its output
+  /// categories. A driver is skipped when both digests match those of a
+  /// former processing, otherwise only its own signal categories are
+  /// replaced. Drivers are selected as in the other modes: the output of the
+  /// drivers without input, skipped by the memory budget or removed since the
+  /// former processing is dropped. Incremental mode reprocesses former output by design and
+  /// cannot be combined with abort_at_former_output.
+  bool is_incremental_mode() const;
+
+  /// Set the incremental reprocessing mode
+  void set_incremental_mode(bool);
+
+  /// Check the on-disk cache of driver outputs
+  bool has_cache() const;
+
+  /// Return the on-disk cache of driver outputs
+  const result_cache &get_cache() const;
+
+  /// Check the continuous-stream pile-up mode
+  bool is_stream_mode() const;
+
+  /// Set the continuous-stream pile-up mode
+  void set_stream_mode(bool);
+
+  /// Return the stream buffer
+  const signal_stream_buffer &get_stream_buffer() const;
+
+  /// Close the frames still open at the end of the stream and emit their signals
+  ///
+  /// The signals are added to the output bank of a final record, with the
+  /// same post-processing as the processed records. Without a flush, the
+  /// open frames are discarded at reset. Return the number of flushed signals.
+  std::size_t flush_stream(datatools::things &data_record_);
+
+  /// Set the executor of the per-driver jobs (empty: sequential processing)
+  ///
+  /// With an executor, each driver fills its own partial signal data, which
+  /// is staged and finally merged into the output bank in driver order,
+  /// whatever the scheduling of the jobs: the output bank is the one of the
+  /// sequential processing. This does not apply to the stream and
+  /// incremental modes.
+  void set_driver_executor(const driver_executor_type &executor_);
+
   /// Check if a driver with given name is set
   bool has_driver(const std::string &name_) const;
 
@@ -140,6 +271,12 @@ class analog_signal_builder_module : public dpp::base_module {
   /// Remove a driver
   void remove_driver(const std::string &name_);
 
+  /// Check if the memory accounting is enabled
+  bool has_memory_accounting() const;
+
+  /// Print the memory high-water marks of the drivers and of the output bank
+  void print_memory_report(std::ostream &out_) const;
+
  private:
   void _init_drivers_(const datatools::properties &setup_,
                       datatools::service_manager &service_manager_);
@@ -148,6 +285,43 @@ class analog_signal_builder_module : public dpp::base_module {
   void _process_(const mctools::simulated_data &sim_data_,
                  mctools::signal::signal_data &analog_signal_builder_data_);
 
+  /// Select the drivers with some input step hits in the current event
+  void _select_active_drivers_(const mctools::simulated_data &sim_data_);
+
+  /// Switch the active drivers to degraded mode, or skip them, if the
+  /// estimated memory of the event exceeds the budget
+  void _apply_memory_budget_(const mctools::simulated_data &sim_data_);
+
+  /// Run the post-processing of an output bank (trigger, index, compaction, encoding)
+  void _finalize_output_(mctools::signal::signal_data &sim_signal_data_,
+                         datatools::things &data_record_);
+
+  /// Build the trigger primitives of a bank and store their summary in the event record
+  void _export_trigger_summary_(const mctools::signal::signal_data &analog_signal_builder_data_,
+                                datatools::things &data_record_);
+
+  /// Account the memory used by the drivers and the output bank in the current event
+  void _account_memory_(mctools::signal::signal_data &sim_signal_data_);
+
+  /// Place the current event on the absolute timeline of the stream
+  double _compute_stream_event_time_(const mctools::simulated_data &sim_data_);
+
+  /// Run one driver, possibly reusing its cached output
+  void _process_driver_(driver_entry &driver_entry_, const mctools::simulated_data &sim_data_,
+                        mctools::signal::signal_data &analog_signal_builder_data_);
+
+  /// Incremental process function
+  void _process_incremental_(const mctools::simulated_data &sim_data_,
+                             mctools::signal::signal_data &analog_signal_builder_data_);
+
+  /// Remove the former output and digests of a driver from an incremental bank
+  void _drop_former_driver_output_(const std::string &driver_name_,
+                                   mctools::signal::signal_data &analog_signal_builder_data_);
+
+  /// Stream process function
+  void _process_stream_(const mctools::simulated_data &sim_data_,
+                        mctools::signal::signal_data &analog_signal_builder_data_);
+
   /// Give default values to specific class members.
   void _set_defaults_();
 
@@ -157,14 +331,50 @@ class analog_signal_builder_module : public dpp::base_module {
   std::string _SSD_label_;  //!< The label of the output simulated signal data bank
   std::string _Geo_label_;  //!< The label of the geometry service
   std::string _Db_label_;   //!< The label of the database service
+  std::string _EH_label_;   //!< The label of the event header bank
   bool _abort_at_missing_input_ = true;
   bool _abort_at_former_output_ = false;
   bool _preserve_former_output_ = false;
+  bool _incremental_mode_ = false;   //!< Incremental reprocessing mode
+  bool _stream_mode_ = false;        //!< Continuous-stream pile-up mode
+  double _stream_event_period_;      //!< Mean time between consecutive events in stream mode
+  bool _stream_random_spacing_ = true;  //!< Poisson spacing of events in stream mode
+  bool _stream_use_sd_time_ = false;    //!< Use the SD event time in stream mode
+  unsigned int _stream_seed_ = 314159;  //!< Seed of the event spacing PRNG
+  std::string _cache_input_digest_;     //!< Digest of the input file for the cache keys
+  std::string _trace_filename_;         //!< Name of the trace-event file
+  bool _trigger_enabled_ = false;       //!< Build the trigger primitives
+  std::string _TP_label_;               //!< The label of the trigger primitive summary bank
+  bool _index_enabled_ = false;         //!< Sort and index the output signals
+  bool _compact_shapes_ = false;        //!< Compact signals referring to shape prototypes
+  bool _fixed_point_enabled_ = false;   //!< Reduced-precision storage of the shape parameters
+  bool _memory_accounting_ = false;     //!< Per-event memory accounting
+  std::size_t _memory_budget_ = 0;      //!< Memory budget of an event (in bytes, 0: none)
+  bool _memory_skip_policy_ = false;    //!< Skip the drivers without degraded mode over budget
 
   // Working data:
   const geomtools::manager *_geometry_manager_ = nullptr;  //!< The geometry manager
   // const snemo::XXX::manager * _database_manager_ = nullptr; //!< The database manager
   driver_dict_type _drivers_;  //!< Dictionary of drivers (embedded generator of signal hits)
+  std::vector<driver_entry *> _active_drivers_;  //!< Drivers with some input in the current event
+  signal_stream_buffer _stream_buffer_;  //!< Sliding buffer of signals in stream mode
+  double _stream_last_event_time_;       //!< Absolute time of the last streamed event
+  std::mt19937 _stream_prng_;            //!< PRNG for the spacing of events in stream mode
+  result_cache _cache_;                  //!< On-disk cache of driver outputs
+  channel_map _channel_map_;             //!< Channel map derived from the geometry
+  std::unique_ptr<span_recorder> _span_recorder_;  //!< Recorder of the timeline spans
+  trigger_primitive_builder _trigger_builder_;     //!< Builder of the trigger primitives
+  shape_prototype_dictionary _shape_prototypes_;   //!< Shape prototypes of the run
+  fixed_point_codec _fixed_point_codec_;           //!< Codec of the shape parameters
+  std::vector<std::string> _degraded_drivers_;  //!< Drivers degraded in the current event
+  std::vector<std::string> _skipped_drivers_;   //!< Drivers skipped in the current event
+  std::map<std::string, std::size_t> _driver_memory_peaks_;  //!< Memory high-water marks
+  std::size_t _bank_memory_peak_ = 0;           //!< Memory high-water mark of the output bank
+  std::size_t _over_budget_events_ = 0;         //!< Number of events over the memory budget
+  int _event_counter_ = 0;               //!< Number of processed event records
+  int _current_event_number_ = -1;       //!< Number of the current event
+  driver_executor_type _driver_executor_;  //!< Executor of the per-driver jobs
+  signal_staging_bank _staging_bank_;      //!< Per-driver staging of signals for the executor
 
   // Macro to automate the registration of the module :
   DPP_MODULE_REGISTRATION_INTERFACE(analog_signal_builder_module)
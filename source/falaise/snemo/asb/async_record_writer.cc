@@ -0,0 +1,203 @@
+// async_record_writer.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/async_record_writer.h>
+
+// Standard library:
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/properties.h>
+
+namespace snemo {
+
+namespace asb {
+
+async_record_writer::async_record_writer() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  return;
+}
+
+async_record_writer::~async_record_writer() {
+  if (is_open()) {
+    try {
+      close();
+    } catch (...) {
+      // Nothing to do in a destructor.
+    }
+  }
+  return;
+}
+
+void async_record_writer::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+void async_record_writer::set_buffer_capacity(std::size_t capacity_) {
+  DT_THROW_IF(is_open(), std::logic_error, "Writer is already open!");
+  DT_THROW_IF(capacity_ == 0, std::domain_error, "Invalid null buffer capacity!");
+  _buffer_capacity_ = capacity_;
+  return;
+}
+
+std::size_t async_record_writer::get_buffer_capacity() const { return _buffer_capacity_; }
+
+void async_record_writer::open(const std::string& filename_) {
+  DT_THROW_IF(is_open(), std::logic_error, "Writer is already open!");
+  datatools::properties output_config;
+  output_config.store("logging.priority", datatools::logger::get_priority_label(_logging_priority_));
+  output_config.store("files.mode", "single");
+  output_config.store("files.single.filename", filename_);
+  _output_.initialize_standalone(output_config);
+  _front_.clear();
+  _front_.reserve(_buffer_capacity_);
+  _back_.clear();
+  _back_.reserve(_buffer_capacity_);
+  _back_pending_ = false;
+  _closing_ = false;
+  _failure_ = nullptr;
+  _stats_ = stats_type();
+  _thread_ = std::thread(&async_record_writer::_writer_loop_, this);
+  return;
+}
+
+bool async_record_writer::is_open() const { return _thread_.joinable(); }
+
+void async_record_writer::write(std::unique_ptr<datatools::things>&& record_) {
+  DT_THROW_IF(!is_open(), std::logic_error, "Writer is not open!");
+  _front_.push_back(std::move(record_));
+  if (_front_.size() >= _buffer_capacity_) {
+    _hand_over_();
+  }
+  return;
+}
+
+void async_record_writer::close() {
+  if (!is_open()) {
+    return;
+  }
+  std::exception_ptr failure;
+  try {
+    if (!_front_.empty()) {
+      _hand_over_();
+    }
+  } catch (...) {
+    failure = std::current_exception();
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    _closing_ = true;
+  }
+  _back_ready_.notify_one();
+  _thread_.join();
+  _front_.clear();
+  _back_.clear();
+  _output_.reset();
+  if (!failure) {
+    failure = _failure_;
+  }
+  _failure_ = nullptr;
+  DT_LOG_DEBUG(_logging_priority_, "Wrote " << _stats_.written_records << " records in "
+                                            << _stats_.flushed_buffers << " buffers; stall="
+                                            << _stats_.stall_time << " s");
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return;
+}
+
+async_record_writer::stats_type async_record_writer::get_stats() const {
+  std::lock_guard<std::mutex> lock(_mutex_);
+  return _stats_;
+}
+
+void async_record_writer::_hand_over_() {
+  std::unique_lock<std::mutex> lock(_mutex_);
+  if (_back_pending_ && !_failure_) {
+    // Backpressure: the writer is still busy with the previous buffer.
+    const auto start = std::chrono::steady_clock::now();
+    _back_done_.wait(lock, [this] { return !_back_pending_ || _failure_; });
+    _stats_.stall_time +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    _stats_.stalls++;
+  }
+  if (_failure_) {
+    std::rethrow_exception(_failure_);
+  }
+  // The back buffer has been emptied by the writer, keeping its storage:
+  std::swap(_front_, _back_);
+  _back_pending_ = true;
+  _stats_.flushed_buffers++;
+  lock.unlock();
+  _back_ready_.notify_one();
+  return;
+}
+
+void async_record_writer::_writer_loop_() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(_mutex_);
+    _back_ready_.wait(lock, [this] { return _back_pending_ || _closing_; });
+    if (!_back_pending_) {
+      break;
+    }
+    lock.unlock();
+    // The producer does not touch the back buffer while it is pending:
+    const auto start = std::chrono::steady_clock::now();
+    std::exception_ptr failure;
+    std::size_t written = 0;
+    try {
+      for (auto& record : _back_) {
+        // The output module reports some failures by status only:
+        const dpp::base_module::process_status status = _output_.process(*record);
+        DT_THROW_IF(status != dpp::base_module::PROCESS_OK, std::runtime_error,
+                    "Cannot write record #" << _stats_.written_records + written << "!");
+        written++;
+      }
+    } catch (...) {
+      failure = std::current_exception();
+    }
+    _back_.clear();
+    const double write_time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    lock.lock();
+    _stats_.written_records += written;
+    _stats_.write_time += write_time;
+    _back_pending_ = false;
+    if (failure) {
+      _failure_ = failure;
+    }
+    lock.unlock();
+    _back_done_.notify_one();
+    if (failure) {
+      break;
+    }
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,116 @@
+// snemo/asb/async_record_writer.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-03
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_ASYNC_RECORD_WRITER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_ASYNC_RECORD_WRITER_H
+
+// Standard library:
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+#include <bayeux/datatools/things.h>
+// - Bayeux/dpp:
+#include <bayeux/dpp/output_module.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Double-buffered writer of event records in a background thread
+///
+/// Records are appended to a front buffer by the producer. When it is full,
+/// the front buffer is swapped with the back buffer, which a background
+/// thread serializes (and compresses, depending on the file extension)
+/// through a dpp::output_module. The producer thus only waits when the
+/// writer falls behind by a whole buffer; this backpressure is measured as
+/// the stall time.
+class async_record_writer : private boost::noncopyable {
+ public:
+  /// \brief Statistics of the writer
+  struct stats_type {
+    std::size_t written_records = 0;  //!< Number of written records
+    std::size_t flushed_buffers = 0;  //!< Number of buffers handed to the background thread
+    std::size_t stalls = 0;           //!< Number of times the producer waited for the writer
+    double stall_time = 0.0;          //!< Time the producer waited for the writer (in seconds)
+    double write_time = 0.0;          //!< Time spent serializing records (in seconds)
+  };
+
+  /// Constructor
+  async_record_writer();
+
+  /// Destructor
+  ~async_record_writer();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Set the number of records per buffer
+  void set_buffer_capacity(std::size_t capacity_);
+
+  /// Return the number of records per buffer
+  std::size_t get_buffer_capacity() const;
+
+  /// Open the output file and start the background thread
+  void open(const std::string& filename_);
+
+  /// Check if the writer is open
+  bool is_open() const;
+
+  /// Append a record, waiting if both buffers are busy
+  ///
+  /// An exception thrown by the background thread is rethrown here.
+  void write(std::unique_ptr<datatools::things>&& record_);
+
+  /// Write all the pending records, stop the background thread and close the file
+  ///
+  /// An exception thrown by the background thread is rethrown here.
+  void close();
+
+  /// Return the statistics of the writer
+  stats_type get_stats() const;
+
+ private:
+  typedef std::vector<std::unique_ptr<datatools::things>> buffer_type;
+
+  void _hand_over_();
+  void _writer_loop_();
+
+ private:
+  datatools::logger::priority _logging_priority_;
+  std::size_t _buffer_capacity_ = 16;  //!< Number of records per buffer
+  dpp::output_module _output_;         //!< Output module
+  std::thread _thread_;                //!< Background writer thread
+  mutable std::mutex _mutex_;          //!< Protects the back buffer and the state
+  std::condition_variable _back_ready_;  //!< Signals a new back buffer to the writer
+  std::condition_variable _back_done_;   //!< Signals an empty back buffer to the producer
+  buffer_type _front_;                 //!< Buffer filled by the producer
+  buffer_type _back_;                  //!< Buffer written by the background thread
+  bool _back_pending_ = false;         //!< The back buffer waits for being written
+  bool _closing_ = false;              //!< Close request
+  std::exception_ptr _failure_;        //!< Exception thrown by the background thread
+  stats_type _stats_;                  //!< Statistics
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_ASYNC_RECORD_WRITER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -30,10 +30,31 @@
 #include <bayeux/datatools/exception.h>
 #include <bayeux/datatools/properties.h>
 
+// This project:
+#include <snemo/asb/utils.h>
+
 namespace snemo {
 
 namespace asb {
 
+namespace {
+
+// Scope in which a driver is processing events, from a single thread
+class processing_guard {
+ public:
+  processing_guard(std::atomic<bool>& flag_, const std::string& id_) : _flag_(flag_) {
+    DT_THROW_IF(_flag_.exchange(true), std::logic_error,
+                "Driver '" << id_ << "' is already processing events in another thread !");
+  }
+
+  ~processing_guard() { _flag_.store(false); }
+
+ private:
+  std::atomic<bool>& _flag_;
+};
+
+}  // namespace
+
 DATATOOLS_FACTORY_SYSTEM_REGISTER_IMPLEMENTATION(
     base_signal_generator_driver, "snemo::asb::base_signal_generator_driver/__system__")
 
@@ -86,6 +107,76 @@ void base_signal_generator_driver::set_signal_category(const std::string& catego
   return;
 }
 
+category_registry::id_type base_signal_generator_driver::get_signal_category_id() const {
+  return _signal_category_id_;
+}
+
+const std::vector<category_registry::id_type>&
+base_signal_generator_driver::get_input_category_ids() const {
+  return _input_category_ids_;
+}
+
+std::size_t base_signal_generator_driver::estimate_event_memory(
+    const mctools::simulated_data& sim_data_) const {
+  // Coarse upper bound, cheap enough to be evaluated before each event: each
+  // hit gives an atomic signal and an output signal, both carrying about six
+  // shape parameters (type, polarity, times and amplitude). A shape parameter
+  // costs about 128 bytes in the auxiliary properties: map node, value
+  // holder, key and description, as in signal_utils::estimate_memory. The
+  // per-event accounting of the module reports the actual bank sizes.
+  static const std::size_t number_of_shape_parameters = 6;
+  static const std::size_t bytes_per_shape_parameter = 128;
+  static const std::size_t bytes_per_hit =
+      2 * (sizeof(mctools::signal::base_signal) +
+           number_of_shape_parameters * bytes_per_shape_parameter);
+  std::size_t number_of_hits = 0;
+  for (const category_registry::id_type category_id : _input_category_ids_) {
+    const mctools::simulated_data::hit_handle_collection_type* hits =
+        _find_step_hits(sim_data_, category_id);
+    if (hits != nullptr) {
+      number_of_hits += hits->size();
+    }
+  }
+  return number_of_hits * bytes_per_hit;
+}
+
+std::size_t base_signal_generator_driver::get_working_memory() const { return 0; }
+
+bool base_signal_generator_driver::has_degraded_mode() const { return false; }
+
+void base_signal_generator_driver::set_degraded_mode(bool degraded_) {
+  _degraded_mode_ = degraded_;
+  return;
+}
+
+bool base_signal_generator_driver::is_degraded_mode() const { return _degraded_mode_; }
+
+bool base_signal_generator_driver::has_input(const mctools::simulated_data& sim_data_) const {
+  for (const category_registry::id_type category_id : _input_category_ids_) {
+    const mctools::simulated_data::hit_handle_collection_type* hits =
+        _find_step_hits(sim_data_, category_id);
+    if (hits != nullptr && !hits->empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void base_signal_generator_driver::build_list_of_input_categories(
+    std::vector<std::string>& categories_) const {
+  // By default, the signal category is also the step hit category:
+  categories_.clear();
+  categories_.push_back(_signal_category_);
+  return;
+}
+
+void base_signal_generator_driver::build_list_of_output_categories(
+    std::vector<std::string>& categories_) const {
+  categories_.clear();
+  categories_.push_back(_signal_category_);
+  return;
+}
+
 bool base_signal_generator_driver::has_geo_manager() const { return _geo_manager_ != nullptr; }
 
 void base_signal_generator_driver::set_geo_manager(const geomtools::manager& mgr_) {
@@ -98,6 +189,25 @@ const geomtools::manager& base_signal_generator_driver::get_geo_manager() const
   return *_geo_manager_;
 }
 
+bool base_signal_generator_driver::has_channel_map() const { return _channel_map_ != nullptr; }
+
+void base_signal_generator_driver::set_channel_map(const channel_map& map_) {
+  _channel_map_ = &map_;
+  return;
+}
+
+const channel_map& base_signal_generator_driver::get_channel_map() const {
+  DT_THROW_IF(!has_channel_map(), std::logic_error, "Missing channel map !");
+  return *_channel_map_;
+}
+
+void base_signal_generator_driver::set_span_recorder(span_recorder* recorder_) {
+  _span_recorder_ = recorder_;
+  return;
+}
+
+span_recorder* base_signal_generator_driver::get_span_recorder() const { return _span_recorder_; }
+
 bool base_signal_generator_driver::is_initialized() const { return _initialized_; }
 
 void base_signal_generator_driver::_set_initialized_(bool i_) {
@@ -128,8 +238,18 @@ void base_signal_generator_driver::initialize(const datatools::properties& confi
 
   DT_THROW_IF(_signal_category_.empty(), std::logic_error, "Missing signal category!");
 
+  span_recorder::scope span(_span_recorder_, "initialize " + _id_, "driver");
   _initialize(config_);
 
+  // Resolve the categories once for all:
+  _signal_category_id_ = category_registry::intern(_signal_category_);
+  std::vector<std::string> input_categories;
+  build_list_of_input_categories(input_categories);
+  _input_category_ids_.clear();
+  for (const auto& category : input_categories) {
+    _input_category_ids_.push_back(category_registry::intern(category));
+  }
+
   _set_initialized_(true);
   return;
 }
@@ -138,16 +258,56 @@ void base_signal_generator_driver::reset() {
   DT_THROW_IF(!is_initialized(), std::logic_error, "Not initialized !");
   _set_initialized_(false);
   _reset();
+  _signal_category_id_ = category_registry::INVALID_ID;
+  _input_category_ids_.clear();
   return;
 }
 
 void base_signal_generator_driver::process(const mctools::simulated_data& sim_data_,
                                            mctools::signal::signal_data& sim_signal_data_) {
   DT_THROW_IF(!is_initialized(), std::logic_error, "Not initialized !");
+  processing_guard guard(_processing_, _id_);
   _process(sim_data_, sim_signal_data_);
   return;
 }
 
+void base_signal_generator_driver::process_batch(
+    const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+    const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Not initialized !");
+  DT_THROW_IF(sim_data_batch_.size() != sim_signal_data_batch_.size(), std::logic_error,
+              "Unmatching sizes of input and output batches !");
+  processing_guard guard(_processing_, _id_);
+  _process_batch(sim_data_batch_, sim_signal_data_batch_);
+  return;
+}
+
+const mctools::simulated_data::hit_handle_collection_type*
+base_signal_generator_driver::_find_step_hits(const mctools::simulated_data& sim_data_,
+                                              category_registry::id_type category_id_) {
+  const std::string& category = category_registry::get_label(category_id_);
+  if (!sim_data_.has_step_hits(category)) {
+    return nullptr;
+  }
+  return &sim_data_.get_step_hits(category);
+}
+
+mctools::signal::signal_data::signal_handle_collection_type&
+base_signal_generator_driver::_grab_output_signals(
+    mctools::signal::signal_data& sim_signal_data_) const {
+  return signal_utils::grab_signal_collection(sim_signal_data_,
+                                              category_registry::get_label(_signal_category_id_));
+}
+
+void base_signal_generator_driver::_process_batch(
+    const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+    const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_) {
+  for (std::size_t ievent = 0; ievent < sim_data_batch_.size(); ievent++) {
+    _process(*sim_data_batch_[ievent], *sim_signal_data_batch_[ievent]);
+  }
+  return;
+}
+
 void base_signal_generator_driver::tree_dump(std::ostream& out_, const std::string& title_,
                                              const std::string& indent_, bool inherit_) const {
   if (!title_.empty()) {
@@ -171,6 +331,14 @@ void base_signal_generator_driver::tree_dump(std::ostream& out_, const std::stri
   }
   out_ << std::endl;
 
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Channel map : ";
+  if (has_channel_map()) {
+    out_ << get_channel_map().size() << " channels";
+  } else {
+    out_ << "<no>";
+  }
+  out_ << std::endl;
+
   out_ << indent_ << datatools::i_tree_dumpable::inherit_tag(inherit_)
        << "Initialized : " << is_initialized() << std::endl;
 
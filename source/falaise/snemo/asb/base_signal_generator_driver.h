@@ -6,6 +6,9 @@
 #ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_BASE_SIGNAL_GENERATOR_DRIVER_H
 #define FALAISE_ASB_PLUGIN_SNEMO_ASB_BASE_SIGNAL_GENERATOR_DRIVER_H
 
+// Standard library:
+#include <atomic>
+
 // Third party:
 // - Bayeux/datatools:
 #include <bayeux/datatools/factory_macros.h>
@@ -19,11 +22,20 @@
 #include <bayeux/mctools/signal/signal_data.h>
 #include <bayeux/mctools/simulated_data.h>
 
+// This project:
+#include <snemo/asb/category_registry.h>
+#include <snemo/asb/channel_map.h>
+#include <snemo/asb/span_recorder.h>
+
 namespace snemo {
 
 namespace asb {
 
 //! \brief Base class for signal generator driver classes
+//!
+//! A driver is not reentrant: its working buffers are reused from one event
+//! to the next. Distinct drivers may run concurrently, but a given driver
+//! must be run by one thread at a time; a concurrent call throws.
 class base_signal_generator_driver : public datatools::i_tree_dumpable {
  public:
   /// Constructor
@@ -56,6 +68,39 @@ class base_signal_generator_driver : public datatools::i_tree_dumpable {
   /// Return the signal category
   const std::string& get_signal_category() const;
 
+  /// Return the interned ID of the signal category (resolved at initialization)
+  category_registry::id_type get_signal_category_id() const;
+
+  /// Return the interned IDs of the step hit categories consumed by the algorithm
+  const std::vector<category_registry::id_type>& get_input_category_ids() const;
+
+  /// Build the list of step hit categories consumed by the algorithm
+  virtual void build_list_of_input_categories(std::vector<std::string>& categories_) const;
+
+  /// Estimate the memory needed to process an event (in bytes)
+  virtual std::size_t estimate_event_memory(const mctools::simulated_data& sim_data_) const;
+
+  /// Return the memory held by the working buffers of the algorithm (in bytes)
+  virtual std::size_t get_working_memory() const;
+
+  /// Check if the algorithm supports a degraded mode using less memory
+  virtual bool has_degraded_mode() const;
+
+  /// Set the degraded mode for the next processed events
+  void set_degraded_mode(bool degraded_);
+
+  /// Check the degraded mode
+  bool is_degraded_mode() const;
+
+  /// Check if an event has step hits in any of the categories consumed by the algorithm
+  ///
+  /// This is a cheap pre-filter: an algorithm with no input produces no signal
+  /// and needs not be run.
+  bool has_input(const mctools::simulated_data& sim_data_) const;
+
+  /// Build the list of signal categories produced by the algorithm
+  virtual void build_list_of_output_categories(std::vector<std::string>& categories_) const;
+
   /// Check geometry manager
   bool has_geo_manager() const;
 
@@ -65,6 +110,21 @@ class base_signal_generator_driver : public datatools::i_tree_dumpable {
   /// Return the geometry manager
   const geomtools::manager& get_geo_manager() const;
 
+  /// Check the channel map
+  bool has_channel_map() const;
+
+  /// Set the channel map derived from the geometry
+  void set_channel_map(const channel_map& map_);
+
+  /// Return the channel map
+  const channel_map& get_channel_map() const;
+
+  /// Set the recorder of the timeline spans (null: no tracing)
+  void set_span_recorder(span_recorder* recorder_);
+
+  /// Return the recorder of the timeline spans, if any
+  span_recorder* get_span_recorder() const;
+
   /// Check if the algorithm is initialized
   bool is_initialized() const;
 
@@ -75,9 +135,17 @@ class base_signal_generator_driver : public datatools::i_tree_dumpable {
   void reset();
 
   /// Run the algorithm
+  ///
+  /// Throws if the driver is already processing events in another thread.
   void process(const mctools::simulated_data& sim_data_,
                mctools::signal::signal_data& sim_signal_data_);
 
+  /// Run the algorithm on a batch of events
+  ///
+  /// The i-th output bank is filled from the i-th input event.
+  void process_batch(const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+                     const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_);
+
   // Smart print
   virtual void tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
                          const std::string& indent_ = "", bool inherit_ = false) const;
@@ -96,6 +164,24 @@ class base_signal_generator_driver : public datatools::i_tree_dumpable {
   virtual void _process(const mctools::simulated_data& sim_data_,
                         mctools::signal::signal_data& sim_signal_data_) = 0;
 
+  /// Return the step hits of an interned category, or nullptr if there is none
+  ///
+  /// Processing loops should resolve the collection once per event and then
+  /// index it, without further category lookups.
+  static const mctools::simulated_data::hit_handle_collection_type* _find_step_hits(
+      const mctools::simulated_data& sim_data_, category_registry::id_type category_id_);
+
+  /// Return the output collection of signals of the driver, creating it if needed
+  mctools::signal::signal_data::signal_handle_collection_type& _grab_output_signals(
+      mctools::signal::signal_data& sim_signal_data_) const;
+
+  /// Run the algorithm on a batch of events
+  ///
+  /// The default implementation runs the algorithm event by event.
+  virtual void _process_batch(
+      const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+      const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_);
+
   // Smart print
   virtual void _tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
                           const std::string& indent_ = "", bool inherit_ = false) const = 0;
@@ -113,6 +199,15 @@ class base_signal_generator_driver : public datatools::i_tree_dumpable {
   std::string _id_;                                   //!< Identifier of the algorithm
   std::string _signal_category_;                      //!< Identifier of the signal category
   const geomtools::manager* _geo_manager_ = nullptr;  //!< Geometry manager
+  const channel_map* _channel_map_ = nullptr;         //!< Channel map derived from the geometry
+  span_recorder* _span_recorder_ = nullptr;           //!< Recorder of the timeline spans
+  bool _degraded_mode_ = false;                       //!< Degraded mode using less memory
+
+  // Working data:
+  std::atomic<bool> _processing_{false};  //!< Flag set while processing events
+  category_registry::id_type _signal_category_id_ =
+      category_registry::INVALID_ID;  //!< Interned signal category
+  std::vector<category_registry::id_type> _input_category_ids_;  //!< Interned input categories
 
   // Factory stuff :
   DATATOOLS_FACTORY_SYSTEM_REGISTER_INTERFACE(base_signal_generator_driver)
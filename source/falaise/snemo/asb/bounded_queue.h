@@ -0,0 +1,149 @@
+// snemo/asb/bounded_queue.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-20
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_BOUNDED_QUEUE_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_BOUNDED_QUEUE_H
+
+// Standard library:
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Blocking FIFO queue with bounded capacity between pipeline stages
+///
+/// Producers block while the queue is full, consumers block while it is
+/// empty. Closing the queue wakes up everybody: pending items can still be
+/// popped, but no new item is accepted.
+template <typename T>
+class bounded_queue : private boost::noncopyable {
+ public:
+  /// Constructor
+  explicit bounded_queue(std::size_t capacity_) : _capacity_(capacity_) {
+    if (_capacity_ == 0) {
+      throw std::logic_error("snemo::asb::bounded_queue: Invalid null capacity!");
+    }
+    return;
+  }
+
+  /// Return the capacity
+  std::size_t get_capacity() const { return _capacity_; }
+
+  /// Push an item, waiting for a free slot
+  ///
+  /// Return false if the queue has been closed.
+  bool push(T&& item_) {
+    std::unique_lock<std::mutex> lock(_mutex_);
+    if (_items_.size() >= _capacity_ && !_closed_) {
+      const auto start = std::chrono::steady_clock::now();
+      _not_full_.wait(lock, [this] { return _items_.size() < _capacity_ || _closed_; });
+      _push_wait_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                              .count();
+      _push_waits_++;
+    }
+    if (_closed_) {
+      return false;
+    }
+    _items_.push_back(std::move(item_));
+    _occupancy_sum_ += _items_.size();
+    _pushes_++;
+    _max_occupancy_ = std::max(_max_occupancy_, _items_.size());
+    lock.unlock();
+    _not_empty_.notify_one();
+    return true;
+  }
+
+  /// Pop an item, waiting for one to be available
+  ///
+  /// Return false if the queue has been closed and is empty.
+  bool pop(T& item_) {
+    std::unique_lock<std::mutex> lock(_mutex_);
+    _not_empty_.wait(lock, [this] { return !_items_.empty() || _closed_; });
+    if (_items_.empty()) {
+      return false;
+    }
+    item_ = std::move(_items_.front());
+    _items_.pop_front();
+    lock.unlock();
+    _not_full_.notify_one();
+    return true;
+  }
+
+  /// Close the queue
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex_);
+      _closed_ = true;
+    }
+    _not_empty_.notify_all();
+    _not_full_.notify_all();
+    return;
+  }
+
+  /// Check if the queue is closed
+  bool is_closed() const {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    return _closed_;
+  }
+
+  /// Return the mean occupancy seen by pushed items
+  double get_mean_occupancy() const {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    return _pushes_ == 0 ? 0.0 : static_cast<double>(_occupancy_sum_) / _pushes_;
+  }
+
+  /// Return the maximum occupancy
+  std::size_t get_max_occupancy() const {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    return _max_occupancy_;
+  }
+
+  /// Return the total time producers spent waiting for a free slot (in seconds)
+  double get_push_wait_time() const {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    return _push_wait_time_;
+  }
+
+  /// Return the number of pushes that had to wait for a free slot
+  std::size_t get_number_of_push_waits() const {
+    std::lock_guard<std::mutex> lock(_mutex_);
+    return _push_waits_;
+  }
+
+ private:
+  const std::size_t _capacity_;  //!< Maximum number of items
+  mutable std::mutex _mutex_;
+  std::condition_variable _not_empty_;
+  std::condition_variable _not_full_;
+  std::deque<T> _items_;
+  bool _closed_ = false;
+  std::size_t _pushes_ = 0;          //!< Number of pushed items
+  std::size_t _occupancy_sum_ = 0;   //!< Sum of the occupancies after each push
+  std::size_t _max_occupancy_ = 0;   //!< Maximum occupancy
+  std::size_t _push_waits_ = 0;      //!< Number of blocked pushes
+  double _push_wait_time_ = 0.0;     //!< Time spent in blocked pushes
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_BOUNDED_QUEUE_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -21,19 +21,74 @@
 // Ourselves:
 #include <snemo/asb/calo_signal_generator_driver.h>
 
+// Standard library:
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+// This project:
+#include <snemo/asb/utils.h>
+
 namespace snemo {
 
 namespace asb {
 
+namespace {
+
+/// Packed GID key and index of a hit
+typedef std::pair<packed_gid::key_type, std::size_t> channel_entry;
+
+/// Sort hit entries by channel
+///
+/// With packed keys (packed_ is true), the order of the keys is the order of
+/// the GIDs. Otherwise some GID could not be packed and the GIDs themselves
+/// are compared.
+template <class GidOf>
+void sort_by_channel(std::vector<channel_entry>& entries_, bool packed_, GidOf gid_of_) {
+  if (packed_) {
+    std::sort(entries_.begin(), entries_.end());
+    return;
+  }
+  std::sort(entries_.begin(), entries_.end(),
+            [&gid_of_](const channel_entry& a_, const channel_entry& b_) {
+              const geomtools::geom_id& gid_a = gid_of_(a_.second);
+              const geomtools::geom_id& gid_b = gid_of_(b_.second);
+              if (gid_a != gid_b) return gid_a < gid_b;
+              return a_.second < b_.second;
+            });
+  return;
+}
+
+/// Check if two hit entries sorted by channel belong to the same channel
+template <class GidOf>
+bool same_channel(const channel_entry& a_, const channel_entry& b_, bool packed_,
+                  GidOf gid_of_) {
+  return packed_ ? a_.first == b_.first : gid_of_(a_.second) == gid_of_(b_.second);
+}
+
+}  // namespace
+
+DATATOOLS_FACTORY_SYSTEM_AUTO_REGISTRATION_IMPLEMENTATION(
+    base_signal_generator_driver, calo_signal_generator_driver,
+    "snemo::asb::calo_signal_generator_driver")
+
 calo_signal_generator_driver::calo_signal_generator_driver(const std::string& id_)
     : base_signal_generator_driver(id_) {
   _mode_ = MODE_INVALID;
+  _default_rise_time_ = 8 * CLHEP::ns;
+  _default_fall_time_ = 70 * CLHEP::ns;
+  _guard_time_ = 10 * CLHEP::ns;
   return;
 }
 
 calo_signal_generator_driver::calo_signal_generator_driver(const mode_type mode_,
                                                            const std::string& id_)
     : base_signal_generator_driver(id_), _mode_(mode_) {
+  _default_rise_time_ = 8 * CLHEP::ns;
+  _default_fall_time_ = 70 * CLHEP::ns;
+  _guard_time_ = 10 * CLHEP::ns;
   return;
 }
 
@@ -70,77 +125,263 @@ void calo_signal_generator_driver::_initialize(const datatools::properties& conf
     DT_THROW(std::logic_error, "Missing driver mode!");
   }
 
+  // 1 MeV is equivalent to 300 mV
+  _amplitude_per_energy_ = 0.3 * CLHEP::volt / CLHEP::MeV;
+
+  // Rise and fall times on calo signal (from Bordeaux wavecatcher signals):
+  _init_channel_timings_(config_);
+
+  if (config_.has_key("streaming.guard_time")) {
+    double guard_time = config_.fetch_real("streaming.guard_time");
+    if (!config_.has_explicit_unit("streaming.guard_time")) guard_time *= CLHEP::ns;
+    set_guard_time(guard_time);
+  }
+
+  // Resolve the shape schema and the hit loop kernel once for all:
+  if (_mode_ == MODE_TRIANGLE) {
+    _schema_.initialize(triangle_shape_policy::shape_type_id());
+    _kernel_ = &calo_signal_generator_driver::_process_hits_<triangle_shape_policy>;
+  }
+
   return;
 }
 
 void calo_signal_generator_driver::_reset() {
   // clear resources...
 
+  _rise_times_.clear();
+  _fall_times_.clear();
+  _channel_type_ = 0;
+  _channel_address_names_.clear();
+  _channel_extents_.clear();
+  _schema_ = shape_schema();
+  _hit_gid_keys_.clear();
+  _atomic_signals_.clear();
+  _atomic_signals_.shrink_to_fit();
+  abort_stream();
+  _stream_hits_.clear();
+  _amplitude_per_energy_ = 0.0;
+  _kernel_ = nullptr;
   _mode_ = MODE_INVALID;
   return;
 }
 
+void calo_signal_generator_driver::_init_channel_timings_(const datatools::properties& config_) {
+  // Default timings:
+  if (config_.has_key("rise_time")) {
+    _default_rise_time_ = config_.fetch_real("rise_time");
+    if (!config_.has_explicit_unit("rise_time")) _default_rise_time_ *= CLHEP::ns;
+  }
+  if (config_.has_key("fall_time")) {
+    _default_fall_time_ = config_.fetch_real("fall_time");
+    if (!config_.has_explicit_unit("fall_time")) _default_fall_time_ *= CLHEP::ns;
+  }
+  DT_THROW_IF(_default_rise_time_ <= 0.0 || _default_fall_time_ <= 0.0, std::domain_error,
+              "Invalid rise/fall times!");
+
+  // Layout of the channels of the signal category, from their GID addresses
+  // following the module number:
+  std::vector<std::size_t> default_extents;
+  _channel_address_names_.clear();
+  _channel_type_ = 0;
+  const std::string& category = get_signal_category();
+  if (category == "calo") {
+    // Calorimeter block GID: [module.side.column.row.part]
+    _channel_type_ = 1302;
+    _channel_address_names_ = {"sides", "columns", "rows"};
+    default_extents = {2, 20, 13};
+  } else if (category == "xcalo") {
+    // X-wall block GID: [module.side.wall.column.row.part]
+    _channel_type_ = 1232;
+    _channel_address_names_ = {"sides", "walls", "columns", "rows"};
+    default_extents = {2, 2, 2, 16};
+  } else if (category == "gveto") {
+    // Gamma veto block GID: [module.side.wall.column.part]
+    _channel_type_ = 1252;
+    _channel_address_names_ = {"sides", "walls", "columns"};
+    default_extents = {2, 2, 16};
+  } else {
+    std::vector<std::string> layout_keys;
+    config_.keys_starting_with(layout_keys, "channels.");
+    config_.keys_starting_with(layout_keys, "channel.");
+    DT_THROW_IF(!layout_keys.empty(), std::logic_error,
+                "No channel layout for per-channel parameters of category '" << category << "'!");
+  }
+  if (!default_extents.empty() && has_channel_map()) {
+    // Layout of the channels of the geometry, after the module number:
+    const std::vector<std::size_t> map_extents =
+        get_channel_map().get_address_extents(_channel_type_);
+    if (!map_extents.empty()) {
+      for (std::size_t iaddress = 0; iaddress < default_extents.size(); iaddress++) {
+        default_extents[iaddress] = map_extents[iaddress + 1];
+      }
+    }
+  }
+  _channel_extents_.clear();
+  std::size_t number_of_channels = _channel_address_names_.empty() ? 0 : 1;
+  for (std::size_t iaddress = 0; iaddress < _channel_address_names_.size(); iaddress++) {
+    const std::string key = "channels." + _channel_address_names_[iaddress];
+    int extent = static_cast<int>(default_extents[iaddress]);
+    if (config_.has_key(key)) {
+      extent = config_.fetch_integer(key);
+    }
+    DT_THROW_IF(extent <= 0, std::domain_error,
+                "Invalid number of channels '" << key << "' = " << extent << "!");
+    _channel_extents_.push_back(static_cast<std::size_t>(extent));
+    number_of_channels *= _channel_extents_.back();
+  }
+  _rise_times_.assign(number_of_channels, _default_rise_time_);
+  _fall_times_.assign(number_of_channels, _default_fall_time_);
+
+  // Per-channel overrides, e.g. 'channel.1.12.4.rise_time : real as time = 7.5 ns':
+  std::vector<std::string> channel_keys;
+  config_.keys_starting_with(channel_keys, "channel.");
+  for (const auto& key : channel_keys) {
+    std::vector<std::string> tokens;
+    std::istringstream key_stream(key);
+    std::string token;
+    while (std::getline(key_stream, token, '.')) {
+      tokens.push_back(token);
+    }
+    DT_THROW_IF(tokens.size() != _channel_extents_.size() + 2, std::logic_error,
+                "Invalid per-channel parameter '" << key << "'!");
+    std::size_t index = 0;
+    for (std::size_t iaddress = 0; iaddress < _channel_extents_.size(); iaddress++) {
+      const std::string& address_token = tokens[iaddress + 1];
+      char* end = nullptr;
+      const unsigned long address = std::strtoul(address_token.c_str(), &end, 10);
+      DT_THROW_IF(!std::isdigit(static_cast<unsigned char>(address_token[0])) || *end != '\0',
+                  std::logic_error, "Invalid per-channel parameter '" << key << "'!");
+      DT_THROW_IF(address >= _channel_extents_[iaddress], std::range_error,
+                  "Per-channel parameter '" << key << "' is out of range!");
+      index = index * _channel_extents_[iaddress] + address;
+    }
+    double value = config_.fetch_real(key);
+    if (!config_.has_explicit_unit(key)) value *= CLHEP::ns;
+    DT_THROW_IF(value <= 0.0, std::domain_error, "Invalid per-channel parameter '" << key << "'!");
+    const std::string& parameter = tokens.back();
+    if (parameter == "rise_time") {
+      _rise_times_[index] = value;
+    } else if (parameter == "fall_time") {
+      _fall_times_[index] = value;
+    } else {
+      DT_THROW(std::logic_error, "Unsupported per-channel parameter '" << key << "'!");
+    }
+  }
+  return;
+}
+
+int calo_signal_generator_driver::_channel_index_(const geomtools::geom_id& gid_) const {
+  if (gid_.get_type() != _channel_type_ || gid_.get_depth() <= _channel_extents_.size()) {
+    return -1;
+  }
+  std::size_t index = 0;
+  for (std::size_t iaddress = 0; iaddress < _channel_extents_.size(); iaddress++) {
+    const uint32_t address = gid_.get(iaddress + 1);
+    if (address >= _channel_extents_[iaddress]) {
+      return -1;
+    }
+    index = index * _channel_extents_[iaddress] + address;
+  }
+  return static_cast<int>(index);
+}
+
+double calo_signal_generator_driver::get_rise_time(const geomtools::geom_id& gid_) const {
+  const int index = _channel_index_(gid_);
+  return index < 0 ? _default_rise_time_ : _rise_times_[index];
+}
+
+double calo_signal_generator_driver::get_fall_time(const geomtools::geom_id& gid_) const {
+  const int index = _channel_index_(gid_);
+  return index < 0 ? _default_fall_time_ : _fall_times_[index];
+}
+
 double calo_signal_generator_driver::_convert_energy_to_amplitude(const double energy_) {
-  // 1 MeV is equivalent to 300 mV
-  double amplitude_1MeV = 0.3 * CLHEP::volt;  // value : 0.3 * 10^-7
-  double amplitude = (energy_ / 1 * CLHEP::MeV) * amplitude_1MeV;
+  const double amplitude = energy_ * _amplitude_per_energy_;
   return amplitude;  // maybe units problem for the moment
 }
 
 void calo_signal_generator_driver::_process(const mctools::simulated_data& sim_data_,
                                             mctools::signal::signal_data& sim_signal_data_) {
-  DT_THROW_IF(!is_initialized(), std::logic_error,
-              "Calo signal generator driver is not initialized !");
-  DT_THROW_IF(_mode_ == MODE_INVALID, std::logic_error,
-              "Calo signal generator driver mode is invalid !");
+  DT_THROW_IF(_kernel_ == nullptr, std::logic_error,
+              "Calo signal generator driver has no hit loop kernel !");
+  (this->*_kernel_)(sim_data_, sim_signal_data_);
+  return;
+}
 
-  if (_mode_ == MODE_TRIANGLE) {
-    _process_triangle_mode_(sim_data_, sim_signal_data_);
+void calo_signal_generator_driver::_process_batch(
+    const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+    const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_) {
+  DT_THROW_IF(_kernel_ == nullptr, std::logic_error,
+              "Calo signal generator driver has no hit loop kernel !");
+  // Size the scratch buffers once for the whole batch:
+  std::size_t max_number_of_hits = 0;
+  for (const mctools::simulated_data* sim_data : sim_data_batch_) {
+    const mctools::simulated_data::hit_handle_collection_type* calo_hits =
+        _find_step_hits(*sim_data, get_signal_category_id());
+    if (calo_hits != nullptr) {
+      max_number_of_hits = std::max(max_number_of_hits, calo_hits->size());
+    }
+  }
+  _atomic_signals_.reserve(max_number_of_hits);
+  for (std::size_t ievent = 0; ievent < sim_data_batch_.size(); ievent++) {
+    (this->*_kernel_)(*sim_data_batch_[ievent], *sim_signal_data_batch_[ievent]);
   }
   return;
 }
 
-void calo_signal_generator_driver::_process_triangle_mode_(
+template <class ShapePolicy>
+void calo_signal_generator_driver::_process_hits_(
     const mctools::simulated_data& sim_data_, mctools::signal::signal_data& sim_signal_data_) {
-  DT_THROW_IF(!sim_data_.has_step_hits("calo"), std::logic_error,
-              "Simulated Datas have no step hits 'calo'");
+  // Categories are resolved once, the hit loops never look them up.
+  // An event without calorimeter hits simply produces no signal:
+  const std::string& category = category_registry::get_label(get_signal_category_id());
+  const mctools::simulated_data::hit_handle_collection_type* calo_hits =
+      _find_step_hits(sim_data_, get_signal_category_id());
+  if (calo_hits != nullptr && is_degraded_mode()) {
+    _process_aggregated_hits_<ShapePolicy>(*calo_hits, sim_signal_data_);
+    return;
+  }
 
-  // For the moment, each calo hit is represented by a triangle calo signal.
-  // The next step is to take into account multi hit into one GID. Several
-  // 'small' signals must construct a 'multi signal' for one GID (sum)
+  // Each calo hit is represented by a triangle calo signal. The hits piled
+  // up in one calo block give a single multi signal, as in the scin driver.
 
-  if (sim_data_.has_step_hits("calo")) {
-    const size_t number_of_calo_hits = sim_data_.get_number_of_step_hits("calo");
+  if (calo_hits != nullptr) {
+    const size_t number_of_calo_hits = calo_hits->size();
 
     double event_time_ref;
     datatools::invalidate(event_time_ref);
-    std::set<geomtools::geom_id> set_of_gids;
-    std::map<geomtools::geom_id, unsigned int> map_gid_hit_in_gid;
-    std::vector<mctools::signal::base_signal> atomic_signal_collection;
+    std::vector<gid_key_entry>& gid_keys = _hit_gid_keys_;
+    std::vector<mctools::signal::base_signal>& atomic_signal_collection = _atomic_signals_;
+    gid_keys.clear();
+    gid_keys.reserve(number_of_calo_hits);
+    atomic_signal_collection.clear();
+    bool packed_keys = true;
+    auto gid_of_signal = [&atomic_signal_collection](
+        std::size_t isignal_) -> const geomtools::geom_id& {
+      return atomic_signal_collection[isignal_].get_geom_id();
+    };
+
+    span_recorder::scope shape_span(get_span_recorder(), "shape building", "phase");
 
     // Search calo time reference for the event :
     for (size_t ihit = 0; ihit < number_of_calo_hits; ihit++) {
-      const double signal_time = sim_data_.get_step_hit("calo", ihit).get_time_start() * CLHEP::ns;
+      const double signal_time = (*calo_hits)[ihit].get().get_time_start() * CLHEP::ns;
       if (!datatools::is_valid(event_time_ref)) event_time_ref = signal_time;
       if (signal_time < event_time_ref) event_time_ref = signal_time;
     }
 
     for (size_t ihit = 0; ihit < number_of_calo_hits; ihit++) {
-      const mctools::base_step_hit& main_calo_hit = sim_data_.get_step_hit("calo", ihit);
+      const mctools::base_step_hit& main_calo_hit = (*calo_hits)[ihit].get();
       unsigned int calo_hit_id = main_calo_hit.get_hit_id();
       const double signal_time = main_calo_hit.get_time_start() * CLHEP::ns;
       const double energy_deposit = main_calo_hit.get_energy_deposit() * CLHEP::MeV;
       const geomtools::geom_id& calo_gid = main_calo_hit.get_geom_id();
 
-      auto it = map_gid_hit_in_gid.find(calo_gid);
-      bool already_exist = false;
-      if (it != map_gid_hit_in_gid.end()) already_exist = true;
-      if (already_exist)
-        map_gid_hit_in_gid.find(calo_gid)->second += 1;
-      else
-        map_gid_hit_in_gid.insert(std::pair<geomtools::geom_id, int>(calo_gid, 1));
-
-      set_of_gids.insert(calo_gid);
+      // Hits are grouped per calo block through their packed GID keys:
+      packed_gid::key_type key = packed_gid::INVALID_KEY;
+      packed_keys = packed_gid::try_encode(calo_gid, key) && packed_keys;
+      gid_keys.push_back(gid_key_entry(key, atomic_signal_collection.size()));
 
       mctools::signal::base_signal a_signal;
 
@@ -148,89 +389,303 @@ void calo_signal_generator_driver::_process_triangle_mode_(
       a_signal.set_geom_id(calo_gid);
 
       const double t0 = signal_time - event_time_ref;
-      const double t1 =
-          t0 + 8 * CLHEP::ns;  // Rise time on calo signal (from Bordeaux wavecatcher signals)
-      const double t2 =
-          t1 + 70 * CLHEP::ns;  // Fall time on calo signal (from Bordeaux wavecatcher signals)
       const double amplitude = _convert_energy_to_amplitude(energy_deposit);
 
-      a_signal.set_category("calo");
+      a_signal.set_category(category);
+      const int channel = _channel_index_(calo_gid);
+      const double rise_time = channel < 0 ? _default_rise_time_ : _rise_times_[channel];
+      const double fall_time = channel < 0 ? _default_fall_time_ : _fall_times_[channel];
+
       a_signal.set_time_ref(event_time_ref);
-      a_signal.set_shape_type_id("mctools::signal::triangle_signal_shape");
-      a_signal.set_shape_string_parameter("polarity", "-");
-      a_signal.set_shape_real_parameter_with_explicit_unit("t0", t0, "ns");
-      a_signal.set_shape_real_parameter_with_explicit_unit("t1", t1, "ns");
-      a_signal.set_shape_real_parameter_with_explicit_unit("t2", t2, "ns");
-      a_signal.set_shape_real_parameter_with_explicit_unit("amplitude", amplitude, "V");
+      ShapePolicy::build(a_signal, _schema_, t0, rise_time, fall_time, amplitude);
       a_signal.initialize_simple();
       atomic_signal_collection.push_back(a_signal);
 
-      a_signal.tree_dump(std::clog, "Calo Hit signal in driver : ");
-
-      std::clog << "Time stop : " << signal_time << std::endl;
-      std::clog << "Energy    : " << energy_deposit << std::endl;
-      std::clog << "Amplitude : " << amplitude << std::endl;
-      std::clog << "GID       : " << calo_gid << std::endl;
+      if (get_logging_priority() >= datatools::logger::PRIO_DEBUG) {
+        a_signal.tree_dump(std::clog, "Calo Hit signal in driver : ");
+        DT_LOG_DEBUG(get_logging_priority(), "Time start : " << signal_time);
+        DT_LOG_DEBUG(get_logging_priority(), "Energy     : " << energy_deposit);
+        DT_LOG_DEBUG(get_logging_priority(), "Amplitude  : " << amplitude);
+        DT_LOG_DEBUG(get_logging_priority(), "GID        : " << calo_gid);
+      }
     }
 
-    // Merge signals which are in the same calo block (thanks to GID) :
-    for (auto it = map_gid_hit_in_gid.begin(); it != map_gid_hit_in_gid.end(); it++) {
-      if (it->second == 1) {
+    shape_span.stop();
+
+    // Merge signals which are in the same calo block (thanks to GID):
+    span_recorder::scope grouping_span(get_span_recorder(), "grouping", "phase");
+    sort_by_channel(gid_keys, packed_keys, gid_of_signal);
+    grouping_span.stop();
+    span_recorder::scope fill_span(get_span_recorder(), "bank fill", "phase");
+    mctools::signal::signal_data::signal_handle_collection_type* output_signals = nullptr;
+    if (number_of_calo_hits > 0) {
+      output_signals = &_grab_output_signals(sim_signal_data_);
+      output_signals->reserve(output_signals->size() + number_of_calo_hits);
+    }
+    std::vector<const mctools::signal::base_signal*> multi_components;
+    std::size_t ifirst = 0;
+    while (ifirst < gid_keys.size()) {
+      std::size_t ilast = ifirst + 1;
+      while (ilast < gid_keys.size() &&
+             same_channel(gid_keys[ilast], gid_keys[ifirst], packed_keys, gid_of_signal)) {
+        ilast++;
+      }
+      if (ilast - ifirst == 1) {
         // Signal alone :
-        for (size_t isig = 0; isig < atomic_signal_collection.size(); isig++) {
-          if (atomic_signal_collection[isig].get_geom_id() == it->first) {
-            mctools::signal::base_signal& signal = sim_signal_data_.add_signal("calo");
-            signal = atomic_signal_collection[isig];
-          }
-        }
+        output_signals->push_back(mctools::signal::signal_data::signal_handle_type(
+            new mctools::signal::base_signal(atomic_signal_collection[gid_keys[ifirst].second])));
       } else {
         // Multi signal :
-        mctools::signal::base_signal& signal = sim_signal_data_.add_signal("calo");
-        datatools::properties multi_signal_config;
-        signal.set_shape_type_id("mctools::signal::multi_signal_shape");
-        for (size_t isig = 0; isig < atomic_signal_collection.size(); isig++) {
-          if (atomic_signal_collection[isig].get_geom_id() == it->first) {
-            // One atomic signal useful to construct the multi signal
-
-            // ici : builder qui permet de recréer les signaux pour construire le multi signal (et
-            // le push back dans sim signal data ??)
-
-            // std::vector<std::string> comp_labels({"hit0","hit1","hit2"});
-            // s5_cfg.store("components", comp_labels);
-
-            // multi_signal_config.store("components.hit0.key", "s1");
-            // multi_signal_config.store_real_with_explicit_unit("components.hit0.time_shift", 3.0 *
-            // CLHEP::ns); multi_signal_config.set_unit_symbol("components.hit0.time_shift", "ns");
-            // multi_signal_config.store_real("components.hit0.scaling", 0.5);
-
-            // multi_signal_config.store("components.hit1.key", "s2");
-            // multi_signal_config.store_real_with_explicit_unit("components.hit1.time_shift", -2.0
-            // * CLHEP::ns); multi_signal_config.set_unit_symbol("components.hit1.time_shift",
-            // "ns"); multi_signal_config.store_real("components.hit1.scaling", 1.0);
-
-            // multi_signal_config.store("components.hit2.key", "s4");
-            // multi_signal_config.store_real_with_explicit_unit("components.hit2.time_shift", 1.5 *
-            // CLHEP::ns); multi_signal_config.set_unit_symbol("components.hit2.time_shift", "ns");
-            // multi_signal_config.store_real("components.hit2.scaling", 1.3);
-
-            // atomic_signal_collection[isig]
-          }
+        output_signals->push_back(
+            mctools::signal::signal_data::signal_handle_type(new mctools::signal::base_signal));
+        multi_components.clear();
+        for (std::size_t ikey = ifirst; ikey < ilast; ikey++) {
+          multi_components.push_back(&atomic_signal_collection[gid_keys[ikey].second]);
         }
+        signal_utils::build_multi_signal(multi_components, output_signals->back().grab());
       }
+      ifirst = ilast;
     }
+  }
+
+  return;
+}
+
+template <class ShapePolicy>
+void calo_signal_generator_driver::_process_aggregated_hits_(
+    const mctools::simulated_data::hit_handle_collection_type& calo_hits_,
+    mctools::signal::signal_data& sim_signal_data_) {
+  // Degraded mode: the hits are grouped per calo block before any signal is
+  // built, and each block gives a single triangle with the summed amplitude,
+  // starting at the earliest hit. No atomic signal is kept in memory.
+  const std::size_t number_of_calo_hits = calo_hits_.size();
+  if (number_of_calo_hits == 0) {
+    return;
+  }
+  const std::string& category = category_registry::get_label(get_signal_category_id());
+  double event_time_ref = calo_hits_[0].get().get_time_start() * CLHEP::ns;
+  std::vector<gid_key_entry>& gid_keys = _hit_gid_keys_;
+  gid_keys.clear();
+  gid_keys.reserve(number_of_calo_hits);
+  bool packed_keys = true;
+  auto gid_of_hit = [&calo_hits_](std::size_t ihit_) -> const geomtools::geom_id& {
+    return calo_hits_[ihit_].get().get_geom_id();
+  };
+  for (std::size_t ihit = 0; ihit < number_of_calo_hits; ihit++) {
+    const mctools::base_step_hit& calo_hit = calo_hits_[ihit].get();
+    event_time_ref = std::min(event_time_ref, calo_hit.get_time_start() * CLHEP::ns);
+    packed_gid::key_type key = packed_gid::INVALID_KEY;
+    packed_keys = packed_gid::try_encode(calo_hit.get_geom_id(), key) && packed_keys;
+    gid_keys.push_back(gid_key_entry(key, ihit));
+  }
+  sort_by_channel(gid_keys, packed_keys, gid_of_hit);
+  mctools::signal::signal_data::signal_handle_collection_type& output_signals =
+      _grab_output_signals(sim_signal_data_);
+  std::size_t ifirst = 0;
+  while (ifirst < gid_keys.size()) {
+    const mctools::base_step_hit& first_hit = calo_hits_[gid_keys[ifirst].second].get();
+    double start_time = first_hit.get_time_start() * CLHEP::ns;
+    double energy_deposit = 0.0;
+    std::size_t ilast = ifirst;
+    while (ilast < gid_keys.size() &&
+           same_channel(gid_keys[ilast], gid_keys[ifirst], packed_keys, gid_of_hit)) {
+      const mctools::base_step_hit& calo_hit = calo_hits_[gid_keys[ilast].second].get();
+      start_time = std::min(start_time, calo_hit.get_time_start() * CLHEP::ns);
+      energy_deposit += calo_hit.get_energy_deposit() * CLHEP::MeV;
+      ilast++;
+    }
+    const geomtools::geom_id& calo_gid = first_hit.get_geom_id();
+    const int channel = _channel_index_(calo_gid);
+    output_signals.push_back(
+        mctools::signal::signal_data::signal_handle_type(new mctools::signal::base_signal));
+    mctools::signal::base_signal& a_signal = output_signals.back().grab();
+    a_signal.set_hit_id(first_hit.get_hit_id());
+    a_signal.set_geom_id(calo_gid);
+    a_signal.set_category(category);
+    a_signal.set_time_ref(event_time_ref);
+    ShapePolicy::build(a_signal, _schema_, start_time - event_time_ref,
+                       channel < 0 ? _default_rise_time_ : _rise_times_[channel],
+                       channel < 0 ? _default_fall_time_ : _fall_times_[channel],
+                       _convert_energy_to_amplitude(energy_deposit));
+    a_signal.initialize_simple();
+    ifirst = ilast;
+  }
+  return;
+}
 
-    // for (auto it_set = set_of_gids.begin(); it_set != set_of_gids.end(); it_set++)
-    //   {
-    //     geomtools::geom_id gid_to_search
+void calo_signal_generator_driver::set_guard_time(double guard_time_) {
+  DT_THROW_IF(guard_time_ < 0.0, std::domain_error, "Invalid negative guard time!");
+  _guard_time_ = guard_time_;
+  return;
+}
+
+double calo_signal_generator_driver::get_guard_time() const { return _guard_time_; }
+
+void calo_signal_generator_driver::begin_stream(const emit_callback_type& callback_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Driver is not initialized!");
+  DT_THROW_IF(_streaming_, std::logic_error, "A stream is already open!");
+  DT_THROW_IF(!callback_, std::logic_error, "Missing stream callback!");
+  DT_THROW_IF(_mode_ != MODE_TRIANGLE, std::logic_error, "Streaming needs the triangle mode!");
+  _stream_callback_ = callback_;
+  _stream_category_ = category_registry::get_label(get_signal_category_id());
+  datatools::invalidate(_stream_time_ref_);
+  datatools::invalidate(_stream_time_);
+  _stream_windows_.clear();
+  _stream_window_ends_ = decltype(_stream_window_ends_)();
+  _stream_fallback_keys_.clear();
+  _max_open_windows_ = 0;
+  _streaming_ = true;
+  return;
+}
 
-    for (size_t isignal = 0; isignal < atomic_signal_collection.size(); isignal++) {
-      // mctools::signal::base_signal & signal = sim_signal_data_.add_signal("calo");
+bool calo_signal_generator_driver::is_streaming() const { return _streaming_; }
+
+void calo_signal_generator_driver::push_hit(const mctools::base_step_hit& hit_) {
+  DT_THROW_IF(!_streaming_, std::logic_error, "No open stream!");
+  const double signal_time = hit_.get_time_start() * CLHEP::ns;
+  DT_THROW_IF(datatools::is_valid(_stream_time_) && signal_time < _stream_time_,
+              std::logic_error, "Stream hits are not sorted by start time!");
+  if (!datatools::is_valid(_stream_time_ref_)) {
+    // The first hit is the earliest one of the event:
+    _stream_time_ref_ = signal_time;
+  }
+  _stream_time_ = signal_time;
+
+  // No further hit can overlap the windows ending before this one:
+  _close_windows_(signal_time);
+
+  const geomtools::geom_id& calo_gid = hit_.get_geom_id();
+  const int channel = _channel_index_(calo_gid);
+  const double rise_time = channel < 0 ? _default_rise_time_ : _rise_times_[channel];
+  const double fall_time = channel < 0 ? _default_fall_time_ : _fall_times_[channel];
+  packed_gid::key_type key = packed_gid::INVALID_KEY;
+  if (!packed_gid::try_encode(calo_gid, key)) {
+    // Packed keys have a type below 0xFFFF, so that these keys never clash
+    // with the key of a packed GID:
+    auto found = _stream_fallback_keys_.find(calo_gid);
+    if (found == _stream_fallback_keys_.end()) {
+      const packed_gid::key_type fallback_key =
+          (0xFFFFULL << 48) | _stream_fallback_keys_.size();
+      found = _stream_fallback_keys_.emplace(calo_gid, fallback_key).first;
     }
+    key = found->second;
+  }
+  stream_window& window = _stream_windows_[key];
+  window.signals.push_back(mctools::signal::base_signal());
+  mctools::signal::base_signal& a_signal = window.signals.back();
+  a_signal.set_hit_id(hit_.get_hit_id());
+  a_signal.set_geom_id(calo_gid);
+  a_signal.set_category(_stream_category_);
+  a_signal.set_time_ref(_stream_time_ref_);
+  const double amplitude =
+      _convert_energy_to_amplitude(hit_.get_energy_deposit() * CLHEP::MeV);
+  triangle_shape_policy::build(a_signal, _schema_, signal_time - _stream_time_ref_, rise_time,
+                               fall_time, amplitude);
+  a_signal.initialize_simple();
+  const double end = signal_time + rise_time + fall_time + _guard_time_;
+  if (end > window.end) {
+    window.end = end;
+    _stream_window_ends_.push(window_end_entry(end, key));
   }
+  _max_open_windows_ = std::max(_max_open_windows_, _stream_windows_.size());
+  return;
+}
 
+void calo_signal_generator_driver::end_stream() {
+  DT_THROW_IF(!_streaming_, std::logic_error, "No open stream!");
+  try {
+    _close_windows_(std::numeric_limits<double>::infinity());
+  } catch (...) {
+    abort_stream();
+    throw;
+  }
+  abort_stream();
   return;
 }
 
+void calo_signal_generator_driver::abort_stream() {
+  _stream_callback_ = emit_callback_type();
+  _stream_category_.clear();
+  _stream_windows_.clear();
+  _stream_window_ends_ = decltype(_stream_window_ends_)();
+  _stream_fallback_keys_.clear();
+  _streaming_ = false;
+  return;
+}
+
+void calo_signal_generator_driver::process_streaming(const mctools::simulated_data& sim_data_,
+                                                     const emit_callback_type& callback_) {
+  begin_stream(callback_);
+  const mctools::simulated_data::hit_handle_collection_type* calo_hits =
+      _find_step_hits(sim_data_, get_signal_category_id());
+  _stream_hits_.clear();
+  if (calo_hits != nullptr) {
+    _stream_hits_.reserve(calo_hits->size());
+    for (const auto& hit_handle : *calo_hits) {
+      _stream_hits_.push_back(&hit_handle.get());
+    }
+    std::stable_sort(_stream_hits_.begin(), _stream_hits_.end(),
+                     [](const mctools::base_step_hit* a_, const mctools::base_step_hit* b_) {
+                       return a_->get_time_start() < b_->get_time_start();
+                     });
+  }
+  try {
+    for (const mctools::base_step_hit* hit : _stream_hits_) {
+      push_hit(*hit);
+    }
+  } catch (...) {
+    // A failing hit or callback leaves the driver ready for another stream:
+    abort_stream();
+    throw;
+  }
+  end_stream();
+  return;
+}
+
+std::size_t calo_signal_generator_driver::get_max_open_windows() const {
+  return _max_open_windows_;
+}
+
+void calo_signal_generator_driver::_close_windows_(double time_) {
+  while (!_stream_window_ends_.empty() && _stream_window_ends_.top().first <= time_) {
+    const window_end_entry entry = _stream_window_ends_.top();
+    _stream_window_ends_.pop();
+    auto found = _stream_windows_.find(entry.second);
+    if (found == _stream_windows_.end() || found->second.end != entry.first) {
+      // Stale entry of an extended or already closed window:
+      continue;
+    }
+    stream_window& window = found->second;
+    if (window.signals.size() == 1) {
+      // Signal alone :
+      _stream_callback_(window.signals.front());
+    } else {
+      // Multi signal, as in the event mode :
+      std::vector<const mctools::signal::base_signal*> multi_components;
+      multi_components.reserve(window.signals.size());
+      for (const auto& window_signal : window.signals) {
+        multi_components.push_back(&window_signal);
+      }
+      mctools::signal::base_signal signal;
+      signal_utils::build_multi_signal(multi_components, signal);
+      _stream_callback_(signal);
+    }
+    _stream_windows_.erase(found);
+  }
+  return;
+}
+
+bool calo_signal_generator_driver::has_degraded_mode() const { return true; }
+
+std::size_t calo_signal_generator_driver::get_working_memory() const {
+  std::size_t bytes = _hit_gid_keys_.capacity() * sizeof(gid_key_entry);
+  bytes += _atomic_signals_.capacity() * sizeof(mctools::signal::base_signal);
+  for (const auto& signal : _atomic_signals_) {
+    bytes += signal_utils::estimate_memory(signal) - sizeof(mctools::signal::base_signal);
+  }
+  return bytes;
+}
+
 void calo_signal_generator_driver::_tree_dump(std::ostream& out_, const std::string& /* title_ */,
                                               const std::string& indent_,
                                               bool /* inherit_ */) const {
@@ -241,6 +696,21 @@ void calo_signal_generator_driver::_tree_dump(std::ostream& out_, const std::str
     mode_str = "triangle";
 
   out_ << indent_ << datatools::i_tree_dumpable::tag << "Mode : '" << mode_str << "'" << std::endl;
+  out_ << indent_ << datatools::i_tree_dumpable::tag
+       << "Default rise time : " << _default_rise_time_ / CLHEP::ns << " ns" << std::endl;
+  out_ << indent_ << datatools::i_tree_dumpable::tag
+       << "Default fall time : " << _default_fall_time_ / CLHEP::ns << " ns" << std::endl;
+  out_ << indent_ << datatools::i_tree_dumpable::tag
+       << "Streaming guard time : " << _guard_time_ / CLHEP::ns << " ns" << std::endl;
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Channels : ";
+  if (_channel_extents_.empty()) {
+    out_ << "<no layout>";
+  }
+  for (std::size_t iaddress = 0; iaddress < _channel_extents_.size(); iaddress++) {
+    if (iaddress > 0) out_ << " x ";
+    out_ << _channel_extents_[iaddress] << " " << _channel_address_names_[iaddress];
+  }
+  out_ << std::endl;
 }
 
 }  // end of namespace asb
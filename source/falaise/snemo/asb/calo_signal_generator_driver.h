@@ -7,8 +7,14 @@
 #define FALAISE_ASB_PLUGIN_SNEMO_ASB_CALO_SIGNAL_GENERATOR_DRIVER_H
 
 // Standard library:
+#include <functional>
+#include <map>
 #include <memory>
+#include <queue>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Third party:
 // - Boost:
@@ -16,12 +22,61 @@
 
 // This project:
 #include <snemo/asb/base_signal_generator_driver.h>
+#include <snemo/asb/packed_gid.h>
+#include <snemo/asb/shape_policies.h>
 
 namespace snemo {
 
 namespace asb {
 
 /// \brief Calorimeter signal generator driver
+///
+/// Example of configuration:
+/// \code
+/// signal_category : string = "calo"
+/// mode : string = "triangle"
+/// rise_time : real as time = 8 ns
+/// fall_time : real as time = 70 ns
+/// channels.sides : integer = 2
+/// channels.columns : integer = 20
+/// channels.rows : integer = 13
+/// channel.1.12.4.rise_time : real as time = 7.5 ns
+/// channel.1.12.4.fall_time : real as time = 72 ns
+/// streaming.guard_time : real as time = 10 ns
+/// \endcode
+///
+/// Per-channel timings are addressed with the layout of the GIDs of the
+/// signal category, after the module number:
+/// - "calo" (type 1302): channels.sides, channels.columns, channels.rows,
+/// - "xcalo" (type 1232): channels.sides, channels.walls, channels.columns,
+///   channels.rows,
+/// - "gveto" (type 1252): channels.sides, channels.walls, channels.columns.
+///
+/// Other categories use the default timings for all their channels. The
+/// numbers of channels default to the SuperNEMO layout, as in the example;
+/// with a channel map handed over by the module, they are taken from the
+/// channels of the geometry instead. Explicit 'channels.*' properties take
+/// precedence in both cases.
+///
+/// The hits piled up in a channel give a single multi signal, built as in
+/// the scin driver: its components are the atomic signals of the hits,
+/// stored as private shapes under the keys "hit<hit ID>".
+///
+/// Streaming mode: the hits of an event are pushed one at a time, in start
+/// time order. The hits of a channel overlapping in time are gathered in a
+/// window, which closes once no further hit can overlap it, that is when
+/// the stream time passes the stop time of its last signal plus the guard
+/// time. The signal of a closed window is emitted at once to a callback, so
+/// that the first signals are available before the whole event is read,
+/// and only the open windows are kept in memory.
+/// \code
+/// csgd.begin_stream([&](const mctools::signal::base_signal& signal_) { ... });
+/// for (...) csgd.push_hit(hit);
+/// csgd.end_stream();
+/// \endcode
+/// If a hit or the callback throws, abort_stream() closes the stream and
+/// drops its open windows; process_streaming() and end_stream() do so on
+/// their own before rethrowing.
 class calo_signal_generator_driver : public base_signal_generator_driver,
                                      private boost::noncopyable {
  public:
@@ -47,6 +102,59 @@ class calo_signal_generator_driver : public base_signal_generator_driver,
   /// Return the driver mode
   mode_type get_mode() const;
 
+  /// Signal shape parameters resolved once at initialization
+  typedef snemo::asb::shape_schema shape_schema;
+
+  /// Return the rise time of the signals of a channel
+  double get_rise_time(const geomtools::geom_id& gid_) const;
+
+  /// Return the fall time of the signals of a channel
+  double get_fall_time(const geomtools::geom_id& gid_) const;
+
+  /// Check if the algorithm supports a degraded mode using less memory
+  ///
+  /// In degraded mode, the hits of a calo block are aggregated in a single
+  /// triangle signal.
+  virtual bool has_degraded_mode() const;
+
+  /// Return the memory held by the working buffers of the algorithm (in bytes)
+  virtual std::size_t get_working_memory() const;
+
+  /// Signature of the callback receiving the signals emitted in streaming mode
+  typedef std::function<void(const mctools::signal::base_signal&)> emit_callback_type;
+
+  /// Set the time added to the stop time of a signal before its window closes
+  void set_guard_time(double guard_time_);
+
+  /// Return the time added to the stop time of a signal before its window closes
+  double get_guard_time() const;
+
+  /// Open a stream emitting the signals of the closed windows to a callback
+  void begin_stream(const emit_callback_type& callback_);
+
+  /// Check if a stream is open
+  bool is_streaming() const;
+
+  /// Consume a hit of the stream, hits coming in non-decreasing start time
+  void push_hit(const mctools::base_step_hit& hit_);
+
+  /// Emit the signals of the windows still open and close the stream
+  void end_stream();
+
+  /// Close the stream without emitting the signals of the open windows
+  void abort_stream();
+
+  /// Stream all the calorimeter hits of an event in start time order
+  void process_streaming(const mctools::simulated_data& sim_data_,
+                         const emit_callback_type& callback_);
+
+  /// Return the maximum number of windows simultaneously open in the last stream
+  std::size_t get_max_open_windows() const;
+
+  /// Signature of the hit loop kernels
+  typedef void (calo_signal_generator_driver::*kernel_type)(
+      const mctools::simulated_data& sim_data_, mctools::signal::signal_data& sim_signal_data_);
+
  protected:
   /// Initialize the algorithm through configuration properties
   virtual void _initialize(const datatools::properties& config_);
@@ -61,17 +169,80 @@ class calo_signal_generator_driver : public base_signal_generator_driver,
   void _process(const mctools::simulated_data& sim_data_,
                 mctools::signal::signal_data& sim_signal_data_);
 
+  /// Run the algorithm on a batch of events
+  void _process_batch(const std::vector<const mctools::simulated_data*>& sim_data_batch_,
+                      const std::vector<mctools::signal::signal_data*>& sim_signal_data_batch_);
+
   // Smart print
   void _tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
                   const std::string& indent_ = "", bool inherit_ = false) const;
 
  private:
-  /// Run the triangle mode process
-  void _process_triangle_mode_(const mctools::simulated_data& sim_data_,
-                               mctools::signal::signal_data& sim_signal_data_);
+  /// Return the index of a channel in the per-channel arrays, or -1
+  int _channel_index_(const geomtools::geom_id& gid_) const;
+
+  /// Build the per-channel arrays of rise and fall times, laid out after the signal category
+  void _init_channel_timings_(const datatools::properties& config_);
+
+  /// Run the hit loop specialized on a signal shape policy
+  template <class ShapePolicy>
+  void _process_hits_(const mctools::simulated_data& sim_data_,
+                      mctools::signal::signal_data& sim_signal_data_);
+
+  /// Emit and close the stream windows ending before a time
+  void _close_windows_(double time_);
+
+  /// Run the degraded hit loop, aggregating the hits per calo block
+  template <class ShapePolicy>
+  void _process_aggregated_hits_(
+      const mctools::simulated_data::hit_handle_collection_type& calo_hits_,
+      mctools::signal::signal_data& sim_signal_data_);
 
  private:
   mode_type _mode_ = MODE_INVALID;  //!< Mode type for calo signals
+  kernel_type _kernel_ = nullptr;   //!< Hit loop kernel resolved at initialization
+
+  // Configuration:
+  double _default_rise_time_;            //!< Default rise time of the signals
+  double _default_fall_time_;            //!< Default fall time of the signals
+  uint32_t _channel_type_ = 0;           //!< Geometry type of the channels (0: no layout)
+  std::vector<std::string> _channel_address_names_;  //!< Names of the channel addresses
+  std::vector<std::size_t> _channel_extents_;  //!< Number of values of each channel address
+
+  // Working data:
+  shape_schema _schema_;                 //!< Shape parameters resolved at initialization
+  std::vector<double> _rise_times_;      //!< Rise times indexed by channel
+  std::vector<double> _fall_times_;      //!< Fall times indexed by channel
+  double _amplitude_per_energy_ = 0.0;  //!< Conversion factor from energy deposit to amplitude
+  typedef std::pair<packed_gid::key_type, std::size_t> gid_key_entry;
+  std::vector<gid_key_entry> _hit_gid_keys_;  //!< Packed GID key and atomic signal index per hit
+  std::vector<mctools::signal::base_signal> _atomic_signals_;  //!< Atomic signal per hit
+
+  // Streaming mode:
+  struct stream_window {
+    std::vector<mctools::signal::base_signal> signals;  //!< Signals of the window
+    double end = 0.0;  //!< Time after which no further hit can overlap the window
+  };
+  typedef std::pair<double, packed_gid::key_type> window_end_entry;
+  double _guard_time_;                         //!< Guard time after the stop time of a signal
+  bool _streaming_ = false;                    //!< Stream open flag
+  emit_callback_type _stream_callback_;        //!< Receiver of the emitted signals
+  double _stream_time_ref_;                    //!< Time reference of the stream (first hit)
+  double _stream_time_;                        //!< Start time of the last pushed hit
+  std::string _stream_category_;               //!< Category label of the streamed signals
+  std::map<geomtools::geom_id, packed_gid::key_type>
+      _stream_fallback_keys_;                  //!< Window keys of the GIDs that cannot be packed
+  std::unordered_map<packed_gid::key_type, stream_window, packed_gid::hash>
+      _stream_windows_;                        //!< Open windows per channel
+  std::priority_queue<window_end_entry, std::vector<window_end_entry>,
+                      std::greater<window_end_entry>>
+      _stream_window_ends_;                    //!< Window ends, earliest first (lazy)
+  std::size_t _max_open_windows_ = 0;          //!< Maximum number of open windows
+  std::vector<const mctools::base_step_hit*> _stream_hits_;  //!< Time-sorted hits of an event
+
+  // Registration of the driver class :
+  DATATOOLS_FACTORY_SYSTEM_AUTO_REGISTRATION_INTERFACE(base_signal_generator_driver,
+                                                       calo_signal_generator_driver)
 };
 
 }  // end of namespace asb
@@ -0,0 +1,97 @@
+// category_registry.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/category_registry.h>
+
+// Standard library:
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+/// \brief Storage of the interned categories
+///
+/// Labels are only appended, so their addresses never change. The deque
+/// is read without lock by get_label: categories are interned at
+/// initialization, before the processing threads look them up.
+struct category_store {
+  std::mutex mutex;
+  std::deque<std::string> labels;                         //!< Labels indexed by ID
+  std::map<std::string, category_registry::id_type> ids;  //!< IDs indexed by label
+};
+
+category_store& store() {
+  static category_store _store;
+  return _store;
+}
+
+}  // end of anonymous namespace
+
+const category_registry::id_type category_registry::INVALID_ID;
+
+category_registry::id_type category_registry::intern(const std::string& label_) {
+  DT_THROW_IF(label_.empty(), std::logic_error, "Cannot intern an empty category!");
+  category_store& s = store();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto found = s.ids.find(label_);
+  if (found != s.ids.end()) {
+    return found->second;
+  }
+  DT_THROW_IF(s.labels.size() >= INVALID_ID, std::range_error,
+              "Too many interned categories!");
+  const id_type id = static_cast<id_type>(s.labels.size());
+  s.labels.push_back(label_);
+  s.ids[label_] = id;
+  return id;
+}
+
+category_registry::id_type category_registry::find(const std::string& label_) {
+  category_store& s = store();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto found = s.ids.find(label_);
+  return found == s.ids.end() ? INVALID_ID : found->second;
+}
+
+const std::string& category_registry::get_label(id_type id_) {
+  const std::deque<std::string>& labels = store().labels;
+  DT_THROW_IF(id_ >= labels.size(), std::range_error, "Invalid category ID " << id_ << "!");
+  return labels[id_];
+}
+
+std::size_t category_registry::size() {
+  category_store& s = store();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.labels.size();
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,60 @@
+// snemo/asb/category_registry.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-31
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_CATEGORY_REGISTRY_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_CATEGORY_REGISTRY_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Process-wide registry of interned hit and signal categories
+///
+/// Categories such as "calo" or "gg" are resolved once, at initialization,
+/// into small integer IDs. The label of an interned category is stored only
+/// once and is never moved, so references to it stay valid for the whole
+/// process and can be passed to the mctools APIs without building new
+/// strings in the processing loops.
+///
+/// Interning is thread-safe and is meant for initialization code. Looking
+/// up the label of an ID takes no lock and can be done in processing loops,
+/// provided that no category is interned concurrently: all categories
+/// must be interned before the processing threads are started.
+class category_registry {
+ public:
+  /// Type of category IDs
+  typedef uint16_t id_type;
+
+  /// Invalid category ID
+  static const id_type INVALID_ID = 0xFFFF;
+
+  /// Intern a category and return its ID
+  static id_type intern(const std::string& label_);
+
+  /// Return the ID of a category, or INVALID_ID if it has not been interned
+  static id_type find(const std::string& label_);
+
+  /// Return the label of an interned category (no lock, see above)
+  static const std::string& get_label(id_type id_);
+
+  /// Return the number of interned categories
+  static std::size_t size();
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_CATEGORY_REGISTRY_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,328 @@
+// channel_map.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/channel_map.h>
+
+// Standard library:
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+// System:
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/multi_properties.h>
+#include <bayeux/datatools/utils.h>
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/id_mgr.h>
+#include <bayeux/geomtools/mapping.h>
+#include <bayeux/geomtools/model_factory.h>
+
+// This project:
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+/// \brief Header of a channel map file
+struct file_header {
+  char magic[8];               //!< File signature
+  uint32_t version;            //!< Format version
+  uint32_t byte_order;         //!< Byte order mark
+  uint64_t digest;             //!< Digest of the geometry setup
+  uint64_t number_of_channels; //!< Number of channels
+};
+
+const char file_magic[8] = {'A', 'S', 'B', 'C', 'M', 'A', 'P', '\0'};
+const uint32_t byte_order_mark = 0x01020304;
+
+// Expected size of a file with a given number of channels
+std::size_t file_size(std::size_t number_of_channels_) {
+  return sizeof(file_header) + number_of_channels_ * (sizeof(uint64_t) + 3 * sizeof(double));
+}
+
+}  // end of anonymous namespace
+
+const uint32_t channel_map::FORMAT_VERSION;
+
+channel_map::channel_map() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  return;
+}
+
+channel_map::~channel_map() {
+  reset();
+  return;
+}
+
+void channel_map::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+uint64_t channel_map::compute_digest(const geomtools::manager& geometry_manager_,
+                                     const std::vector<std::string>& categories_) {
+  uint64_t digest = hash_utils::offset_basis;
+  digest = hash_utils::update(digest, static_cast<uint64_t>(FORMAT_VERSION));
+  digest = hash_utils::update(digest, geometry_manager_.get_setup_label());
+  digest = hash_utils::update(digest, geometry_manager_.get_setup_version());
+  // Content of the geometry files, from which the channels and their
+  // placements are derived:
+  const datatools::multi_properties& models = geometry_manager_.get_factory().get_mp();
+  for (const auto* model : models.ordered_entries()) {
+    digest = hash_utils::update(digest, model->get_key());
+    digest = hash_utils::update(digest, model->get_meta());
+    digest = hash_utils::hash_properties(model->get_properties(), digest);
+  }
+  // Numbering scheme of the channels:
+  const geomtools::id_mgr& id_mgr = geometry_manager_.get_id_mgr();
+  for (const auto& category : categories_) {
+    digest = hash_utils::update(digest, category);
+    if (id_mgr.has_category_info(category)) {
+      const geomtools::id_mgr::category_info& info = id_mgr.get_category_info(category);
+      digest = hash_utils::update(digest, static_cast<uint64_t>(info.get_type()));
+      digest = hash_utils::update(digest, static_cast<uint64_t>(info.get_depth()));
+      for (const auto& address : info.get_addresses()) {
+        digest = hash_utils::update(digest, address);
+      }
+    }
+  }
+  return digest;
+}
+
+std::string channel_map::make_filename(uint64_t digest_) {
+  return "channel_map_" + hash_utils::to_hex(digest_) + ".bin";
+}
+
+void channel_map::build(const geomtools::manager& geometry_manager_,
+                        const std::vector<std::string>& categories_) {
+  reset();
+  packed_gid_codec codec;
+  const geomtools::id_mgr& id_mgr = geometry_manager_.get_id_mgr();
+  for (const auto& category : categories_) {
+    if (!id_mgr.has_category_info(category)) {
+      DT_LOG_WARNING(_logging_priority_,
+                     "Geometry category '" << category << "' does not exist; skip it.");
+      continue;
+    }
+    codec.add_category(id_mgr, category);
+  }
+  std::vector<std::pair<uint64_t, const geomtools::geom_info*>> channels;
+  for (const auto& entry : geometry_manager_.get_mapping().get_geom_infos()) {
+    if (!codec.has_type(entry.first.get_type())) continue;
+    channels.push_back(std::make_pair(codec.encode(entry.first), &entry.second));
+  }
+  std::sort(channels.begin(), channels.end(),
+            [](const std::pair<uint64_t, const geomtools::geom_info*>& a_,
+               const std::pair<uint64_t, const geomtools::geom_info*>& b_) {
+              return a_.first < b_.first;
+            });
+  _key_storage_.reserve(channels.size());
+  _position_storage_.reserve(3 * channels.size());
+  for (const auto& channel : channels) {
+    _key_storage_.push_back(channel.first);
+    const geomtools::vector_3d& position = channel.second->get_world_placement().get_translation();
+    _position_storage_.push_back(position.x());
+    _position_storage_.push_back(position.y());
+    _position_storage_.push_back(position.z());
+  }
+  _keys_ = _key_storage_.data();
+  _positions_ = _position_storage_.data();
+  _size_ = _key_storage_.size();
+  _digest_ = compute_digest(geometry_manager_, categories_);
+  DT_LOG_DEBUG(_logging_priority_, "Built a channel map with " << _size_ << " channels.");
+  return;
+}
+
+bool channel_map::load_or_build(const geomtools::manager& geometry_manager_,
+                                const std::string& cache_directory_,
+                                const std::vector<std::string>& categories_) {
+  std::string directory = cache_directory_;
+  datatools::fetch_path_with_env(directory);
+  const uint64_t digest = compute_digest(geometry_manager_, categories_);
+  const std::string path = directory + "/" + make_filename(digest);
+  if (load(path, digest)) {
+    DT_LOG_DEBUG(_logging_priority_, "Loaded channel map '" << path << "'.");
+    return true;
+  }
+  build(geometry_manager_, categories_);
+  try {
+    file_utils::make_directories(directory);
+    save(path);
+  } catch (std::exception& error) {
+    DT_LOG_WARNING(_logging_priority_, "Cannot save channel map : " << error.what());
+  }
+  return false;
+}
+
+bool channel_map::load(const std::string& path_, uint64_t digest_) {
+  reset();
+  const int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 ||
+      static_cast<std::size_t>(file_stat.st_size) < sizeof(file_header)) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = file_stat.st_size;
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  const file_header* header = static_cast<const file_header*>(mapping);
+  if (std::memcmp(header->magic, file_magic, sizeof(file_magic)) != 0 ||
+      header->version != FORMAT_VERSION || header->byte_order != byte_order_mark ||
+      header->digest != digest_ || file_size(header->number_of_channels) != size) {
+    DT_LOG_WARNING(_logging_priority_, "Ignore invalid or stale channel map '" << path_ << "'.");
+    ::munmap(mapping, size);
+    return false;
+  }
+  _mapping_ = mapping;
+  _mapping_size_ = size;
+  _size_ = header->number_of_channels;
+  const char* data = static_cast<const char*>(mapping) + sizeof(file_header);
+  _keys_ = reinterpret_cast<const uint64_t*>(data);
+  _positions_ = reinterpret_cast<const double*>(data + _size_ * sizeof(uint64_t));
+  _digest_ = digest_;
+  return true;
+}
+
+void channel_map::save(const std::string& path_) const {
+  DT_THROW_IF(!is_valid(), std::logic_error, "Cannot save an invalid channel map!");
+  file_header header;
+  std::memcpy(header.magic, file_magic, sizeof(file_magic));
+  header.version = FORMAT_VERSION;
+  header.byte_order = byte_order_mark;
+  header.digest = _digest_;
+  header.number_of_channels = _size_;
+  // Unique among the processes and threads saving the same table:
+  const std::string tmp_path = file_utils::make_temporary_file(path_);
+  try {
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    DT_THROW_IF(!out, std::runtime_error, "Cannot open file '" << tmp_path << "'!");
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(_keys_), _size_ * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(_positions_), 3 * _size_ * sizeof(double));
+    out.close();
+    DT_THROW_IF(!out, std::runtime_error, "Cannot write file '" << tmp_path << "'!");
+    // Publish the file atomically, concurrent jobs may load it at any time:
+    DT_THROW_IF(std::rename(tmp_path.c_str(), path_.c_str()) != 0, std::runtime_error,
+                "Cannot publish file '" << path_ << "'!");
+  } catch (...) {
+    std::remove(tmp_path.c_str());
+    throw;
+  }
+  return;
+}
+
+bool channel_map::is_valid() const { return _digest_ != 0; }
+
+bool channel_map::is_mapped() const { return _mapping_ != nullptr; }
+
+uint64_t channel_map::get_digest() const { return _digest_; }
+
+std::size_t channel_map::size() const { return _size_; }
+
+int channel_map::get_channel_index(packed_gid::key_type key_) const {
+  const uint64_t* last = _keys_ + _size_;
+  const uint64_t* found = std::lower_bound(_keys_, last, key_);
+  if (found == last || *found != key_) {
+    return -1;
+  }
+  return static_cast<int>(found - _keys_);
+}
+
+int channel_map::get_channel_index(const geomtools::geom_id& gid_) const {
+  packed_gid::key_type key;
+  if (!packed_gid::try_encode(gid_, key)) {
+    return -1;
+  }
+  return get_channel_index(key);
+}
+
+packed_gid::key_type channel_map::get_key(std::size_t index_) const {
+  DT_THROW_IF(index_ >= _size_, std::range_error, "Invalid channel index " << index_ << "!");
+  return _keys_[index_];
+}
+
+const double* channel_map::get_position(std::size_t index_) const {
+  DT_THROW_IF(index_ >= _size_, std::range_error, "Invalid channel index " << index_ << "!");
+  return _positions_ + 3 * index_;
+}
+
+std::vector<std::size_t> channel_map::get_address_extents(uint32_t type_) const {
+  std::vector<std::size_t> extents;
+  // Keys start with the geometry type: the channels of a type are contiguous.
+  const uint64_t* last = _keys_ + _size_;
+  const uint64_t* first = std::lower_bound(_keys_, last, static_cast<uint64_t>(type_) << 48);
+  geomtools::geom_id gid;
+  for (const uint64_t* key = first; key != last && packed_gid::get_type(*key) == type_; key++) {
+    if (extents.empty()) {
+      extents.assign(packed_gid::MAX_DEPTH, 1);
+    }
+    packed_gid::decode(*key, packed_gid::MAX_DEPTH, gid);
+    for (std::size_t iaddress = 0; iaddress < packed_gid::MAX_DEPTH; iaddress++) {
+      if (gid.is_any(iaddress) || gid.is_invalid(iaddress)) continue;
+      extents[iaddress] = std::max(extents[iaddress], std::size_t(gid.get(iaddress)) + 1);
+    }
+  }
+  return extents;
+}
+
+void channel_map::_unmap_() {
+  if (_mapping_ != nullptr) {
+    ::munmap(_mapping_, _mapping_size_);
+    _mapping_ = nullptr;
+    _mapping_size_ = 0;
+  }
+  return;
+}
+
+void channel_map::reset() {
+  _unmap_();
+  _key_storage_.clear();
+  _position_storage_.clear();
+  _keys_ = nullptr;
+  _positions_ = nullptr;
+  _size_ = 0;
+  _digest_ = 0;
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,151 @@
+// snemo/asb/channel_map.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-07
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_CHANNEL_MAP_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_CHANNEL_MAP_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/manager.h>
+
+// This project:
+#include <snemo/asb/packed_gid.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Table of the readout channels derived from the geometry
+///
+/// The channels of some geometry categories (calorimeter, X-wall, gamma veto
+/// and tracker cells by default) are indexed densely, in the order of their
+/// packed geometry IDs, together with per-channel constants (world position
+/// of the channel).
+///
+/// Building the table walks the geometry mapping. The table can be saved in
+/// a versioned binary file, keyed by a digest of the geometry setup, and
+/// later memory-mapped as is: no parsing nor copy is needed at load time.
+/// The digest covers the setup label and version, the geometry models
+/// loaded from the geometry files and the numbering scheme of the
+/// categories, so that any change of the geometry invalidates the file.
+///
+/// The table complements the geometry mapping and does not replace it: the
+/// geometry service still builds its own mapping. It is handed over to the
+/// signal generator drivers, for their per-channel tables: the calorimeter
+/// driver takes the layout of its per-channel timings from it.
+///
+/// File layout (native byte order, 8-byte aligned):
+/// - header: magic, format version, byte order mark, digest, number of channels,
+/// - packed keys of the channels (uint64 x N, sorted),
+/// - world positions of the channels (double x 3N).
+class channel_map : private boost::noncopyable {
+ public:
+  /// Version of the file format
+  static const uint32_t FORMAT_VERSION = 1;
+
+  /// Constructor
+  channel_map();
+
+  /// Destructor
+  ~channel_map();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Compute the digest identifying the table derived from a geometry setup
+  static uint64_t compute_digest(const geomtools::manager& geometry_manager_,
+                                 const std::vector<std::string>& categories_);
+
+  /// Return the name of the cache file for a digest
+  static std::string make_filename(uint64_t digest_);
+
+  /// Build the table from the geometry
+  void build(const geomtools::manager& geometry_manager_,
+             const std::vector<std::string>& categories_ = packed_gid_codec::default_categories());
+
+  /// Load the table from a cache directory if a valid file exists, otherwise
+  /// build it and save it in the cache directory
+  ///
+  /// Return true if the table was loaded from the cache.
+  bool load_or_build(const geomtools::manager& geometry_manager_,
+                     const std::string& cache_directory_,
+                     const std::vector<std::string>& categories_ =
+                         packed_gid_codec::default_categories());
+
+  /// Memory-map a table file, return false if it is missing or invalid for this digest
+  bool load(const std::string& path_, uint64_t digest_);
+
+  /// Save the table in a file
+  void save(const std::string& path_) const;
+
+  /// Check if the table is available
+  bool is_valid() const;
+
+  /// Check if the table is memory-mapped from a file
+  bool is_mapped() const;
+
+  /// Return the digest of the table
+  uint64_t get_digest() const;
+
+  /// Return the number of channels
+  std::size_t size() const;
+
+  /// Return the index of a channel, or -1 if it is unknown
+  int get_channel_index(packed_gid::key_type key_) const;
+
+  /// Return the index of a channel, or -1 if it is unknown
+  int get_channel_index(const geomtools::geom_id& gid_) const;
+
+  /// Return the packed key of a channel
+  packed_gid::key_type get_key(std::size_t index_) const;
+
+  /// Return the world position (x, y, z) of a channel
+  const double* get_position(std::size_t index_) const;
+
+  /// Return the extents of the addresses of the channels of a geometry type
+  ///
+  /// The extent of an address is its highest value plus one, 'any' and
+  /// invalid addresses aside. Unused trailing addresses have an extent of
+  /// one. The result is empty if the map has no channel of this type.
+  std::vector<std::size_t> get_address_extents(uint32_t type_) const;
+
+  /// Reset
+  void reset();
+
+ private:
+  void _unmap_();
+
+ private:
+  datatools::logger::priority _logging_priority_;
+  uint64_t _digest_ = 0;                      //!< Digest of the geometry setup
+  std::vector<uint64_t> _key_storage_;        //!< Owned keys (built table)
+  std::vector<double> _position_storage_;     //!< Owned positions (built table)
+  const uint64_t* _keys_ = nullptr;           //!< Sorted packed keys of the channels
+  const double* _positions_ = nullptr;        //!< World positions of the channels
+  std::size_t _size_ = 0;                     //!< Number of channels
+  void* _mapping_ = nullptr;                  //!< Memory-mapped file, if any
+  std::size_t _mapping_size_ = 0;             //!< Size of the memory-mapped file
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_CHANNEL_MAP_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
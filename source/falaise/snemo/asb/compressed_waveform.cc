@@ -0,0 +1,254 @@
+// compressed_waveform.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/compressed_waveform.h>
+
+// Standard library:
+#include <algorithm>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Gap between two regions below which they are merged: storing the gap
+// samples costs less than the description of a new region
+const uint32_t merge_gap = 8;
+
+// Zigzag encoding of a difference, small magnitudes giving small codes
+uint32_t zigzag(int delta_) {
+  return (static_cast<uint32_t>(delta_) << 1) ^ static_cast<uint32_t>(delta_ >> 31);
+}
+
+// Number of bits needed to store a value
+unsigned int bit_width(uint32_t value_) {
+  unsigned int width = 0;
+  while (value_ != 0) {
+    value_ >>= 1;
+    width++;
+  }
+  return width;
+}
+
+}  // end of anonymous namespace
+
+compressed_waveform::compressed_waveform() { return; }
+
+void compressed_waveform::set_adc_bits(unsigned int adc_bits_) {
+  DT_THROW_IF(adc_bits_ == 0 || adc_bits_ > 16, std::domain_error,
+              "Invalid ADC resolution " << adc_bits_ << " bits!");
+  _adc_bits_ = adc_bits_;
+  return;
+}
+
+unsigned int compressed_waveform::get_adc_bits() const { return _adc_bits_; }
+
+void compressed_waveform::set_threshold(unsigned int threshold_) {
+  _threshold_ = threshold_;
+  return;
+}
+
+void compressed_waveform::set_padding(unsigned int padding_) {
+  _padding_ = padding_;
+  return;
+}
+
+void compressed_waveform::_append_bits_(uint64_t value_, unsigned int width_) {
+  const std::size_t word = _stream_bits_ >> 5;
+  const unsigned int offset = _stream_bits_ & 31;
+  _stream_[word] |= static_cast<uint32_t>(value_ << offset);
+  if (offset + width_ > 32) {
+    _stream_[word + 1] |= static_cast<uint32_t>(value_ >> (32 - offset));
+  }
+  _stream_bits_ += width_;
+  return;
+}
+
+void compressed_waveform::encode(const code_type* samples_, std::size_t number_of_samples_,
+                                 code_type baseline_) {
+  reset();
+  _number_of_samples_ = number_of_samples_;
+  _baseline_ = baseline_;
+  const int baseline = baseline_;
+  const int threshold = _threshold_;
+
+  // Regions around the samples out of the suppression band:
+  for (std::size_t isample = 0; isample < number_of_samples_; isample++) {
+    DT_THROW_IF(samples_[isample] >> _adc_bits_, std::range_error,
+                "Sample #" << isample << " exceeds the ADC range!");
+    const int deviation = static_cast<int>(samples_[isample]) - baseline;
+    if (deviation <= threshold && deviation >= -threshold) continue;
+    const uint32_t first = isample > _padding_ ? isample - _padding_ : 0;
+    const uint32_t stop = std::min<std::size_t>(number_of_samples_, isample + 1 + _padding_);
+    if (!_regions_.empty() &&
+        first <= _regions_.back().first_sample + _regions_.back().length + merge_gap) {
+      _regions_.back().length = stop - _regions_.back().first_sample;
+    } else {
+      region_type region;
+      region.first_sample = first;
+      region.length = stop - first;
+      _regions_.push_back(region);
+    }
+  }
+
+  // Zigzag-encoded differences, packed with the width of each region:
+  std::size_t max_bits = 0;
+  for (auto& region : _regions_) {
+    uint32_t max_code = 0;
+    int previous = baseline;
+    for (uint32_t isample = region.first_sample; isample < region.first_sample + region.length;
+         isample++) {
+      const int delta = static_cast<int>(samples_[isample]) - previous;
+      max_code = std::max(max_code, zigzag(delta));
+      previous = samples_[isample];
+    }
+    region.width = bit_width(max_code);
+    max_bits += region.width * region.length;
+  }
+  // One spare word lets the decoder always read two words:
+  _stream_.assign((max_bits + 31) / 32 + 1, 0);
+  for (auto& region : _regions_) {
+    region.bit_offset = _stream_bits_;
+    int previous = baseline;
+    for (uint32_t isample = region.first_sample; isample < region.first_sample + region.length;
+         isample++) {
+      const int delta = static_cast<int>(samples_[isample]) - previous;
+      _append_bits_(zigzag(delta), region.width);
+      previous = samples_[isample];
+    }
+  }
+  return;
+}
+
+void compressed_waveform::encode(const std::vector<code_type>& samples_, code_type baseline_) {
+  encode(samples_.data(), samples_.size(), baseline_);
+  return;
+}
+
+void compressed_waveform::decode(code_type* samples_) const {
+  std::fill(samples_, samples_ + _number_of_samples_, _baseline_);
+  const uint32_t* stream = _stream_.data();
+  for (const auto& region : _regions_) {
+    // Null differences only: the region sits at the baseline.
+    if (region.width == 0) continue;
+    const uint64_t mask = (uint64_t(1) << region.width) - 1;
+    uint64_t bit = region.bit_offset;
+    int value = _baseline_;
+    code_type* out = samples_ + region.first_sample;
+    for (uint32_t isample = 0; isample < region.length; isample++) {
+      const std::size_t word = bit >> 5;
+      const uint64_t window = stream[word] | (static_cast<uint64_t>(stream[word + 1]) << 32);
+      const uint32_t code = static_cast<uint32_t>((window >> (bit & 31)) & mask);
+      value += static_cast<int>(code >> 1) ^ -static_cast<int>(code & 1);
+      out[isample] = static_cast<code_type>(value);
+      bit += region.width;
+    }
+  }
+  return;
+}
+
+void compressed_waveform::decode(std::vector<code_type>& samples_) const {
+  samples_.resize(_number_of_samples_);
+  decode(samples_.data());
+  return;
+}
+
+std::size_t compressed_waveform::get_number_of_samples() const { return _number_of_samples_; }
+
+compressed_waveform::code_type compressed_waveform::get_baseline() const { return _baseline_; }
+
+const std::vector<compressed_waveform::region_type>& compressed_waveform::get_regions() const {
+  return _regions_;
+}
+
+std::size_t compressed_waveform::get_compressed_size() const {
+  // Number of samples, baseline and ADC resolution, then the regions and the stream:
+  const std::size_t region_size = 3 * sizeof(uint32_t) + sizeof(uint8_t);
+  return sizeof(uint32_t) + sizeof(code_type) + sizeof(uint8_t) + _regions_.size() * region_size +
+         ((_stream_bits_ + 31) / 32) * sizeof(uint32_t);
+}
+
+void compressed_waveform::export_to(datatools::properties& store_,
+                                    const std::string& prefix_) const {
+  std::vector<int> regions;
+  regions.reserve(4 * _regions_.size());
+  for (const auto& region : _regions_) {
+    regions.push_back(region.first_sample);
+    regions.push_back(region.length);
+    regions.push_back(region.bit_offset);
+    regions.push_back(region.width);
+  }
+  std::vector<int> stream(_stream_.begin(), _stream_.begin() + (_stream_bits_ + 31) / 32);
+  store_.store_integer(prefix_ + "samples", _number_of_samples_);
+  store_.store_integer(prefix_ + "baseline", _baseline_);
+  store_.store_integer(prefix_ + "adc_bits", _adc_bits_);
+  store_.store(prefix_ + "regions", regions);
+  store_.store(prefix_ + "stream", stream);
+  return;
+}
+
+void compressed_waveform::import_from(const datatools::properties& store_,
+                                      const std::string& prefix_) {
+  reset();
+  set_adc_bits(store_.fetch_integer(prefix_ + "adc_bits"));
+  _number_of_samples_ = store_.fetch_integer(prefix_ + "samples");
+  _baseline_ = store_.fetch_integer(prefix_ + "baseline");
+  std::vector<int> regions;
+  store_.fetch(prefix_ + "regions", regions);
+  DT_THROW_IF(regions.size() % 4 != 0, std::logic_error, "Invalid compressed waveform regions!");
+  std::vector<int> stream;
+  store_.fetch(prefix_ + "stream", stream);
+  for (std::size_t i = 0; i < regions.size(); i += 4) {
+    region_type region;
+    region.first_sample = regions[i];
+    region.length = regions[i + 1];
+    region.bit_offset = regions[i + 2];
+    region.width = regions[i + 3];
+    DT_THROW_IF(region.first_sample + region.length > _number_of_samples_ || region.width > 17 ||
+                    region.bit_offset + uint64_t(region.width) * region.length >
+                        32 * uint64_t(stream.size()),
+                std::logic_error, "Invalid compressed waveform region!");
+    _regions_.push_back(region);
+  }
+  _stream_.assign(stream.begin(), stream.end());
+  _stream_bits_ = 32 * _stream_.size();
+  _stream_.push_back(0);
+  return;
+}
+
+void compressed_waveform::reset() {
+  _number_of_samples_ = 0;
+  _baseline_ = 0;
+  _regions_.clear();
+  _stream_.clear();
+  _stream_bits_ = 0;
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,129 @@
+// snemo/asb/compressed_waveform.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-07
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_COMPRESSED_WAVEFORM_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_COMPRESSED_WAVEFORM_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/properties.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Compact container of a digitized waveform (ADC codes)
+///
+/// Samples within the suppression threshold of the baseline are dropped;
+/// the remaining samples are grouped in regions, padded with a few samples
+/// on each side. In each region, the first code is stored as a difference
+/// to the baseline and the next ones as differences to their predecessor.
+/// The zigzag-encoded differences are bit-packed with the smallest width
+/// fitting the whole region, which never exceeds the ADC resolution plus
+/// one bit.
+///
+/// With a null threshold, the compression is lossless. Otherwise, the
+/// suppressed samples are decoded as the baseline.
+///
+/// Decoding reads the packed stream one 64-bit word at a time, with no
+/// branch per sample but the region boundaries.
+///
+/// The ASB drivers produce analog signal shapes, not ADC codes: this
+/// container is not filled by the module. It is meant for the digitization
+/// stage, which can store it in its output banks through export_to().
+class compressed_waveform {
+ public:
+  /// ADC code type
+  typedef uint16_t code_type;
+
+  /// \brief Region of kept samples
+  struct region_type {
+    uint32_t first_sample = 0;  //!< Index of the first sample
+    uint32_t length = 0;        //!< Number of samples
+    uint32_t bit_offset = 0;    //!< Offset of the packed differences in the stream
+    uint8_t width = 0;          //!< Width of the packed differences (in bits)
+  };
+
+  /// Constructor
+  compressed_waveform();
+
+  /// Set the ADC resolution (in bits, 12 or 14 for SuperNEMO digitizers)
+  void set_adc_bits(unsigned int adc_bits_);
+
+  /// Return the ADC resolution
+  unsigned int get_adc_bits() const;
+
+  /// Set the suppression threshold around the baseline (in ADC codes, 0: lossless)
+  void set_threshold(unsigned int threshold_);
+
+  /// Set the number of samples kept before and after each region
+  void set_padding(unsigned int padding_);
+
+  /// Compress a waveform around a baseline
+  void encode(const code_type* samples_, std::size_t number_of_samples_, code_type baseline_);
+
+  /// Compress a waveform around a baseline
+  void encode(const std::vector<code_type>& samples_, code_type baseline_);
+
+  /// Decode the waveform in a buffer of the original number of samples
+  void decode(code_type* samples_) const;
+
+  /// Decode the waveform
+  void decode(std::vector<code_type>& samples_) const;
+
+  /// Return the number of samples of the original waveform
+  std::size_t get_number_of_samples() const;
+
+  /// Return the baseline
+  code_type get_baseline() const;
+
+  /// Return the regions of kept samples
+  const std::vector<region_type>& get_regions() const;
+
+  /// Return the size of the compressed representation (in bytes)
+  std::size_t get_compressed_size() const;
+
+  /// Store the compressed waveform in properties, with a key prefix
+  void export_to(datatools::properties& store_, const std::string& prefix_) const;
+
+  /// Load a compressed waveform from properties, with a key prefix
+  void import_from(const datatools::properties& store_, const std::string& prefix_);
+
+  /// Reset
+  void reset();
+
+ private:
+  void _append_bits_(uint64_t value_, unsigned int width_);
+
+ private:
+  // Configuration:
+  unsigned int _adc_bits_ = 12;  //!< ADC resolution
+  unsigned int _threshold_ = 0;  //!< Suppression threshold around the baseline
+  unsigned int _padding_ = 2;    //!< Samples kept around the regions
+
+  // Compressed data:
+  uint32_t _number_of_samples_ = 0;  //!< Number of samples of the original waveform
+  code_type _baseline_ = 0;          //!< Baseline
+  std::vector<region_type> _regions_;  //!< Regions of kept samples
+  std::vector<uint32_t> _stream_;      //!< Packed zigzag differences
+  uint64_t _stream_bits_ = 0;          //!< Number of used bits in the stream
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_COMPRESSED_WAVEFORM_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,240 @@
+// fixed_point_codec.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/fixed_point_codec.h>
+
+// Standard library:
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+const std::string& time_resolution_key() {
+  static const std::string _key("asb.fixed_point.time_resolution");
+  return _key;
+}
+
+const std::string& amplitude_full_scale_key() {
+  static const std::string _key("asb.fixed_point.amplitude_full_scale");
+  return _key;
+}
+
+// Store a real parameter with its unit symbol
+void store_with_unit(datatools::properties& aux_, const std::string& key_, double value_,
+                     const std::string& unit_) {
+  aux_.store_real_with_explicit_unit(key_, value_);
+  aux_.set_unit_symbol(key_, unit_);
+  return;
+}
+
+}  // end of anonymous namespace
+
+const int fixed_point_codec::max_amplitude_code;
+
+bool fixed_point_codec::is_encoded(const mctools::signal::signal_data& signal_data_) {
+  return signal_data_.get_auxiliaries().has_key(time_resolution_key());
+}
+
+fixed_point_codec::fixed_point_codec() {
+  _time_resolution_ = 10.0 * CLHEP::picosecond;
+  _amplitude_full_scale_ = 4.0 * CLHEP::volt;
+  _time_keys_[0] = mctools::signal::base_signal::shape_key("t0");
+  _time_keys_[1] = mctools::signal::base_signal::shape_key("t1");
+  _time_keys_[2] = mctools::signal::base_signal::shape_key("t2");
+  _amplitude_key_ = mctools::signal::base_signal::shape_key("amplitude");
+  return;
+}
+
+void fixed_point_codec::initialize(const datatools::properties& config_) {
+  if (config_.has_key("time_resolution")) {
+    double resolution = config_.fetch_real("time_resolution");
+    if (!config_.has_explicit_unit("time_resolution")) {
+      resolution *= CLHEP::picosecond;
+    }
+    set_time_resolution(resolution);
+  }
+  if (config_.has_key("amplitude_full_scale")) {
+    double full_scale = config_.fetch_real("amplitude_full_scale");
+    if (!config_.has_explicit_unit("amplitude_full_scale")) {
+      full_scale *= CLHEP::volt;
+    }
+    set_amplitude_full_scale(full_scale);
+  }
+  return;
+}
+
+void fixed_point_codec::set_time_resolution(double resolution_) {
+  DT_THROW_IF(!(resolution_ > 0.0), std::domain_error, "Invalid time resolution!");
+  _time_resolution_ = resolution_;
+  return;
+}
+
+double fixed_point_codec::get_time_resolution() const { return _time_resolution_; }
+
+void fixed_point_codec::set_amplitude_full_scale(double full_scale_) {
+  DT_THROW_IF(!(full_scale_ > 0.0), std::domain_error, "Invalid amplitude full scale!");
+  _amplitude_full_scale_ = full_scale_;
+  return;
+}
+
+double fixed_point_codec::get_amplitude_full_scale() const { return _amplitude_full_scale_; }
+
+double fixed_point_codec::get_amplitude_lsb() const {
+  return _amplitude_full_scale_ / max_amplitude_code;
+}
+
+bool fixed_point_codec::encode_time(double time_, int& code_) const {
+  const double steps = std::round(time_ / _time_resolution_);
+  if (!(std::abs(steps) <= std::numeric_limits<int>::max())) {
+    return false;
+  }
+  code_ = static_cast<int>(steps);
+  return true;
+}
+
+double fixed_point_codec::decode_time(int code_) const { return code_ * _time_resolution_; }
+
+bool fixed_point_codec::encode_amplitude(double amplitude_, int16_t& code_) const {
+  const double steps = std::round(amplitude_ / get_amplitude_lsb());
+  if (!(std::abs(steps) <= max_amplitude_code)) {
+    return false;
+  }
+  code_ = static_cast<int16_t>(steps);
+  return true;
+}
+
+double fixed_point_codec::decode_amplitude(int16_t code_) const {
+  return code_ * get_amplitude_lsb();
+}
+
+void fixed_point_codec::encode(mctools::signal::base_signal& signal_) const {
+  datatools::properties& aux = signal_.grab_auxiliaries();
+  for (const auto& key : _time_keys_) {
+    if (!aux.has_key(key) || !aux.is_real(key)) continue;
+    int code;
+    if (!encode_time(aux.fetch_real(key), code)) {
+      _overflows_++;
+      continue;
+    }
+    aux.erase(key);
+    aux.store_integer(key, code);
+  }
+  if (aux.has_key(_amplitude_key_) && aux.is_real(_amplitude_key_)) {
+    int16_t code;
+    if (encode_amplitude(aux.fetch_real(_amplitude_key_), code)) {
+      aux.erase(_amplitude_key_);
+      aux.store_integer(_amplitude_key_, code);
+    } else {
+      _overflows_++;
+    }
+  }
+  return;
+}
+
+void fixed_point_codec::decode(mctools::signal::base_signal& signal_) const {
+  datatools::properties& aux = signal_.grab_auxiliaries();
+  for (const auto& key : _time_keys_) {
+    if (!aux.has_key(key) || !aux.is_integer(key)) continue;
+    const double time = decode_time(aux.fetch_integer(key));
+    aux.erase(key);
+    store_with_unit(aux, key, time, "ns");
+  }
+  if (aux.has_key(_amplitude_key_) && aux.is_integer(_amplitude_key_)) {
+    const double amplitude = decode_amplitude(aux.fetch_integer(_amplitude_key_));
+    aux.erase(_amplitude_key_);
+    store_with_unit(aux, _amplitude_key_, amplitude, "V");
+  }
+  return;
+}
+
+std::size_t fixed_point_codec::encode(mctools::signal::signal_data& signal_data_) const {
+  std::size_t number_of_signals = 0;
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  for (const auto& category : categories) {
+    for (auto& signal_handle : signal_data_.grab_signals(category)) {
+      encode(signal_handle.grab());
+      number_of_signals++;
+    }
+  }
+  if (number_of_signals > 0) {
+    export_to(signal_data_.grab_auxiliaries());
+  }
+  return number_of_signals;
+}
+
+std::size_t fixed_point_codec::decode(mctools::signal::signal_data& signal_data_) {
+  if (!is_encoded(signal_data_)) {
+    return 0;
+  }
+  fixed_point_codec codec;
+  codec.import_from(signal_data_.get_auxiliaries());
+  std::size_t number_of_signals = 0;
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  for (const auto& category : categories) {
+    for (auto& signal_handle : signal_data_.grab_signals(category)) {
+      codec.decode(signal_handle.grab());
+      number_of_signals++;
+    }
+  }
+  signal_data_.grab_auxiliaries().erase(time_resolution_key());
+  signal_data_.grab_auxiliaries().erase(amplitude_full_scale_key());
+  return number_of_signals;
+}
+
+void fixed_point_codec::export_to(datatools::properties& bank_aux_) const {
+  if (bank_aux_.has_key(time_resolution_key())) {
+    bank_aux_.erase(time_resolution_key());
+  }
+  if (bank_aux_.has_key(amplitude_full_scale_key())) {
+    bank_aux_.erase(amplitude_full_scale_key());
+  }
+  store_with_unit(bank_aux_, time_resolution_key(), _time_resolution_, "ps");
+  store_with_unit(bank_aux_, amplitude_full_scale_key(), _amplitude_full_scale_, "V");
+  return;
+}
+
+void fixed_point_codec::import_from(const datatools::properties& bank_aux_) {
+  DT_THROW_IF(!bank_aux_.has_key(time_resolution_key()) ||
+                  !bank_aux_.has_key(amplitude_full_scale_key()),
+              std::logic_error, "Missing fixed-point codec parameters in bank auxiliaries!");
+  set_time_resolution(bank_aux_.fetch_real(time_resolution_key()));
+  set_amplitude_full_scale(bank_aux_.fetch_real(amplitude_full_scale_key()));
+  return;
+}
+
+std::size_t fixed_point_codec::get_number_of_overflows() const { return _overflows_; }
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,127 @@
+// snemo/asb/fixed_point_codec.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-10
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_FIXED_POINT_CODEC_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_FIXED_POINT_CODEC_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/properties.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Reduced-precision storage of the shape parameters of signals
+///
+/// The time parameters (t0, t1, t2) of the signal shapes are stored as
+/// integer multiples of the time resolution, and the amplitude as a signed
+/// 16-bit code of the amplitude full scale. The integer parameters replace
+/// the real ones under the same keys; a parameter out of the integer range
+/// is kept as a real. The decoding error is at most half the time
+/// resolution and half the amplitude LSB.
+///
+/// The codec parameters are stored in the auxiliaries of each encoded bank:
+/// \code
+/// asb.fixed_point.time_resolution : real as time = 10 ps
+/// asb.fixed_point.amplitude_full_scale : real as electric_potential = 4 V
+/// \endcode
+///
+/// Configuration:
+/// \code
+/// time_resolution : real as time = 10 ps
+/// amplitude_full_scale : real as electric_potential = 4 V
+/// \endcode
+class fixed_point_codec {
+ public:
+  /// Maximum amplitude code
+  static const int max_amplitude_code = 32767;
+
+  /// Check if a bank has encoded signals
+  static bool is_encoded(const mctools::signal::signal_data& signal_data_);
+
+  /// Constructor
+  fixed_point_codec();
+
+  /// Initialize from configuration properties
+  void initialize(const datatools::properties& config_);
+
+  /// Set the time resolution
+  void set_time_resolution(double resolution_);
+
+  /// Return the time resolution
+  double get_time_resolution() const;
+
+  /// Set the amplitude full scale
+  void set_amplitude_full_scale(double full_scale_);
+
+  /// Return the amplitude full scale
+  double get_amplitude_full_scale() const;
+
+  /// Return the amplitude LSB
+  double get_amplitude_lsb() const;
+
+  /// Encode a time, return false if out of range
+  bool encode_time(double time_, int& code_) const;
+
+  /// Decode a time
+  double decode_time(int code_) const;
+
+  /// Encode an amplitude, return false if out of range
+  bool encode_amplitude(double amplitude_, int16_t& code_) const;
+
+  /// Decode an amplitude
+  double decode_amplitude(int16_t code_) const;
+
+  /// Encode the shape parameters of a signal
+  void encode(mctools::signal::base_signal& signal_) const;
+
+  /// Decode the shape parameters of a signal
+  void decode(mctools::signal::base_signal& signal_) const;
+
+  /// Encode the shape parameters of all the signals of a bank and store the codec in the bank
+  std::size_t encode(mctools::signal::signal_data& signal_data_) const;
+
+  /// Decode all the signals of a bank with the codec stored in the bank, and remove it
+  static std::size_t decode(mctools::signal::signal_data& signal_data_);
+
+  /// Store the codec parameters in the auxiliaries of a bank
+  void export_to(datatools::properties& bank_aux_) const;
+
+  /// Load the codec parameters from the auxiliaries of a bank
+  void import_from(const datatools::properties& bank_aux_);
+
+  /// Return the number of parameters kept as reals because out of range
+  std::size_t get_number_of_overflows() const;
+
+ private:
+  double _time_resolution_;       //!< Time resolution
+  double _amplitude_full_scale_;  //!< Amplitude full scale
+
+  // Shape parameter keys, resolved once:
+  std::string _time_keys_[3];
+  std::string _amplitude_key_;
+
+  mutable std::size_t _overflows_ = 0;  //!< Parameters kept as reals
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_FIXED_POINT_CODEC_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,158 @@
+// packed_gid.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/packed_gid.h>
+
+// Standard library:
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+const uint64_t invalid_packed_address = 0xFF;
+const uint64_t any_packed_address = 0xFE;
+const uint64_t max_packed_type = 0xFFFF;
+
+// Bit offset of the address slot of given index
+inline unsigned int address_shift(std::size_t index_) { return 40 - 8 * index_; }
+
+}  // end of anonymous namespace
+
+const packed_gid::key_type packed_gid::INVALID_KEY;
+const std::size_t packed_gid::MAX_DEPTH;
+
+bool packed_gid::try_encode(const geomtools::geom_id& gid_, key_type& key_) {
+  const uint32_t type = gid_.get_type();
+  const std::size_t depth = gid_.get_depth();
+  if (type >= max_packed_type || depth > MAX_DEPTH) {
+    return false;
+  }
+  key_type key = static_cast<key_type>(type) << 48;
+  for (std::size_t i = 0; i < depth; i++) {
+    uint64_t address = 0;
+    if (gid_.is_invalid(i)) {
+      address = invalid_packed_address;
+    } else if (gid_.is_any(i)) {
+      address = any_packed_address;
+    } else {
+      address = gid_.get(i);
+      if (address >= any_packed_address) {
+        return false;
+      }
+    }
+    key |= address << address_shift(i);
+  }
+  key_ = key;
+  return true;
+}
+
+packed_gid::key_type packed_gid::encode(const geomtools::geom_id& gid_) {
+  key_type key = INVALID_KEY;
+  DT_THROW_IF(!try_encode(gid_, key), std::range_error,
+              "Geometry ID " << gid_ << " cannot be packed in a 64-bit key!");
+  return key;
+}
+
+void packed_gid::decode(key_type key_, std::size_t depth_, geomtools::geom_id& gid_) {
+  DT_THROW_IF(key_ == INVALID_KEY, std::logic_error, "Cannot unpack an invalid key!");
+  DT_THROW_IF(depth_ > MAX_DEPTH, std::range_error, "Invalid depth " << depth_ << "!");
+  gid_.reset();
+  gid_.set_type(get_type(key_));
+  gid_.set_depth(depth_);
+  for (std::size_t i = 0; i < depth_; i++) {
+    const uint64_t address = (key_ >> address_shift(i)) & 0xFF;
+    if (address == invalid_packed_address) {
+      gid_.set(i, geomtools::geom_id::INVALID_ADDRESS);
+    } else if (address == any_packed_address) {
+      gid_.set(i, geomtools::geom_id::ANY_ADDRESS);
+    } else {
+      gid_.set(i, static_cast<uint32_t>(address));
+    }
+  }
+  return;
+}
+
+uint32_t packed_gid::get_type(key_type key_) { return static_cast<uint32_t>(key_ >> 48); }
+
+const std::vector<std::string>& packed_gid_codec::default_categories() {
+  static const std::vector<std::string> _categories = {"calorimeter_block", "xcalo_block",
+                                                       "gveto_block", "drift_cell_core"};
+  return _categories;
+}
+
+void packed_gid_codec::initialize(const geomtools::id_mgr& id_mgr_,
+                                  const std::vector<std::string>& categories_) {
+  for (const auto& category : categories_) {
+    add_category(id_mgr_, category);
+  }
+  return;
+}
+
+void packed_gid_codec::add_category(const geomtools::id_mgr& id_mgr_,
+                                    const std::string& category_) {
+  DT_THROW_IF(!id_mgr_.has_category_info(category_), std::logic_error,
+              "Unknown geometry category '" << category_ << "'!");
+  const geomtools::id_mgr::category_info& info = id_mgr_.get_category_info(category_);
+  const uint32_t type = info.get_type();
+  const std::size_t depth = info.get_depth();
+  DT_THROW_IF(type >= max_packed_type, std::range_error,
+              "Geometry category '" << category_ << "' has a too large type " << type << "!");
+  DT_THROW_IF(depth > packed_gid::MAX_DEPTH, std::range_error,
+              "Geometry category '" << category_ << "' has too many addresses (" << depth
+                                    << ")!");
+  _depths_[type] = depth;
+  return;
+}
+
+bool packed_gid_codec::has_type(uint32_t type_) const { return _depths_.count(type_) > 0; }
+
+packed_gid::key_type packed_gid_codec::encode(const geomtools::geom_id& gid_) const {
+  auto found = _depths_.find(gid_.get_type());
+  DT_THROW_IF(found == _depths_.end(), std::logic_error,
+              "Geometry type " << gid_.get_type() << " is not registered!");
+  DT_THROW_IF(gid_.get_depth() != found->second, std::logic_error,
+              "Geometry ID " << gid_ << " does not match the depth of its category!");
+  return packed_gid::encode(gid_);
+}
+
+void packed_gid_codec::decode(packed_gid::key_type key_, geomtools::geom_id& gid_) const {
+  auto found = _depths_.find(packed_gid::get_type(key_));
+  DT_THROW_IF(found == _depths_.end(), std::logic_error,
+              "Geometry type " << packed_gid::get_type(key_) << " is not registered!");
+  packed_gid::decode(key_, found->second, gid_);
+  return;
+}
+
+void packed_gid_codec::reset() {
+  _depths_.clear();
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
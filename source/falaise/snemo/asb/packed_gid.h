@@ -0,0 +1,112 @@
+// snemo/asb/packed_gid.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-03
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_PACKED_GID_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_PACKED_GID_H
+
+// Standard library:
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/geom_id.h>
+#include <bayeux/geomtools/id_mgr.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Packing of short geometry IDs into 64-bit integer keys
+///
+/// Layout of a key, from the most significant bits:
+/// - 16 bits: geometry type,
+/// - 6 x 8 bits: addresses, unused trailing slots being zero.
+///
+/// An invalid address is packed as 0xFF and an 'any' address as 0xFE, so
+/// that valid addresses must be lower than 0xFE. For IDs of the same type
+/// and depth, the order of the keys is the order of the geometry IDs.
+///
+/// This covers the SuperNEMO calorimeter, X-wall, gamma veto and tracker
+/// cell categories.
+struct packed_gid {
+  /// Type of packed keys
+  typedef uint64_t key_type;
+
+  /// Invalid key
+  static const key_type INVALID_KEY = 0xFFFFFFFFFFFFFFFFULL;
+
+  /// Maximum number of packed addresses
+  static const std::size_t MAX_DEPTH = 6;
+
+  /// Pack a geometry ID, return false if it cannot be represented
+  static bool try_encode(const geomtools::geom_id& gid_, key_type& key_);
+
+  /// Pack a geometry ID, throw if it cannot be represented
+  static key_type encode(const geomtools::geom_id& gid_);
+
+  /// Unpack a key with a given number of addresses
+  static void decode(key_type key_, std::size_t depth_, geomtools::geom_id& gid_);
+
+  /// Return the geometry type of a key
+  static uint32_t get_type(key_type key_);
+
+  /// \brief Hash functor for packed keys (splitmix64 finalizer)
+  struct hash {
+    std::size_t operator()(key_type key_) const {
+      key_ += 0x9E3779B97F4A7C15ULL;
+      key_ = (key_ ^ (key_ >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      key_ = (key_ ^ (key_ >> 27)) * 0x94D049BB133111EBULL;
+      return static_cast<std::size_t>(key_ ^ (key_ >> 31));
+    }
+  };
+};
+
+/// \brief Codec of packed geometry IDs for a set of geometry categories
+///
+/// The layouts (type and depth) of the categories are taken from the
+/// geometry ID manager, so that keys can be unpacked without knowing their
+/// category in advance.
+class packed_gid_codec {
+ public:
+  /// Return the default SuperNEMO categories (calo, X-wall, gamma veto, tracker cells)
+  static const std::vector<std::string>& default_categories();
+
+  /// Register the layouts of geometry categories
+  void initialize(const geomtools::id_mgr& id_mgr_,
+                  const std::vector<std::string>& categories_ = default_categories());
+
+  /// Register the layout of a geometry category
+  void add_category(const geomtools::id_mgr& id_mgr_, const std::string& category_);
+
+  /// Check if a geometry type is registered
+  bool has_type(uint32_t type_) const;
+
+  /// Pack a geometry ID of a registered category
+  packed_gid::key_type encode(const geomtools::geom_id& gid_) const;
+
+  /// Unpack a key of a registered category
+  void decode(packed_gid::key_type key_, geomtools::geom_id& gid_) const;
+
+  /// Reset
+  void reset();
+
+ private:
+  std::map<uint32_t, std::size_t> _depths_;  //!< Number of addresses per geometry type
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_PACKED_GID_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,444 @@
+// pipeline_runner.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/pipeline_runner.h>
+
+// Standard library:
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+// - Bayeux/dpp:
+#include <bayeux/dpp/input_module.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/simulated_data.h>
+
+// This project:
+#include <snemo/asb/analog_signal_builder_module.h>
+#include <snemo/asb/bounded_queue.h>
+#include <snemo/asb/result_cache.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Return the total number of step hits of an event
+std::size_t count_step_hits(const mctools::simulated_data& sim_data_) {
+  std::vector<std::string> categories;
+  sim_data_.get_step_hits_categories(categories);
+  std::size_t number_of_hits = 0;
+  for (const auto& category : categories) {
+    number_of_hits += sim_data_.get_number_of_step_hits(category);
+  }
+  return number_of_hits;
+}
+
+}  // end of anonymous namespace
+
+pipeline_runner::pipeline_runner() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  return;
+}
+
+pipeline_runner::~pipeline_runner() { return; }
+
+void pipeline_runner::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+datatools::logger::priority pipeline_runner::get_logging_priority() const {
+  return _logging_priority_;
+}
+
+void pipeline_runner::set_input_filename(const std::string& filename_) {
+  _input_filename_ = filename_;
+  return;
+}
+
+void pipeline_runner::set_output_filename(const std::string& filename_) {
+  _output_filename_ = filename_;
+  return;
+}
+
+void pipeline_runner::set_module_config(const datatools::properties& config_) {
+  _module_config_ = config_;
+  return;
+}
+
+void pipeline_runner::set_service_manager(datatools::service_manager& service_manager_) {
+  _service_manager_ = &service_manager_;
+  return;
+}
+
+void pipeline_runner::set_number_of_workers(std::size_t number_of_workers_) {
+  DT_THROW_IF(number_of_workers_ == 0, std::domain_error, "Invalid null number of workers!");
+  _number_of_workers_ = number_of_workers_;
+  return;
+}
+
+void pipeline_runner::set_queue_capacity(std::size_t capacity_) {
+  DT_THROW_IF(capacity_ == 0, std::domain_error, "Invalid null queue capacity!");
+  _queue_capacity_ = capacity_;
+  return;
+}
+
+void pipeline_runner::set_write_buffer_capacity(std::size_t capacity_) {
+  DT_THROW_IF(capacity_ == 0, std::domain_error, "Invalid null write buffer capacity!");
+  _write_buffer_capacity_ = capacity_;
+  return;
+}
+
+void pipeline_runner::set_max_records(std::size_t max_records_) {
+  _max_records_ = max_records_;
+  return;
+}
+
+void pipeline_runner::set_split_threshold(std::size_t split_threshold_) {
+  _split_threshold_ = split_threshold_;
+  return;
+}
+
+void pipeline_runner::set_shard(std::size_t shard_index_, std::size_t number_of_shards_) {
+  DT_THROW_IF(number_of_shards_ == 0, std::domain_error, "Invalid null number of shards!");
+  DT_THROW_IF(shard_index_ >= number_of_shards_, std::domain_error,
+              "Invalid shard index " << shard_index_ << "/" << number_of_shards_ << "!");
+  _shard_index_ = shard_index_;
+  _number_of_shards_ = number_of_shards_;
+  return;
+}
+
+void pipeline_runner::run() {
+  DT_THROW_IF(_input_filename_.empty(), std::logic_error, "Missing input filename!");
+  DT_THROW_IF(_output_filename_.empty(), std::logic_error, "Missing output filename!");
+  DT_THROW_IF(_service_manager_ == nullptr, std::logic_error, "Missing service manager!");
+  _report_.reset(new report_type);
+  report_type& report = *_report_;
+  report.worker_records.assign(_number_of_workers_, 0);
+
+  work_stealing_scheduler scheduler(_number_of_workers_);
+  std::atomic<std::size_t> split_records(0);
+
+  // Cache entries of the drivers are keyed by the digest of the input file:
+  std::string cache_input_digest;
+  if (_module_config_.has_key("cache.enabled") && _module_config_.fetch_boolean("cache.enabled") &&
+      !_module_config_.has_key("cache.input_digest")) {
+    cache_input_digest = result_cache::compute_input_digest(_input_filename_);
+  }
+
+  // One analog signal builder module per compute worker:
+  std::vector<std::unique_ptr<analog_signal_builder_module>> modules;
+  for (std::size_t iworker = 0; iworker < _number_of_workers_; iworker++) {
+    modules.emplace_back(new analog_signal_builder_module(_logging_priority_));
+    analog_signal_builder_module& module = *modules.back();
+    std::ostringstream name;
+    name << "ASB_" << iworker;
+    module.set_name(name.str());
+    datatools::properties module_config = _module_config_;
+    if (!cache_input_digest.empty()) {
+      module_config.store_string("cache.input_digest", cache_input_digest);
+    }
+    if (_number_of_workers_ > 1 && module_config.has_key("trace.filename")) {
+      // One trace file per worker:
+      std::string trace_filename = module_config.fetch_string("trace.filename");
+      std::size_t dot = trace_filename.rfind('.');
+      const std::size_t slash = trace_filename.rfind('/');
+      if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = trace_filename.size();
+      }
+      trace_filename.insert(dot, "_" + std::to_string(iworker));
+      module_config.update_string("trace.filename", trace_filename);
+    }
+    dpp::module_handle_dict_type no_modules;
+    module.initialize(module_config, *_service_manager_, no_modules);
+    DT_THROW_IF(module.is_stream_mode() && _number_of_workers_ > 1, std::logic_error,
+                "Stream mode needs the events in order and cannot use several workers!");
+    DT_THROW_IF(module.is_stream_mode() && _number_of_shards_ > 1, std::logic_error,
+                "Stream mode needs all the events of the timeline and cannot run on shards!");
+    if (_split_threshold_ > 0) {
+      // Large events are split in per-driver tasks that other workers may steal:
+      module.set_driver_executor([this, &scheduler, &split_records](
+                                     const mctools::simulated_data& sim_data_,
+                                     std::vector<std::function<void()>>& jobs_) {
+        if (count_step_hits(sim_data_) < _split_threshold_) {
+          for (auto& job : jobs_) job();
+          return;
+        }
+        split_records++;
+        work_stealing_scheduler::task_group group;
+        for (auto& job : jobs_) {
+          std::function<void()>* pjob = &job;
+          scheduler.submit(group, [pjob](std::size_t) { (*pjob)(); });
+        }
+        scheduler.wait(group);
+        return;
+      });
+    }
+  }
+
+  // Reader stage:
+  dpp::input_module reader;
+  datatools::properties reader_config;
+  reader_config.store("logging.priority", datatools::logger::get_priority_label(_logging_priority_));
+  reader_config.store("files.mode", "single");
+  reader_config.store("files.single.filename", _input_filename_);
+  if (_max_records_ > 0) {
+    reader_config.store("max_record_total", static_cast<int>(_max_records_));
+  }
+  reader.initialize_standalone(reader_config);
+
+  // Writer stage, serializing the records in a background thread:
+  async_record_writer writer;
+  writer.set_logging_priority(_logging_priority_);
+  writer.set_buffer_capacity(_write_buffer_capacity_);
+  writer.open(_output_filename_);
+
+  bounded_queue<record_entry> input_queue(_queue_capacity_);
+  bounded_queue<record_entry> output_queue(_queue_capacity_);
+
+  // Records admitted in the compute stage and not yet written; the slot of
+  // a record is only released by the writer, so that the records waiting
+  // for reordering are bounded too:
+  std::mutex in_flight_mutex;
+  std::condition_variable in_flight_done;
+  std::size_t in_flight = 0;
+  bool aborted = false;
+
+  std::mutex failure_mutex;
+  std::exception_ptr failure;
+  auto record_failure = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(failure_mutex);
+      if (!failure) failure = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(in_flight_mutex);
+      aborted = true;
+    }
+    in_flight_done.notify_all();
+    input_queue.close();
+    output_queue.close();
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::thread reader_thread([&]() {
+    try {
+      std::size_t input_index = 0;
+      std::size_t index = 0;
+      while (!reader.is_terminated()) {
+        record_entry entry;
+        entry.index = index;
+        entry.record.reset(new datatools::things);
+        const dpp::base_module::process_status status = reader.process(*entry.record);
+        if (status != dpp::base_module::PROCESS_OK) break;
+        if (input_index++ % _number_of_shards_ != _shard_index_) {
+          report.skipped_records++;
+          continue;
+        }
+        index++;
+        if (!input_queue.push(std::move(entry))) break;
+      }
+      report.read_records = input_index;
+    } catch (...) {
+      record_failure();
+    }
+    input_queue.close();
+  });
+
+  // Compute stage: a dispatcher submits one task per record to the scheduler,
+  // with a bounded number of records in flight:
+  scheduler.start();
+  std::thread dispatcher_thread([&]() {
+    try {
+      record_entry entry;
+      while (input_queue.pop(entry)) {
+        {
+          std::unique_lock<std::mutex> lock(in_flight_mutex);
+          in_flight_done.wait(lock, [&] { return in_flight < _queue_capacity_ || aborted; });
+          if (aborted) break;
+          in_flight++;
+          report.max_in_flight = std::max(report.max_in_flight, in_flight);
+        }
+        std::shared_ptr<record_entry> shared_entry(new record_entry(std::move(entry)));
+        scheduler.submit([&, shared_entry](std::size_t worker_) {
+          try {
+            shared_entry->status = modules[worker_]->process(*shared_entry->record);
+            report.worker_records[worker_]++;
+            output_queue.push(std::move(*shared_entry));
+          } catch (...) {
+            record_failure();
+          }
+        });
+      }
+    } catch (...) {
+      record_failure();
+    }
+    try {
+      scheduler.stop();
+    } catch (...) {
+      record_failure();
+    }
+    output_queue.close();
+  });
+
+  // Writer stage, restoring the original order of the records (at most
+  // one queue capacity of records waits for reordering):
+  try {
+    std::map<std::size_t, record_entry> pending;
+    std::size_t next_index = 0;
+    record_entry entry;
+    while (output_queue.pop(entry)) {
+      const std::size_t index = entry.index;
+      pending[index] = std::move(entry);
+      while (!pending.empty() && pending.begin()->first == next_index) {
+        record_entry& ready = pending.begin()->second;
+        if (ready.status != dpp::base_module::PROCESS_OK) {
+          report.failed_records++;
+        }
+        writer.write(std::move(ready.record));
+        report.written_records++;
+        pending.erase(pending.begin());
+        next_index++;
+        {
+          std::lock_guard<std::mutex> lock(in_flight_mutex);
+          in_flight--;
+        }
+        in_flight_done.notify_one();
+      }
+    }
+  } catch (...) {
+    record_failure();
+  }
+
+  reader_thread.join();
+  dispatcher_thread.join();
+
+  // Final record with the frames still open at the end of the stream:
+  if (!failure && modules.front()->is_stream_mode()) {
+    try {
+      std::unique_ptr<datatools::things> final_record(new datatools::things);
+      modules.front()->flush_stream(*final_record);
+      writer.write(std::move(final_record));
+      report.written_records++;
+    } catch (...) {
+      record_failure();
+    }
+  }
+
+  try {
+    writer.close();
+  } catch (...) {
+    record_failure();
+  }
+
+  report.elapsed_time =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  report.input_mean_occupancy = input_queue.get_mean_occupancy();
+  report.input_max_occupancy = input_queue.get_max_occupancy();
+  report.input_wait_time = input_queue.get_push_wait_time();
+  report.output_mean_occupancy = output_queue.get_mean_occupancy();
+  report.output_max_occupancy = output_queue.get_max_occupancy();
+  report.output_wait_time = output_queue.get_push_wait_time();
+  report.split_records = split_records;
+  report.scheduler_time = scheduler.get_elapsed_time();
+  report.worker_stats = scheduler.get_worker_stats();
+  report.writer_stats = writer.get_stats();
+
+  reader.reset();
+  for (auto& module : modules) {
+    module->reset();
+  }
+
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return;
+}
+
+bool pipeline_runner::has_report() const { return _report_ != nullptr; }
+
+const pipeline_runner::report_type& pipeline_runner::get_report() const {
+  DT_THROW_IF(!_report_, std::logic_error, "No report available!");
+  return *_report_;
+}
+
+void pipeline_runner::print_report(std::ostream& out_) const {
+  if (!_report_) {
+    out_ << "No report available." << std::endl;
+    return;
+  }
+  const report_type& report = *_report_;
+  const double throughput =
+      report.elapsed_time > 0.0 ? report.written_records / report.elapsed_time : 0.0;
+  out_ << "Pipeline report:" << std::endl;
+  out_ << "|-- Workers           : " << _number_of_workers_ << std::endl;
+  out_ << "|-- Shard             : " << _shard_index_ << "/" << _number_of_shards_
+       << std::endl;
+  out_ << "|-- Read records      : " << report.read_records << std::endl;
+  out_ << "|-- Skipped records   : " << report.skipped_records << std::endl;
+  out_ << "|-- Written records   : " << report.written_records << std::endl;
+  out_ << "|-- Failed records    : " << report.failed_records << std::endl;
+  out_ << "|-- Elapsed time      : " << report.elapsed_time << " s" << std::endl;
+  out_ << "|-- Throughput        : " << throughput << " records/s" << std::endl;
+  out_ << "|-- Input queue       : mean occupancy=" << report.input_mean_occupancy << "/"
+       << _queue_capacity_ << " max=" << report.input_max_occupancy
+       << " reader stall=" << report.input_wait_time << " s" << std::endl;
+  out_ << "|-- Output queue      : mean occupancy=" << report.output_mean_occupancy << "/"
+       << _queue_capacity_ << " max=" << report.output_max_occupancy
+       << " workers stall=" << report.output_wait_time << " s" << std::endl;
+  out_ << "|-- In flight         : max=" << report.max_in_flight << "/" << _queue_capacity_
+       << std::endl;
+  out_ << "|-- Writer            : " << report.writer_stats.written_records << " records in "
+       << report.writer_stats.flushed_buffers << " buffers of " << _write_buffer_capacity_
+       << ", write time=" << report.writer_stats.write_time
+       << " s, stall=" << report.writer_stats.stall_time << " s ("
+       << report.writer_stats.stalls << " times)" << std::endl;
+  out_ << "|-- Split records     : " << report.split_records << " (threshold="
+       << _split_threshold_ << " step hits)" << std::endl;
+  for (std::size_t iworker = 0; iworker < report.worker_records.size(); iworker++) {
+    const work_stealing_scheduler::worker_stats& stats = report.worker_stats[iworker];
+    const double utilisation =
+        report.scheduler_time > 0.0 ? stats.busy_time / report.scheduler_time : 0.0;
+    out_ << (iworker + 1 == report.worker_records.size() ? "`-- " : "|-- ") << "Worker #"
+         << iworker << "         : " << report.worker_records[iworker] << " records, "
+         << stats.executed_tasks << " tasks (" << stats.stolen_tasks
+         << " stolen), utilisation=" << 100.0 * utilisation << " %" << std::endl;
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
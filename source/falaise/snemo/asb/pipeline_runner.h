@@ -0,0 +1,169 @@
+// snemo/asb/pipeline_runner.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-20
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_PIPELINE_RUNNER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_PIPELINE_RUNNER_H
+
+// Standard library:
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+#include <bayeux/datatools/properties.h>
+#include <bayeux/datatools/service_manager.h>
+#include <bayeux/datatools/things.h>
+
+// This project:
+#include <snemo/asb/async_record_writer.h>
+#include <snemo/asb/work_stealing_scheduler.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Standalone pipelined runner of the analog signal builder
+///
+/// The runner is made of three stages connected by bounded queues:
+/// - a reader stage (dpp::input_module) loading the event records,
+/// - N compute workers, each one running its own analog signal builder
+///   module, fed by a work-stealing scheduler,
+/// - a writer stage restoring the original order of the processed records,
+///   which are serialized by a double-buffered background writer
+///   (async_record_writer).
+///
+/// Disk input/output thus overlap with the generation of signals. At most
+/// one queue capacity of records is processed or waits for reordering at
+/// any time: a slow record holds back the admission of new ones instead of
+/// letting the following records pile up in memory.
+///
+/// Events whose number of step hits exceeds the split threshold are further
+/// split into one task per signal generator driver, so that idle workers can
+/// steal part of the work of a very large event instead of waiting for it.
+///
+/// In stream mode (one worker, no shard), the frames still open after the
+/// last event are flushed into a final record, written after all the others.
+///
+/// A run may process only one shard of the input: with K shards, the shard
+/// i processes the records whose index modulo K is i. The outputs of the K
+/// shards can be merged back into the original record order with the
+/// shard_merger class.
+class pipeline_runner : private boost::noncopyable {
+ public:
+  /// \brief Event record travelling through the pipeline
+  struct record_entry {
+    std::size_t index = 0;                     //!< Index of the record in the input
+    std::unique_ptr<datatools::things> record;  //!< The event record
+    int status = 0;                            //!< Processing status
+  };
+
+  /// \brief Report of a pipeline run
+  struct report_type {
+    std::size_t read_records = 0;     //!< Number of records read
+    std::size_t skipped_records = 0;  //!< Number of records belonging to other shards
+    std::size_t written_records = 0;  //!< Number of records written
+    std::size_t failed_records = 0;   //!< Number of records with processing errors
+    double elapsed_time = 0.0;        //!< Wall-clock time of the run (in seconds)
+    double input_mean_occupancy = 0.0;
+    std::size_t input_max_occupancy = 0;
+    double input_wait_time = 0.0;     //!< Time the reader waited for the workers
+    double output_mean_occupancy = 0.0;
+    std::size_t output_max_occupancy = 0;
+    double output_wait_time = 0.0;    //!< Time the workers waited for the writer
+    std::size_t max_in_flight = 0;    //!< Maximum number of records in flight
+    async_record_writer::stats_type writer_stats;  //!< Statistics of the background writer
+    std::vector<std::size_t> worker_records;  //!< Number of records per worker
+    std::size_t split_records = 0;    //!< Number of records split in per-driver tasks
+    double scheduler_time = 0.0;      //!< Lifetime of the scheduler (in seconds)
+    std::vector<work_stealing_scheduler::worker_stats> worker_stats;  //!< Scheduler statistics
+  };
+
+  /// Constructor
+  pipeline_runner();
+
+  /// Destructor
+  ~pipeline_runner();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Return logging priority level
+  datatools::logger::priority get_logging_priority() const;
+
+  /// Set the input filename
+  void set_input_filename(const std::string& filename_);
+
+  /// Set the output filename
+  void set_output_filename(const std::string& filename_);
+
+  /// Set the configuration of the analog signal builder module
+  void set_module_config(const datatools::properties& config_);
+
+  /// Set the service manager providing the geometry service
+  void set_service_manager(datatools::service_manager& service_manager_);
+
+  /// Set the number of compute workers
+  void set_number_of_workers(std::size_t number_of_workers_);
+
+  /// Set the capacity of the queues between stages
+  void set_queue_capacity(std::size_t capacity_);
+
+  /// Set the number of records per buffer of the background writer
+  void set_write_buffer_capacity(std::size_t capacity_);
+
+  /// Set the maximum number of records to be read (0: no limit)
+  void set_max_records(std::size_t max_records_);
+
+  /// Set the number of step hits above which an event is split in per-driver tasks (0: never)
+  void set_split_threshold(std::size_t split_threshold_);
+
+  /// Select the shard to be processed
+  void set_shard(std::size_t shard_index_, std::size_t number_of_shards_);
+
+  /// Run the pipeline
+  void run();
+
+  /// Check if a report of the last run is available
+  bool has_report() const;
+
+  /// Return the report of the last run
+  const report_type& get_report() const;
+
+  /// Print the processing report
+  void print_report(std::ostream& out_ = std::clog) const;
+
+ private:
+  datatools::logger::priority _logging_priority_;
+  std::string _input_filename_;   //!< Input filename
+  std::string _output_filename_;  //!< Output filename
+  datatools::properties _module_config_;  //!< Configuration of the analog signal builder
+  datatools::service_manager* _service_manager_ = nullptr;  //!< Service manager
+  std::size_t _number_of_workers_ = 1;  //!< Number of compute workers
+  std::size_t _queue_capacity_ = 16;    //!< Capacity of the queues
+  std::size_t _write_buffer_capacity_ = 16;  //!< Number of records per buffer of the writer
+  std::size_t _max_records_ = 0;        //!< Maximum number of records to be read
+  std::size_t _split_threshold_ = 0;    //!< Number of step hits above which events are split
+  std::size_t _shard_index_ = 0;        //!< Index of the processed shard
+  std::size_t _number_of_shards_ = 1;   //!< Number of shards
+  std::unique_ptr<report_type> _report_;  //!< Report of the last run
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_PIPELINE_RUNNER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,376 @@
+// result_cache.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/result_cache.h>
+
+// Standard library:
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/io_factory.h>
+#include <bayeux/datatools/utils.h>
+
+// This project:
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+/// \brief Scoped advisory lock on a file
+class scoped_file_lock {
+ public:
+  scoped_file_lock(const std::string& path_, bool exclusive_) {
+    _fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    DT_THROW_IF(_fd_ < 0, std::runtime_error, "Cannot open lock file '" << path_ << "'!");
+    int status = 0;
+    do {
+      status = ::flock(_fd_, exclusive_ ? LOCK_EX : LOCK_SH);
+    } while (status != 0 && errno == EINTR);
+    if (status != 0) {
+      ::close(_fd_);
+      DT_THROW(std::runtime_error, "Cannot lock file '" << path_ << "'!");
+    }
+    return;
+  }
+
+  ~scoped_file_lock() {
+    ::flock(_fd_, LOCK_UN);
+    ::close(_fd_);
+    return;
+  }
+
+  /// Read the total size recorded in the lock file, return false if none
+  bool read_total_size(std::size_t& total_size_) const {
+    char buffer[32];
+    const ssize_t count = ::pread(_fd_, buffer, sizeof(buffer) - 1, 0);
+    if (count <= 0) return false;
+    buffer[count] = '\0';
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(buffer, &end, 10);
+    if (end == buffer || *end != '\n') return false;
+    total_size_ = static_cast<std::size_t>(value);
+    return true;
+  }
+
+  /// Record the total size in the lock file
+  ///
+  /// A former longer record is left after the end of line, which ends the value.
+  void write_total_size(std::size_t total_size_) {
+    const std::string record = std::to_string(total_size_) + "\n";
+    const ssize_t count = ::pwrite(_fd_, record.data(), record.size(), 0);
+    DT_THROW_IF(count != (ssize_t)record.size(), std::runtime_error,
+                "Cannot record the cache size in the lock file!");
+    return;
+  }
+
+ private:
+  int _fd_ = -1;
+};
+
+// Fraction of the size cap kept after an eviction, so that the directory is
+// not scanned again at the next store
+const double eviction_ratio = 0.9;
+
+const std::string& entry_suffix() {
+  static const std::string _suffix(".ssd.data");
+  return _suffix;
+}
+
+}  // end of anonymous namespace
+
+const std::string& result_cache::default_directory() {
+  static const std::string _directory("/tmp/${USER}/asb_cache");
+  return _directory;
+}
+
+std::string result_cache::compute_input_digest(const std::string& input_filename_) {
+  std::string path = input_filename_;
+  DT_THROW_IF(!datatools::fetch_path_with_env(path), std::logic_error,
+              "Cannot resolve input file '" << input_filename_ << "'!");
+  return hash_utils::to_hex(file_utils::hash_file(path));
+}
+
+result_cache::result_cache() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  _directory_ = default_directory();
+  _max_size_ = 1024 * 1024 * 1024;
+  return;
+}
+
+result_cache::~result_cache() {
+  if (is_initialized()) {
+    reset();
+  }
+  return;
+}
+
+void result_cache::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+void result_cache::set_directory(const std::string& directory_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Cache is already initialized!");
+  _directory_ = directory_;
+  return;
+}
+
+const std::string& result_cache::get_directory() const { return _directory_; }
+
+void result_cache::set_max_size(std::size_t max_size_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Cache is already initialized!");
+  _max_size_ = max_size_;
+  return;
+}
+
+std::size_t result_cache::get_max_size() const { return _max_size_; }
+
+bool result_cache::is_initialized() const { return _initialized_; }
+
+void result_cache::initialize() {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Cache is already initialized!");
+  DT_THROW_IF(_directory_.empty(), std::logic_error, "Missing cache directory!");
+  DT_THROW_IF(!datatools::fetch_path_with_env(_directory_), std::logic_error,
+              "Cannot resolve cache directory '" << _directory_ << "'!");
+  file_utils::make_directories(_directory_);
+  _lock_path_ = _directory_ + "/.lock";
+  {
+    // The first job using the cache directory records its total size:
+    scoped_file_lock lock(_lock_path_, true);
+    std::size_t total_size = 0;
+    if (!lock.read_total_size(total_size)) {
+      lock.write_total_size(_evict_(_max_size_));
+    }
+  }
+  _hits_ = 0;
+  _misses_ = 0;
+  _stores_ = 0;
+  _evictions_ = 0;
+  _initialized_ = true;
+  return;
+}
+
+void result_cache::reset() {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Cache is not initialized!");
+  _initialized_ = false;
+  DT_LOG_NOTICE(_logging_priority_, "Cache '" << _directory_ << "' : hits=" << _hits_
+                                              << " misses=" << _misses_ << " stores=" << _stores_
+                                              << " evictions=" << _evictions_);
+  _lock_path_.clear();
+  return;
+}
+
+std::string result_cache::make_key(const std::string& input_digest_, uint64_t config_hash_,
+                                   uint64_t input_hash_) {
+  uint64_t digest = hash_utils::offset_basis;
+  digest = hash_utils::update(digest, input_digest_);
+  digest = hash_utils::update(digest, config_hash_);
+  digest = hash_utils::update(digest, input_hash_);
+  return hash_utils::to_hex(digest);
+}
+
+std::string result_cache::_entry_path_(const std::string& key_) const {
+  return _directory_ + "/" + key_ + entry_suffix();
+}
+
+bool result_cache::load(const std::string& key_, const std::vector<std::string>& categories_,
+                        mctools::signal::signal_data& target_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Cache is not initialized!");
+  const std::string path = _entry_path_(key_);
+  mctools::signal::signal_data cached;
+  {
+    scoped_file_lock lock(_lock_path_, false);
+    struct stat entry_stat;
+    if (::stat(path.c_str(), &entry_stat) != 0) {
+      _misses_++;
+      return false;
+    }
+    try {
+      datatools::data_reader reader(path, datatools::using_multi_archives);
+      reader.load(cached);
+    } catch (std::exception& error) {
+      DT_LOG_WARNING(_logging_priority_,
+                     "Invalid cache entry '" << path << "' : " << error.what());
+      _misses_++;
+      return false;
+    }
+    // Mark the entry as recently used:
+    ::utime(path.c_str(), nullptr);
+  }
+  for (const auto& category : categories_) {
+    signal_utils::copy_signals(cached, category, target_);
+  }
+  _hits_++;
+  return true;
+}
+
+void result_cache::store(const std::string& key_, const mctools::signal::signal_data& source_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Cache is not initialized!");
+  const std::string path = _entry_path_(key_);
+  // Unique among the threads and processes storing the same entry:
+  const std::string tmp_path = file_utils::make_temporary_file(path);
+  try {
+    datatools::data_writer writer(tmp_path, datatools::using_multi_archives);
+    writer.store(source_);
+  } catch (...) {
+    std::remove(tmp_path.c_str());
+    throw;
+  }
+  struct stat tmp_stat;
+  if (::stat(tmp_path.c_str(), &tmp_stat) != 0) {
+    std::remove(tmp_path.c_str());
+    DT_LOG_WARNING(_logging_priority_, "Cannot write cache entry '" << path << "'!");
+    return;
+  }
+  scoped_file_lock lock(_lock_path_, true);
+  // An entry stored by another job for the same key is replaced:
+  std::size_t replaced_size = 0;
+  struct stat entry_stat;
+  if (::stat(path.c_str(), &entry_stat) == 0) {
+    replaced_size = entry_stat.st_size;
+  }
+  // Publish the entry atomically:
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    DT_LOG_WARNING(_logging_priority_, "Cannot publish cache entry '" << path << "'!");
+    return;
+  }
+  _stores_++;
+  std::size_t total_size = 0;
+  if (!lock.read_total_size(total_size) || total_size < replaced_size) {
+    // The record was lost, rebuild it:
+    total_size = _evict_(_max_size_);
+  } else {
+    total_size = total_size - replaced_size + tmp_stat.st_size;
+    if (total_size > _max_size_) {
+      total_size = _evict_(static_cast<std::size_t>(eviction_ratio * _max_size_));
+    }
+  }
+  lock.write_total_size(total_size);
+  return;
+}
+
+std::size_t result_cache::_evict_(std::size_t target_size_) {
+  struct entry_info {
+    std::string path;
+    std::size_t size;
+    time_t last_use;
+  };
+  DIR* dir = ::opendir(_directory_.c_str());
+  if (dir == nullptr) {
+    return 0;
+  }
+  std::vector<entry_info> entries;
+  std::size_t total_size = 0;
+  const std::string& suffix = entry_suffix();
+  while (struct dirent* dent = ::readdir(dir)) {
+    const std::string name(dent->d_name);
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+      continue;
+    }
+    entry_info info;
+    info.path = _directory_ + "/" + name;
+    struct stat entry_stat;
+    if (::stat(info.path.c_str(), &entry_stat) != 0) {
+      continue;
+    }
+    info.size = entry_stat.st_size;
+    info.last_use = entry_stat.st_mtime;
+    total_size += info.size;
+    entries.push_back(info);
+  }
+  ::closedir(dir);
+  if (total_size <= target_size_) {
+    return total_size;
+  }
+  std::sort(entries.begin(), entries.end(), [](const entry_info& a_, const entry_info& b_) {
+    return a_.last_use < b_.last_use;
+  });
+  for (const auto& entry : entries) {
+    if (total_size <= target_size_) break;
+    if (::unlink(entry.path.c_str()) == 0) {
+      total_size -= entry.size;
+      _evictions_++;
+    }
+  }
+  return total_size;
+}
+
+std::size_t result_cache::get_number_of_hits() const { return _hits_; }
+
+std::size_t result_cache::get_number_of_misses() const { return _misses_; }
+
+std::size_t result_cache::get_size() const {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Cache is not initialized!");
+  scoped_file_lock lock(_lock_path_, false);
+  std::size_t total_size = 0;
+  lock.read_total_size(total_size);
+  return total_size;
+}
+
+void result_cache::tree_dump(std::ostream& out_, const std::string& title_,
+                             const std::string& indent_, bool inherit_) const {
+  if (!title_.empty()) {
+    out_ << indent_ << title_ << std::endl;
+  }
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Directory : '" << _directory_ << "'"
+       << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Maximum size : " << _max_size_
+       << " bytes" << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Hits : " << _hits_ << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Misses : " << _misses_ << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Evictions : " << _evictions_
+       << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::inherit_tag(inherit_)
+       << "Initialized : " << is_initialized() << std::endl;
+
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,137 @@
+// snemo/asb/result_cache.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-14
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_RESULT_CACHE_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_RESULT_CACHE_H
+
+// Standard library:
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/i_tree_dump.h>
+#include <bayeux/datatools/logger.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief On-disk cache of driver outputs
+///
+/// Each entry is a content-addressed file storing the signals produced by
+/// one driver for one event. Entries are keyed by the input file digest, the
+/// driver configuration digest and the digest of the consumed step hits, so
+/// that the key of an event does not depend on its position in the run. The
+/// total size of the cache is capped and the least recently used entries are
+/// evicted first.
+///
+/// Several jobs may share the same cache directory on a node: new entries
+/// are written in unique temporary files and atomically renamed, while
+/// lookups and updates are serialized through an advisory lock file. The
+/// lock file also records the running total size of the entries, so that a
+/// store only scans the cache directory when the total exceeds the cap; the
+/// scan then evicts entries down to 90% of the cap. The cache directory,
+/// "/tmp/${USER}/asb_cache" by default, is created with its missing parents
+/// at initialization.
+class result_cache : public datatools::i_tree_dumpable {
+ public:
+  /// Return the default cache directory
+  static const std::string& default_directory();
+
+  /// Compute the digest of an input file, used in the keys of the entries
+  static std::string compute_input_digest(const std::string& input_filename_);
+
+  /// Constructor
+  result_cache();
+
+  /// Destructor
+  virtual ~result_cache();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Set the cache directory
+  void set_directory(const std::string& directory_);
+
+  /// Return the cache directory
+  const std::string& get_directory() const;
+
+  /// Set the maximum size of the cache (in bytes)
+  void set_max_size(std::size_t max_size_);
+
+  /// Return the maximum size of the cache (in bytes)
+  std::size_t get_max_size() const;
+
+  /// Check if the cache is initialized
+  bool is_initialized() const;
+
+  /// Initialize the cache
+  void initialize();
+
+  /// Reset the cache
+  void reset();
+
+  /// Build the key of a cache entry
+  static std::string make_key(const std::string& input_digest_, uint64_t config_hash_,
+                              uint64_t input_hash_);
+
+  /// Load the signals of some categories from a cache entry into a bank
+  ///
+  /// Return false if no valid entry exists for this key.
+  bool load(const std::string& key_, const std::vector<std::string>& categories_,
+            mctools::signal::signal_data& target_);
+
+  /// Store a bank in a cache entry
+  void store(const std::string& key_, const mctools::signal::signal_data& source_);
+
+  /// Return the number of hits
+  std::size_t get_number_of_hits() const;
+
+  /// Return the number of misses
+  std::size_t get_number_of_misses() const;
+
+  /// Return the total size of the entries, as recorded in the lock file (in bytes)
+  std::size_t get_size() const;
+
+  /// Smart print
+  virtual void tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
+                         const std::string& indent_ = "", bool inherit_ = false) const;
+
+ private:
+  std::string _entry_path_(const std::string& key_) const;
+
+  /// Evict the least recently used entries down to a size, return the size left
+  ///
+  /// Must be called with the exclusive lock held.
+  std::size_t _evict_(std::size_t target_size_);
+
+ private:
+  bool _initialized_ = false;
+  datatools::logger::priority _logging_priority_;
+  std::string _directory_;       //!< Cache directory
+  std::size_t _max_size_;        //!< Maximum size of the cache (in bytes)
+  std::string _lock_path_;       //!< Path of the lock file
+  std::atomic<std::size_t> _hits_{0};  //!< Number of cache hits
+  std::atomic<std::size_t> _misses_{0};  //!< Number of cache misses
+  std::atomic<std::size_t> _stores_{0};  //!< Number of stored entries
+  std::atomic<std::size_t> _evictions_{0};  //!< Number of evicted entries
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_RESULT_CACHE_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
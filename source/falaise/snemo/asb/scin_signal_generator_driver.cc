@@ -0,0 +1,355 @@
+// scin_signal_generator_driver.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/scin_signal_generator_driver.h>
+
+// Standard library:
+#include <algorithm>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/utils.h>
+
+// This project:
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+DATATOOLS_FACTORY_SYSTEM_AUTO_REGISTRATION_IMPLEMENTATION(
+    base_signal_generator_driver, scin_signal_generator_driver,
+    "snemo::asb::scin_signal_generator_driver")
+
+scin_signal_generator_driver::scin_signal_generator_driver(const std::string& id_)
+    : base_signal_generator_driver(id_) {
+  return;
+}
+
+scin_signal_generator_driver::~scin_signal_generator_driver() {
+  if (is_initialized()) {
+    this->scin_signal_generator_driver::reset();
+  }
+  return;
+}
+
+void scin_signal_generator_driver::build_list_of_input_categories(
+    std::vector<std::string>& categories_) const {
+  categories_.clear();
+  for (const auto& category : _categories_) {
+    categories_.push_back(category.label);
+  }
+  return;
+}
+
+void scin_signal_generator_driver::build_list_of_output_categories(
+    std::vector<std::string>& categories_) const {
+  // Each step hit category produces the signal category with the same name:
+  build_list_of_input_categories(categories_);
+  return;
+}
+
+void scin_signal_generator_driver::_initialize(const datatools::properties& config_) {
+  std::string mode_label = "triangle";
+  if (config_.has_key("mode")) {
+    mode_label = config_.fetch_string("mode");
+  }
+  if (mode_label == "triangle") {
+    _schema_.initialize(triangle_shape_policy::shape_type_id());
+    _kernel_ = &scin_signal_generator_driver::_process_hits_<triangle_shape_policy>;
+  } else {
+    DT_THROW(std::logic_error, "Unsupported driver mode '" << mode_label << "'!");
+  }
+
+  // Default timings (from Bordeaux wavecatcher signals):
+  double rise_time = 8 * CLHEP::ns;
+  double fall_time = 70 * CLHEP::ns;
+  if (config_.has_key("rise_time")) {
+    rise_time = config_.fetch_real("rise_time");
+    if (!config_.has_explicit_unit("rise_time")) rise_time *= CLHEP::ns;
+  }
+  if (config_.has_key("fall_time")) {
+    fall_time = config_.fetch_real("fall_time");
+    if (!config_.has_explicit_unit("fall_time")) fall_time *= CLHEP::ns;
+  }
+
+  std::vector<std::string> labels = {"calo", "xcalo", "gveto"};
+  if (config_.has_key("categories")) {
+    labels.clear();
+    config_.fetch("categories", labels);
+  }
+  DT_THROW_IF(labels.empty(), std::logic_error, "Missing step hit categories!");
+  _categories_.clear();
+  for (const auto& label : labels) {
+    category_entry entry;
+    entry.label = label;
+    entry.id = category_registry::intern(label);
+    entry.rise_time = rise_time;
+    entry.fall_time = fall_time;
+    const std::string prefix = "category." + label + ".";
+    if (config_.has_key(prefix + "rise_time")) {
+      entry.rise_time = config_.fetch_real(prefix + "rise_time");
+      if (!config_.has_explicit_unit(prefix + "rise_time")) entry.rise_time *= CLHEP::ns;
+    }
+    if (config_.has_key(prefix + "fall_time")) {
+      entry.fall_time = config_.fetch_real(prefix + "fall_time");
+      if (!config_.has_explicit_unit(prefix + "fall_time")) entry.fall_time *= CLHEP::ns;
+    }
+    DT_THROW_IF(entry.rise_time <= 0.0 || entry.fall_time <= 0.0, std::domain_error,
+                "Invalid rise/fall times for category '" << label << "'!");
+    _categories_.push_back(entry);
+  }
+
+  // 1 MeV is equivalent to 300 mV
+  _amplitude_per_energy_ = 0.3 * CLHEP::volt / CLHEP::MeV;
+
+  _step_hits_.assign(_categories_.size(), nullptr);
+  return;
+}
+
+void scin_signal_generator_driver::_reset() {
+  _categories_.clear();
+  _step_hits_.clear();
+  _hit_entries_.clear();
+  _atomic_signals_.clear();
+  _atomic_signals_.shrink_to_fit();
+  _schema_ = shape_schema();
+  _amplitude_per_energy_ = 0.0;
+  _kernel_ = nullptr;
+  return;
+}
+
+void scin_signal_generator_driver::_process(const mctools::simulated_data& sim_data_,
+                                            mctools::signal::signal_data& sim_signal_data_) {
+  DT_THROW_IF(_kernel_ == nullptr, std::logic_error,
+              "Scintillator signal generator driver has no hit loop kernel !");
+  (this->*_kernel_)(sim_data_, sim_signal_data_);
+  return;
+}
+
+template <class ShapePolicy>
+void scin_signal_generator_driver::_process_hits_(
+    const mctools::simulated_data& sim_data_, mctools::signal::signal_data& sim_signal_data_) {
+  // Resolve the step hits of all categories at once:
+  std::size_t number_of_hits = 0;
+  for (std::size_t icat = 0; icat < _categories_.size(); icat++) {
+    _step_hits_[icat] = _find_step_hits(sim_data_, _categories_[icat].id);
+    if (_step_hits_[icat] != nullptr) {
+      number_of_hits += _step_hits_[icat]->size();
+    }
+  }
+  if (number_of_hits == 0) {
+    return;
+  }
+
+  span_recorder::scope shape_span(get_span_recorder(), "shape building", "phase");
+
+  // Common time reference of all the scintillator hits of the event:
+  double event_time_ref;
+  datatools::invalidate(event_time_ref);
+  for (const auto* step_hits : _step_hits_) {
+    if (step_hits == nullptr) continue;
+    for (const auto& hit : *step_hits) {
+      const double hit_time = hit.get().get_time_start() * CLHEP::ns;
+      if (!datatools::is_valid(event_time_ref) || hit_time < event_time_ref) {
+        event_time_ref = hit_time;
+      }
+    }
+  }
+
+  if (is_degraded_mode()) {
+    shape_span.stop();
+    _process_aggregated_hits_<ShapePolicy>(event_time_ref, number_of_hits, sim_signal_data_);
+    return;
+  }
+
+  // Build the atomic signals of all categories in one pass:
+  _hit_entries_.clear();
+  _hit_entries_.reserve(number_of_hits);
+  _atomic_signals_.clear();
+  _atomic_signals_.reserve(number_of_hits);
+  for (std::size_t icat = 0; icat < _categories_.size(); icat++) {
+    const auto* step_hits = _step_hits_[icat];
+    if (step_hits == nullptr) continue;
+    const category_entry& category = _categories_[icat];
+    for (const auto& hit_handle : *step_hits) {
+      const mctools::base_step_hit& hit = hit_handle.get();
+      const geomtools::geom_id& gid = hit.get_geom_id();
+      hit_entry entry;
+      entry.category = icat;
+      entry.gid_key = packed_gid::encode(gid);
+      entry.signal = _atomic_signals_.size();
+      _hit_entries_.push_back(entry);
+
+      _atomic_signals_.push_back(mctools::signal::base_signal());
+      mctools::signal::base_signal& a_signal = _atomic_signals_.back();
+      a_signal.set_hit_id(hit.get_hit_id());
+      a_signal.set_geom_id(gid);
+      a_signal.set_category(category_registry::get_label(category.id));
+      a_signal.set_time_ref(event_time_ref);
+      const double t0 = hit.get_time_start() * CLHEP::ns - event_time_ref;
+      const double amplitude = hit.get_energy_deposit() * CLHEP::MeV * _amplitude_per_energy_;
+      ShapePolicy::build(a_signal, _schema_, t0, category.rise_time, category.fall_time,
+                         amplitude);
+      a_signal.initialize_simple();
+    }
+  }
+
+  shape_span.stop();
+
+  // Group the signals per category and channel:
+  span_recorder::scope grouping_span(get_span_recorder(), "grouping", "phase");
+  std::sort(_hit_entries_.begin(), _hit_entries_.end());
+  grouping_span.stop();
+  span_recorder::scope fill_span(get_span_recorder(), "bank fill", "phase");
+  std::size_t current_category = _categories_.size();
+  mctools::signal::signal_data::signal_handle_collection_type* output_signals = nullptr;
+  std::vector<const mctools::signal::base_signal*> multi_components;
+  std::size_t ifirst = 0;
+  while (ifirst < _hit_entries_.size()) {
+    const hit_entry& first = _hit_entries_[ifirst];
+    std::size_t ilast = ifirst + 1;
+    while (ilast < _hit_entries_.size() && _hit_entries_[ilast].category == first.category &&
+           _hit_entries_[ilast].gid_key == first.gid_key) {
+      ilast++;
+    }
+    if (first.category != current_category) {
+      current_category = first.category;
+      output_signals = &signal_utils::grab_signal_collection(
+          sim_signal_data_, category_registry::get_label(_categories_[current_category].id));
+      output_signals->reserve(output_signals->size() + _step_hits_[current_category]->size());
+    }
+    if (ilast - ifirst == 1) {
+      // Signal alone :
+      output_signals->push_back(mctools::signal::signal_data::signal_handle_type(
+          new mctools::signal::base_signal(_atomic_signals_[first.signal])));
+    } else {
+      // Multi signal built from the atomic signals of the channel :
+      output_signals->push_back(
+          mctools::signal::signal_data::signal_handle_type(new mctools::signal::base_signal));
+      multi_components.clear();
+      for (std::size_t ientry = ifirst; ientry < ilast; ientry++) {
+        multi_components.push_back(&_atomic_signals_[_hit_entries_[ientry].signal]);
+      }
+      signal_utils::build_multi_signal(multi_components, output_signals->back().grab());
+    }
+    ifirst = ilast;
+  }
+  return;
+}
+
+template <class ShapePolicy>
+void scin_signal_generator_driver::_process_aggregated_hits_(
+    double event_time_ref_, std::size_t number_of_hits_,
+    mctools::signal::signal_data& sim_signal_data_) {
+  // Degraded mode: the hits are grouped per channel before any signal is
+  // built, and each channel gives a single triangle with the summed
+  // amplitude, starting at the earliest hit. No atomic signal is kept.
+  std::vector<const mctools::base_step_hit*> hits;
+  hits.reserve(number_of_hits_);
+  _hit_entries_.clear();
+  _hit_entries_.reserve(number_of_hits_);
+  for (std::size_t icat = 0; icat < _categories_.size(); icat++) {
+    const auto* step_hits = _step_hits_[icat];
+    if (step_hits == nullptr) continue;
+    for (const auto& hit_handle : *step_hits) {
+      hit_entry entry;
+      entry.category = icat;
+      entry.gid_key = packed_gid::encode(hit_handle.get().get_geom_id());
+      entry.signal = hits.size();
+      _hit_entries_.push_back(entry);
+      hits.push_back(&hit_handle.get());
+    }
+  }
+  std::sort(_hit_entries_.begin(), _hit_entries_.end());
+  std::size_t current_category = _categories_.size();
+  mctools::signal::signal_data::signal_handle_collection_type* output_signals = nullptr;
+  std::size_t ifirst = 0;
+  while (ifirst < _hit_entries_.size()) {
+    const hit_entry& first = _hit_entries_[ifirst];
+    const mctools::base_step_hit& first_hit = *hits[first.signal];
+    double start_time = first_hit.get_time_start() * CLHEP::ns;
+    double energy_deposit = 0.0;
+    std::size_t ilast = ifirst;
+    while (ilast < _hit_entries_.size() && _hit_entries_[ilast].category == first.category &&
+           _hit_entries_[ilast].gid_key == first.gid_key) {
+      const mctools::base_step_hit& hit = *hits[_hit_entries_[ilast].signal];
+      start_time = std::min(start_time, hit.get_time_start() * CLHEP::ns);
+      energy_deposit += hit.get_energy_deposit() * CLHEP::MeV;
+      ilast++;
+    }
+    const category_entry& category = _categories_[first.category];
+    if (first.category != current_category) {
+      current_category = first.category;
+      output_signals = &signal_utils::grab_signal_collection(
+          sim_signal_data_, category_registry::get_label(category.id));
+    }
+    output_signals->push_back(
+        mctools::signal::signal_data::signal_handle_type(new mctools::signal::base_signal));
+    mctools::signal::base_signal& a_signal = output_signals->back().grab();
+    a_signal.set_hit_id(first_hit.get_hit_id());
+    a_signal.set_geom_id(first_hit.get_geom_id());
+    a_signal.set_category(category_registry::get_label(category.id));
+    a_signal.set_time_ref(event_time_ref_);
+    ShapePolicy::build(a_signal, _schema_, start_time - event_time_ref_, category.rise_time,
+                       category.fall_time, energy_deposit * _amplitude_per_energy_);
+    a_signal.initialize_simple();
+    ifirst = ilast;
+  }
+  return;
+}
+
+bool scin_signal_generator_driver::has_degraded_mode() const { return true; }
+
+std::size_t scin_signal_generator_driver::get_working_memory() const {
+  std::size_t bytes = _hit_entries_.capacity() * sizeof(hit_entry);
+  bytes += _atomic_signals_.capacity() * sizeof(mctools::signal::base_signal);
+  for (const auto& signal : _atomic_signals_) {
+    bytes += signal_utils::estimate_memory(signal) - sizeof(mctools::signal::base_signal);
+  }
+  return bytes;
+}
+
+void scin_signal_generator_driver::_tree_dump(std::ostream& out_,
+                                              const std::string& /* title_ */,
+                                              const std::string& indent_,
+                                              bool /* inherit_ */) const {
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Shape : '" << _schema_.shape_type_id
+       << "'" << std::endl;
+  out_ << indent_ << datatools::i_tree_dumpable::last_tag << "Categories : "
+       << _categories_.size() << std::endl;
+  for (std::size_t icat = 0; icat < _categories_.size(); icat++) {
+    const category_entry& category = _categories_[icat];
+    out_ << indent_ << datatools::i_tree_dumpable::last_skip_tag
+         << (icat + 1 == _categories_.size() ? datatools::i_tree_dumpable::last_tag
+                                             : datatools::i_tree_dumpable::tag)
+         << "'" << category.label << "' : rise=" << category.rise_time / CLHEP::ns
+         << " ns fall=" << category.fall_time / CLHEP::ns << " ns" << std::endl;
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
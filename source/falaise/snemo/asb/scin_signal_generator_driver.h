@@ -0,0 +1,151 @@
+// snemo/asb/scin_signal_generator_driver.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-05
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SCIN_SIGNAL_GENERATOR_DRIVER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SCIN_SIGNAL_GENERATOR_DRIVER_H
+
+// Standard library:
+#include <string>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+
+// This project:
+#include <snemo/asb/base_signal_generator_driver.h>
+#include <snemo/asb/category_registry.h>
+#include <snemo/asb/packed_gid.h>
+#include <snemo/asb/shape_policies.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Scintillator signal generator driver for several categories in one pass
+///
+/// The main calorimeter, X-wall and gamma veto step hits are processed
+/// together: the event time reference is common to all categories, and the
+/// setup, shape schema and scratch buffers are shared. Each input step hit
+/// category produces signals in the signal category with the same name.
+///
+/// Example of configuration:
+/// \code
+/// signal_category : string = "scin"
+/// categories : string[3] = "calo" "xcalo" "gveto"
+/// mode : string = "triangle"
+/// rise_time : real as time = 8 ns
+/// fall_time : real as time = 70 ns
+/// category.gveto.rise_time : real as time = 10 ns
+/// category.gveto.fall_time : real as time = 60 ns
+/// \endcode
+///
+/// The hits piled up in a channel give a single multi signal. Its
+/// components are the atomic signals of the hits, stored as private shapes
+/// of the signal under the keys "hit<hit ID>", with no time shift and unit
+/// scaling.
+class scin_signal_generator_driver : public base_signal_generator_driver,
+                                     private boost::noncopyable {
+ public:
+  /// Constructor
+  scin_signal_generator_driver(const std::string& id_ = "scin");
+
+  /// Destructor
+  virtual ~scin_signal_generator_driver();
+
+  /// Build the list of step hit categories consumed by the algorithm
+  virtual void build_list_of_input_categories(std::vector<std::string>& categories_) const;
+
+  /// Build the list of signal categories produced by the algorithm
+  virtual void build_list_of_output_categories(std::vector<std::string>& categories_) const;
+
+  /// Check if the algorithm supports a degraded mode using less memory
+  ///
+  /// In degraded mode, the hits of a channel are aggregated in a single
+  /// triangle signal.
+  virtual bool has_degraded_mode() const;
+
+  /// Return the memory held by the working buffers of the algorithm (in bytes)
+  virtual std::size_t get_working_memory() const;
+
+  /// Signature of the hit loop kernels
+  typedef void (scin_signal_generator_driver::*kernel_type)(
+      const mctools::simulated_data& sim_data_, mctools::signal::signal_data& sim_signal_data_);
+
+ protected:
+  /// Initialize the algorithm through configuration properties
+  virtual void _initialize(const datatools::properties& config_);
+
+  /// Reset the algorithm
+  virtual void _reset();
+
+  /// Run the algorithm
+  void _process(const mctools::simulated_data& sim_data_,
+                mctools::signal::signal_data& sim_signal_data_);
+
+  // Smart print
+  void _tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
+                  const std::string& indent_ = "", bool inherit_ = false) const;
+
+ private:
+  /// Run the hit loop specialized on a signal shape policy
+  template <class ShapePolicy>
+  void _process_hits_(const mctools::simulated_data& sim_data_,
+                      mctools::signal::signal_data& sim_signal_data_);
+
+  /// Run the degraded hit loop, aggregating the hits per channel
+  template <class ShapePolicy>
+  void _process_aggregated_hits_(double event_time_ref_, std::size_t number_of_hits_,
+                                 mctools::signal::signal_data& sim_signal_data_);
+
+  /// \brief Parameters of a processed category
+  struct category_entry {
+    std::string label;                                          //!< Category label
+    category_registry::id_type id = category_registry::INVALID_ID;  //!< Interned category
+    double rise_time = 0.0;                                     //!< Rise time of the signals
+    double fall_time = 0.0;                                     //!< Fall time of the signals
+  };
+
+  /// \brief Grouping entry of a step hit
+  struct hit_entry {
+    std::size_t category;          //!< Index of the category
+    packed_gid::key_type gid_key;  //!< Packed GID of the channel
+    std::size_t signal;            //!< Index of the atomic signal
+    bool operator<(const hit_entry& other_) const {
+      if (category != other_.category) return category < other_.category;
+      if (gid_key != other_.gid_key) return gid_key < other_.gid_key;
+      return signal < other_.signal;
+    }
+  };
+
+ private:
+  // Configuration:
+  std::vector<category_entry> _categories_;  //!< Processed categories
+  double _amplitude_per_energy_ = 0.0;       //!< Conversion factor from energy deposit to amplitude
+
+  // Working data:
+  kernel_type _kernel_ = nullptr;  //!< Hit loop kernel resolved at initialization
+  shape_schema _schema_;           //!< Shape parameters shared by all categories
+  std::vector<const mctools::simulated_data::hit_handle_collection_type*>
+      _step_hits_;                                             //!< Step hits per category
+  std::vector<hit_entry> _hit_entries_;                        //!< Grouping entries of the hits
+  std::vector<mctools::signal::base_signal> _atomic_signals_;  //!< Atomic signal per hit
+
+  // Registration of the driver class :
+  DATATOOLS_FACTORY_SYSTEM_AUTO_REGISTRATION_INTERFACE(base_signal_generator_driver,
+                                                       scin_signal_generator_driver)
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SCIN_SIGNAL_GENERATOR_DRIVER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,289 @@
+// shape_factory.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/shape_factory.h>
+
+// Standard library:
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+
+// This project:
+#include <snemo/asb/shape_policies.h>
+
+namespace snemo {
+
+namespace asb {
+
+shape_factory::shape_factory() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  _time_quantum_ = 0.1 * CLHEP::ns;
+  _amplitude_quantum_ = 0.5 * CLHEP::millivolt;
+  return;
+}
+
+shape_factory::~shape_factory() {
+  if (is_initialized()) {
+    reset();
+  }
+  return;
+}
+
+void shape_factory::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+void shape_factory::set_capacity(std::size_t capacity_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  DT_THROW_IF(capacity_ == 0, std::domain_error, "Invalid null capacity!");
+  _capacity_ = capacity_;
+  return;
+}
+
+std::size_t shape_factory::get_capacity() const { return _capacity_; }
+
+void shape_factory::set_time_quantum(double quantum_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  DT_THROW_IF(!(quantum_ > 0.0), std::domain_error, "Invalid time quantum!");
+  _time_quantum_ = quantum_;
+  return;
+}
+
+void shape_factory::set_amplitude_quantum(double quantum_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  DT_THROW_IF(!(quantum_ > 0.0), std::domain_error, "Invalid amplitude quantum!");
+  _amplitude_quantum_ = quantum_;
+  return;
+}
+
+void shape_factory::set_parameter_quantum(const std::string& name_, double quantum_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  DT_THROW_IF(!(quantum_ > 0.0), std::domain_error,
+              "Invalid quantum for shape parameter '" << name_ << "'!");
+  _explicit_quanta_[name_] = quantum_;
+  return;
+}
+
+double shape_factory::get_parameter_quantum(const std::string& name_) const {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Shape factory is not initialized!");
+  const auto found = _quanta_.find(name_);
+  return found != _quanta_.end() ? found->second : 0.0;
+}
+
+bool shape_factory::is_initialized() const { return _initialized_; }
+
+void shape_factory::initialize(const datatools::properties& config_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  if (config_.has_key("capacity")) {
+    const int capacity = config_.fetch_integer("capacity");
+    DT_THROW_IF(capacity <= 0, std::domain_error, "Invalid capacity (" << capacity << ")!");
+    set_capacity(capacity);
+  }
+  if (config_.has_key("time_quantum")) {
+    double quantum = config_.fetch_real("time_quantum");
+    if (!config_.has_explicit_unit("time_quantum")) {
+      quantum *= CLHEP::ns;
+    }
+    set_time_quantum(quantum);
+  }
+  if (config_.has_key("amplitude_quantum")) {
+    double quantum = config_.fetch_real("amplitude_quantum");
+    if (!config_.has_explicit_unit("amplitude_quantum")) {
+      quantum *= CLHEP::millivolt;
+    }
+    set_amplitude_quantum(quantum);
+  }
+  _builder_config_.clear();
+  config_.export_and_rename_starting_with(_builder_config_, "builder.", "");
+  _category_.clear();
+  _shape_type_ids_.clear();
+  _setup_quanta_();
+  _setup_builder_();
+  _initialized_ = true;
+  return;
+}
+
+void shape_factory::initialize_simple(const std::string& category_,
+                                      const std::vector<std::string>& shape_type_ids_) {
+  DT_THROW_IF(is_initialized(), std::logic_error, "Shape factory is already initialized!");
+  DT_THROW_IF(shape_type_ids_.empty(), std::logic_error, "Missing shape type identifiers!");
+  _builder_config_.clear();
+  _category_ = category_;
+  _shape_type_ids_ = shape_type_ids_;
+  _setup_quanta_();
+  _setup_builder_();
+  _initialized_ = true;
+  return;
+}
+
+void shape_factory::reset() {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Shape factory is not initialized!");
+  _initialized_ = false;
+  if (_builder_.is_initialized()) {
+    _builder_.reset();
+  }
+  _functors_.clear();
+  _key_.clear();
+  _quanta_.clear();
+  _quantized_parameters_.clear();
+  _builder_config_.clear();
+  _category_.clear();
+  _shape_type_ids_.clear();
+  _epoch_ = 0;
+  _stats_ = stats_type();
+  return;
+}
+
+const mygsl::i_unary_function& shape_factory::get_shape(
+    const std::string& shape_type_id_, const datatools::properties& shape_parameters_) {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Shape factory is not initialized!");
+  DT_THROW_IF(shape_type_id_ == "mctools::signal::multi_signal_shape", std::logic_error,
+              "Multi signal shapes cannot be shared!");
+  _make_key_(shape_type_id_, shape_parameters_);
+  auto found = _functors_.find(_key_);
+  if (found != _functors_.end()) {
+    _stats_.hits++;
+    return _builder_.get_functor(found->second);
+  }
+  if (_functors_.size() >= _capacity_) {
+    DT_LOG_DEBUG(_logging_priority_, "Shape cache is full; flush " << _functors_.size()
+                                                                    << " functors.");
+    flush();
+  }
+  _stats_.misses++;
+  const std::string functor_key = "shape_" + std::to_string(_functors_.size());
+  const mygsl::i_unary_function& functor =
+      _builder_.create_signal_shape(functor_key, shape_type_id_, _quantized_parameters_);
+  _functors_.emplace(_key_, functor_key);
+  return functor;
+}
+
+const mygsl::i_unary_function& shape_factory::get_shape(
+    const mctools::signal::base_signal& signal_) {
+  datatools::properties shape_parameters;
+  signal_.get_auxiliaries().export_and_rename_starting_with(
+      shape_parameters, mctools::signal::base_signal::shape_parameter_prefix(), "");
+  return get_shape(signal_.get_shape_type_id(), shape_parameters);
+}
+
+std::size_t shape_factory::get_size() const { return _functors_.size(); }
+
+std::size_t shape_factory::get_epoch() const { return _epoch_; }
+
+const shape_factory::stats_type& shape_factory::get_stats() const { return _stats_; }
+
+const mctools::signal::signal_shape_builder& shape_factory::get_builder() const {
+  return _builder_;
+}
+
+void shape_factory::flush() {
+  DT_THROW_IF(!is_initialized(), std::logic_error, "Shape factory is not initialized!");
+  _builder_.reset();
+  _functors_.clear();
+  _setup_builder_();
+  _epoch_++;
+  _stats_.flushes++;
+  return;
+}
+
+void shape_factory::_make_key_(const std::string& shape_type_id_,
+                               const datatools::properties& parameters_) {
+  // The key lists the parameters in the (sorted) order of their names:
+  _key_ = shape_type_id_;
+  _quantized_parameters_.clear();
+  std::vector<std::string> keys;
+  parameters_.keys(keys);
+  for (const auto& key : keys) {
+    DT_THROW_IF(parameters_.is_vector(key), std::logic_error,
+                "Vector shape parameter '" << key << "' cannot be shared!");
+    _key_ += '|';
+    _key_ += key;
+    _key_ += '=';
+    if (parameters_.is_real(key)) {
+      const auto found = _quanta_.find(key);
+      double value = parameters_.fetch_real(key);
+      if (found != _quanta_.end()) {
+        const long long step = std::llround(value / found->second);
+        _key_ += std::to_string(step);
+        value = step * found->second;
+      } else {
+        // Exact value, keyed by its bit pattern:
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        _key_ += 'x';
+        _key_ += std::to_string(bits);
+      }
+      _quantized_parameters_.store_real_with_explicit_unit(key, value);
+      if (parameters_.has_explicit_unit(key)) {
+        _quantized_parameters_.set_unit_symbol(key, parameters_.get_unit_symbol(key));
+      }
+    } else if (parameters_.is_integer(key)) {
+      _key_ += std::to_string(parameters_.fetch_integer(key));
+      _quantized_parameters_.store_integer(key, parameters_.fetch_integer(key));
+    } else if (parameters_.is_boolean(key)) {
+      _key_ += parameters_.fetch_boolean(key) ? '1' : '0';
+      _quantized_parameters_.store_boolean(key, parameters_.fetch_boolean(key));
+    } else {
+      _key_ += parameters_.fetch_string(key);
+      _quantized_parameters_.store_string(key, parameters_.fetch_string(key));
+    }
+  }
+  return;
+}
+
+void shape_factory::_setup_quanta_() {
+  _quanta_.clear();
+  for (const auto& name : shape_schema::time_parameter_names()) {
+    _quanta_[name] = _time_quantum_;
+  }
+  for (const auto& name : shape_schema::amplitude_parameter_names()) {
+    _quanta_[name] = _amplitude_quantum_;
+  }
+  for (const auto& explicit_quantum : _explicit_quanta_) {
+    _quanta_[explicit_quantum.first] = explicit_quantum.second;
+  }
+  return;
+}
+
+void shape_factory::_setup_builder_() {
+  _builder_.set_logging_priority(_logging_priority_);
+  if (_shape_type_ids_.empty()) {
+    _builder_.initialize(_builder_config_);
+  } else {
+    _builder_.set_category(_category_);
+    for (const auto& shape_type_id : _shape_type_ids_) {
+      _builder_.add_registered_shape_type_id(shape_type_id);
+    }
+    _builder_.initialize_simple();
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,167 @@
+// snemo/asb/shape_factory.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-08
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_FACTORY_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_FACTORY_H
+
+// Standard library:
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+#include <bayeux/datatools/properties.h>
+// - Bayeux/mygsl:
+#include <bayeux/mygsl/i_unary_function.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+#include <bayeux/mctools/signal/signal_shape_builder.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Factory of signal shape functors with a bounded cache
+///
+/// Shape functors are keyed by their shape type and their quantized
+/// parameters, so that identical or near-identical pulses share a single
+/// functor, created once by an embedded signal shape builder. Real
+/// parameters are rounded to the quantum of a per-parameter table: the time
+/// quantum for the time parameters of the shape schema, the amplitude
+/// quantum for its amplitude parameters, or an explicit quantum. The
+/// functor is built from the rounded values. Real parameters without a
+/// quantum are not rounded, so that only identical values are shared.
+///
+/// The signal shape builder cannot release a single functor: when the cache
+/// is full, all the functors are flushed at once and a new epoch starts.
+/// References returned by the factory are only valid within their epoch.
+/// Shapes referring to other functors (multi signal shapes) are not cached.
+///
+/// Configuration:
+/// \code
+/// capacity : integer = 4096
+/// time_quantum : real as time = 0.1 ns
+/// amplitude_quantum : real as electric_potential = 0.5 mV
+///
+/// # Configuration of the embedded signal shape builder (all the keys of
+/// # mctools::signal::signal_shape_builder, with the "builder." prefix):
+/// builder.category : string = "calo"
+/// \endcode
+class shape_factory : private boost::noncopyable {
+ public:
+  /// \brief Statistics of the cache
+  struct stats_type {
+    std::size_t hits = 0;     //!< Number of requests served by an existing functor
+    std::size_t misses = 0;   //!< Number of created functors
+    std::size_t flushes = 0;  //!< Number of cache flushes
+  };
+
+  /// Constructor
+  shape_factory();
+
+  /// Destructor
+  ~shape_factory();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Set the maximum number of cached functors
+  void set_capacity(std::size_t capacity_);
+
+  /// Return the maximum number of cached functors
+  std::size_t get_capacity() const;
+
+  /// Set the quantum of the time parameters
+  void set_time_quantum(double quantum_);
+
+  /// Set the quantum of the amplitude parameters
+  void set_amplitude_quantum(double quantum_);
+
+  /// Set the quantum of a real shape parameter, by name, overriding the schema defaults
+  void set_parameter_quantum(const std::string& name_, double quantum_);
+
+  /// Return the quantum of a real shape parameter, or zero if it is not rounded
+  double get_parameter_quantum(const std::string& name_) const;
+
+  /// Check initialization flag
+  bool is_initialized() const;
+
+  /// Initialize from configuration properties
+  void initialize(const datatools::properties& config_);
+
+  /// Initialize with a builder of the given category and shape types
+  void initialize_simple(const std::string& category_,
+                         const std::vector<std::string>& shape_type_ids_);
+
+  /// Reset
+  void reset();
+
+  /// Return the functor of a shape, creating it if needed
+  const mygsl::i_unary_function& get_shape(const std::string& shape_type_id_,
+                                           const datatools::properties& shape_parameters_);
+
+  /// Return the functor of the shape of a signal, creating it if needed
+  const mygsl::i_unary_function& get_shape(const mctools::signal::base_signal& signal_);
+
+  /// Return the number of cached functors
+  std::size_t get_size() const;
+
+  /// Return the current epoch, incremented at each flush
+  std::size_t get_epoch() const;
+
+  /// Return the statistics of the cache
+  const stats_type& get_stats() const;
+
+  /// Return the embedded signal shape builder
+  const mctools::signal::signal_shape_builder& get_builder() const;
+
+  /// Release all the functors and start a new epoch
+  void flush();
+
+ private:
+  void _make_key_(const std::string& shape_type_id_, const datatools::properties& parameters_);
+  void _setup_builder_();
+  void _setup_quanta_();
+
+ private:
+  // Management:
+  bool _initialized_ = false;
+  datatools::logger::priority _logging_priority_;
+
+  // Configuration:
+  std::size_t _capacity_ = 4096;  //!< Maximum number of cached functors
+  double _time_quantum_;          //!< Quantum of the time parameters
+  double _amplitude_quantum_;     //!< Quantum of the amplitude parameters
+  std::map<std::string, double> _explicit_quanta_;  //!< Explicit quanta by parameter name
+  datatools::properties _builder_config_;     //!< Configuration of the builder
+  std::string _category_;                     //!< Category of the simple builder
+  std::vector<std::string> _shape_type_ids_;  //!< Shape types of the simple builder
+
+  // Working data:
+  mctools::signal::signal_shape_builder _builder_;          //!< Builder of the functors
+  std::unordered_map<std::string, std::string> _functors_;  //!< Functor keys by shape key
+  std::string _key_;                                        //!< Shape key being built
+  std::map<std::string, double> _quanta_;                   //!< Quanta by parameter name
+  datatools::properties _quantized_parameters_;             //!< Rounded shape parameters
+  std::size_t _epoch_ = 0;                                  //!< Current epoch
+  stats_type _stats_;                                       //!< Statistics of the cache
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_FACTORY_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,107 @@
+// snemo/asb/shape_policies.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-05
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_POLICIES_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_POLICIES_H
+
+// Standard library:
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/properties.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Signal shape parameters resolved once at initialization
+///
+/// Auxiliary keys, unit symbols and fixed shape constants are built once,
+/// so that building the shape of a signal is pure arithmetic.
+struct shape_schema {
+  std::string shape_type_id;   //!< Shape type identifier
+  std::string polarity;        //!< Polarity of the signals
+  std::string polarity_key;    //!< Auxiliary key of the polarity
+  std::string t0_key;          //!< Auxiliary key of the start time
+  std::string t1_key;          //!< Auxiliary key of the peak time
+  std::string t2_key;          //!< Auxiliary key of the stop time
+  std::string amplitude_key;   //!< Auxiliary key of the amplitude
+  std::string time_unit;       //!< Unit symbol of the time parameters
+  std::string amplitude_unit;  //!< Unit symbol of the amplitude
+
+  /// Return the names of the time shape parameters (without the shape parameter prefix)
+  static const std::vector<std::string>& time_parameter_names() {
+    static const std::vector<std::string> _names = {"t0", "t1", "t2"};
+    return _names;
+  }
+
+  /// Return the names of the amplitude shape parameters (without the shape parameter prefix)
+  static const std::vector<std::string>& amplitude_parameter_names() {
+    static const std::vector<std::string> _names = {"amplitude"};
+    return _names;
+  }
+
+  /// Resolve the keys and units of a shape type
+  void initialize(const std::string& shape_type_id_, const std::string& polarity_ = "-") {
+    shape_type_id = shape_type_id_;
+    polarity = polarity_;
+    polarity_key = mctools::signal::base_signal::shape_key("polarity");
+    t0_key = mctools::signal::base_signal::shape_key("t0");
+    t1_key = mctools::signal::base_signal::shape_key("t1");
+    t2_key = mctools::signal::base_signal::shape_key("t2");
+    amplitude_key = mctools::signal::base_signal::shape_key("amplitude");
+    time_unit = "ns";
+    amplitude_unit = "V";
+    return;
+  }
+};
+
+/// \brief Triangle signal shape policy of the scintillator drivers
+struct triangle_shape_policy {
+  static const std::string& shape_type_id() {
+    static const std::string _id("mctools::signal::triangle_signal_shape");
+    return _id;
+  }
+
+  static void build(mctools::signal::base_signal& signal_, const shape_schema& schema_,
+                    const double t0_, const double rise_time_, const double fall_time_,
+                    const double amplitude_) {
+    const double t1 = t0_ + rise_time_;
+    const double t2 = t1 + fall_time_;
+    signal_.set_shape_type_id(schema_.shape_type_id);
+    datatools::properties& aux = signal_.grab_auxiliaries();
+    aux.store_string(schema_.polarity_key, schema_.polarity);
+    _store_(aux, schema_.t0_key, t0_, schema_.time_unit);
+    _store_(aux, schema_.t1_key, t1, schema_.time_unit);
+    _store_(aux, schema_.t2_key, t2, schema_.time_unit);
+    _store_(aux, schema_.amplitude_key, amplitude_, schema_.amplitude_unit);
+    return;
+  }
+
+ private:
+  // Store a real shape parameter with its unit symbol
+  static void _store_(datatools::properties& aux_, const std::string& key_, const double value_,
+                      const std::string& unit_) {
+    aux_.store_real_with_explicit_unit(key_, value_);
+    aux_.set_unit_symbol(key_, unit_);
+    return;
+  }
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_POLICIES_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
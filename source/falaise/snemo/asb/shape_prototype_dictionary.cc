@@ -0,0 +1,284 @@
+// shape_prototype_dictionary.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/shape_prototype_dictionary.h>
+
+// Standard library:
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+
+// This project:
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Resolution of the rise and fall times of the prototypes
+const double time_resolution = 1.0 * CLHEP::picosecond;
+
+const std::string& triangle_shape_type_id() {
+  static const std::string _id("mctools::signal::triangle_signal_shape");
+  return _id;
+}
+
+const std::string& prototype_prefix() {
+  static const std::string _prefix("asb.shape_prototype.");
+  return _prefix;
+}
+
+const std::string& prototype_ids_key() {
+  static const std::string _key("asb.shape_prototype.ids");
+  return _key;
+}
+
+// Store a real parameter with its unit symbol
+void store_with_unit(datatools::properties& aux_, const std::string& key_, double value_,
+                     const std::string& unit_) {
+  aux_.store_real_with_explicit_unit(key_, value_);
+  aux_.set_unit_symbol(key_, unit_);
+  return;
+}
+
+}  // end of anonymous namespace
+
+const std::string& shape_prototype_dictionary::prototype_key() {
+  static const std::string _key("asb.shape_prototype");
+  return _key;
+}
+
+bool shape_prototype_dictionary::is_compact(const mctools::signal::base_signal& signal_) {
+  return signal_.get_auxiliaries().has_key(prototype_key());
+}
+
+shape_prototype_dictionary::shape_prototype_dictionary() {
+  _polarity_key_ = mctools::signal::base_signal::shape_key("polarity");
+  _t0_key_ = mctools::signal::base_signal::shape_key("t0");
+  _t1_key_ = mctools::signal::base_signal::shape_key("t1");
+  _t2_key_ = mctools::signal::base_signal::shape_key("t2");
+  _amplitude_key_ = mctools::signal::base_signal::shape_key("amplitude");
+  return;
+}
+
+std::size_t shape_prototype_dictionary::get_number_of_prototypes() const {
+  return _prototypes_.size();
+}
+
+const shape_prototype_dictionary::prototype_type& shape_prototype_dictionary::get_prototype(
+    int id_) const {
+  auto found = _prototypes_.find(id_);
+  DT_THROW_IF(found == _prototypes_.end(), std::range_error,
+              "Invalid shape prototype identifier [" << id_ << "]!");
+  return found->second;
+}
+
+int shape_prototype_dictionary::_make_id_(const index_key_type& key_) {
+  uint64_t digest = hash_utils::update(hash_utils::offset_basis, std::get<0>(key_));
+  digest = hash_utils::update(digest, std::get<1>(key_));
+  digest = hash_utils::update(digest, static_cast<uint64_t>(std::get<2>(key_)));
+  digest = hash_utils::update(digest, static_cast<uint64_t>(std::get<3>(key_)));
+  // Fold the digest on the non-negative range of integer properties:
+  return static_cast<int>((digest ^ (digest >> 32)) & 0x7FFFFFFFULL);
+}
+
+int shape_prototype_dictionary::add_prototype(const std::string& shape_type_id_,
+                                              const std::string& polarity_, double rise_time_,
+                                              double fall_time_) {
+  const long long rise_step = std::llround(rise_time_ / time_resolution);
+  const long long fall_step = std::llround(fall_time_ / time_resolution);
+  const index_key_type key(shape_type_id_, polarity_, rise_step, fall_step);
+  auto found = _index_.find(key);
+  if (found != _index_.end()) {
+    return found->second;
+  }
+  const int id = _make_id_(key);
+  DT_THROW_IF(_prototypes_.count(id), std::logic_error,
+              "Shape prototype identifier [" << id << "] is shared by two prototypes!");
+  prototype_type prototype;
+  prototype.shape_type_id = shape_type_id_;
+  prototype.polarity = polarity_;
+  prototype.rise_time = rise_step * time_resolution;
+  prototype.fall_time = fall_step * time_resolution;
+  _prototypes_.emplace(id, prototype);
+  _index_.emplace(key, id);
+  return id;
+}
+
+bool shape_prototype_dictionary::compact(mctools::signal::base_signal& signal_) {
+  if (signal_.get_shape_type_id() != triangle_shape_type_id()) {
+    return false;
+  }
+  datatools::properties& aux = signal_.grab_auxiliaries();
+  if (!aux.has_key(_t0_key_) || !aux.has_key(_t1_key_) || !aux.has_key(_t2_key_) ||
+      !aux.has_key(_amplitude_key_)) {
+    return false;
+  }
+  const double t0 = aux.fetch_real(_t0_key_);
+  const double t1 = aux.fetch_real(_t1_key_);
+  const double t2 = aux.fetch_real(_t2_key_);
+  const std::string polarity = aux.has_key(_polarity_key_) ? aux.fetch_string(_polarity_key_) : "";
+  const int id = add_prototype(signal_.get_shape_type_id(), polarity, t1 - t0, t2 - t1);
+  aux.erase(_t1_key_);
+  aux.erase(_t2_key_);
+  if (aux.has_key(_polarity_key_)) {
+    aux.erase(_polarity_key_);
+  }
+  aux.store_integer(prototype_key(), id);
+  signal_.set_shape_type_id("");
+  return true;
+}
+
+std::size_t shape_prototype_dictionary::compact(mctools::signal::signal_data& signal_data_) {
+  std::size_t number_of_compacted = 0;
+  _keys_.clear();
+  _bank_ids_.clear();
+  signal_data_.build_list_of_categories(_keys_);
+  for (const auto& category : _keys_) {
+    for (auto& signal_handle : signal_data_.grab_signals(category)) {
+      if (compact(signal_handle.grab())) {
+        _bank_ids_.push_back(signal_handle.get().get_auxiliaries().fetch_integer(prototype_key()));
+        number_of_compacted++;
+      }
+    }
+  }
+  if (number_of_compacted > 0) {
+    // Only the prototypes referenced by the bank are stored with it:
+    std::sort(_bank_ids_.begin(), _bank_ids_.end());
+    _bank_ids_.erase(std::unique(_bank_ids_.begin(), _bank_ids_.end()), _bank_ids_.end());
+    export_to(signal_data_.grab_auxiliaries(), _bank_ids_);
+  }
+  return number_of_compacted;
+}
+
+void shape_prototype_dictionary::expand(mctools::signal::base_signal& signal_) const {
+  datatools::properties& aux = signal_.grab_auxiliaries();
+  if (!aux.has_key(prototype_key())) {
+    return;
+  }
+  const prototype_type& prototype = get_prototype(aux.fetch_integer(prototype_key()));
+  const double t0 = aux.fetch_real(_t0_key_);
+  const std::string time_unit = aux.has_explicit_unit(_t0_key_) ? aux.get_unit_symbol(_t0_key_)
+                                                                  : std::string("ns");
+  signal_.set_shape_type_id(prototype.shape_type_id);
+  if (!prototype.polarity.empty()) {
+    aux.store_string(_polarity_key_, prototype.polarity);
+  }
+  store_with_unit(aux, _t1_key_, t0 + prototype.rise_time, time_unit);
+  store_with_unit(aux, _t2_key_, t0 + prototype.rise_time + prototype.fall_time, time_unit);
+  aux.erase(prototype_key());
+  return;
+}
+
+std::size_t shape_prototype_dictionary::expand(mctools::signal::signal_data& signal_data_) {
+  shape_prototype_dictionary dictionary;
+  dictionary.import_from(signal_data_.get_auxiliaries());
+  if (dictionary.get_number_of_prototypes() == 0) {
+    return 0;
+  }
+  std::size_t number_of_expanded = 0;
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  for (const auto& category : categories) {
+    for (auto& signal_handle : signal_data_.grab_signals(category)) {
+      if (is_compact(signal_handle.get())) {
+        dictionary.expand(signal_handle.grab());
+        number_of_expanded++;
+      }
+    }
+  }
+  signal_data_.grab_auxiliaries().erase_all_starting_with(prototype_prefix());
+  return number_of_expanded;
+}
+
+void shape_prototype_dictionary::export_to(datatools::properties& bank_aux_) const {
+  std::vector<int> ids;
+  for (const auto& prototype : _prototypes_) {
+    ids.push_back(prototype.first);
+  }
+  export_to(bank_aux_, ids);
+  return;
+}
+
+void shape_prototype_dictionary::export_to(datatools::properties& bank_aux_,
+                                           const std::vector<int>& ids_) const {
+  bank_aux_.erase_all_starting_with(prototype_prefix());
+  if (ids_.empty()) {
+    return;
+  }
+  bank_aux_.store(prototype_ids_key(), ids_);
+  for (const int id : ids_) {
+    const prototype_type& prototype = get_prototype(id);
+    const std::string prefix = prototype_prefix() + std::to_string(id) + ".";
+    bank_aux_.store_string(prefix + "shape_type_id", prototype.shape_type_id);
+    bank_aux_.store_string(prefix + "polarity", prototype.polarity);
+    store_with_unit(bank_aux_, prefix + "rise_time", prototype.rise_time, "ns");
+    store_with_unit(bank_aux_, prefix + "fall_time", prototype.fall_time, "ns");
+  }
+  return;
+}
+
+void shape_prototype_dictionary::import_from(const datatools::properties& bank_aux_) {
+  clear();
+  if (!bank_aux_.has_key(prototype_ids_key())) {
+    return;
+  }
+  std::vector<int> ids;
+  bank_aux_.fetch(prototype_ids_key(), ids);
+  for (const int id : ids) {
+    DT_THROW_IF(id < 0, std::range_error,
+                "Invalid shape prototype identifier [" << id << "] in bank auxiliaries!");
+    DT_THROW_IF(_prototypes_.count(id), std::logic_error,
+                "Duplicated shape prototype [" << id << "] in bank auxiliaries!");
+    const std::string prefix = prototype_prefix() + std::to_string(id) + ".";
+    prototype_type prototype;
+    prototype.shape_type_id = bank_aux_.fetch_string(prefix + "shape_type_id");
+    prototype.polarity = bank_aux_.fetch_string(prefix + "polarity");
+    const long long rise_step =
+        std::llround(bank_aux_.fetch_real(prefix + "rise_time") / time_resolution);
+    const long long fall_step =
+        std::llround(bank_aux_.fetch_real(prefix + "fall_time") / time_resolution);
+    prototype.rise_time = rise_step * time_resolution;
+    prototype.fall_time = fall_step * time_resolution;
+    _prototypes_[id] = prototype;
+    _index_.emplace(index_key_type(prototype.shape_type_id, prototype.polarity, rise_step,
+                                   fall_step),
+                    id);
+  }
+  return;
+}
+
+void shape_prototype_dictionary::clear() {
+  _prototypes_.clear();
+  _index_.clear();
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,137 @@
+// snemo/asb/shape_prototype_dictionary.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-09
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_PROTOTYPE_DICTIONARY_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_PROTOTYPE_DICTIONARY_H
+
+// Standard library:
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/properties.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Dictionary of the constant parameters shared by triangle signals
+///
+/// A prototype gathers the shape type identifier, the polarity and the rise
+/// and fall times of triangle signals. A compact signal has no shape type
+/// identifier and only carries its prototype identifier, its start time t0
+/// and its amplitude; the peak and stop times are t0 + rise time and
+/// t0 + rise time + fall time. Rise and fall times are rounded to 1 ps.
+///
+/// The identifier of a prototype is a 31-bit digest of its rounded
+/// parameters, so that it does not depend on the order in which signals are
+/// compacted: the modules of parallel workers or of the shards of a run give
+/// the same identifiers, and the same compact banks. Each bank with compact
+/// signals stores the prototypes it refers to, and only those, in its
+/// auxiliaries:
+/// \code
+/// asb.shape_prototype.ids : integer[2] = 216193936 1438241968
+/// asb.shape_prototype.216193936.shape_type_id : string = "mctools::signal::triangle_signal_shape"
+/// asb.shape_prototype.216193936.polarity : string = "-"
+/// asb.shape_prototype.216193936.rise_time : real as time = 7.5 ns
+/// asb.shape_prototype.216193936.fall_time : real as time = 70 ns
+/// asb.shape_prototype.1438241968.shape_type_id : string = "mctools::signal::triangle_signal_shape"
+/// ...
+/// \endcode
+///
+/// Compact signals must be expanded before building their shapes.
+class shape_prototype_dictionary {
+ public:
+  /// \brief Constant parameters of a family of triangle signals
+  struct prototype_type {
+    std::string shape_type_id;  //!< Shape type identifier
+    std::string polarity;       //!< Polarity of the signals
+    double rise_time = 0.0;     //!< Time from the start to the peak
+    double fall_time = 0.0;     //!< Time from the peak to the stop
+  };
+
+  /// Return the auxiliary key of the prototype identifier of a compact signal
+  static const std::string& prototype_key();
+
+  /// Check if a signal is compact
+  static bool is_compact(const mctools::signal::base_signal& signal_);
+
+  /// Constructor
+  shape_prototype_dictionary();
+
+  /// Return the number of prototypes
+  std::size_t get_number_of_prototypes() const;
+
+  /// Return a prototype
+  const prototype_type& get_prototype(int id_) const;
+
+  /// Return the identifier of the prototype of a triangle, adding it if needed
+  ///
+  /// Throw if another prototype has the same identifier.
+  int add_prototype(const std::string& shape_type_id_, const std::string& polarity_,
+                    double rise_time_, double fall_time_);
+
+  /// Make a triangle signal compact (other signals are left unchanged)
+  bool compact(mctools::signal::base_signal& signal_);
+
+  /// Make all the triangle signals of a bank compact and store the prototypes
+  /// they refer to in the bank
+  std::size_t compact(mctools::signal::signal_data& signal_data_);
+
+  /// Restore the full shape parameters of a compact signal
+  void expand(mctools::signal::base_signal& signal_) const;
+
+  /// Restore the full shape parameters of all the compact signals of a bank and
+  /// remove the prototypes from the bank
+  static std::size_t expand(mctools::signal::signal_data& signal_data_);
+
+  /// Store all the prototypes in the auxiliaries of a bank
+  void export_to(datatools::properties& bank_aux_) const;
+
+  /// Store some prototypes, by identifier, in the auxiliaries of a bank
+  void export_to(datatools::properties& bank_aux_, const std::vector<int>& ids_) const;
+
+  /// Load the prototypes from the auxiliaries of a bank, keeping their identifiers
+  void import_from(const datatools::properties& bank_aux_);
+
+  /// Remove all the prototypes
+  void clear();
+
+ private:
+  typedef std::tuple<std::string, std::string, long long, long long> index_key_type;
+
+  /// Return the identifier of a prototype from its rounded parameters
+  static int _make_id_(const index_key_type& key_);
+
+  // Shape parameter keys, resolved once:
+  std::string _polarity_key_;
+  std::string _t0_key_;
+  std::string _t1_key_;
+  std::string _t2_key_;
+  std::string _amplitude_key_;
+
+  std::map<int, prototype_type> _prototypes_;  //!< Prototypes by identifier
+  std::map<index_key_type, int> _index_;       //!< Identifiers by rounded parameters
+  std::vector<std::string> _keys_;             //!< Working list of auxiliary keys
+  std::vector<int> _bank_ids_;                 //!< Working list of prototypes of a bank
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SHAPE_PROTOTYPE_DICTIONARY_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,125 @@
+// shard_merger.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/shard_merger.h>
+
+// Standard library:
+#include <memory>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/things.h>
+// - Bayeux/dpp:
+#include <bayeux/dpp/input_module.h>
+#include <bayeux/dpp/output_module.h>
+
+namespace snemo {
+
+namespace asb {
+
+shard_merger::shard_merger() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  return;
+}
+
+void shard_merger::set_logging_priority(datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+void shard_merger::add_shard_filename(const std::string& filename_) {
+  DT_THROW_IF(filename_.empty(), std::logic_error, "Missing shard filename!");
+  _shard_filenames_.push_back(filename_);
+  return;
+}
+
+void shard_merger::set_output_filename(const std::string& filename_) {
+  _output_filename_ = filename_;
+  return;
+}
+
+std::size_t shard_merger::merge() {
+  DT_THROW_IF(_shard_filenames_.empty(), std::logic_error, "No shard to merge!");
+  DT_THROW_IF(_output_filename_.empty(), std::logic_error, "Missing output filename!");
+  const std::string priority_label = datatools::logger::get_priority_label(_logging_priority_);
+
+  std::vector<std::unique_ptr<dpp::input_module>> readers;
+  for (const auto& shard_filename : _shard_filenames_) {
+    readers.emplace_back(new dpp::input_module);
+    datatools::properties reader_config;
+    reader_config.store("logging.priority", priority_label);
+    reader_config.store("files.mode", "single");
+    reader_config.store("files.single.filename", shard_filename);
+    readers.back()->initialize_standalone(reader_config);
+  }
+
+  dpp::output_module writer;
+  datatools::properties writer_config;
+  writer_config.store("logging.priority", priority_label);
+  writer_config.store("files.mode", "single");
+  writer_config.store("files.single.filename", _output_filename_);
+  writer.initialize_standalone(writer_config);
+
+  // Round robin over the shards; once a shard is exhausted, all the
+  // following ones must be exhausted in the same round:
+  std::size_t merged_records = 0;
+  std::size_t exhausted_shard = _shard_filenames_.size();
+  datatools::things record;
+  for (std::size_t ishard = 0; exhausted_shard == _shard_filenames_.size();
+       ishard = (ishard + 1) % readers.size()) {
+    dpp::input_module& reader = *readers[ishard];
+    if (reader.is_terminated()) {
+      exhausted_shard = ishard;
+      break;
+    }
+    record.clear();
+    if (reader.process(record) != dpp::base_module::PROCESS_OK) {
+      exhausted_shard = ishard;
+      break;
+    }
+    writer.process(record);
+    merged_records++;
+  }
+  for (std::size_t ishard = exhausted_shard + 1; ishard < readers.size(); ishard++) {
+    DT_THROW_IF(!readers[ishard]->is_terminated(), std::logic_error,
+                "Shard '" << _shard_filenames_[ishard]
+                          << "' has too many records; the shards are not consistent!");
+  }
+  for (std::size_t ishard = 0; ishard < exhausted_shard; ishard++) {
+    DT_THROW_IF(!readers[ishard]->is_terminated(), std::logic_error,
+                "Shard '" << _shard_filenames_[ishard]
+                          << "' has too many records; the shards are not consistent!");
+  }
+
+  writer.reset();
+  for (auto& reader : readers) {
+    reader->reset();
+  }
+  DT_LOG_NOTICE(_logging_priority_, "Merged " << merged_records << " records from "
+                                              << readers.size() << " shards.");
+  return merged_records;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,61 @@
+// snemo/asb/shard_merger.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-22
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SHARD_MERGER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SHARD_MERGER_H
+
+// Standard library:
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Merge of the outputs of a sharded ASB run
+///
+/// With K shards, the record r of the original input has been processed by
+/// the shard r modulo K. The shard outputs, given in shard index order, are
+/// read in turn so that the merged output restores the original order.
+class shard_merger {
+ public:
+  /// Constructor
+  shard_merger();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Add the output file of the next shard
+  void add_shard_filename(const std::string& filename_);
+
+  /// Set the merged output filename
+  void set_output_filename(const std::string& filename_);
+
+  /// Merge the shards
+  ///
+  /// Return the number of merged records.
+  std::size_t merge();
+
+ private:
+  datatools::logger::priority _logging_priority_;
+  std::vector<std::string> _shard_filenames_;  //!< Output files of the shards in index order
+  std::string _output_filename_;               //!< Merged output filename
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SHARD_MERGER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
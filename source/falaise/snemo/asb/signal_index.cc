@@ -0,0 +1,257 @@
+// signal_index.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/signal_index.h>
+
+// Standard library:
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+// This project:
+#include <snemo/asb/fixed_point_codec.h>
+#include <snemo/asb/signal_stream_buffer.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+std::string index_prefix(const std::string& category_) { return "asb.index." + category_ + "."; }
+
+}  // end of anonymous namespace
+
+void signal_index::build(mctools::signal::signal_data& signal_data_) {
+  DT_THROW_IF(fixed_point_codec::is_encoded(signal_data_), std::logic_error,
+              "Cannot index a fixed-point encoded bank; decode it first!");
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  std::vector<std::pair<double, std::size_t>> entries;
+  std::vector<int> channel_offsets;
+  std::vector<int> time_order;
+  std::vector<double> start_times;
+  mctools::signal::signal_data::signal_handle_collection_type sorted;
+  for (const auto& category : categories) {
+    mctools::signal::signal_data::signal_handle_collection_type& signals =
+        signal_data_.grab_signals(category);
+    // Sort by channel and start time, keeping the order of equal signals:
+    entries.clear();
+    entries.reserve(signals.size());
+    for (std::size_t isignal = 0; isignal < signals.size(); isignal++) {
+      entries.emplace_back(compute_start_time(signals[isignal].get()), isignal);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&signals](const std::pair<double, std::size_t>& a_,
+                                const std::pair<double, std::size_t>& b_) {
+                       const geomtools::geom_id& gid_a = signals[a_.second].get().get_geom_id();
+                       const geomtools::geom_id& gid_b = signals[b_.second].get().get_geom_id();
+                       if (gid_a != gid_b) return gid_a < gid_b;
+                       return a_.first < b_.first;
+                     });
+    sorted.clear();
+    sorted.reserve(signals.size());
+    channel_offsets.clear();
+    start_times.clear();
+    start_times.reserve(signals.size());
+    for (std::size_t ientry = 0; ientry < entries.size(); ientry++) {
+      const mctools::signal::signal_data::signal_handle_type& handle =
+          signals[entries[ientry].second];
+      if (ientry == 0 || handle.get().get_geom_id() != sorted.back().get().get_geom_id()) {
+        channel_offsets.push_back(ientry);
+      }
+      sorted.push_back(handle);
+      start_times.push_back(entries[ientry].first);
+    }
+    channel_offsets.push_back(entries.size());
+    signals.swap(sorted);
+
+    // Positions in start time order:
+    time_order.resize(entries.size());
+    std::iota(time_order.begin(), time_order.end(), 0);
+    std::stable_sort(time_order.begin(), time_order.end(), [&entries](int a_, int b_) {
+      return entries[a_].first < entries[b_].first;
+    });
+
+    datatools::properties& bank_aux = signal_data_.grab_auxiliaries();
+    const std::string prefix = index_prefix(category);
+    bank_aux.erase_all_starting_with(prefix);
+    bank_aux.store(prefix + "channel_offsets", channel_offsets);
+    bank_aux.store(prefix + "time_order", time_order);
+    bank_aux.store(prefix + "start_times", start_times);
+  }
+  return;
+}
+
+bool signal_index::is_indexed(const mctools::signal::signal_data& signal_data_,
+                              const std::string& category_) {
+  return signal_data_.get_auxiliaries().has_key(index_prefix(category_) + "time_order");
+}
+
+double signal_index::compute_start_time(const mctools::signal::base_signal& signal_) {
+  return signal_stream_buffer::compute_start_time(
+      signal_, signal_.has_time_ref() ? signal_.get_time_ref() : 0.0);
+}
+
+signal_index::signal_index() { return; }
+
+void signal_index::attach(const mctools::signal::signal_data& signal_data_) {
+  detach();
+  DT_THROW_IF(fixed_point_codec::is_encoded(signal_data_), std::logic_error,
+              "Cannot attach to a fixed-point encoded bank; decode it first!");
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  const datatools::properties& bank_aux = signal_data_.get_auxiliaries();
+  for (const auto& category : categories) {
+    DT_THROW_IF(!is_indexed(signal_data_, category), std::logic_error,
+                "Category '" << category << "' of the bank is not indexed!");
+    const std::string prefix = index_prefix(category);
+    category_index& index = _categories_[category];
+    index.signals = &signal_data_.get_signals(category);
+    bank_aux.fetch(prefix + "channel_offsets", index.channel_offsets);
+    bank_aux.fetch(prefix + "time_order", index.time_order);
+    if (bank_aux.has_key(prefix + "start_times")) {
+      bank_aux.fetch(prefix + "start_times", index.start_times);
+    }
+    DT_THROW_IF(index.time_order.size() != index.signals->size() ||
+                    index.start_times.size() != index.signals->size() ||
+                    index.channel_offsets.empty() ||
+                    index.channel_offsets.back() != (int)index.signals->size(),
+                std::logic_error, "Index of category '" << category << "' is out of date!");
+    DT_THROW_IF(!_is_consistent_(index), std::logic_error,
+                "Index of category '" << category << "' is corrupted!");
+  }
+  _signal_data_ = &signal_data_;
+  return;
+}
+
+bool signal_index::_is_consistent_(const category_index& index_) {
+  // Channel offsets increase, and start times increase within each channel:
+  const std::vector<int>& offsets = index_.channel_offsets;
+  if (offsets.front() != 0) return false;
+  for (std::size_t ichannel = 0; ichannel + 1 < offsets.size(); ichannel++) {
+    if (offsets[ichannel] >= offsets[ichannel + 1]) return false;
+    for (int position = offsets[ichannel] + 1; position < offsets[ichannel + 1]; position++) {
+      if (index_.start_times[position] < index_.start_times[position - 1]) return false;
+    }
+  }
+  // The time order is a permutation of the positions, by increasing start time:
+  std::vector<bool> seen(index_.time_order.size(), false);
+  for (std::size_t rank = 0; rank < index_.time_order.size(); rank++) {
+    const int position = index_.time_order[rank];
+    if (position < 0 || position >= (int)seen.size() || seen[position]) return false;
+    seen[position] = true;
+    if (rank > 0 &&
+        index_.start_times[position] < index_.start_times[index_.time_order[rank - 1]]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool signal_index::is_attached() const { return _signal_data_ != nullptr; }
+
+void signal_index::detach() {
+  _categories_.clear();
+  _signal_data_ = nullptr;
+  return;
+}
+
+signal_index::range_type signal_index::find_channel(const std::string& category_,
+                                                    const geomtools::geom_id& gid_) const {
+  const category_index& index = _get_category_(category_);
+  range_type range;
+  // Binary search on the first signal of each channel:
+  const auto found = std::lower_bound(
+      index.channel_offsets.begin(), index.channel_offsets.end() - 1, gid_,
+      [&index](int offset_, const geomtools::geom_id& value_) {
+        return (*index.signals)[offset_].get().get_geom_id() < value_;
+      });
+  if (found == index.channel_offsets.end() - 1 ||
+      (*index.signals)[*found].get().get_geom_id() != gid_) {
+    return range;
+  }
+  range.first = *found;
+  range.last = *(found + 1);
+  return range;
+}
+
+signal_index::range_type signal_index::find_channel_window(const std::string& category_,
+                                                           const geomtools::geom_id& gid_,
+                                                           double tmin_, double tmax_) const {
+  const category_index& index = _get_category_(category_);
+  range_type range = find_channel(category_, gid_);
+  const auto begin = index.start_times.begin();
+  range.first = std::lower_bound(begin + range.first, begin + range.last, tmin_) - begin;
+  range.last = std::max(range.first,
+                        (std::size_t)(std::lower_bound(begin + range.first, begin + range.last,
+                                                       tmax_) -
+                                      begin));
+  return range;
+}
+
+signal_index::range_type signal_index::find_window(const std::string& category_, double tmin_,
+                                                   double tmax_) const {
+  const category_index& index = _get_category_(category_);
+  auto before = [&index](int position_, double time_) {
+    return index.start_times[position_] < time_;
+  };
+  range_type range;
+  const auto begin = index.time_order.begin();
+  range.first = std::lower_bound(begin, index.time_order.end(), tmin_, before) - begin;
+  range.last = std::max(
+      range.first,
+      (std::size_t)(std::lower_bound(begin + range.first, index.time_order.end(), tmax_, before) -
+                    begin));
+  return range;
+}
+
+std::size_t signal_index::get_position(const std::string& category_, std::size_t rank_) const {
+  const category_index& index = _get_category_(category_);
+  DT_THROW_IF(rank_ >= index.time_order.size(), std::range_error,
+              "Invalid rank " << rank_ << " in category '" << category_ << "'!");
+  return index.time_order[rank_];
+}
+
+double signal_index::get_start_time(const std::string& category_, std::size_t position_) const {
+  const category_index& index = _get_category_(category_);
+  DT_THROW_IF(position_ >= index.start_times.size(), std::range_error,
+              "Invalid position " << position_ << " in category '" << category_ << "'!");
+  return index.start_times[position_];
+}
+
+const signal_index::category_index& signal_index::_get_category_(
+    const std::string& category_) const {
+  DT_THROW_IF(!is_attached(), std::logic_error, "Signal index is not attached!");
+  const auto found = _categories_.find(category_);
+  DT_THROW_IF(found == _categories_.end(), std::logic_error,
+              "No signal category '" << category_ << "' in the index!");
+  return found->second;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
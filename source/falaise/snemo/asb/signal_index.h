@@ -0,0 +1,120 @@
+// snemo/asb/signal_index.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-11
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_INDEX_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_INDEX_H
+
+// Standard library:
+#include <map>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Channel and time index of the signals of a bank
+///
+/// The signals of each category are sorted by channel (geometry ID) and
+/// start time. The index stored in the auxiliaries of the bank holds the
+/// position of the first signal of each channel, the positions of the
+/// signals in start time order and their start times:
+/// \code
+/// asb.index.calo.channel_offsets : integer[C+1] = ...
+/// asb.index.calo.time_order : integer[N] = ...
+/// asb.index.calo.start_times : real[N] = ...
+/// \endcode
+///
+/// Once attached to a bank, the index answers channel lookups and time
+/// window queries by binary search, without allocation. Start times are
+/// absolute (time reference plus t0); they are computed once at build time
+/// and only checked for consistency at attach time. They need signals with
+/// real shape parameters: fixed-point encoded banks are rejected, and must
+/// be decoded before being indexed or attached.
+class signal_index {
+ public:
+  /// \brief Range of positions [first, last)
+  struct range_type {
+    std::size_t first = 0;  //!< First position
+    std::size_t last = 0;   //!< Position past the last one
+
+    /// Return the number of positions
+    std::size_t size() const { return last - first; }
+
+    /// Check if the range is empty
+    bool empty() const { return first == last; }
+  };
+
+  /// Sort the signals of all categories of a bank and store their index in the bank
+  static void build(mctools::signal::signal_data& signal_data_);
+
+  /// Check if a category of a bank is indexed
+  static bool is_indexed(const mctools::signal::signal_data& signal_data_,
+                         const std::string& category_);
+
+  /// Compute the absolute start time of a signal
+  static double compute_start_time(const mctools::signal::base_signal& signal_);
+
+  /// Constructor
+  signal_index();
+
+  /// Attach to an indexed bank
+  void attach(const mctools::signal::signal_data& signal_data_);
+
+  /// Check if the index is attached to a bank
+  bool is_attached() const;
+
+  /// Detach from the bank
+  void detach();
+
+  /// Return the positions of the signals of a channel, sorted by start time
+  range_type find_channel(const std::string& category_, const geomtools::geom_id& gid_) const;
+
+  /// Return the positions of the signals of a channel starting in [tmin, tmax)
+  range_type find_channel_window(const std::string& category_, const geomtools::geom_id& gid_,
+                                 double tmin_, double tmax_) const;
+
+  /// Return the ranks, in start time order, of the signals of a category starting in [tmin, tmax)
+  range_type find_window(const std::string& category_, double tmin_, double tmax_) const;
+
+  /// Return the position of the signal of a category with a given rank in start time order
+  std::size_t get_position(const std::string& category_, std::size_t rank_) const;
+
+  /// Return the start time of the signal of a category at a given position
+  double get_start_time(const std::string& category_, std::size_t position_) const;
+
+ private:
+  struct category_index {
+    const mctools::signal::signal_data::signal_handle_collection_type* signals = nullptr;
+    std::vector<int> channel_offsets;  //!< Position of the first signal of each channel
+    std::vector<int> time_order;       //!< Positions in start time order
+    std::vector<double> start_times;   //!< Start times by position
+  };
+
+  const category_index& _get_category_(const std::string& category_) const;
+  static bool _is_consistent_(const category_index& index_);
+
+ private:
+  const mctools::signal::signal_data* _signal_data_ = nullptr;  //!< Attached bank
+  std::map<std::string, category_index> _categories_;           //!< Index per category
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_INDEX_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,163 @@
+// signal_staging_bank.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/signal_staging_bank.h>
+
+// Standard library:
+#include <algorithm>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+// This project:
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+mctools::signal::base_signal& signal_staging_bank::producer_buffer::add_signal(
+    const std::string& category_) {
+  staged_signal staged;
+  staged.category = category_;
+  staged.handle.reset(new mctools::signal::base_signal);
+  _signals_.push_back(staged);
+  mctools::signal::base_signal& signal = _signals_.back().handle.grab();
+  signal.set_category(category_);
+  return signal;
+}
+
+std::size_t signal_staging_bank::producer_buffer::absorb(mctools::signal::signal_data& source_) {
+  std::vector<std::string> categories;
+  source_.build_list_of_categories(categories);
+  std::size_t number_of_signals = 0;
+  for (const auto& category : categories) {
+    number_of_signals += source_.get_number_of_signals(category);
+  }
+  _signals_.reserve(_signals_.size() + number_of_signals);
+  for (const auto& category : categories) {
+    mctools::signal::signal_data::signal_handle_collection_type& handles =
+        source_.grab_signals(category);
+    for (auto& handle : handles) {
+      staged_signal staged;
+      staged.category = category;
+      staged.handle = handle;
+      _signals_.push_back(staged);
+    }
+    handles.clear();
+  }
+  return number_of_signals;
+}
+
+std::size_t signal_staging_bank::producer_buffer::size() const { return _signals_.size(); }
+
+void signal_staging_bank::producer_buffer::clear() {
+  _signals_.clear();
+  return;
+}
+
+signal_staging_bank::signal_staging_bank(std::size_t number_of_producers_) {
+  set_number_of_producers(number_of_producers_);
+  return;
+}
+
+void signal_staging_bank::set_number_of_producers(std::size_t number_of_producers_) {
+  _producers_.clear();
+  for (std::size_t iproducer = 0; iproducer < number_of_producers_; iproducer++) {
+    // Separate allocations keep the producers away from each other's cache lines:
+    _producers_.emplace_back(new producer_buffer);
+  }
+  return;
+}
+
+std::size_t signal_staging_bank::get_number_of_producers() const { return _producers_.size(); }
+
+signal_staging_bank::producer_buffer& signal_staging_bank::grab_producer(std::size_t producer_) {
+  DT_THROW_IF(producer_ >= _producers_.size(), std::range_error,
+              "Invalid producer index " << producer_ << "!");
+  return *_producers_[producer_];
+}
+
+std::size_t signal_staging_bank::get_number_of_staged_signals() const {
+  std::size_t number_of_signals = 0;
+  for (const auto& producer : _producers_) {
+    number_of_signals += producer->size();
+  }
+  return number_of_signals;
+}
+
+std::size_t signal_staging_bank::merge(mctools::signal::signal_data& target_) {
+  // Build the sort keys of all staged signals, in producer and insertion order:
+  _merge_items_.clear();
+  _merge_items_.reserve(get_number_of_staged_signals());
+  for (std::size_t iproducer = 0; iproducer < _producers_.size(); iproducer++) {
+    const std::vector<producer_buffer::staged_signal>& staged = _producers_[iproducer]->_signals_;
+    for (std::size_t isig = 0; isig < staged.size(); isig++) {
+      merge_item item;
+      item.category = &staged[isig].category;
+      item.producer = iproducer;
+      item.index = isig;
+      _merge_items_.push_back(item);
+    }
+  }
+  // Gather the categories, keeping that order within each of them:
+  std::stable_sort(_merge_items_.begin(), _merge_items_.end(),
+                   [](const merge_item& a_, const merge_item& b_) {
+                     return *a_.category < *b_.category;
+                   });
+
+  // Move the signals, one category at a time:
+  std::size_t first = 0;
+  while (first < _merge_items_.size()) {
+    const std::string& category = *_merge_items_[first].category;
+    std::size_t last = first;
+    while (last < _merge_items_.size() && *_merge_items_[last].category == category) {
+      last++;
+    }
+    // Capacity is reserved once per category:
+    mctools::signal::signal_data::signal_handle_collection_type& handles =
+        signal_utils::grab_signal_collection(target_, category);
+    handles.reserve(handles.size() + (last - first));
+    for (std::size_t iitem = first; iitem < last; iitem++) {
+      const merge_item& item = _merge_items_[iitem];
+      handles.push_back(_producers_[item.producer]->_signals_[item.index].handle);
+    }
+    first = last;
+  }
+
+  const std::size_t number_of_signals = _merge_items_.size();
+  _merge_items_.clear();
+  clear();
+  return number_of_signals;
+}
+
+void signal_staging_bank::clear() {
+  for (auto& producer : _producers_) {
+    producer->clear();
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,115 @@
+// snemo/asb/signal_staging_bank.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-29
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STAGING_BANK_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STAGING_BANK_H
+
+// Standard library:
+#include <memory>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Per-producer staging of signals before their merge in a signal data bank
+///
+/// Adding signals to a mctools::signal::signal_data is not thread-safe. In
+/// parallel processing paths, each producer thus appends its signals to its
+/// own buffer, without any locking, and a single merge step moves all the
+/// staged signals into the output bank.
+///
+/// The merge does not depend on the scheduling of the producers: within a
+/// category, the signals are appended in producer order, each producer
+/// keeping the order in which it staged them. With the producers indexed in
+/// the order they would run sequentially, the merged bank is the one they
+/// would fill directly. Signal objects are moved by handle, never copied.
+class signal_staging_bank : private boost::noncopyable {
+ public:
+  typedef mctools::signal::signal_data::signal_handle_type signal_handle_type;
+
+  /// \brief Staging buffer owned by a single producer
+  class producer_buffer : private boost::noncopyable {
+   public:
+    /// Append a new signal of a given category
+    mctools::signal::base_signal& add_signal(const std::string& category_);
+
+    /// Move all the signals of a signal data bank into the buffer
+    ///
+    /// Room for all the signals is reserved at once. Return the number of staged signals.
+    std::size_t absorb(mctools::signal::signal_data& source_);
+
+    /// Return the number of staged signals
+    std::size_t size() const;
+
+    /// Remove all staged signals, keeping the allocated capacity
+    void clear();
+
+   private:
+    friend class signal_staging_bank;
+
+    struct staged_signal {
+      std::string category;       //!< Signal category
+      signal_handle_type handle;  //!< The staged signal
+    };
+
+    std::vector<staged_signal> _signals_;  //!< Staged signals in insertion order
+  };
+
+  /// Constructor
+  explicit signal_staging_bank(std::size_t number_of_producers_ = 0);
+
+  /// Set the number of producers
+  void set_number_of_producers(std::size_t number_of_producers_);
+
+  /// Return the number of producers
+  std::size_t get_number_of_producers() const;
+
+  /// Return the buffer of a producer
+  producer_buffer& grab_producer(std::size_t producer_);
+
+  /// Return the total number of staged signals
+  std::size_t get_number_of_staged_signals() const;
+
+  /// Move all staged signals into a signal data bank and clear the buffers
+  ///
+  /// Must not be called while producers are still appending signals.
+  /// Return the number of merged signals.
+  std::size_t merge(mctools::signal::signal_data& target_);
+
+  /// Clear all buffers, keeping their allocated capacity
+  void clear();
+
+ private:
+  /// Sort key of a staged signal during the merge
+  struct merge_item {
+    const std::string* category = nullptr;  //!< Signal category
+    std::size_t producer = 0;               //!< Index of the producer
+    std::size_t index = 0;                  //!< Insertion index in the producer buffer
+  };
+
+  std::vector<std::unique_ptr<producer_buffer>> _producers_;  //!< Per-producer buffers
+  std::vector<merge_item> _merge_items_;  //!< Working sort keys of the merge
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STAGING_BANK_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
@@ -0,0 +1,230 @@
+// signal_stream_buffer.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/signal_stream_buffer.h>
+
+// Standard library:
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+signal_stream_buffer::signal_stream_buffer() {
+  _window_ = 1.0 * CLHEP::microsecond;
+  _stream_time_ = 0.0;
+  return;
+}
+
+signal_stream_buffer::~signal_stream_buffer() { return; }
+
+void signal_stream_buffer::set_window(double window_) {
+  DT_THROW_IF(!datatools::is_valid(window_) || window_ <= 0.0, std::domain_error,
+              "Invalid stream window length!");
+  DT_THROW_IF(_number_of_pulses_ > 0, std::logic_error,
+              "Cannot change the stream window while signals are buffered!");
+  _window_ = window_;
+  return;
+}
+
+double signal_stream_buffer::get_window() const { return _window_; }
+
+double signal_stream_buffer::get_stream_time() const { return _stream_time_; }
+
+std::size_t signal_stream_buffer::get_number_of_pulses() const { return _number_of_pulses_; }
+
+std::size_t signal_stream_buffer::get_max_number_of_pulses() const {
+  return _max_number_of_pulses_;
+}
+
+long signal_stream_buffer::get_number_of_emitted_frames() const { return _emitted_frames_; }
+
+long signal_stream_buffer::_frame_of_(double time_) const {
+  return static_cast<long>(std::floor(time_ / _window_));
+}
+
+double signal_stream_buffer::compute_start_time(const mctools::signal::base_signal& signal_,
+                                                double absolute_time_ref_) {
+  double start_time = absolute_time_ref_;
+  const std::string t0_key = mctools::signal::base_signal::shape_parameter_prefix() + "t0";
+  const datatools::properties& aux = signal_.get_auxiliaries();
+  if (aux.has_key(t0_key)) {
+    DT_THROW_IF(!aux.is_real(t0_key), std::logic_error,
+                "Start time of signal #" << signal_.get_hit_id()
+                                         << " is not real; the signal is fixed-point encoded!");
+    start_time += aux.fetch_real(t0_key);
+  }
+  return start_time;
+}
+
+void signal_stream_buffer::push(const mctools::signal::base_signal& signal_,
+                                double absolute_time_ref_) {
+  pulse_entry entry;
+  entry.signal = signal_;
+  entry.signal.set_time_ref(absolute_time_ref_);
+  entry.start_time = compute_start_time(signal_, absolute_time_ref_);
+  entry.frame = _frame_of_(entry.start_time);
+  if (entry.frame < _next_frame_) {
+    // Late signal with respect to the stream: attach it to the first open frame.
+    entry.frame = _next_frame_;
+  }
+  channel_type channel(signal_.get_category(), signal_.get_geom_id());
+  _channels_[channel].push_back(entry);
+  _number_of_pulses_++;
+  _max_number_of_pulses_ = std::max(_max_number_of_pulses_, _number_of_pulses_);
+  return;
+}
+
+std::size_t signal_stream_buffer::advance(double stream_time_,
+                                          mctools::signal::signal_data& output_) {
+  DT_THROW_IF(!datatools::is_valid(stream_time_), std::domain_error, "Invalid stream time!");
+  if (stream_time_ > _stream_time_) {
+    _stream_time_ = stream_time_;
+  }
+  return _emit_(_frame_of_(_stream_time_), output_);
+}
+
+std::size_t signal_stream_buffer::flush(mctools::signal::signal_data& output_) {
+  long first_open_frame = _next_frame_;
+  for (const auto& channel : _channels_) {
+    for (const auto& entry : channel.second) {
+      first_open_frame = std::max(first_open_frame, entry.frame + 1);
+    }
+  }
+  const std::size_t number_of_signals = _emit_(first_open_frame, output_);
+  // The stream restarts after the flushed frames:
+  _stream_time_ = std::max(_stream_time_, first_open_frame * _window_);
+  return number_of_signals;
+}
+
+std::size_t signal_stream_buffer::_emit_(long first_open_frame_,
+                                         mctools::signal::signal_data& output_) {
+  if (first_open_frame_ <= _next_frame_) {
+    return 0;
+  }
+
+  // Collect the signals of closed frames, channel by channel:
+  struct closed_entry {
+    long frame;
+    std::size_t channel_rank;
+    double start_time;
+    const pulse_entry* entry;
+  };
+  std::vector<closed_entry> closed;
+  std::size_t channel_rank = 0;
+  for (auto& channel : _channels_) {
+    for (const auto& entry : channel.second) {
+      if (entry.frame < first_open_frame_) {
+        closed.push_back({entry.frame, channel_rank, entry.start_time, &entry});
+      }
+    }
+    channel_rank++;
+  }
+
+  // Deterministic emission order: frame, channel, start time.
+  std::stable_sort(closed.begin(), closed.end(),
+                   [](const closed_entry& a_, const closed_entry& b_) {
+                     if (a_.frame != b_.frame) return a_.frame < b_.frame;
+                     if (a_.channel_rank != b_.channel_rank)
+                       return a_.channel_rank < b_.channel_rank;
+                     return a_.start_time < b_.start_time;
+                   });
+
+  for (const auto& c : closed) {
+    mctools::signal::base_signal& signal = output_.add_signal(c.entry->signal.get_category());
+    signal = c.entry->signal;
+    // Frame indices exceed the integer range on long runs, reals hold them exactly:
+    signal.grab_auxiliaries().store_real("asb.stream.frame", static_cast<double>(c.frame));
+  }
+
+  datatools::properties& bank_aux = output_.grab_auxiliaries();
+  bank_aux.update_real("asb.stream.first_closed_frame", static_cast<double>(_next_frame_));
+  bank_aux.update_real("asb.stream.first_open_frame", static_cast<double>(first_open_frame_));
+  bank_aux.update_real("asb.stream.window", _window_);
+  bank_aux.set_unit_symbol("asb.stream.window", "ns");
+
+  // Drop the emitted signals from the channel rings:
+  for (auto ichannel = _channels_.begin(); ichannel != _channels_.end();) {
+    pulse_ring_type& ring = ichannel->second;
+    ring.erase(std::remove_if(ring.begin(), ring.end(),
+                              [first_open_frame_](const pulse_entry& e_) {
+                                return e_.frame < first_open_frame_;
+                              }),
+               ring.end());
+    if (ring.empty()) {
+      ichannel = _channels_.erase(ichannel);
+    } else {
+      ++ichannel;
+    }
+  }
+
+  _number_of_pulses_ -= closed.size();
+  _emitted_frames_ += first_open_frame_ - _next_frame_;
+  _next_frame_ = first_open_frame_;
+  return closed.size();
+}
+
+void signal_stream_buffer::reset() {
+  _channels_.clear();
+  _stream_time_ = 0.0;
+  _next_frame_ = 0;
+  _number_of_pulses_ = 0;
+  _max_number_of_pulses_ = 0;
+  _emitted_frames_ = 0;
+  return;
+}
+
+void signal_stream_buffer::tree_dump(std::ostream& out_, const std::string& title_,
+                                     const std::string& indent_, bool inherit_) const {
+  if (!title_.empty()) {
+    out_ << indent_ << title_ << std::endl;
+  }
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Window : " << _window_ / CLHEP::ns
+       << " ns" << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Stream time : "
+       << _stream_time_ / CLHEP::ns << " ns" << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Buffered channels : "
+       << _channels_.size() << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::tag << "Buffered signals : "
+       << _number_of_pulses_ << " (max=" << _max_number_of_pulses_ << ")" << std::endl;
+
+  out_ << indent_ << datatools::i_tree_dumpable::inherit_tag(inherit_)
+       << "Emitted frames : " << _emitted_frames_ << std::endl;
+
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,138 @@
+// snemo/asb/signal_stream_buffer.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-06
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STREAM_BUFFER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STREAM_BUFFER_H
+
+// Standard library:
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/i_tree_dump.h>
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Sliding per-channel buffer of signals placed on an absolute timeline
+///
+/// Signals pushed in the buffer are grouped in consecutive readout frames of
+/// fixed length. A frame is closed, and its signals emitted, as soon as the
+/// stream time goes beyond its upper bound. Only signals from open frames are
+/// kept in memory.
+///
+/// Each emitted signal records the index of its frame, and the bank records
+/// the range of frames closed by the last advance. Frame indices are stored
+/// as reals, which hold them exactly far beyond the integer range:
+/// \code
+/// asb.stream.frame : real = 12345
+/// asb.stream.first_closed_frame : real = 12340
+/// asb.stream.first_open_frame : real = 12346
+/// asb.stream.window : real as time = 1 us
+/// \endcode
+class signal_stream_buffer : public datatools::i_tree_dumpable {
+ public:
+  /// Channel identifier (signal category, geometry ID)
+  typedef std::pair<std::string, geomtools::geom_id> channel_type;
+
+  /// Buffered signal with its absolute start time and frame index
+  struct pulse_entry {
+    double start_time = 0.0;  //!< Absolute start time of the signal
+    long frame = 0;           //!< Index of the readout frame
+    mctools::signal::base_signal signal;  //!< The buffered signal
+  };
+
+  typedef std::deque<pulse_entry> pulse_ring_type;
+  typedef std::map<channel_type, pulse_ring_type> channel_dict_type;
+
+  /// Constructor
+  signal_stream_buffer();
+
+  /// Destructor
+  virtual ~signal_stream_buffer();
+
+  /// Set the readout frame length
+  void set_window(double window_);
+
+  /// Return the readout frame length
+  double get_window() const;
+
+  /// Return the current stream time
+  double get_stream_time() const;
+
+  /// Return the number of buffered signals
+  std::size_t get_number_of_pulses() const;
+
+  /// Return the highest number of buffered signals since the last reset
+  std::size_t get_max_number_of_pulses() const;
+
+  /// Return the number of emitted frames
+  long get_number_of_emitted_frames() const;
+
+  /// Push a signal with its absolute time reference
+  ///
+  /// The signal time reference is replaced by the absolute one, the shape
+  /// parameters remain relative to it.
+  void push(const mctools::signal::base_signal& signal_, double absolute_time_ref_);
+
+  /// Advance the stream time and emit the signals of all closed frames in a bank
+  ///
+  /// Return the number of emitted signals.
+  std::size_t advance(double stream_time_, mctools::signal::signal_data& output_);
+
+  /// Close all the open frames and emit their signals in a bank
+  ///
+  /// This ends the stream, typically after its last event. Return the
+  /// number of emitted signals.
+  std::size_t flush(mctools::signal::signal_data& output_);
+
+  /// Discard all buffered signals and restart the timeline
+  void reset();
+
+  /// Smart print
+  virtual void tree_dump(std::ostream& out_ = std::clog, const std::string& title_ = "",
+                         const std::string& indent_ = "", bool inherit_ = false) const;
+
+  /// Compute the absolute start time of a signal from its time reference
+  ///
+  /// Throw if the start time of the signal is fixed-point encoded.
+  static double compute_start_time(const mctools::signal::base_signal& signal_,
+                                   double absolute_time_ref_);
+
+ private:
+  long _frame_of_(double time_) const;
+
+  std::size_t _emit_(long first_open_frame_, mctools::signal::signal_data& output_);
+
+ private:
+  double _window_;                     //!< Length of a readout frame
+  double _stream_time_;                //!< Current stream time
+  long _next_frame_ = 0;               //!< Index of the first open frame
+  std::size_t _number_of_pulses_ = 0;  //!< Number of buffered signals
+  std::size_t _max_number_of_pulses_ = 0;  //!< High-water mark of buffered signals
+  long _emitted_frames_ = 0;           //!< Number of emitted frames
+  channel_dict_type _channels_;        //!< Per-channel ring buffers
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SIGNAL_STREAM_BUFFER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
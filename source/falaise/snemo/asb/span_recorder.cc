@@ -0,0 +1,219 @@
+// span_recorder.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/span_recorder.h>
+
+// Standard library:
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Source of unique recorder identifiers (addresses may be reused):
+std::atomic<uint64_t> g_next_instance_id(1);
+
+// Buffers of the current thread, per recorder identifier:
+thread_local std::vector<std::pair<uint64_t, void*>> t_buffers;
+
+// Identifiers of the living recorders, used to prune the buffers of the
+// destroyed ones from the threads that outlive them:
+std::mutex& live_instances_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::set<uint64_t>& live_instance_ids() {
+  static std::set<uint64_t> ids;
+  return ids;
+}
+
+// Write a JSON string
+void write_json_string(std::ostream& out_, const std::string& text_) {
+  out_ << '"';
+  for (const char c : text_) {
+    switch (c) {
+      case '"':
+        out_ << "\\\"";
+        break;
+      case '\\':
+        out_ << "\\\\";
+        break;
+      case '\n':
+        out_ << "\\n";
+        break;
+      case '\t':
+        out_ << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out_ << ' ';
+        } else {
+          out_ << c;
+        }
+    }
+  }
+  out_ << '"';
+  return;
+}
+
+}  // end of anonymous namespace
+
+span_recorder::scope::scope(span_recorder* recorder_, const std::string& name_,
+                            const char* category_)
+    : _recorder_(recorder_), _category_(category_) {
+  if (_recorder_ != nullptr) {
+    _name_ = name_;
+    _start_ = std::chrono::steady_clock::now();
+  }
+  return;
+}
+
+span_recorder::scope::~scope() {
+  stop();
+  return;
+}
+
+void span_recorder::scope::stop() {
+  if (_recorder_ != nullptr) {
+    _recorder_->record(_name_, _category_, _start_, std::chrono::steady_clock::now());
+    _recorder_ = nullptr;
+  }
+  return;
+}
+
+span_recorder::span_recorder()
+    : _instance_id_(g_next_instance_id++), _origin_(std::chrono::steady_clock::now()) {
+  std::lock_guard<std::mutex> lock(live_instances_mutex());
+  live_instance_ids().insert(_instance_id_);
+  return;
+}
+
+span_recorder::~span_recorder() {
+  std::lock_guard<std::mutex> lock(live_instances_mutex());
+  live_instance_ids().erase(_instance_id_);
+  return;
+}
+
+span_recorder::thread_buffer& span_recorder::_grab_thread_buffer_() {
+  for (const auto& entry : t_buffers) {
+    if (entry.first == _instance_id_) {
+      return *static_cast<thread_buffer*>(entry.second);
+    }
+  }
+  {
+    // First span of this thread: forget the buffers of the destroyed recorders.
+    std::lock_guard<std::mutex> lock(live_instances_mutex());
+    const std::set<uint64_t>& live_ids = live_instance_ids();
+    t_buffers.erase(std::remove_if(t_buffers.begin(), t_buffers.end(),
+                                   [&live_ids](const std::pair<uint64_t, void*>& entry_) {
+                                     return live_ids.count(entry_.first) == 0;
+                                   }),
+                    t_buffers.end());
+  }
+  // Register a new buffer:
+  std::lock_guard<std::mutex> lock(_registration_mutex_);
+  _buffers_.emplace_back(new thread_buffer);
+  thread_buffer& buffer = *_buffers_.back();
+  buffer.thread_index = _buffers_.size() - 1;
+  t_buffers.push_back(std::make_pair(_instance_id_, static_cast<void*>(&buffer)));
+  return buffer;
+}
+
+void span_recorder::record(const std::string& name_, const char* category_,
+                           std::chrono::steady_clock::time_point start_,
+                           std::chrono::steady_clock::time_point stop_) {
+  thread_buffer& buffer = _grab_thread_buffer_();
+  span_type span;
+  span.name = name_;
+  span.category = category_;
+  span.start = std::chrono::duration<double, std::micro>(start_ - _origin_).count();
+  span.duration = std::chrono::duration<double, std::micro>(stop_ - start_).count();
+  buffer.spans.push_back(std::move(span));
+  return;
+}
+
+std::size_t span_recorder::get_number_of_spans() const {
+  std::lock_guard<std::mutex> lock(_registration_mutex_);
+  std::size_t number_of_spans = 0;
+  for (const auto& buffer : _buffers_) {
+    number_of_spans += buffer->spans.size();
+  }
+  return number_of_spans;
+}
+
+void span_recorder::write_json(std::ostream& out_) const {
+  std::lock_guard<std::mutex> lock(_registration_mutex_);
+  out_ << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& buffer : _buffers_) {
+    // Thread name metadata:
+    out_ << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << buffer->thread_index << ",\"args\":{\"name\":\"thread #" << buffer->thread_index
+         << "\"}}";
+    first = false;
+    for (const auto& span : buffer->spans) {
+      out_ << ",\n{\"name\":";
+      write_json_string(out_, span.name);
+      out_ << ",\"cat\":";
+      write_json_string(out_, span.category != nullptr ? span.category : "");
+      out_ << ",\"ph\":\"X\",\"ts\":" << span.start << ",\"dur\":" << span.duration
+           << ",\"pid\":1,\"tid\":" << buffer->thread_index << "}";
+    }
+  }
+  out_ << "\n]}" << std::endl;
+  return;
+}
+
+void span_recorder::write_json_file(const std::string& filename_) const {
+  std::string filename = filename_;
+  datatools::fetch_path_with_env(filename);
+  std::ofstream out(filename.c_str());
+  DT_THROW_IF(!out, std::runtime_error, "Cannot open trace file '" << filename << "'!");
+  out.precision(15);
+  write_json(out);
+  DT_THROW_IF(!out, std::runtime_error, "Cannot write trace file '" << filename << "'!");
+  return;
+}
+
+void span_recorder::clear() {
+  std::lock_guard<std::mutex> lock(_registration_mutex_);
+  for (auto& buffer : _buffers_) {
+    buffer->spans.clear();
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,121 @@
+// snemo/asb/span_recorder.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-04
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_SPAN_RECORDER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_SPAN_RECORDER_H
+
+// Standard library:
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Recorder of timed spans exported as a Chrome trace-event timeline
+///
+/// Each thread appends its spans to its own buffer, without locking; the
+/// buffers are only registered once per thread. Threads refer to the buffers
+/// by recorder identifier rather than address, and drop those of destroyed
+/// recorders when registering a new one. The timeline is written as
+/// a Chrome trace-event JSON file, which can be opened locally with
+/// chrome://tracing or Perfetto.
+///
+/// Usage:
+/// \code
+/// {
+///   span_recorder::scope span(recorder_ptr, "event", "module");
+///   ...
+/// } // the span ends here
+/// \endcode
+///
+/// A null recorder makes the scope a no-op, so that tracing stays opt-in.
+class span_recorder : private boost::noncopyable {
+ public:
+  /// \brief Recorded span
+  struct span_type {
+    std::string name;      //!< Name of the span
+    const char* category;  //!< Category of the span (static string)
+    double start;          //!< Start time since the start of the recorder (in microseconds)
+    double duration;       //!< Duration (in microseconds)
+  };
+
+  /// \brief Span bound to a C++ scope
+  class scope : private boost::noncopyable {
+   public:
+    /// Constructor: start a span (no-op with a null recorder)
+    scope(span_recorder* recorder_, const std::string& name_, const char* category_);
+
+    /// Destructor: end the span if still running
+    ~scope();
+
+    /// End the span before the end of the scope
+    void stop();
+
+   private:
+    span_recorder* _recorder_;  //!< Recorder, if any
+    std::string _name_;         //!< Name of the span
+    const char* _category_;     //!< Category of the span
+    std::chrono::steady_clock::time_point _start_;  //!< Start time
+  };
+
+  /// Constructor
+  span_recorder();
+
+  /// Destructor
+  ~span_recorder();
+
+  /// Record a span of the calling thread
+  void record(const std::string& name_, const char* category_,
+              std::chrono::steady_clock::time_point start_,
+              std::chrono::steady_clock::time_point stop_);
+
+  /// Return the total number of recorded spans
+  std::size_t get_number_of_spans() const;
+
+  /// Write the timeline in Chrome trace-event JSON format
+  void write_json(std::ostream& out_) const;
+
+  /// Write the timeline in a Chrome trace-event JSON file
+  void write_json_file(const std::string& filename_) const;
+
+  /// Discard all the recorded spans
+  void clear();
+
+ private:
+  struct thread_buffer {
+    std::size_t thread_index = 0;  //!< Index of the thread in the timeline
+    std::vector<span_type> spans;  //!< Spans recorded by the thread
+  };
+
+  thread_buffer& _grab_thread_buffer_();
+
+ private:
+  const uint64_t _instance_id_;                   //!< Unique identifier of the recorder
+  std::chrono::steady_clock::time_point _origin_;  //!< Origin of the timeline
+  mutable std::mutex _registration_mutex_;        //!< Protects the list of buffers
+  std::vector<std::unique_ptr<thread_buffer>> _buffers_;  //!< Per-thread buffers
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_SPAN_RECORDER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
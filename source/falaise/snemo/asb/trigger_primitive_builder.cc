@@ -0,0 +1,348 @@
+// trigger_primitive_builder.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/trigger_primitive_builder.h>
+
+// Standard library:
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/clhep_units.h>
+#include <bayeux/datatools/exception.h>
+#include <bayeux/datatools/multi_properties.h>
+#include <bayeux/datatools/utils.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/base_signal.h>
+
+// This project:
+#include <snemo/asb/packed_gid.h>
+#include <snemo/asb/utils.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Value at time x_ of a triangle
+double triangle_value(double x_, double t0_, double t1_, double t2_, double amplitude_) {
+  if (x_ < t0_ || x_ > t2_) {
+    return 0.0;
+  }
+  if (x_ <= t1_) {
+    return t1_ > t0_ ? amplitude_ * (x_ - t0_) / (t1_ - t0_) : amplitude_;
+  }
+  return t2_ > t1_ ? amplitude_ * (t2_ - x_) / (t2_ - t1_) : 0.0;
+}
+
+}  // end of anonymous namespace
+
+trigger_primitive_builder::trigger_primitive_builder() {
+  _logging_priority_ = datatools::logger::PRIO_FATAL;
+  _threshold_ = 50.0 * CLHEP::millivolt;
+  _coincidence_window_ = 50.0 * CLHEP::ns;
+  _component_keys_.t0 = "t0";
+  _component_keys_.t1 = "t1";
+  _component_keys_.t2 = "t2";
+  _component_keys_.amplitude = "amplitude";
+  _shape_keys_.t0 = mctools::signal::base_signal::shape_key(_component_keys_.t0);
+  _shape_keys_.t1 = mctools::signal::base_signal::shape_key(_component_keys_.t1);
+  _shape_keys_.t2 = mctools::signal::base_signal::shape_key(_component_keys_.t2);
+  _shape_keys_.amplitude = mctools::signal::base_signal::shape_key(_component_keys_.amplitude);
+  _components_key_ = mctools::signal::base_signal::shape_key("components");
+  return;
+}
+
+void trigger_primitive_builder::set_logging_priority(
+    datatools::logger::priority logging_priority_) {
+  _logging_priority_ = logging_priority_;
+  return;
+}
+
+void trigger_primitive_builder::initialize(const datatools::properties& config_) {
+  if (config_.has_key("threshold")) {
+    double threshold = config_.fetch_real("threshold");
+    if (!config_.has_explicit_unit("threshold")) {
+      threshold *= CLHEP::millivolt;
+    }
+    set_threshold(threshold);
+  }
+  if (config_.has_key("coincidence_window")) {
+    double window = config_.fetch_real("coincidence_window");
+    if (!config_.has_explicit_unit("coincidence_window")) {
+      window *= CLHEP::ns;
+    }
+    set_coincidence_window(window);
+  }
+  if (config_.has_key("multiplicity")) {
+    const int multiplicity = config_.fetch_integer("multiplicity");
+    DT_THROW_IF(multiplicity <= 0, std::domain_error, "Invalid trigger multiplicity!");
+    set_multiplicity(multiplicity);
+  }
+  return;
+}
+
+void trigger_primitive_builder::set_threshold(double threshold_) {
+  DT_THROW_IF(!(threshold_ > 0.0), std::domain_error, "Invalid trigger threshold!");
+  _threshold_ = threshold_;
+  return;
+}
+
+double trigger_primitive_builder::get_threshold() const { return _threshold_; }
+
+void trigger_primitive_builder::set_coincidence_window(double window_) {
+  DT_THROW_IF(!(window_ >= 0.0), std::domain_error, "Invalid coincidence window!");
+  _coincidence_window_ = window_;
+  return;
+}
+
+void trigger_primitive_builder::set_multiplicity(unsigned int multiplicity_) {
+  DT_THROW_IF(multiplicity_ == 0, std::domain_error, "Invalid trigger multiplicity!");
+  _multiplicity_ = multiplicity_;
+  return;
+}
+
+void trigger_primitive_builder::build(const mctools::signal::signal_data& signal_data_) {
+  _primitives_.clear();
+  _triangles_.clear();
+  _unresolved_signals_ = 0;
+  _max_coincidence_ = 0;
+
+  // Collect the triangles on the absolute time axis, channel by channel:
+  std::map<std::pair<std::string, geomtools::geom_id>, std::size_t> channels;
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  for (const auto& category : categories) {
+    const std::size_t number_of_signals = signal_data_.get_number_of_signals(category);
+    for (std::size_t isig = 0; isig < number_of_signals; isig++) {
+      const mctools::signal::base_signal& signal = signal_data_.get_signal(category, isig);
+      const std::size_t ifirst = _triangles_.size();
+      if (!_add_triangles_(signal)) {
+        _unresolved_signals_++;
+        continue;
+      }
+      const auto found = channels.insert(
+          std::make_pair(std::make_pair(category, signal.get_geom_id()), channels.size()));
+      if (found.second) {
+        _primitives_.push_back(primitive_type());
+        _primitives_.back().category = category;
+        _primitives_.back().gid = signal.get_geom_id();
+      }
+      for (std::size_t itriangle = ifirst; itriangle < _triangles_.size(); itriangle++) {
+        _triangles_[itriangle].channel = found.first->second;
+      }
+    }
+  }
+  std::stable_sort(_triangles_.begin(), _triangles_.end(),
+                   [](const triangle_entry& a_, const triangle_entry& b_) {
+                     return a_.channel < b_.channel;
+                   });
+
+  // Primitives of each channel:
+  std::size_t ifirst = 0;
+  while (ifirst < _triangles_.size()) {
+    std::size_t ilast = ifirst + 1;
+    while (ilast < _triangles_.size() && _triangles_[ilast].channel == _triangles_[ifirst].channel) {
+      ilast++;
+    }
+    _build_channel_(_primitives_[_triangles_[ifirst].channel], &_triangles_[ifirst],
+                    &_triangles_[0] + ilast);
+    ifirst = ilast;
+  }
+
+  // Coincidences of the crossing channels within a sliding window:
+  std::vector<double> crossing_times;
+  for (const auto& primitive : _primitives_) {
+    if (primitive.crossed) crossing_times.push_back(primitive.crossing_time);
+  }
+  std::sort(crossing_times.begin(), crossing_times.end());
+  std::size_t iopen = 0;
+  for (std::size_t iclose = 0; iclose < crossing_times.size(); iclose++) {
+    while (crossing_times[iclose] - crossing_times[iopen] > _coincidence_window_) {
+      iopen++;
+    }
+    _max_coincidence_ = std::max(_max_coincidence_, iclose - iopen + 1);
+  }
+  return;
+}
+
+bool trigger_primitive_builder::_add_triangles_(const mctools::signal::base_signal& signal_) {
+  double time_ref = 0.0;
+  if (signal_.has_time_ref() && datatools::is_valid(signal_.get_time_ref())) {
+    time_ref = signal_.get_time_ref();
+  }
+  const datatools::properties& aux = signal_.get_auxiliaries();
+  if (signal_.get_shape_type_id() != "mctools::signal::multi_signal_shape") {
+    return _add_triangle_(aux, _shape_keys_, time_ref, 1.0);
+  }
+  // Multi signal: sum of its components, shifted and scaled:
+  if (!aux.has_key(_components_key_) || !signal_.has_private_shapes_config()) {
+    return false;
+  }
+  std::vector<std::string> components;
+  aux.fetch(_components_key_, components);
+  const datatools::multi_properties& private_shapes = signal_.get_private_shapes_config();
+  const std::size_t ifirst = _triangles_.size();
+  for (const auto& component : components) {
+    const std::string prefix = "components." + component + ".";
+    const std::string key_key = mctools::signal::base_signal::shape_key(prefix + "key");
+    const std::string key = aux.has_key(key_key) ? aux.fetch_string(key_key) : component;
+    if (!private_shapes.has_key(key)) {
+      _triangles_.resize(ifirst);
+      return false;
+    }
+    const std::string shift_key = mctools::signal::base_signal::shape_key(prefix + "time_shift");
+    const std::string scaling_key = mctools::signal::base_signal::shape_key(prefix + "scaling");
+    const double time_shift = aux.has_key(shift_key) ? aux.fetch_real(shift_key) : 0.0;
+    const double scaling = aux.has_key(scaling_key) ? aux.fetch_real(scaling_key) : 1.0;
+    if (!_add_triangle_(private_shapes.get_section(key), _component_keys_, time_ref + time_shift,
+                        scaling)) {
+      _triangles_.resize(ifirst);
+      return false;
+    }
+  }
+  return !components.empty();
+}
+
+bool trigger_primitive_builder::_add_triangle_(const datatools::properties& parameters_,
+                                               const triangle_keys& keys_, double time_shift_,
+                                               double scaling_) {
+  if (!parameters_.has_key(keys_.t0) || !parameters_.has_key(keys_.t1) ||
+      !parameters_.has_key(keys_.t2) || !parameters_.has_key(keys_.amplitude)) {
+    return false;
+  }
+  triangle_entry triangle;
+  triangle.channel = 0;
+  triangle.t0 = time_shift_ + parameters_.fetch_real(keys_.t0);
+  triangle.t1 = time_shift_ + parameters_.fetch_real(keys_.t1);
+  triangle.t2 = time_shift_ + parameters_.fetch_real(keys_.t2);
+  triangle.amplitude = std::abs(scaling_ * parameters_.fetch_real(keys_.amplitude));
+  _triangles_.push_back(triangle);
+  return true;
+}
+
+void trigger_primitive_builder::_build_channel_(primitive_type& primitive_,
+                                                const triangle_entry* first_,
+                                                const triangle_entry* last_) {
+  // The sum of the triangles is linear between consecutive breakpoints:
+  _breakpoints_.clear();
+  for (const triangle_entry* triangle = first_; triangle != last_; triangle++) {
+    _breakpoints_.push_back(triangle->t0);
+    _breakpoints_.push_back(triangle->t1);
+    _breakpoints_.push_back(triangle->t2);
+  }
+  std::sort(_breakpoints_.begin(), _breakpoints_.end());
+  _breakpoints_.erase(std::unique(_breakpoints_.begin(), _breakpoints_.end()),
+                      _breakpoints_.end());
+  double previous_time = 0.0;
+  double previous_value = 0.0;
+  for (std::size_t ipoint = 0; ipoint < _breakpoints_.size(); ipoint++) {
+    const double time = _breakpoints_[ipoint];
+    double value = 0.0;
+    for (const triangle_entry* triangle = first_; triangle != last_; triangle++) {
+      value += triangle_value(time, triangle->t0, triangle->t1, triangle->t2, triangle->amplitude);
+    }
+    if (!primitive_.crossed && value >= _threshold_) {
+      primitive_.crossed = true;
+      if (ipoint == 0 || value == previous_value) {
+        primitive_.crossing_time = time;
+      } else {
+        primitive_.crossing_time = previous_time + (_threshold_ - previous_value) *
+                                                       (time - previous_time) /
+                                                       (value - previous_value);
+      }
+    }
+    if (value > primitive_.peak_amplitude) {
+      primitive_.peak_amplitude = value;
+      primitive_.peak_time = time;
+    }
+    previous_time = time;
+    previous_value = value;
+  }
+  return;
+}
+
+const std::vector<trigger_primitive_builder::primitive_type>&
+trigger_primitive_builder::get_primitives() const {
+  return _primitives_;
+}
+
+std::size_t trigger_primitive_builder::get_number_of_unresolved_signals() const {
+  return _unresolved_signals_;
+}
+
+std::size_t trigger_primitive_builder::get_max_coincidence() const { return _max_coincidence_; }
+
+bool trigger_primitive_builder::is_accepted() const {
+  return _unresolved_signals_ > 0 || _max_coincidence_ >= _multiplicity_;
+}
+
+void trigger_primitive_builder::export_summary(datatools::properties& summary_) const {
+  std::vector<double> crossing_times;
+  std::vector<double> peak_amplitudes;
+  std::vector<std::string> crossing_categories;
+  std::vector<std::string> crossing_channels;
+  for (const auto& primitive : _primitives_) {
+    if (!primitive.crossed) continue;
+    crossing_times.push_back(primitive.crossing_time);
+    peak_amplitudes.push_back(primitive.peak_amplitude);
+    crossing_categories.push_back(primitive.category);
+    // Packed keys do not fit integer properties; they are stored in hexadecimal:
+    packed_gid::key_type key = packed_gid::INVALID_KEY;
+    packed_gid::try_encode(primitive.gid, key);
+    crossing_channels.push_back(hash_utils::to_hex(key));
+  }
+  summary_.store_real_with_explicit_unit("trigger.threshold", _threshold_);
+  summary_.set_unit_symbol("trigger.threshold", "mV");
+  summary_.store_integer("trigger.channels_above_threshold", crossing_times.size());
+  summary_.store_integer("trigger.max_coincidence", _max_coincidence_);
+  if (!crossing_times.empty()) {
+    summary_.store_real_with_explicit_unit(
+        "trigger.first_crossing_time",
+        *std::min_element(crossing_times.begin(), crossing_times.end()));
+    summary_.set_unit_symbol("trigger.first_crossing_time", "ns");
+    summary_.store("trigger.crossing_times", crossing_times);
+    summary_.store("trigger.peak_amplitudes", peak_amplitudes);
+    summary_.store("trigger.crossing_categories", crossing_categories);
+    summary_.store("trigger.crossing_channels", crossing_channels);
+  }
+  summary_.store_integer("trigger.unresolved_signals", _unresolved_signals_);
+  summary_.store_boolean("trigger.accept", is_accepted());
+  return;
+}
+
+void trigger_primitive_builder::reset() {
+  _primitives_.clear();
+  _triangles_.clear();
+  _breakpoints_.clear();
+  _unresolved_signals_ = 0;
+  _max_coincidence_ = 0;
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
@@ -0,0 +1,173 @@
+// snemo/asb/trigger_primitive_builder.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-04-06
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_TRIGGER_PRIMITIVE_BUILDER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_TRIGGER_PRIMITIVE_BUILDER_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/logger.h>
+#include <bayeux/datatools/properties.h>
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/signal_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Builder of threshold trigger primitives from generated signals
+///
+/// The signals of a channel (category and geometry ID) are summed as
+/// piecewise-linear functions of time, built from the analytic parameters
+/// (t0, t1, t2, amplitude) of their triangle shapes. The first threshold
+/// crossing time and the peak amplitude of each channel are thus computed
+/// exactly, from the breakpoints only, without sampling any waveform.
+///
+/// Multi signals contribute the triangles of their components, shifted and
+/// scaled as the multi signal shape does.
+///
+/// The channels crossing the threshold are counted in coincidence within a
+/// sliding time window. Signals without analytic parameters (other shapes,
+/// or multi signals with such a component) are reported as unresolved: an
+/// event with unresolved signals is always accepted.
+///
+/// Configuration:
+/// \code
+/// threshold : real as electric_potential = 50 mV
+/// coincidence_window : real as time = 50 ns
+/// multiplicity : integer = 1
+/// \endcode
+///
+/// Summary properties (stored in the summary bank):
+/// \code
+/// trigger.threshold : real as electric_potential
+/// trigger.channels_above_threshold : integer
+/// trigger.max_coincidence : integer
+/// trigger.first_crossing_time : real as time (only with some crossing)
+/// trigger.crossing_times : real[N] as time (one per crossing channel)
+/// trigger.peak_amplitudes : real[N] as electric_potential (idem)
+/// trigger.crossing_categories : string[N] (idem)
+/// trigger.crossing_channels : string[N] (idem, hexadecimal packed geometry
+///   IDs, "ffffffffffffffff" for the geometry IDs that cannot be packed)
+/// trigger.unresolved_signals : integer
+/// trigger.accept : boolean
+/// \endcode
+class trigger_primitive_builder {
+ public:
+  /// \brief Trigger primitive of a channel
+  struct primitive_type {
+    std::string category;         //!< Signal category
+    geomtools::geom_id gid;       //!< Geometry ID of the channel
+    bool crossed = false;         //!< Threshold crossing flag
+    double crossing_time = 0.0;   //!< First threshold crossing time
+    double peak_amplitude = 0.0;  //!< Peak amplitude
+    double peak_time = 0.0;       //!< Time of the peak
+  };
+
+  /// Constructor
+  trigger_primitive_builder();
+
+  /// Set logging priority level
+  void set_logging_priority(datatools::logger::priority logging_priority_);
+
+  /// Initialize from configuration properties
+  void initialize(const datatools::properties& config_);
+
+  /// Set the threshold (absolute amplitude)
+  void set_threshold(double threshold_);
+
+  /// Return the threshold
+  double get_threshold() const;
+
+  /// Set the coincidence window
+  void set_coincidence_window(double window_);
+
+  /// Set the multiplicity required to accept an event
+  void set_multiplicity(unsigned int multiplicity_);
+
+  /// Build the trigger primitives of all the signals of a bank
+  void build(const mctools::signal::signal_data& signal_data_);
+
+  /// Return the primitives of the channels of the last built bank
+  const std::vector<primitive_type>& get_primitives() const;
+
+  /// Return the number of signals without analytic parameters in the last built bank
+  std::size_t get_number_of_unresolved_signals() const;
+
+  /// Return the maximum number of crossing channels within the coincidence window
+  std::size_t get_max_coincidence() const;
+
+  /// Check if the last built bank passes the trigger
+  bool is_accepted() const;
+
+  /// Store the summary of the last built bank
+  void export_summary(datatools::properties& summary_) const;
+
+  /// Reset
+  void reset();
+
+ private:
+  // Triangle of a channel on the absolute time axis:
+  struct triangle_entry {
+    std::size_t channel;  //!< Index of the channel in the event
+    double t0;            //!< Start time
+    double t1;            //!< Peak time
+    double t2;            //!< Stop time
+    double amplitude;     //!< Absolute amplitude
+  };
+
+  // Keys of the triangle parameters in a set of properties:
+  struct triangle_keys {
+    std::string t0;         //!< Start time key
+    std::string t1;         //!< Peak time key
+    std::string t2;         //!< Stop time key
+    std::string amplitude;  //!< Amplitude key
+  };
+
+  bool _add_triangles_(const mctools::signal::base_signal& signal_);
+
+  bool _add_triangle_(const datatools::properties& parameters_, const triangle_keys& keys_,
+                      double time_shift_, double scaling_);
+
+  void _build_channel_(primitive_type& primitive_, const triangle_entry* first_,
+                       const triangle_entry* last_);
+
+ private:
+  datatools::logger::priority _logging_priority_;
+  double _threshold_;               //!< Threshold on the absolute amplitude
+  double _coincidence_window_;      //!< Coincidence window
+  unsigned int _multiplicity_ = 1;  //!< Multiplicity required to accept an event
+
+  // Parameter keys, resolved once:
+  triangle_keys _shape_keys_;      //!< Keys in the auxiliaries of an atomic signal
+  triangle_keys _component_keys_;  //!< Keys in the private shapes of a multi signal
+  std::string _components_key_;    //!< Key of the components of a multi signal
+
+  // Working data:
+  std::vector<primitive_type> _primitives_;  //!< Primitives of the channels
+  std::vector<triangle_entry> _triangles_;   //!< Triangles of the event
+  std::vector<double> _breakpoints_;         //!< Breakpoints of a channel
+  std::size_t _unresolved_signals_ = 0;      //!< Number of unresolved signals
+  std::size_t _max_coincidence_ = 0;         //!< Maximum coincidence
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_TRIGGER_PRIMITIVE_BUILDER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
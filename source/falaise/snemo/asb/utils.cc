@@ -0,0 +1,289 @@
+// utils.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/utils.h>
+
+// Standard library:
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// POSIX:
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+uint64_t hash_utils::update(uint64_t digest_, const void* data_, std::size_t size_) {
+  static const uint64_t fnv_prime = 1099511628211ULL;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data_);
+  for (std::size_t i = 0; i < size_; i++) {
+    digest_ ^= static_cast<uint64_t>(bytes[i]);
+    digest_ *= fnv_prime;
+  }
+  return digest_;
+}
+
+uint64_t hash_utils::update(uint64_t digest_, const std::string& data_) {
+  digest_ = update(digest_, static_cast<uint64_t>(data_.size()));
+  return update(digest_, data_.data(), data_.size());
+}
+
+uint64_t hash_utils::update(uint64_t digest_, uint64_t value_) {
+  unsigned char bytes[8];
+  // Little-endian byte order whatever the platform:
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = static_cast<unsigned char>((value_ >> (8 * i)) & 0xFF);
+  }
+  return update(digest_, bytes, sizeof(bytes));
+}
+
+uint64_t hash_utils::update(uint64_t digest_, double value_) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value_, sizeof(bits));
+  return update(digest_, bits);
+}
+
+uint64_t hash_utils::update(uint64_t digest_, const geomtools::geom_id& gid_) {
+  digest_ = update(digest_, static_cast<uint64_t>(gid_.get_type()));
+  digest_ = update(digest_, static_cast<uint64_t>(gid_.get_depth()));
+  for (std::size_t i = 0; i < gid_.get_depth(); i++) {
+    digest_ = update(digest_, static_cast<uint64_t>(gid_.get(i)));
+  }
+  return digest_;
+}
+
+uint64_t hash_utils::hash_properties(const datatools::properties& config_, uint64_t digest_) {
+  std::vector<std::string> keys;
+  config_.keys(keys);
+  std::sort(keys.begin(), keys.end());
+  for (const auto& key : keys) {
+    // The logging configuration has no effect on the results:
+    if (key.compare(0, 8, "logging.") == 0) continue;
+    digest_ = update(digest_, key);
+    const std::size_t size = config_.is_vector(key) ? config_.size(key) : 1;
+    digest_ = update(digest_, static_cast<uint64_t>(size));
+    for (int i = 0; i < static_cast<int>(size); i++) {
+      if (config_.is_boolean(key)) {
+        digest_ = update(digest_, static_cast<uint64_t>(config_.fetch_boolean(key, i) ? 1 : 0));
+      } else if (config_.is_integer(key)) {
+        digest_ = update(digest_, static_cast<uint64_t>(config_.fetch_integer(key, i)));
+      } else if (config_.is_real(key)) {
+        digest_ = update(digest_, config_.fetch_real(key, i));
+      } else {
+        digest_ = update(digest_, config_.fetch_string(key, i));
+      }
+    }
+    if (config_.is_real(key)) {
+      // Reals without explicit unit are interpreted with a default unit:
+      digest_ = update(digest_, static_cast<uint64_t>(config_.has_explicit_unit(key) ? 1 : 0));
+    }
+  }
+  return digest_;
+}
+
+uint64_t hash_utils::hash_step_hits(const mctools::simulated_data& sim_data_,
+                                    const std::vector<std::string>& categories_,
+                                    uint64_t digest_) {
+  for (const auto& category : categories_) {
+    digest_ = update(digest_, category);
+    if (!sim_data_.has_step_hits(category)) {
+      digest_ = update(digest_, static_cast<uint64_t>(0));
+      continue;
+    }
+    const std::size_t number_of_hits = sim_data_.get_number_of_step_hits(category);
+    digest_ = update(digest_, static_cast<uint64_t>(number_of_hits));
+    for (std::size_t ihit = 0; ihit < number_of_hits; ihit++) {
+      const mctools::base_step_hit& hit = sim_data_.get_step_hit(category, ihit);
+      digest_ = update(digest_, static_cast<uint64_t>(hit.get_hit_id()));
+      digest_ = update(digest_, hit.get_geom_id());
+      digest_ = update(digest_, hit.get_time_start());
+      digest_ = update(digest_, hit.get_time_stop());
+      digest_ = update(digest_, hit.get_energy_deposit());
+    }
+  }
+  return digest_;
+}
+
+std::string hash_utils::to_hex(uint64_t digest_) {
+  std::ostringstream out;
+  out << std::hex << std::setw(16) << std::setfill('0') << digest_;
+  return out.str();
+}
+
+std::size_t signal_utils::copy_signals(const mctools::signal::signal_data& source_,
+                                       const std::string& category_,
+                                       mctools::signal::signal_data& target_) {
+  if (!source_.has_signals(category_)) {
+    return 0;
+  }
+  const std::size_t number_of_signals = source_.get_number_of_signals(category_);
+  for (std::size_t isig = 0; isig < number_of_signals; isig++) {
+    mctools::signal::base_signal& signal = target_.add_signal(category_);
+    signal = source_.get_signal(category_, isig);
+  }
+  return number_of_signals;
+}
+
+void signal_utils::build_multi_signal(
+    const std::vector<const mctools::signal::base_signal*>& atomic_signals_,
+    mctools::signal::base_signal& signal_) {
+  DT_THROW_IF(atomic_signals_.empty(), std::logic_error, "Missing atomic signals!");
+  const mctools::signal::base_signal& first_signal = *atomic_signals_.front();
+  signal_.set_hit_id(first_signal.get_hit_id());
+  signal_.set_geom_id(first_signal.get_geom_id());
+  signal_.set_category(first_signal.get_category());
+  signal_.set_time_ref(first_signal.get_time_ref());
+  signal_.set_shape_type_id("mctools::signal::multi_signal_shape");
+  std::vector<std::string> components;
+  components.reserve(atomic_signals_.size());
+  for (const mctools::signal::base_signal* atomic_signal : atomic_signals_) {
+    const std::string component = "hit" + std::to_string(atomic_signal->get_hit_id());
+    datatools::properties shape_parameters;
+    atomic_signal->get_auxiliaries().export_and_rename_starting_with(
+        shape_parameters, mctools::signal::base_signal::shape_parameter_prefix(), "");
+    signal_.add_private_shape(component, atomic_signal->get_shape_type_id(), shape_parameters);
+    const std::string prefix = "components." + component + ".";
+    signal_.set_shape_string_parameter(prefix + "key", component);
+    signal_.set_shape_real_parameter_with_explicit_unit(prefix + "time_shift", 0.0, "ns");
+    signal_.set_shape_real_parameter(prefix + "scaling", 1.0);
+    components.push_back(component);
+  }
+  signal_.grab_auxiliaries().store(mctools::signal::base_signal::shape_key("components"),
+                                   components);
+  return;
+}
+
+mctools::signal::signal_data::signal_handle_collection_type& signal_utils::grab_signal_collection(
+    mctools::signal::signal_data& target_, const std::string& category_) {
+  if (!target_.has_signals(category_)) {
+    // Adding a signal is the only public way to create a category:
+    target_.add_signal(category_);
+    target_.grab_signals(category_).pop_back();
+  }
+  return target_.grab_signals(category_);
+}
+
+std::size_t signal_utils::estimate_memory(const mctools::signal::base_signal& signal_) {
+  // Approximate cost of a property: map node, value holder and description.
+  static const std::size_t property_overhead = 96;
+  const datatools::properties& aux = signal_.get_auxiliaries();
+  std::size_t bytes = sizeof(mctools::signal::base_signal);
+  std::vector<std::string> keys;
+  aux.keys(keys);
+  for (const auto& key : keys) {
+    bytes += property_overhead + key.size();
+    if (aux.is_string(key) && !aux.is_vector(key)) {
+      bytes += aux.fetch_string(key).size();
+    } else if (aux.is_vector(key)) {
+      bytes += aux.size(key) * sizeof(double);
+    }
+  }
+  return bytes;
+}
+
+std::size_t signal_utils::estimate_memory(const mctools::signal::signal_data& signal_data_,
+                                          const std::string& category_) {
+  if (!signal_data_.has_signals(category_)) {
+    return 0;
+  }
+  const mctools::signal::signal_data::signal_handle_collection_type& signals =
+      signal_data_.get_signals(category_);
+  std::size_t bytes = signals.capacity() * sizeof(mctools::signal::signal_data::signal_handle_type);
+  for (const auto& signal : signals) {
+    bytes += estimate_memory(signal.get());
+  }
+  return bytes;
+}
+
+std::size_t signal_utils::estimate_memory(const mctools::signal::signal_data& signal_data_) {
+  std::vector<std::string> categories;
+  signal_data_.build_list_of_categories(categories);
+  std::size_t bytes = sizeof(mctools::signal::signal_data);
+  for (const auto& category : categories) {
+    bytes += estimate_memory(signal_data_, category);
+  }
+  return bytes;
+}
+
+void file_utils::make_directories(const std::string& path_) {
+  DT_THROW_IF(path_.empty(), std::logic_error, "Missing directory path!");
+  std::size_t position = 0;
+  do {
+    position = path_.find('/', position + 1);
+    const std::string path = path_.substr(0, position);
+    if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+      DT_THROW(std::runtime_error, "Cannot create directory '" << path << "'!");
+    }
+  } while (position != std::string::npos);
+  struct stat path_stat;
+  DT_THROW_IF(::stat(path_.c_str(), &path_stat) != 0 || !S_ISDIR(path_stat.st_mode),
+              std::runtime_error, "'" << path_ << "' is not a directory!");
+  return;
+}
+
+std::string file_utils::make_temporary_file(const std::string& target_path_) {
+  std::vector<char> path(target_path_.begin(), target_path_.end());
+  static const std::string suffix = ".tmp.XXXXXX";
+  path.insert(path.end(), suffix.begin(), suffix.end());
+  path.push_back('\0');
+  const int fd = ::mkstemp(path.data());
+  DT_THROW_IF(fd < 0, std::runtime_error,
+              "Cannot create a temporary file for '" << target_path_ << "'!");
+  ::close(fd);
+  return std::string(path.data());
+}
+
+uint64_t file_utils::hash_file(const std::string& path_) {
+  static const std::size_t chunk_size = 1024 * 1024;
+  std::FILE* file = std::fopen(path_.c_str(), "rb");
+  DT_THROW_IF(file == nullptr, std::runtime_error, "Cannot open file '" << path_ << "'!");
+  std::vector<char> chunk(chunk_size);
+  uint64_t digest = hash_utils::offset_basis;
+  std::fseek(file, 0, SEEK_END);
+  const long size = std::ftell(file);
+  digest = hash_utils::update(digest, static_cast<uint64_t>(size));
+  std::fseek(file, 0, SEEK_SET);
+  std::size_t read_bytes = std::fread(chunk.data(), 1, chunk_size, file);
+  digest = hash_utils::update(digest, chunk.data(), read_bytes);
+  if (size > static_cast<long>(chunk_size)) {
+    std::fseek(file, std::max(static_cast<long>(chunk_size), size - static_cast<long>(chunk_size)),
+               SEEK_SET);
+    read_bytes = std::fread(chunk.data(), 1, chunk_size, file);
+    digest = hash_utils::update(digest, chunk.data(), read_bytes);
+  }
+  std::fclose(file);
+  return digest;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
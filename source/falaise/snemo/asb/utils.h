@@ -0,0 +1,124 @@
+// snemo/asb/utils.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-10
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_UTILS_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_UTILS_H
+
+// Standard library:
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/properties.h>
+// - Bayeux/geomtools:
+#include <bayeux/geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <bayeux/mctools/signal/signal_data.h>
+#include <bayeux/mctools/simulated_data.h>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Stable 64-bit hashing of ASB inputs and configurations
+///
+/// The FNV-1a algorithm is used so that digests are reproducible across
+/// runs, platforms and compilers, and can be persisted in output banks.
+struct hash_utils {
+  /// Initial value of a digest
+  static const uint64_t offset_basis = 14695981039346656037ULL;
+
+  /// Update a digest with a buffer of bytes
+  static uint64_t update(uint64_t digest_, const void* data_, std::size_t size_);
+
+  /// Update a digest with a string
+  static uint64_t update(uint64_t digest_, const std::string& data_);
+
+  /// Update a digest with an integral value
+  static uint64_t update(uint64_t digest_, uint64_t value_);
+
+  /// Update a digest with a real value
+  static uint64_t update(uint64_t digest_, double value_);
+
+  /// Update a digest with a geometry ID
+  static uint64_t update(uint64_t digest_, const geomtools::geom_id& gid_);
+
+  /// Compute the digest of a set of configuration properties
+  ///
+  /// Only the keys and values are hashed, in key order; descriptions and the
+  /// logging configuration (keys starting with "logging.") are ignored.
+  static uint64_t hash_properties(const datatools::properties& config_,
+                                  uint64_t digest_ = offset_basis);
+
+  /// Compute the digest of the step hits of some categories in a simulated data
+  static uint64_t hash_step_hits(const mctools::simulated_data& sim_data_,
+                                 const std::vector<std::string>& categories_,
+                                 uint64_t digest_ = offset_basis);
+
+  /// Return the hexadecimal representation of a digest
+  static std::string to_hex(uint64_t digest_);
+};
+
+/// \brief Utilities for simulated signal data banks
+struct signal_utils {
+  /// Append copies of the signals of a category from a bank to another one
+  ///
+  /// Return the number of copied signals.
+  static std::size_t copy_signals(const mctools::signal::signal_data& source_,
+                                  const std::string& category_,
+                                  mctools::signal::signal_data& target_);
+
+  /// Build the multi signal of the atomic signals piled up in a channel
+  ///
+  /// The multi signal takes the hit ID, geometry ID, category and time
+  /// reference of the first atomic signal. Its components are the atomic
+  /// signals, stored as private shapes under the keys "hit<hit ID>", with
+  /// no time shift and unit scaling (the time references are shared).
+  static void build_multi_signal(
+      const std::vector<const mctools::signal::base_signal*>& atomic_signals_,
+      mctools::signal::base_signal& signal_);
+
+  /// Return the collection of signal handles of a category, creating the category if needed
+  static mctools::signal::signal_data::signal_handle_collection_type& grab_signal_collection(
+      mctools::signal::signal_data& target_, const std::string& category_);
+
+  /// Estimate the memory footprint of a signal, including its auxiliary properties (in bytes)
+  static std::size_t estimate_memory(const mctools::signal::base_signal& signal_);
+
+  /// Estimate the memory footprint of the signals of a category in a bank (in bytes)
+  static std::size_t estimate_memory(const mctools::signal::signal_data& signal_data_,
+                                     const std::string& category_);
+
+  /// Estimate the memory footprint of all the signals of a bank (in bytes)
+  static std::size_t estimate_memory(const mctools::signal::signal_data& signal_data_);
+};
+
+/// \brief Utilities for the files shared by concurrent jobs
+struct file_utils {
+  /// Create a directory and its missing parents
+  static void make_directories(const std::string& path_);
+
+  /// Create an empty temporary file next to a target file, unique among the
+  /// processes and threads writing the same target, and return its path
+  static std::string make_temporary_file(const std::string& target_path_);
+
+  /// Compute a digest of the content of a file from its size and its first
+  /// and last megabytes, so that copies of a file share the same digest
+  static uint64_t hash_file(const std::string& path_);
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_UTILS_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
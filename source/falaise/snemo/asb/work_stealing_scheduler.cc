@@ -0,0 +1,354 @@
+// work_stealing_scheduler.cc
+//
+// Copyright (c) 2017 F. Mauger <mauger@lpccaen.in2p3.fr>
+// Copyright (c) 2017 G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+//
+// This file is part of Falaise/ASB plugin.
+//
+// Falaise/ASB plugin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Falaise/ASB plugin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Falaise/ASB plugin.  If not, see <http://www.gnu.org/licenses/>.
+
+// Ourselves:
+#include <snemo/asb/work_stealing_scheduler.h>
+
+// Standard library:
+#include <iterator>
+#include <stdexcept>
+
+// Third party:
+// - Bayeux/datatools:
+#include <bayeux/datatools/exception.h>
+
+namespace snemo {
+
+namespace asb {
+
+namespace {
+
+// Scheduler and worker index of the current thread:
+thread_local const work_stealing_scheduler* t_scheduler = nullptr;
+thread_local std::size_t t_worker = 0;
+// Nesting depth of the tasks run by the current thread (tasks run while
+// waiting for a group are nested in the waiting task):
+thread_local std::size_t t_depth = 0;
+
+}  // end of anonymous namespace
+
+work_stealing_scheduler::work_stealing_scheduler(std::size_t number_of_workers_) {
+  DT_THROW_IF(number_of_workers_ == 0, std::domain_error, "Invalid null number of workers!");
+  for (std::size_t iworker = 0; iworker < number_of_workers_; iworker++) {
+    _workers_.emplace_back(new worker_type);
+  }
+  return;
+}
+
+work_stealing_scheduler::~work_stealing_scheduler() {
+  if (is_running()) {
+    try {
+      stop();
+    } catch (...) {
+      // Nothing to do in a destructor.
+    }
+  }
+  return;
+}
+
+std::size_t work_stealing_scheduler::get_number_of_workers() const { return _workers_.size(); }
+
+bool work_stealing_scheduler::is_running() const { return !_threads_.empty(); }
+
+void work_stealing_scheduler::start() {
+  DT_THROW_IF(is_running(), std::logic_error, "Scheduler is already running!");
+  _stopping_ = false;
+  _failure_ = nullptr;
+  _start_time_ = std::chrono::steady_clock::now();
+  for (std::size_t iworker = 0; iworker < _workers_.size(); iworker++) {
+    _workers_[iworker]->stats = worker_stats();
+    _threads_.emplace_back(&work_stealing_scheduler::_worker_loop_, this, iworker);
+  }
+  return;
+}
+
+void work_stealing_scheduler::stop() {
+  DT_THROW_IF(!is_running(), std::logic_error, "Scheduler is not running!");
+  {
+    std::lock_guard<std::mutex> lock(_wake_mutex_);
+    _stopping_ = true;
+  }
+  _wake_.notify_all();
+  for (auto& thread : _threads_) {
+    thread.join();
+  }
+  _threads_.clear();
+  if (_failure_) {
+    std::exception_ptr failure = _failure_;
+    _failure_ = nullptr;
+    std::rethrow_exception(failure);
+  }
+  return;
+}
+
+int work_stealing_scheduler::get_current_worker() const {
+  return t_scheduler == this ? static_cast<int>(t_worker) : -1;
+}
+
+void work_stealing_scheduler::submit(const task_type& task_) {
+  task_entry entry;
+  entry.task = task_;
+  const int current = get_current_worker();
+  if (current >= 0) {
+    _push_(current, std::move(entry));
+  } else {
+    _inject_(std::move(entry));
+  }
+  return;
+}
+
+void work_stealing_scheduler::submit(task_group& group_, const task_type& task_) {
+  task_entry entry;
+  entry.task = task_;
+  entry.group = &group_;
+  group_._pending_++;
+  const int current = get_current_worker();
+  if (current >= 0) {
+    _push_(current, std::move(entry));
+  } else {
+    _inject_(std::move(entry));
+  }
+  return;
+}
+
+void work_stealing_scheduler::wait(task_group& group_) {
+  const int current = get_current_worker();
+  while (group_._pending_.load() > 0) {
+    task_entry entry;
+    bool stolen = false;
+    if (current >= 0 && _take_group_task_(current, group_, entry, stolen)) {
+      _execute_(current, entry, stolen);
+    } else {
+      // The remaining tasks of the group are running on other workers:
+      std::this_thread::yield();
+    }
+  }
+  std::exception_ptr failure;
+  {
+    std::lock_guard<std::mutex> lock(group_._failure_mutex_);
+    failure = group_._failure_;
+    group_._failure_ = nullptr;
+  }
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  return;
+}
+
+void work_stealing_scheduler::_push_(std::size_t worker_, task_entry&& entry_) {
+  {
+    worker_type& worker = *_workers_[worker_];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(entry_));
+  }
+  {
+    std::lock_guard<std::mutex> lock(_wake_mutex_);
+    _queued_tasks_++;
+  }
+  _wake_.notify_one();
+  return;
+}
+
+void work_stealing_scheduler::_inject_(task_entry&& entry_) {
+  {
+    std::lock_guard<std::mutex> lock(_injection_mutex_);
+    _injected_.push_back(std::move(entry_));
+  }
+  {
+    std::lock_guard<std::mutex> lock(_wake_mutex_);
+    _queued_tasks_++;
+  }
+  _wake_.notify_one();
+  return;
+}
+
+bool work_stealing_scheduler::_pop_local_(std::size_t worker_, task_entry& entry_) {
+  worker_type& worker = *_workers_[worker_];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  entry_ = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  _queued_tasks_--;
+  return true;
+}
+
+bool work_stealing_scheduler::_pop_injected_(task_entry& entry_) {
+  std::lock_guard<std::mutex> lock(_injection_mutex_);
+  if (_injected_.empty()) {
+    return false;
+  }
+  entry_ = std::move(_injected_.front());
+  _injected_.pop_front();
+  _queued_tasks_--;
+  return true;
+}
+
+bool work_stealing_scheduler::_steal_(std::size_t thief_, task_entry& entry_) {
+  const std::size_t number_of_workers = _workers_.size();
+  for (std::size_t i = 1; i < number_of_workers; i++) {
+    worker_type& victim = *_workers_[(thief_ + i) % number_of_workers];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty()) {
+      continue;
+    }
+    entry_ = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    _queued_tasks_--;
+    return true;
+  }
+  return false;
+}
+
+bool work_stealing_scheduler::_take_group_task_(std::size_t worker_, const task_group& group_,
+                                                task_entry& entry_, bool& stolen_) {
+  // Search a task of the group in a deque, newest first for the own deque of
+  // the worker and oldest first for the others:
+  auto take = [&](std::deque<task_entry>& tasks_, bool newest_first_) {
+    if (newest_first_) {
+      for (auto itask = tasks_.rbegin(); itask != tasks_.rend(); ++itask) {
+        if (itask->group == &group_) {
+          entry_ = std::move(*itask);
+          tasks_.erase(std::next(itask).base());
+          _queued_tasks_--;
+          return true;
+        }
+      }
+    } else {
+      for (auto itask = tasks_.begin(); itask != tasks_.end(); ++itask) {
+        if (itask->group == &group_) {
+          entry_ = std::move(*itask);
+          tasks_.erase(itask);
+          _queued_tasks_--;
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+  const std::size_t number_of_workers = _workers_.size();
+  for (std::size_t i = 0; i < number_of_workers; i++) {
+    worker_type& worker = *_workers_[(worker_ + i) % number_of_workers];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (take(worker.tasks, i == 0)) {
+      stolen_ = (i != 0);
+      return true;
+    }
+  }
+  std::lock_guard<std::mutex> lock(_injection_mutex_);
+  if (take(_injected_, false)) {
+    stolen_ = false;
+    return true;
+  }
+  return false;
+}
+
+void work_stealing_scheduler::_execute_(std::size_t worker_, task_entry& entry_, bool stolen_) {
+  const auto start = std::chrono::steady_clock::now();
+  t_depth++;
+  try {
+    entry_.task(worker_);
+  } catch (...) {
+    if (entry_.group != nullptr) {
+      // Reported by the wait for the group:
+      std::lock_guard<std::mutex> lock(entry_.group->_failure_mutex_);
+      if (!entry_.group->_failure_) entry_.group->_failure_ = std::current_exception();
+    } else {
+      std::lock_guard<std::mutex> lock(_failure_mutex_);
+      if (!_failure_) _failure_ = std::current_exception();
+    }
+  }
+  t_depth--;
+  const double duration =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  {
+    worker_type& worker = *_workers_[worker_];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.stats.executed_tasks++;
+    if (stolen_) worker.stats.stolen_tasks++;
+    if (t_depth == 0) {
+      // Nested tasks are already accounted for in the busy time of their parent:
+      worker.stats.busy_time += duration;
+    }
+  }
+  if (entry_.group != nullptr) {
+    entry_.group->_pending_--;
+  }
+  return;
+}
+
+void work_stealing_scheduler::_worker_loop_(std::size_t worker_) {
+  t_scheduler = this;
+  t_worker = worker_;
+  while (true) {
+    task_entry entry;
+    if (_pop_local_(worker_, entry)) {
+      _execute_(worker_, entry, false);
+      continue;
+    }
+    if (_pop_injected_(entry)) {
+      _execute_(worker_, entry, false);
+      continue;
+    }
+    if (_steal_(worker_, entry)) {
+      _execute_(worker_, entry, true);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(_wake_mutex_);
+    _wake_.wait(lock, [this] { return _queued_tasks_.load() > 0 || _stopping_; });
+    if (_stopping_ && _queued_tasks_.load() == 0) {
+      break;
+    }
+  }
+  t_scheduler = nullptr;
+  return;
+}
+
+std::vector<work_stealing_scheduler::worker_stats> work_stealing_scheduler::get_worker_stats()
+    const {
+  std::vector<worker_stats> stats;
+  for (const auto& worker : _workers_) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    stats.push_back(worker->stats);
+  }
+  return stats;
+}
+
+double work_stealing_scheduler::get_elapsed_time() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time_).count();
+}
+
+void work_stealing_scheduler::print_stats(std::ostream& out_, const std::string& indent_) const {
+  const double elapsed = get_elapsed_time();
+  const std::vector<worker_stats> stats = get_worker_stats();
+  for (std::size_t iworker = 0; iworker < stats.size(); iworker++) {
+    const double utilisation = elapsed > 0.0 ? stats[iworker].busy_time / elapsed : 0.0;
+    out_ << indent_ << (iworker + 1 == stats.size() ? "`-- " : "|-- ") << "Worker #" << iworker
+         << " : tasks=" << stats[iworker].executed_tasks
+         << " stolen=" << stats[iworker].stolen_tasks << " busy=" << stats[iworker].busy_time
+         << " s utilisation=" << 100.0 * utilisation << " %" << std::endl;
+  }
+  return;
+}
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
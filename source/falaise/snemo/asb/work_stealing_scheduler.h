@@ -0,0 +1,158 @@
+// snemo/asb/work_stealing_scheduler.h
+// Author(s): F. Mauger <mauger@lpccaen.in2p3.fr>
+// Author(s): G. Oliviéro <goliviero@lpccaen.in2p3.fr>
+// Date: 2017-03-27
+
+#ifndef FALAISE_ASB_PLUGIN_SNEMO_ASB_WORK_STEALING_SCHEDULER_H
+#define FALAISE_ASB_PLUGIN_SNEMO_ASB_WORK_STEALING_SCHEDULER_H
+
+// Standard library:
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Third party:
+// - Boost:
+#include <boost/noncopyable.hpp>
+
+namespace snemo {
+
+namespace asb {
+
+/// \brief Task scheduler with per-worker deques and work stealing
+///
+/// Each worker owns a deque of tasks: it pushes and pops its own tasks at
+/// the back, while idle workers steal the oldest tasks at the front of the
+/// other deques. Tasks submitted from outside the workers go to a shared
+/// injection queue, served in submission order once a worker has no local
+/// task left. A task receives the index of the worker running it, so that
+/// it can use per-worker resources.
+///
+/// Tasks may be grouped: a worker waiting for the completion of a group
+/// helps by running the tasks of this group, wherever they are queued, and
+/// never starts unrelated work meanwhile. The first exception thrown by a
+/// task of a group is rethrown by the wait for this group.
+class work_stealing_scheduler : private boost::noncopyable {
+ public:
+  /// Task type
+  typedef std::function<void(std::size_t)> task_type;
+
+  /// \brief Group of tasks that can be waited for
+  class task_group : private boost::noncopyable {
+   public:
+    /// Return the number of pending tasks
+    std::size_t get_number_of_pending_tasks() const { return _pending_.load(); }
+
+   private:
+    friend class work_stealing_scheduler;
+    std::atomic<std::size_t> _pending_{0};
+    std::mutex _failure_mutex_;      //!< Protects the failure record
+    std::exception_ptr _failure_;    //!< First exception thrown by a task of the group
+  };
+
+  /// \brief Statistics of a worker
+  struct worker_stats {
+    std::size_t executed_tasks = 0;  //!< Number of executed tasks
+    std::size_t stolen_tasks = 0;    //!< Number of tasks stolen from other workers
+    double busy_time = 0.0;          //!< Time spent running tasks (in seconds)
+  };
+
+  /// Constructor
+  explicit work_stealing_scheduler(std::size_t number_of_workers_);
+
+  /// Destructor
+  ~work_stealing_scheduler();
+
+  /// Return the number of workers
+  std::size_t get_number_of_workers() const;
+
+  /// Start the workers
+  void start();
+
+  /// Run all pending tasks and stop the workers
+  ///
+  /// The first exception thrown by a task, if any, is rethrown here.
+  void stop();
+
+  /// Check if the workers are running
+  bool is_running() const;
+
+  /// Submit a task
+  void submit(const task_type& task_);
+
+  /// Submit a task in a group
+  void submit(task_group& group_, const task_type& task_);
+
+  /// Wait for the completion of all the tasks of a group
+  ///
+  /// The first exception thrown by a task of the group, if any, is rethrown here.
+  void wait(task_group& group_);
+
+  /// Return the index of the worker running the calling thread, or -1
+  int get_current_worker() const;
+
+  /// Return the statistics of the workers
+  std::vector<worker_stats> get_worker_stats() const;
+
+  /// Return the time elapsed since the start of the workers (in seconds)
+  double get_elapsed_time() const;
+
+  /// Print the statistics of the workers
+  void print_stats(std::ostream& out_ = std::clog, const std::string& indent_ = "") const;
+
+ private:
+  struct task_entry {
+    task_type task;
+    task_group* group = nullptr;
+  };
+
+  struct worker_type {
+    mutable std::mutex mutex;
+    std::deque<task_entry> tasks;
+    worker_stats stats;
+  };
+
+  void _push_(std::size_t worker_, task_entry&& entry_);
+  void _inject_(task_entry&& entry_);
+  bool _pop_local_(std::size_t worker_, task_entry& entry_);
+  bool _pop_injected_(task_entry& entry_);
+  bool _steal_(std::size_t thief_, task_entry& entry_);
+  bool _take_group_task_(std::size_t worker_, const task_group& group_, task_entry& entry_,
+                         bool& stolen_);
+  void _execute_(std::size_t worker_, task_entry& entry_, bool stolen_);
+  void _worker_loop_(std::size_t worker_);
+
+ private:
+  std::vector<std::unique_ptr<worker_type>> _workers_;  //!< Per-worker deques and statistics
+  std::vector<std::thread> _threads_;                   //!< Worker threads
+  std::mutex _wake_mutex_;                   //!< Protects the sleeping of idle workers
+  std::condition_variable _wake_;            //!< Wakes up idle workers
+  std::atomic<std::size_t> _queued_tasks_{0};  //!< Number of tasks waiting in the deques
+  std::mutex _injection_mutex_;              //!< Protects the injection queue
+  std::deque<task_entry> _injected_;         //!< Tasks submitted from outside the workers
+  bool _stopping_ = false;                   //!< Stop request
+  std::mutex _failure_mutex_;                //!< Protects the failure record
+  std::exception_ptr _failure_;              //!< First exception thrown by a task
+  std::chrono::steady_clock::time_point _start_time_;  //!< Start time of the workers
+};
+
+}  // end of namespace asb
+
+}  // end of namespace snemo
+
+#endif  // FALAISE_ASB_PLUGIN_SNEMO_ASB_WORK_STEALING_SCHEDULER_H
+
+// Local Variables: --
+// mode: c++ --
+// c-file-style: "gnu" --
+// tab-width: 2 --
+// End: --
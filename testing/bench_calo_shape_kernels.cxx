@@ -0,0 +1,229 @@
+// bench_calo_shape_kernels.cxx
+//
+// Benchmark of the calorimeter driver hit loop: the kernel specialized on a
+// shape policy against a reference driver reproducing the former dispatch
+// path (runtime mode test per call and string-keyed shape parameters). The
+// per-hit dumps of the former path are left out, as they would dominate
+// the timing. Not run by ctest.
+
+// Standard libraries :
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/utils.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/base_signal_generator_driver.h>
+#include <snemo/asb/calo_signal_generator_driver.h>
+
+// Reference driver with the former dispatch path of the calorimeter driver
+class reference_calo_driver : public snemo::asb::base_signal_generator_driver {
+ public:
+  enum mode_type { MODE_INVALID = 0, MODE_TRIANGLE = 1 };
+
+  reference_calo_driver() : snemo::asb::base_signal_generator_driver("reference_calo") {}
+
+  virtual ~reference_calo_driver() {}
+
+ protected:
+  virtual void _initialize(const datatools::properties &config_) {
+    if (config_.has_key("mode") && config_.fetch_string("mode") == "triangle") {
+      _mode_ = MODE_TRIANGLE;
+    }
+    return;
+  }
+
+  virtual void _reset() {
+    _mode_ = MODE_INVALID;
+    return;
+  }
+
+  virtual void _process(const mctools::simulated_data &sim_data_,
+                        mctools::signal::signal_data &sim_signal_data_) {
+    DT_THROW_IF(!is_initialized(), std::logic_error, "Driver is not initialized !");
+    DT_THROW_IF(_mode_ == MODE_INVALID, std::logic_error, "Driver mode is invalid !");
+    if (_mode_ == MODE_TRIANGLE) {
+      _process_triangle_mode_(sim_data_, sim_signal_data_);
+    }
+    return;
+  }
+
+  virtual void _tree_dump(std::ostream &, const std::string &, const std::string &, bool) const {
+    return;
+  }
+
+ private:
+  void _process_triangle_mode_(const mctools::simulated_data &sim_data_,
+                               mctools::signal::signal_data &sim_signal_data_) {
+    if (!sim_data_.has_step_hits("calo")) return;
+    const std::size_t number_of_calo_hits = sim_data_.get_number_of_step_hits("calo");
+    double event_time_ref;
+    datatools::invalidate(event_time_ref);
+    for (std::size_t ihit = 0; ihit < number_of_calo_hits; ihit++) {
+      const double signal_time = sim_data_.get_step_hit("calo", ihit).get_time_start();
+      if (!datatools::is_valid(event_time_ref) || signal_time < event_time_ref) {
+        event_time_ref = signal_time;
+      }
+    }
+    std::map<geomtools::geom_id, unsigned int> hits_per_gid;
+    std::vector<mctools::signal::base_signal> atomic_signals;
+    for (std::size_t ihit = 0; ihit < number_of_calo_hits; ihit++) {
+      const mctools::base_step_hit &hit = sim_data_.get_step_hit("calo", ihit);
+      hits_per_gid[hit.get_geom_id()]++;
+      mctools::signal::base_signal a_signal;
+      a_signal.set_hit_id(hit.get_hit_id());
+      a_signal.set_geom_id(hit.get_geom_id());
+      const double t0 = hit.get_time_start() - event_time_ref;
+      const double t1 = t0 + 8 * CLHEP::ns;
+      const double t2 = t1 + 70 * CLHEP::ns;
+      const double amplitude = hit.get_energy_deposit() / CLHEP::MeV * 0.3 * CLHEP::volt;
+      a_signal.set_category("calo");
+      a_signal.set_time_ref(event_time_ref);
+      a_signal.set_shape_type_id("mctools::signal::triangle_signal_shape");
+      a_signal.set_shape_string_parameter("polarity", "-");
+      a_signal.set_shape_real_parameter_with_explicit_unit("t0", t0, "ns");
+      a_signal.set_shape_real_parameter_with_explicit_unit("t1", t1, "ns");
+      a_signal.set_shape_real_parameter_with_explicit_unit("t2", t2, "ns");
+      a_signal.set_shape_real_parameter_with_explicit_unit("amplitude", amplitude, "V");
+      a_signal.initialize_simple();
+      atomic_signals.push_back(a_signal);
+    }
+    for (const auto &gid_hits : hits_per_gid) {
+      if (gid_hits.second == 1) {
+        for (const auto &atomic_signal : atomic_signals) {
+          if (atomic_signal.get_geom_id() == gid_hits.first) {
+            sim_signal_data_.add_signal("calo") = atomic_signal;
+          }
+        }
+      } else {
+        mctools::signal::base_signal &signal = sim_signal_data_.add_signal("calo");
+        signal.set_shape_type_id("mctools::signal::multi_signal_shape");
+      }
+    }
+    return;
+  }
+
+ private:
+  mode_type _mode_ = MODE_INVALID;
+};
+
+// Fill a simulated data with random calorimeter step hits
+void fill_calo_hits(mctools::simulated_data &sd_, std::size_t number_of_hits_,
+                    std::mt19937 &prng_) {
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> column(0, 19);
+  std::uniform_int_distribution<int> row(0, 12);
+  std::uniform_real_distribution<double> time(0.0, 50.0);
+  std::uniform_real_distribution<double> energy(0.01, 3.0);
+  sd_.add_step_hits("calo", number_of_hits_);
+  for (std::size_t ihit = 0; ihit < number_of_hits_; ihit++) {
+    mctools::base_step_hit &hit = sd_.add_step_hit("calo");
+    hit.set_hit_id(ihit);
+    hit.set_geom_id(geomtools::geom_id(1302, 0, side(prng_), column(prng_), row(prng_), 1));
+    hit.set_time_start(time(prng_) * CLHEP::ns);
+    hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+    hit.set_energy_deposit(energy(prng_) * CLHEP::MeV);
+  }
+  return;
+}
+
+// Return the time per hit of a driver over a set of events (in ns)
+double time_driver(snemo::asb::base_signal_generator_driver &driver_,
+                   const std::vector<mctools::simulated_data> &events_,
+                   std::size_t number_of_hits_, std::size_t &number_of_signals_) {
+  number_of_signals_ = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto &sd : events_) {
+    mctools::signal::signal_data ssd;
+    driver_.process(sd, ssd);
+    number_of_signals_ += ssd.get_number_of_signals("calo");
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  const double elapsed_ns = std::chrono::duration<double, std::nano>(stop - start).count();
+  return elapsed_ns / (events_.size() * number_of_hits_);
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::size_t number_of_events = 1000;
+    std::size_t number_of_hits = 50;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-n" || arg == "--number") {
+        number_of_events = std::atoi(argv_[++iarg]);
+      } else if (arg == "-H" || arg == "--hits") {
+        number_of_hits = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "calo");
+    driver_config.store("mode", "triangle");
+
+    snemo::asb::calo_signal_generator_driver policy_driver;
+    policy_driver.initialize(driver_config);
+    reference_calo_driver reference_driver;
+    reference_driver.initialize(driver_config);
+
+    std::mt19937 prng(314159);
+    std::vector<mctools::simulated_data> events(number_of_events);
+    for (auto &sd : events) {
+      fill_calo_hits(sd, number_of_hits, prng);
+    }
+
+    // Warm up, then alternate the two paths:
+    std::size_t reference_signals = 0;
+    std::size_t policy_signals = 0;
+    time_driver(reference_driver, events, number_of_hits, reference_signals);
+    time_driver(policy_driver, events, number_of_hits, policy_signals);
+    const double reference_ns = time_driver(reference_driver, events, number_of_hits,
+                                            reference_signals);
+    const double policy_ns = time_driver(policy_driver, events, number_of_hits, policy_signals);
+
+    std::clog << "Events            : " << number_of_events << std::endl;
+    std::clog << "Hits per event    : " << number_of_hits << std::endl;
+    std::clog << "Reference path    : " << reference_ns << " ns/hit (" << reference_signals
+              << " signals)" << std::endl;
+    std::clog << "Policy kernel     : " << policy_ns << " ns/hit (" << policy_signals
+              << " signals)" << std::endl;
+    std::clog << "Speed-up          : " << (policy_ns > 0.0 ? reference_ns / policy_ns : 0.0)
+              << std::endl;
+    DT_THROW_IF(reference_signals != policy_signals, std::logic_error,
+                "The two paths produce different numbers of signals!");
+
+    policy_driver.reset();
+    reference_driver.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
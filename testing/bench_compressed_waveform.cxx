@@ -0,0 +1,106 @@
+// bench_compressed_waveform.cxx
+//
+// Benchmark of the compressed waveform container on synthetic digitized
+// calorimeter pulses: compression ratios against doubles and raw ADC codes,
+// and decode throughput, for 12 and 14-bit ADCs with and without zero
+// suppression. Not run by ctest.
+
+// Standard libraries :
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/compressed_waveform.h>
+
+// Fill a waveform with baseline noise and a negative triangle pulse
+void fill_waveform(std::vector<uint16_t> &samples_, int baseline_, std::mt19937 &prng_) {
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::uniform_int_distribution<int> start(100, 800);
+  std::uniform_real_distribution<double> amplitude(50.0, 1500.0);
+  const int t0 = start(prng_);
+  const double a = amplitude(prng_);
+  for (std::size_t i = 0; i < samples_.size(); i++) {
+    const double t = static_cast<double>(i) - t0;
+    double value = baseline_ + noise(prng_);
+    if (t >= 0.0 && t < 10.0) {
+      value -= a * t / 10.0;
+    } else if (t >= 10.0 && t < 80.0) {
+      value -= a * (80.0 - t) / 70.0;
+    }
+    samples_[i] = static_cast<uint16_t>(std::lround(value));
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::size_t number_of_waveforms = 10000;
+    std::size_t number_of_samples = 1024;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-n" || arg == "--number") {
+        number_of_waveforms = std::atoi(argv_[++iarg]);
+      } else if (arg == "-S" || arg == "--samples") {
+        number_of_samples = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    std::clog << "Waveforms         : " << number_of_waveforms << std::endl;
+    std::clog << "Samples           : " << number_of_samples << std::endl;
+    for (const unsigned int adc_bits : {12u, 14u}) {
+      for (const unsigned int threshold : {0u, 3u}) {
+        const int baseline = 1 << (adc_bits - 1);
+        std::mt19937 prng(314159);
+        std::vector<uint16_t> samples(number_of_samples);
+        std::vector<uint16_t> decoded(number_of_samples);
+        snemo::asb::compressed_waveform waveform;
+        waveform.set_adc_bits(adc_bits);
+        waveform.set_threshold(threshold);
+        std::size_t compressed_size = 0;
+        double decode_time = 0.0;
+        for (std::size_t iwf = 0; iwf < number_of_waveforms; iwf++) {
+          fill_waveform(samples, baseline, prng);
+          waveform.encode(samples, baseline);
+          compressed_size += waveform.get_compressed_size();
+          const auto start = std::chrono::steady_clock::now();
+          waveform.decode(decoded);
+          decode_time +=
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        const double total_samples = static_cast<double>(number_of_waveforms) * number_of_samples;
+        std::clog << "ADC bits=" << adc_bits << " threshold=" << threshold << " :" << std::endl;
+        std::clog << "  Ratio vs. doubles : " << total_samples * sizeof(double) / compressed_size
+                  << std::endl;
+        std::clog << "  Ratio vs. codes   : " << total_samples * sizeof(uint16_t) / compressed_size
+                  << std::endl;
+        std::clog << "  Decode throughput : " << total_samples / decode_time / 1.0e6
+                  << " Msamples/s" << std::endl;
+      }
+    }
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
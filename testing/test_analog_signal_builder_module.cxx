@@ -0,0 +1,382 @@
+// test_analog_signal_builder_module.cxx
+// Standard libraries :
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/io_factory.h>
+#include <datatools/properties.h>
+#include <datatools/service_manager.h>
+#include <datatools/things.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/dpp:
+#include <dpp/input_module.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/analog_signal_builder_module.h>
+
+// Return the text serialization of a signal data bank
+std::string serialize(const mctools::signal::signal_data &ssd_, const std::string &filename_) {
+  {
+    datatools::data_writer writer(filename_, datatools::using_multi_archives);
+    writer.store(ssd_);
+  }
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  DT_THROW_IF(!in, std::runtime_error, "Cannot open file '" << filename_ << "'!");
+  const std::string content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  std::remove(filename_.c_str());
+  return content;
+}
+
+// Return the configuration of a module with a calorimeter and a scintillator driver
+datatools::properties make_module_config() {
+  datatools::properties module_config;
+  module_config.store("logging.priority", "fatal");
+  std::vector<std::string> drivers = {"calo", "scin"};
+  module_config.store("drivers", drivers);
+  module_config.store("driver.calo.type_id", "snemo::asb::calo_signal_generator_driver");
+  module_config.store("driver.calo.config.signal_category", "calo");
+  module_config.store("driver.calo.config.mode", "triangle");
+  module_config.store("driver.scin.type_id", "snemo::asb::scin_signal_generator_driver");
+  module_config.store("driver.scin.config.signal_category", "scin");
+  std::vector<std::string> scin_categories = {"xcalo", "gveto"};
+  module_config.store("driver.scin.config.categories", scin_categories);
+  module_config.store("driver.scin.config.mode", "triangle");
+  return module_config;
+}
+
+// Add a step hit to a simulated data
+void add_hit(mctools::simulated_data &sd_, const std::string &category_, int hit_id_,
+             const geomtools::geom_id &gid_, double time_, double energy_) {
+  mctools::base_step_hit &hit = sd_.add_step_hit(category_);
+  hit.set_hit_id(hit_id_);
+  hit.set_geom_id(gid_);
+  hit.set_time_start(time_);
+  hit.set_time_stop(time_ + 1.0 * CLHEP::ns);
+  hit.set_energy_deposit(energy_);
+  return;
+}
+
+// Mark all the signals of a category, and check if they are all marked
+void mark_signals(mctools::signal::signal_data &ssd_, const std::string &category_) {
+  for (auto &signal : ssd_.grab_signals(category_)) {
+    datatools::properties &aux = signal.grab().grab_auxiliaries();
+    if (!aux.has_flag("test.marker")) aux.store_flag("test.marker");
+  }
+  return;
+}
+
+bool are_marked(const mctools::signal::signal_data &ssd_, const std::string &category_) {
+  if (!ssd_.has_signals(category_) || ssd_.get_number_of_signals(category_) == 0) return false;
+  for (std::size_t isig = 0; isig < ssd_.get_number_of_signals(category_); isig++) {
+    if (!ssd_.get_signal(category_, isig).get_auxiliaries().has_flag("test.marker")) return false;
+  }
+  return true;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::analog_signal_builder_module'!"
+              << std::endl;
+
+    std::string geometry_config_filename =
+        "@falaise:config/snemo/demonstrator/geometry/4.0/manager.conf";
+    std::string input_filename;
+    if (std::getenv("FALAISE_ASB_TESTING_DIR") != nullptr) {
+      input_filename = std::string(std::getenv("FALAISE_ASB_TESTING_DIR")) +
+                       "/data/Se82_0nubb-source_strips_bulk_SD_10_events.brio";
+    }
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-g" || arg == "--geometry") {
+        geometry_config_filename = argv_[++iarg];
+      } else if (arg == "-i" || arg == "--input") {
+        input_filename = argv_[++iarg];
+      }
+      iarg++;
+    }
+    DT_THROW_IF(input_filename.empty(), std::logic_error, "Missing input file!");
+
+    datatools::service_manager services("ASBServices", "Services of the ASB test");
+    datatools::properties geometry_service_config;
+    geometry_service_config.store("manager.configuration_file", geometry_config_filename);
+    services.load("geometry", "geomtools::geometry_service", geometry_service_config);
+    services.initialize();
+
+    char root_template[] = "/tmp/test_analog_signal_builder_module.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    const std::string bank_filename = root + "/bank.xml";
+
+    // Readers of the input records:
+    datatools::properties reader_config;
+    reader_config.store("logging.priority", "fatal");
+    reader_config.store("files.mode", "single");
+    reader_config.store("files.single.filename", input_filename);
+
+    const datatools::properties module_config = make_module_config();
+    dpp::module_handle_dict_type no_modules;
+
+    // Executor: the output bank is the one of the sequential processing,
+    // whatever the scheduling of the per-driver jobs:
+    {
+      snemo::asb::analog_signal_builder_module serial_module;
+      serial_module.initialize(module_config, services, no_modules);
+      snemo::asb::analog_signal_builder_module executor_module;
+      executor_module.initialize(module_config, services, no_modules);
+      executor_module.set_driver_executor(
+          [](const mctools::simulated_data &, std::vector<std::function<void()>> &jobs_) {
+            // Concurrent jobs, started in reverse order:
+            std::vector<std::thread> threads;
+            for (auto job = jobs_.rbegin(); job != jobs_.rend(); job++) {
+              threads.emplace_back(*job);
+            }
+            for (auto &thread : threads) {
+              thread.join();
+            }
+            return;
+          });
+      dpp::input_module serial_reader;
+      serial_reader.initialize_standalone(reader_config);
+      dpp::input_module executor_reader;
+      executor_reader.initialize_standalone(reader_config);
+      std::size_t number_of_banks = 0;
+      for (int irecord = 0; !serial_reader.is_terminated(); irecord++) {
+        datatools::things serial_record;
+        datatools::things executor_record;
+        if (serial_reader.process(serial_record) != dpp::base_module::PROCESS_OK ||
+            executor_reader.process(executor_record) != dpp::base_module::PROCESS_OK) {
+          break;
+        }
+        DT_THROW_IF(serial_module.process(serial_record) != dpp::base_module::PROCESS_OK ||
+                        executor_module.process(executor_record) != dpp::base_module::PROCESS_OK,
+                    std::logic_error, "Cannot process record #" << irecord << "!");
+        const std::string &ssd_label = serial_module.get_ssd_label();
+        DT_THROW_IF(serial_record.has(ssd_label) != executor_record.has(ssd_label),
+                    std::logic_error, "Output banks differ in record #" << irecord << "!");
+        if (!serial_record.has(ssd_label)) continue;
+        DT_THROW_IF(serialize(serial_record.get<mctools::signal::signal_data>(ssd_label),
+                              bank_filename) !=
+                        serialize(executor_record.get<mctools::signal::signal_data>(ssd_label),
+                                  bank_filename),
+                    std::logic_error,
+                    "Executor and sequential banks differ in record #" << irecord << "!");
+        number_of_banks++;
+      }
+      serial_reader.reset();
+      executor_reader.reset();
+      DT_THROW_IF(number_of_banks == 0, std::logic_error, "No output bank!");
+      std::clog << "Compared banks    : " << number_of_banks << std::endl;
+      serial_module.reset();
+      executor_module.reset();
+    }
+
+    // Stream mode: the frames span several events, and the flush emits the
+    // frames still open after the last event. All the signals of the
+    // per-event processing are emitted exactly once:
+    {
+      snemo::asb::analog_signal_builder_module event_module;
+      event_module.initialize(module_config, services, no_modules);
+      datatools::properties stream_config = module_config;
+      stream_config.store_boolean("stream_mode", true);
+      stream_config.store_real_with_explicit_unit("stream.window", 1.0 * CLHEP::microsecond);
+      stream_config.set_unit_symbol("stream.window", "us");
+      stream_config.store_real_with_explicit_unit("stream.event_period", 250.0 * CLHEP::ns);
+      stream_config.set_unit_symbol("stream.event_period", "ns");
+      stream_config.store_boolean("stream.random_spacing", false);
+      snemo::asb::analog_signal_builder_module stream_module;
+      stream_module.initialize(stream_config, services, no_modules);
+      const std::string &ssd_label = stream_module.get_ssd_label();
+      // Number of signals in a bank; in stream mode, a frame is emitted once,
+      // after the former ones:
+      auto count_signals = [&ssd_label](const datatools::things &record_, double *last_frame_) {
+        std::size_t number_of_signals = 0;
+        if (!record_.has(ssd_label)) return number_of_signals;
+        const auto &ssd = record_.get<mctools::signal::signal_data>(ssd_label);
+        const double former_frame = last_frame_ != nullptr ? *last_frame_ : 0.0;
+        std::vector<std::string> categories;
+        ssd.build_list_of_categories(categories);
+        for (const auto &category : categories) {
+          const std::size_t number_of_category_signals = ssd.get_number_of_signals(category);
+          for (std::size_t isig = 0; isig < number_of_category_signals; isig++) {
+            number_of_signals++;
+            if (last_frame_ == nullptr) continue;
+            const datatools::properties &aux = ssd.get_signal(category, isig).get_auxiliaries();
+            const double frame = aux.fetch_real("asb.stream.frame");
+            DT_THROW_IF(frame <= former_frame, std::logic_error,
+                        "Frame " << frame << " emitted after frame " << former_frame << "!");
+            *last_frame_ = std::max(*last_frame_, frame);
+          }
+        }
+        return number_of_signals;
+      };
+      dpp::input_module event_reader;
+      event_reader.initialize_standalone(reader_config);
+      dpp::input_module stream_reader;
+      stream_reader.initialize_standalone(reader_config);
+      std::size_t event_signals = 0;
+      std::size_t streamed_signals = 0;
+      std::size_t buffered_records = 0;
+      double last_frame = -1.0;
+      for (int irecord = 0; !event_reader.is_terminated(); irecord++) {
+        datatools::things event_record;
+        datatools::things stream_record;
+        if (event_reader.process(event_record) != dpp::base_module::PROCESS_OK ||
+            stream_reader.process(stream_record) != dpp::base_module::PROCESS_OK) {
+          break;
+        }
+        DT_THROW_IF(event_module.process(event_record) != dpp::base_module::PROCESS_OK ||
+                        stream_module.process(stream_record) != dpp::base_module::PROCESS_OK,
+                    std::logic_error, "Cannot process record #" << irecord << "!");
+        event_signals += count_signals(event_record, nullptr);
+        streamed_signals += count_signals(stream_record, &last_frame);
+        if (stream_module.get_stream_buffer().get_number_of_pulses() > 0) {
+          buffered_records++;
+        }
+      }
+      event_reader.reset();
+      stream_reader.reset();
+      DT_THROW_IF(buffered_records == 0, std::logic_error, "No frame spans several events!");
+      DT_THROW_IF(stream_module.get_stream_buffer().get_number_of_pulses() == 0,
+                  std::logic_error, "No open frame after the last event!");
+      datatools::things final_record;
+      const std::size_t flushed_signals = stream_module.flush_stream(final_record);
+      DT_THROW_IF(flushed_signals == 0 ||
+                      count_signals(final_record, &last_frame) != flushed_signals,
+                  std::logic_error, "Wrong final record!");
+      DT_THROW_IF(stream_module.get_stream_buffer().get_number_of_pulses() != 0,
+                  std::logic_error, "Open frames after the flush!");
+      DT_THROW_IF(streamed_signals + flushed_signals != event_signals, std::logic_error,
+                  "Streamed " << streamed_signals << "+" << flushed_signals
+                              << " signals instead of " << event_signals << "!");
+      std::clog << "Streamed signals  : " << streamed_signals << " + " << flushed_signals
+                << " flushed" << std::endl;
+      event_module.reset();
+      stream_module.reset();
+    }
+
+    // Incremental mode: a record is processed, then reprocessed by modules
+    // with other configurations. The signals are marked after each pass, so
+    // that the rerun drivers are those whose signals lost their mark:
+    {
+      datatools::things record;
+      mctools::simulated_data &sd = record.add<mctools::simulated_data>("SD");
+      sd.add_step_hits("calo", 2);
+      sd.add_step_hits("gveto", 1);
+      add_hit(sd, "calo", 0, geomtools::geom_id(1302, 0, 1, 4, 7, 1), 20.0 * CLHEP::ns,
+              1.0 * CLHEP::MeV);
+      add_hit(sd, "calo", 1, geomtools::geom_id(1302, 0, 0, 2, 3, 1), 10.0 * CLHEP::ns,
+              0.5 * CLHEP::MeV);
+      add_hit(sd, "gveto", 0, geomtools::geom_id(1252, 0, 1, 0, 5, 1), 15.0 * CLHEP::ns,
+              0.3 * CLHEP::MeV);
+      datatools::properties incremental_config = module_config;
+      incremental_config.store_boolean("incremental_mode", true);
+      std::string ssd_label;
+      auto reprocess = [&](const datatools::properties &config_) -> mctools::signal::signal_data & {
+        snemo::asb::analog_signal_builder_module module;
+        module.initialize(config_, services, no_modules);
+        DT_THROW_IF(module.process(record) != dpp::base_module::PROCESS_OK, std::logic_error,
+                    "Cannot process the incremental record!");
+        ssd_label = module.get_ssd_label();
+        module.reset();
+        return record.grab<mctools::signal::signal_data>(ssd_label);
+      };
+      auto mark_all = [](mctools::signal::signal_data &ssd_) {
+        mark_signals(ssd_, "calo");
+        mark_signals(ssd_, "gveto");
+        return;
+      };
+
+      // First pass:
+      mctools::signal::signal_data &ssd = reprocess(incremental_config);
+      DT_THROW_IF(ssd.get_number_of_signals("calo") != 2 ||
+                      ssd.get_number_of_signals("gveto") != 1,
+                  std::logic_error, "Wrong first incremental pass!");
+      const std::string calo_hash_key = "asb.driver.calo.config_hash";
+      const std::string calo_hash = ssd.get_auxiliaries().fetch_string(calo_hash_key);
+      DT_THROW_IF(!ssd.get_auxiliaries().has_key("asb.driver.scin.config_hash"),
+                  std::logic_error, "Missing digests of the scin driver!");
+      mark_all(ssd);
+
+      // Unchanged configuration: no driver is rerun:
+      reprocess(incremental_config);
+      DT_THROW_IF(!are_marked(ssd, "calo") || !are_marked(ssd, "gveto"), std::logic_error,
+                  "Unchanged drivers were rerun!");
+
+      // Logging-only changes: no driver is rerun either:
+      datatools::properties logging_config = incremental_config;
+      logging_config.update_string("logging.priority", "error");
+      logging_config.store_string("driver.calo.config.logging.priority", "error");
+      reprocess(logging_config);
+      DT_THROW_IF(!are_marked(ssd, "calo") || !are_marked(ssd, "gveto"), std::logic_error,
+                  "Drivers were rerun after a logging change!");
+
+      // One driver changed: only its categories are replaced:
+      datatools::properties changed_config = incremental_config;
+      changed_config.store_real_with_explicit_unit("driver.calo.config.rise_time",
+                                                   9.0 * CLHEP::ns);
+      changed_config.set_unit_symbol("driver.calo.config.rise_time", "ns");
+      reprocess(changed_config);
+      DT_THROW_IF(are_marked(ssd, "calo") || ssd.get_number_of_signals("calo") != 2,
+                  std::logic_error, "The changed driver was not rerun!");
+      DT_THROW_IF(!are_marked(ssd, "gveto"), std::logic_error,
+                  "An unchanged driver was rerun!");
+      DT_THROW_IF(ssd.get_auxiliaries().fetch_string(calo_hash_key) == calo_hash,
+                  std::logic_error, "Digest of the changed driver was not updated!");
+      mark_all(ssd);
+
+      // One driver removed: its output and digests are dropped:
+      datatools::properties removed_config = changed_config;
+      removed_config.erase("drivers");
+      removed_config.store("drivers", std::vector<std::string>{"calo"});
+      removed_config.erase_all_starting_with("driver.scin.");
+      reprocess(removed_config);
+      DT_THROW_IF(ssd.has_signals("gveto") && ssd.get_number_of_signals("gveto") != 0,
+                  std::logic_error, "Output of the removed driver was kept!");
+      std::vector<std::string> scin_keys;
+      ssd.get_auxiliaries().keys_starting_with(scin_keys, "asb.driver.scin.");
+      DT_THROW_IF(!scin_keys.empty(), std::logic_error,
+                  "Digests of the removed driver were kept!");
+      DT_THROW_IF(!are_marked(ssd, "calo"), std::logic_error, "The remaining driver was rerun!");
+      std::clog << "Incremental passes: checked" << std::endl;
+    }
+
+    ::rmdir(root.c_str());
+    services.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
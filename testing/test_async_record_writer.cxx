@@ -0,0 +1,113 @@
+// test_async_record_writer.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/things.h>
+// - Bayeux/dpp:
+#include <dpp/input_module.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/async_record_writer.h>
+
+// Return a new record tagged with an index
+std::unique_ptr<datatools::things> make_record(int index_) {
+  std::unique_ptr<datatools::things> record(new datatools::things);
+  datatools::properties &bank = record->add<datatools::properties>("Test");
+  bank.store_integer("index", index_);
+  return record;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::async_record_writer'!" << std::endl;
+
+    char root_template[] = "/tmp/test_async_record_writer.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    const std::string filename = root + "/records.xml";
+
+    // Double-buffer handoff: two full buffers, then a partial one at close:
+    const int number_of_records = 10;
+    snemo::asb::async_record_writer writer;
+    writer.set_buffer_capacity(4);
+    writer.open(filename);
+    for (int irecord = 0; irecord < number_of_records; irecord++) {
+      writer.write(make_record(irecord));
+    }
+    writer.close();
+    const snemo::asb::async_record_writer::stats_type stats = writer.get_stats();
+    DT_THROW_IF(writer.is_open(), std::logic_error, "Writer is still open!");
+    DT_THROW_IF(stats.written_records != static_cast<std::size_t>(number_of_records),
+                std::logic_error,
+                "Wrong number of written records: " << stats.written_records << "!");
+    DT_THROW_IF(stats.flushed_buffers != 3, std::logic_error,
+                "Wrong number of flushed buffers: " << stats.flushed_buffers << "!");
+
+    // All the records are written once, in order:
+    dpp::input_module reader;
+    datatools::properties reader_config;
+    reader_config.store("logging.priority", "fatal");
+    reader_config.store("files.mode", "single");
+    reader_config.store("files.single.filename", filename);
+    reader.initialize_standalone(reader_config);
+    int read_records = 0;
+    while (!reader.is_terminated()) {
+      datatools::things record;
+      if (reader.process(record) != dpp::base_module::PROCESS_OK) break;
+      const int index = record.get<datatools::properties>("Test").fetch_integer("index");
+      DT_THROW_IF(index != read_records, std::logic_error,
+                  "Record #" << index << " read at position " << read_records << "!");
+      read_records++;
+    }
+    reader.reset();
+    DT_THROW_IF(read_records != number_of_records, std::logic_error,
+                "Wrong number of read records: " << read_records << "!");
+
+    // A write failure reaches the producer, and failed records are not counted:
+    snemo::asb::async_record_writer failing_writer;
+    failing_writer.set_buffer_capacity(2);
+    bool failed = false;
+    try {
+      failing_writer.open(root + "/missing/records.xml");
+      for (int irecord = 0; irecord < number_of_records; irecord++) {
+        failing_writer.write(make_record(irecord));
+      }
+      failing_writer.close();
+    } catch (std::exception &expected) {
+      std::clog << "Expected failure: " << expected.what() << std::endl;
+      failed = true;
+    }
+    DT_THROW_IF(!failed, std::logic_error, "Write failure was not propagated!");
+    DT_THROW_IF(failing_writer.get_stats().written_records != 0, std::logic_error,
+                "Failed records were counted as written!");
+
+    std::remove(filename.c_str());
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
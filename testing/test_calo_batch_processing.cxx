@@ -0,0 +1,198 @@
+// test_calo_batch_processing.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/io_factory.h>
+#include <datatools/properties.h>
+#include <datatools/things.h>
+// - Bayeux/dpp:
+#include <dpp/input_module.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/calo_signal_generator_driver.h>
+
+// Return the text serialization of a signal data bank
+std::string serialize(const mctools::signal::signal_data &ssd_, const std::string &filename_) {
+  {
+    datatools::data_writer writer(filename_, datatools::using_multi_archives);
+    writer.store(ssd_);
+  }
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  DT_THROW_IF(!in, std::runtime_error, "Cannot open file '" << filename_ << "'!");
+  const std::string content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  std::remove(filename_.c_str());
+  return content;
+}
+
+// Calorimeter driver holding its batches until they are released
+class held_calo_driver : public snemo::asb::calo_signal_generator_driver {
+ public:
+  std::promise<void> entered;       //!< Set once a batch is being processed
+  std::promise<void> release;       //!< Set to let the batch go on
+
+ protected:
+  void _process_batch(const std::vector<const mctools::simulated_data *> &sim_data_batch_,
+                      const std::vector<mctools::signal::signal_data *> &sim_signal_data_batch_) {
+    entered.set_value();
+    release.get_future().wait();
+    calo_signal_generator_driver::_process_batch(sim_data_batch_, sim_signal_data_batch_);
+    return;
+  }
+};
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for the batch processing of "
+              << "'snemo::asb::calo_signal_generator_driver'!" << std::endl;
+
+    std::string input_filename;
+    if (std::getenv("FALAISE_ASB_TESTING_DIR") != nullptr) {
+      input_filename = std::string(std::getenv("FALAISE_ASB_TESTING_DIR")) +
+                       "/data/Se82_0nubb-source_strips_bulk_SD_10_events.brio";
+    }
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-i" || arg == "--input") {
+        input_filename = argv_[++iarg];
+      }
+      iarg++;
+    }
+    DT_THROW_IF(input_filename.empty(), std::logic_error, "Missing input file!");
+
+    char root_template[] = "/tmp/test_calo_batch_processing.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    const std::string bank_filename = root + "/bank.xml";
+
+    // Simulated data of all the input records:
+    std::vector<std::unique_ptr<datatools::things>> records;
+    std::vector<const mctools::simulated_data *> sim_data_batch;
+    {
+      datatools::properties reader_config;
+      reader_config.store("logging.priority", "fatal");
+      reader_config.store("files.mode", "single");
+      reader_config.store("files.single.filename", input_filename);
+      dpp::input_module reader;
+      reader.initialize_standalone(reader_config);
+      while (!reader.is_terminated()) {
+        std::unique_ptr<datatools::things> record(new datatools::things);
+        if (reader.process(*record) != dpp::base_module::PROCESS_OK) break;
+        if (!record->has("SD")) continue;
+        sim_data_batch.push_back(&record->get<mctools::simulated_data>("SD"));
+        records.push_back(std::move(record));
+      }
+      reader.reset();
+    }
+    DT_THROW_IF(sim_data_batch.empty(), std::logic_error, "No simulated data!");
+
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "calo");
+    driver_config.store("mode", "triangle");
+
+    // Per-event processing:
+    snemo::asb::calo_signal_generator_driver event_driver;
+    event_driver.initialize(driver_config);
+    std::vector<mctools::signal::signal_data> event_banks(sim_data_batch.size());
+    for (std::size_t ievent = 0; ievent < sim_data_batch.size(); ievent++) {
+      event_driver.process(*sim_data_batch[ievent], event_banks[ievent]);
+    }
+    event_driver.reset();
+
+    // Batch processing, held while other calls are attempted from another thread:
+    held_calo_driver batch_driver;
+    batch_driver.initialize(driver_config);
+    std::vector<mctools::signal::signal_data> batch_banks(sim_data_batch.size());
+    std::vector<mctools::signal::signal_data *> sim_signal_data_batch;
+    for (auto &bank : batch_banks) {
+      sim_signal_data_batch.push_back(&bank);
+    }
+    std::exception_ptr batch_failure;
+    std::thread batch_thread([&]() {
+      try {
+        batch_driver.process_batch(sim_data_batch, sim_signal_data_batch);
+      } catch (...) {
+        batch_failure = std::current_exception();
+      }
+    });
+    batch_driver.entered.get_future().wait();
+    std::size_t rejected_calls = 0;
+    try {
+      mctools::signal::signal_data concurrent_bank;
+      batch_driver.process(*sim_data_batch.front(), concurrent_bank);
+    } catch (std::logic_error &error) {
+      std::clog << "Rejected call: " << error.what() << std::endl;
+      rejected_calls++;
+    }
+    try {
+      mctools::signal::signal_data concurrent_bank;
+      std::vector<mctools::signal::signal_data *> concurrent_batch = {&concurrent_bank};
+      batch_driver.process_batch({sim_data_batch.front()}, concurrent_batch);
+    } catch (std::logic_error &error) {
+      std::clog << "Rejected batch: " << error.what() << std::endl;
+      rejected_calls++;
+    }
+    batch_driver.release.set_value();
+    batch_thread.join();
+    if (batch_failure) {
+      std::rethrow_exception(batch_failure);
+    }
+    DT_THROW_IF(rejected_calls != 2, std::logic_error,
+                "Concurrent calls were accepted during a batch!");
+
+    // The batch gives the banks of the per-event processing:
+    std::size_t number_of_signals = 0;
+    for (std::size_t ievent = 0; ievent < sim_data_batch.size(); ievent++) {
+      DT_THROW_IF(serialize(batch_banks[ievent], bank_filename) !=
+                      serialize(event_banks[ievent], bank_filename),
+                  std::logic_error, "Batch and per-event banks differ in event #" << ievent << "!");
+      if (event_banks[ievent].has_signals("calo")) {
+        number_of_signals += event_banks[ievent].get_number_of_signals("calo");
+      }
+    }
+    DT_THROW_IF(number_of_signals == 0, std::logic_error, "No calorimeter signal!");
+    std::clog << "Compared events   : " << sim_data_batch.size() << " (" << number_of_signals
+              << " signals)" << std::endl;
+
+    // The driver accepts calls again once the batch is done:
+    mctools::signal::signal_data last_bank;
+    batch_driver.process(*sim_data_batch.front(), last_bank);
+    batch_driver.reset();
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,154 @@
+// test_calo_shape_kernels.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/calo_signal_generator_driver.h>
+#include <snemo/asb/utils.h>
+
+// Fill a simulated data with random calorimeter step hits
+void fill_calo_hits(mctools::simulated_data &sd_, std::size_t number_of_hits_,
+                    std::mt19937 &prng_) {
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> column(0, 19);
+  std::uniform_int_distribution<int> row(0, 12);
+  std::uniform_real_distribution<double> time(0.0, 50.0);
+  std::uniform_real_distribution<double> energy(0.01, 3.0);
+  sd_.add_step_hits("calo", number_of_hits_);
+  for (std::size_t ihit = 0; ihit < number_of_hits_; ihit++) {
+    mctools::base_step_hit &hit = sd_.add_step_hit("calo");
+    hit.set_hit_id(ihit);
+    hit.set_geom_id(geomtools::geom_id(1302, 0, side(prng_), column(prng_), row(prng_), 1));
+    hit.set_time_start(time(prng_) * CLHEP::ns);
+    hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+    hit.set_energy_deposit(energy(prng_) * CLHEP::MeV);
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for the hit loop kernels of class "
+                 "'snemo::asb::calo_signal_generator_driver'!"
+              << std::endl;
+
+    std::size_t number_of_events = 50;
+    std::size_t number_of_hits = 50;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-n" || arg == "--number") {
+        number_of_events = std::atoi(argv_[++iarg]);
+      } else if (arg == "-H" || arg == "--hits") {
+        number_of_hits = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "calo");
+    driver_config.store("mode", "triangle");
+
+    snemo::asb::calo_signal_generator_driver csgd;
+    csgd.initialize(driver_config);
+
+    std::mt19937 prng(314159);
+    std::vector<mctools::simulated_data> events(number_of_events);
+    for (auto &sd : events) {
+      fill_calo_hits(sd, number_of_hits, prng);
+    }
+
+    // Timings against the former dispatch path: see bench_calo_shape_kernels.
+    std::size_t number_of_signals = 0;
+    for (const auto &sd : events) {
+      mctools::signal::signal_data ssd;
+      csgd.process(sd, ssd);
+      number_of_signals += ssd.get_number_of_signals("calo");
+    }
+
+    std::clog << "Processed events  : " << number_of_events << std::endl;
+    std::clog << "Hits per event    : " << number_of_hits << std::endl;
+    std::clog << "Output signals    : " << number_of_signals << std::endl;
+
+    DT_THROW_IF(number_of_signals == 0, std::logic_error, "No signal was produced!");
+
+    // An event without calorimeter hits is filtered out and produces no signal:
+    mctools::simulated_data empty_sd;
+    mctools::signal::signal_data empty_ssd;
+    DT_THROW_IF(csgd.has_input(empty_sd), std::logic_error, "Empty event has some input!");
+    csgd.process(empty_sd, empty_ssd);
+    DT_THROW_IF(empty_ssd.has_signals("calo"), std::logic_error,
+                "Empty event produced some signals!");
+
+    // Hits whose GID cannot be packed are grouped by GID comparison:
+    mctools::simulated_data unpacked_sd;
+    unpacked_sd.add_step_hits("calo", 3);
+    const uint32_t unpacked_columns[3] = {300, 1, 300};
+    for (int ihit = 0; ihit < 3; ihit++) {
+      mctools::base_step_hit &hit = unpacked_sd.add_step_hit("calo");
+      hit.set_hit_id(ihit);
+      hit.set_geom_id(geomtools::geom_id(1302, 0, 0, unpacked_columns[ihit], 3, 1));
+      hit.set_time_start(ihit * 10.0 * CLHEP::ns);
+      hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+      hit.set_energy_deposit(1.0 * CLHEP::MeV);
+    }
+    for (int degraded = 0; degraded < 2; degraded++) {
+      csgd.set_degraded_mode(degraded == 1);
+      mctools::signal::signal_data unpacked_ssd;
+      csgd.process(unpacked_sd, unpacked_ssd);
+      DT_THROW_IF(unpacked_ssd.get_number_of_signals("calo") != 2, std::logic_error,
+                  "Wrong grouping of hits with unpacked GIDs!");
+    }
+    csgd.set_degraded_mode(false);
+
+    // Degraded mode: one aggregated signal per channel, no multi signal:
+    DT_THROW_IF(!csgd.has_degraded_mode(), std::logic_error, "No degraded mode!");
+    csgd.set_degraded_mode(true);
+    mctools::signal::signal_data degraded_ssd;
+    csgd.process(events.front(), degraded_ssd);
+    csgd.set_degraded_mode(false);
+    mctools::signal::signal_data full_ssd;
+    csgd.process(events.front(), full_ssd);
+    DT_THROW_IF(degraded_ssd.get_number_of_signals("calo") != full_ssd.get_number_of_signals("calo"),
+                std::logic_error, "Degraded mode changed the number of channels!");
+    for (const auto &signal : degraded_ssd.get_signals("calo")) {
+      DT_THROW_IF(signal.get().get_shape_type_id() == "mctools::signal::multi_signal_shape",
+                  std::logic_error, "Degraded mode produced a multi signal!");
+    }
+    std::clog << "Degraded bank     : " << snemo::asb::signal_utils::estimate_memory(degraded_ssd)
+              << " bytes (full: " << snemo::asb::signal_utils::estimate_memory(full_ssd) << ")"
+              << std::endl;
+
+    csgd.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
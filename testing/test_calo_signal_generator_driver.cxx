@@ -8,7 +8,9 @@
 
 // - Bayeux/datatools:
 #include <datatools/clhep_units.h>
+#include <datatools/exception.h>
 #include <datatools/io_factory.h>
+#include <datatools/properties.h>
 #include <datatools/temporary_files.h>
 #include <datatools/utils.h>
 // - Bayeux/mctools:
@@ -19,6 +21,7 @@
 #include <dpp/output_module.h>
 #include <mygsl/parameter_store.h>
 // - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
 #include <geomtools/geomtools_config.h>
 #include <geomtools/gnuplot_draw.h>
 #if GEOMTOOLS_WITH_GNUPLOT_DISPLAY == 1
@@ -31,6 +34,7 @@
 
 // This project :
 #include <snemo/asb/calo_signal_generator_driver.h>
+#include <snemo/asb/shape_factory.h>
 
 int main(int argc_, char **argv_) {
   falaise::initialize(argc_, argv_);
@@ -111,9 +115,13 @@ int main(int argc_, char **argv_) {
     ssb_1.initialize_simple();
     // ssb_1.tree_dump(std::clog, "My signal shape builder 1");
 
-    // shape builder 2 : configuration by file.conf
-    mctools::signal::signal_shape_builder ssb_2;
-    ssb_2.initialize(calo_signal_shape_builder_prop);
+    // shape builder 2 : configuration by file.conf, shared functors
+    datatools::properties shape_factory_prop;
+    shape_factory_prop.store_integer("capacity", 1024);
+    calo_signal_shape_builder_prop.export_all_adding_prefix(shape_factory_prop, "builder.");
+    snemo::asb::shape_factory sf_2;
+    sf_2.initialize(shape_factory_prop);
+    const mctools::signal::signal_shape_builder &ssb_2 = sf_2.get_builder();
     ssb_2.tree_dump(std::clog, "My signal shape builder 2");
 
     while (!reader.is_terminated()) {
@@ -144,8 +152,9 @@ int main(int argc_, char **argv_) {
                 "Event_" + std::to_string(psd_count) + "_Signal_" + std::to_string(isignal);
             // ssb_1.create_signal_shape(unique_signal_key,
             // "mctools::signal::triangle_signal_shape", signal_shape_properties);
-            ssb_2.create_signal_shape(unique_signal_key, "mctools::signal::triangle_signal_shape",
-                                      signal_shape_properties);
+            if (my_signal.get_shape_type_id() == "mctools::signal::triangle_signal_shape") {
+              sf_2.get_shape("mctools::signal::triangle_signal_shape", signal_shape_properties);
+            }
             my_signal.tree_dump(std::clog, unique_signal_key);
           }
 
@@ -228,6 +237,37 @@ int main(int argc_, char **argv_) {
     }  // end of reader is terminated
 
     DT_LOG_NOTICE(logging, "Reader is terminated");
+    std::clog << "Shared shape functors : " << sf_2.get_size() << " (hits=" << sf_2.get_stats().hits
+              << ", misses=" << sf_2.get_stats().misses
+              << ", flushes=" << sf_2.get_stats().flushes << ")" << std::endl;
+    sf_2.reset();
+
+    // Per-channel timings follow the GID layout of the signal category:
+    datatools::properties xcalo_config;
+    xcalo_config.store("logging.priority", "fatal");
+    xcalo_config.store("signal_category", "xcalo");
+    xcalo_config.store("mode", "triangle");
+    xcalo_config.store_real_with_explicit_unit("channel.1.0.1.15.rise_time", 5.0 * CLHEP::ns);
+    xcalo_config.set_unit_symbol("channel.1.0.1.15.rise_time", "ns");
+    snemo::asb::calo_signal_generator_driver xcalo_driver("xcalo");
+    xcalo_driver.initialize(xcalo_config);
+    DT_THROW_IF(xcalo_driver.get_rise_time(geomtools::geom_id(1232, 0, 1, 0, 1, 15, 1)) !=
+                        5.0 * CLHEP::ns ||
+                    xcalo_driver.get_rise_time(geomtools::geom_id(1232, 0, 1, 0, 1, 14, 1)) !=
+                        8.0 * CLHEP::ns ||
+                    xcalo_driver.get_rise_time(geomtools::geom_id(1302, 0, 1, 0, 1, 1)) !=
+                        8.0 * CLHEP::ns,
+                std::logic_error, "Wrong per-channel timings of the xcalo channels!");
+    xcalo_driver.reset();
+    bool caught = false;
+    try {
+      xcalo_config.store("channels.rows", -3);
+      snemo::asb::calo_signal_generator_driver invalid_driver("xcalo");
+      invalid_driver.initialize(xcalo_config);
+    } catch (std::domain_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Negative number of channels was accepted!");
 
     std::clog << "The end." << std::endl;
 
@@ -0,0 +1,187 @@
+// test_calo_streaming.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/calo_signal_generator_driver.h>
+#include <snemo/asb/shape_policies.h>
+
+// Fill a simulated data with random calorimeter step hits
+void fill_calo_hits(mctools::simulated_data &sd_, std::size_t number_of_hits_,
+                    std::mt19937 &prng_) {
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> column(0, 19);
+  std::uniform_int_distribution<int> row(0, 12);
+  std::uniform_real_distribution<double> time(0.0, 50.0);
+  std::uniform_real_distribution<double> energy(0.01, 3.0);
+  sd_.add_step_hits("calo", number_of_hits_);
+  for (std::size_t ihit = 0; ihit < number_of_hits_; ihit++) {
+    mctools::base_step_hit &hit = sd_.add_step_hit("calo");
+    hit.set_hit_id(ihit);
+    hit.set_geom_id(geomtools::geom_id(1302, 0, side(prng_), column(prng_), row(prng_), 1));
+    hit.set_time_start(time(prng_) * CLHEP::ns);
+    hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+    hit.set_energy_deposit(energy(prng_) * CLHEP::MeV);
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for the streaming mode of class "
+                 "'snemo::asb::calo_signal_generator_driver'!"
+              << std::endl;
+
+    std::size_t number_of_hits = 50;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-H" || arg == "--hits") {
+        number_of_hits = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "calo");
+    driver_config.store("mode", "triangle");
+
+    snemo::asb::calo_signal_generator_driver csgd;
+    csgd.initialize(driver_config);
+
+    std::mt19937 prng(314159);
+    mctools::simulated_data sd;
+    fill_calo_hits(sd, number_of_hits, prng);
+    mctools::signal::signal_data full_ssd;
+    csgd.process(sd, full_ssd);
+
+    // Every channel of the event mode gets some signal, and the windows
+    // closed by later hits are emitted before the end of the stream:
+    std::map<geomtools::geom_id, std::vector<mctools::signal::base_signal>> streamed_signals;
+    std::size_t number_of_streamed = 0;
+    csgd.process_streaming(sd, [&](const mctools::signal::base_signal &signal_) {
+      streamed_signals[signal_.get_geom_id()].push_back(signal_);
+      number_of_streamed++;
+    });
+    std::clog << "Streamed signals  : " << number_of_streamed << " (max open windows: "
+              << csgd.get_max_open_windows() << ")" << std::endl;
+    DT_THROW_IF(streamed_signals.size() != full_ssd.get_number_of_signals("calo"),
+                std::logic_error, "Streaming mode missed some channels!");
+
+    // Single hit channels get the signal of the event mode:
+    std::vector<std::string> real_parameter_names =
+        snemo::asb::shape_schema::time_parameter_names();
+    for (const auto &name : snemo::asb::shape_schema::amplitude_parameter_names()) {
+      real_parameter_names.push_back(name);
+    }
+    const std::string polarity_key = mctools::signal::base_signal::shape_key("polarity");
+    for (const auto &handle : full_ssd.get_signals("calo")) {
+      const mctools::signal::base_signal &event_signal = handle.get();
+      if (event_signal.get_shape_type_id() == "mctools::signal::multi_signal_shape") continue;
+      const auto found = streamed_signals.find(event_signal.get_geom_id());
+      DT_THROW_IF(found == streamed_signals.end() || found->second.size() != 1, std::logic_error,
+                  "Channel " << event_signal.get_geom_id() << " is not streamed once!");
+      const mctools::signal::base_signal &streamed_signal = found->second.front();
+      DT_THROW_IF(streamed_signal.get_shape_type_id() != event_signal.get_shape_type_id() ||
+                      streamed_signal.get_time_ref() != event_signal.get_time_ref(),
+                  std::logic_error,
+                  "Wrong streamed signal for channel " << event_signal.get_geom_id() << "!");
+      const datatools::properties &streamed_aux = streamed_signal.get_auxiliaries();
+      const datatools::properties &event_aux = event_signal.get_auxiliaries();
+      for (const auto &name : real_parameter_names) {
+        const std::string key = mctools::signal::base_signal::shape_key(name);
+        DT_THROW_IF(streamed_aux.fetch_real(key) != event_aux.fetch_real(key), std::logic_error,
+                    "Wrong streamed '" << name << "' for channel " << event_signal.get_geom_id()
+                                       << "!");
+      }
+      DT_THROW_IF(streamed_aux.fetch_string(polarity_key) != event_aux.fetch_string(polarity_key),
+                  std::logic_error,
+                  "Wrong streamed polarity for channel " << event_signal.get_geom_id() << "!");
+    }
+
+    // Hits whose GID cannot be packed get their own windows:
+    mctools::simulated_data unpacked_sd;
+    unpacked_sd.add_step_hits("calo", 3);
+    const uint32_t unpacked_columns[3] = {300, 1, 300};
+    for (int ihit = 0; ihit < 3; ihit++) {
+      mctools::base_step_hit &hit = unpacked_sd.add_step_hit("calo");
+      hit.set_hit_id(ihit);
+      hit.set_geom_id(geomtools::geom_id(1302, 0, 0, unpacked_columns[ihit], 3, 1));
+      hit.set_time_start(ihit * 10.0 * CLHEP::ns);
+      hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+      hit.set_energy_deposit(1.0 * CLHEP::MeV);
+    }
+    std::set<geomtools::geom_id> unpacked_channels;
+    csgd.process_streaming(unpacked_sd, [&](const mctools::signal::base_signal &signal_) {
+      unpacked_channels.insert(signal_.get_geom_id());
+    });
+    DT_THROW_IF(unpacked_channels.size() != 2, std::logic_error,
+                "Wrong streaming of hits with unpacked GIDs!");
+
+    // A failing callback closes the stream, so that another one can be opened:
+    bool callback_failed = false;
+    try {
+      csgd.process_streaming(sd, [](const mctools::signal::base_signal &) {
+        throw std::runtime_error("Failing callback");
+      });
+    } catch (std::runtime_error &) {
+      callback_failed = true;
+    }
+    DT_THROW_IF(!callback_failed || csgd.is_streaming(), std::logic_error,
+                "A failing callback left the stream open!");
+    mctools::simulated_data spaced_sd;
+    spaced_sd.add_step_hits("calo", 3);
+    for (int ihit = 0; ihit < 3; ihit++) {
+      mctools::base_step_hit &hit = spaced_sd.add_step_hit("calo");
+      hit.set_hit_id(ihit);
+      hit.set_geom_id(geomtools::geom_id(1302, 0, 0, ihit, 0, 1));
+      hit.set_time_start(ihit * 500.0 * CLHEP::ns);
+      hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+      hit.set_energy_deposit(1.0 * CLHEP::MeV);
+    }
+    std::size_t emitted_while_streaming = 0;
+    csgd.begin_stream([&](const mctools::signal::base_signal &) { emitted_while_streaming++; });
+    for (const auto &hit : spaced_sd.get_step_hits("calo")) {
+      csgd.push_hit(hit.get());
+    }
+    DT_THROW_IF(emitted_while_streaming != 2, std::logic_error,
+                "Closed windows were not emitted before the end of the stream!");
+    csgd.end_stream();
+    DT_THROW_IF(emitted_while_streaming != 3 || csgd.get_max_open_windows() != 1,
+                std::logic_error, "Wrong streaming of spaced hits!");
+
+    csgd.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
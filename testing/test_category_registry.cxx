@@ -0,0 +1,114 @@
+// test_category_registry.cxx
+// Standard libraries :
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/category_registry.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::category_registry'!" << std::endl;
+
+    std::size_t number_of_workers = 8;
+    std::size_t number_of_lookups = 20000;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-j" || arg == "--workers") {
+        number_of_workers = std::atoi(argv_[++iarg]);
+      } else if (arg == "-n" || arg == "--number") {
+        number_of_lookups = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    typedef snemo::asb::category_registry registry;
+
+    // Interning gives one ID per label, whatever the number of calls:
+    std::vector<std::string> labels = {"calo", "xcalo", "gveto", "gg"};
+    for (std::size_t ilabel = 0; ilabel < 300; ilabel++) {
+      labels.push_back("test.category." + std::to_string(ilabel));
+    }
+    std::vector<registry::id_type> ids;
+    std::vector<const std::string *> addresses;
+    for (const auto &label : labels) {
+      ids.push_back(registry::intern(label));
+      addresses.push_back(&registry::get_label(ids.back()));
+      DT_THROW_IF(registry::intern(label) != ids.back() || registry::find(label) != ids.back(),
+                  std::logic_error, "Unstable ID for category '" << label << "'!");
+      DT_THROW_IF(*addresses.back() != label, std::logic_error,
+                  "Wrong label for category '" << label << "'!");
+    }
+    DT_THROW_IF(registry::size() < labels.size(), std::logic_error, "Missing categories!");
+    DT_THROW_IF(registry::find("test.unknown") != registry::INVALID_ID, std::logic_error,
+                "Unknown category was found!");
+    bool caught = false;
+    try {
+      registry::get_label(registry::INVALID_ID);
+    } catch (std::range_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Invalid ID has a label!");
+    caught = false;
+    try {
+      registry::intern("");
+    } catch (std::logic_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Empty category was interned!");
+
+    // Concurrent lookups see the same IDs and the same label objects:
+    const std::size_t number_of_categories = registry::size();
+    std::atomic<std::size_t> number_of_mismatches(0);
+    std::vector<std::thread> workers;
+    for (std::size_t iworker = 0; iworker < number_of_workers; iworker++) {
+      workers.emplace_back([&, iworker]() {
+        for (std::size_t ilookup = 0; ilookup < number_of_lookups; ilookup++) {
+          const std::size_t ilabel = (ilookup * 7 + iworker) % labels.size();
+          const std::string &label = registry::get_label(ids[ilabel]);
+          if (&label != addresses[ilabel] || label != labels[ilabel]) {
+            number_of_mismatches++;
+          }
+          if (ilookup % 16 == 0 &&
+              (registry::find(labels[ilabel]) != ids[ilabel] ||
+               registry::intern(labels[ilabel]) != ids[ilabel])) {
+            number_of_mismatches++;
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    std::clog << "Categories        : " << number_of_categories << std::endl;
+    std::clog << "Lookups           : " << number_of_workers * number_of_lookups << " in "
+              << number_of_workers << " threads" << std::endl;
+    DT_THROW_IF(number_of_mismatches != 0, std::logic_error,
+                number_of_mismatches << " concurrent lookups gave another ID or label!");
+    DT_THROW_IF(registry::size() != number_of_categories, std::logic_error,
+                "Lookups interned new categories!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,141 @@
+// test_channel_map.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/utils.h>
+// - Bayeux/geomtools:
+#include <geomtools/manager.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/calo_signal_generator_driver.h>
+#include <snemo/asb/channel_map.h>
+#include <snemo/asb/packed_gid.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::channel_map'!" << std::endl;
+
+    std::string geometry_config_filename =
+        "@falaise:config/snemo/demonstrator/geometry/4.0/manager.conf";
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-g" || arg == "--geometry") {
+        geometry_config_filename = argv_[++iarg];
+      }
+      iarg++;
+    }
+    datatools::fetch_path_with_env(geometry_config_filename);
+    datatools::properties geometry_config;
+    geometry_config.read_configuration(geometry_config_filename);
+    geomtools::manager geometry_manager;
+    geometry_manager.initialize(geometry_config);
+
+    char root_template[] = "/tmp/test_channel_map.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    // Nested directories are created with their parents:
+    const std::string directory = root + "/nested/cache";
+
+    // The first run builds the table and saves it:
+    snemo::asb::channel_map built;
+    DT_THROW_IF(built.load_or_build(geometry_manager, directory), std::logic_error,
+                "Loaded a table from an empty cache!");
+    DT_THROW_IF(!built.is_valid() || built.is_mapped() || built.size() == 0, std::logic_error,
+                "Wrong built table!");
+    const uint64_t digest = built.get_digest();
+    const std::string path = directory + "/" + snemo::asb::channel_map::make_filename(digest);
+
+    // The next run maps the saved table, with the same content:
+    snemo::asb::channel_map loaded;
+    DT_THROW_IF(!loaded.load_or_build(geometry_manager, directory) || !loaded.is_mapped(),
+                std::logic_error, "Saved table was not loaded!");
+    DT_THROW_IF(loaded.get_digest() != digest || loaded.size() != built.size(), std::logic_error,
+                "Wrong loaded table!");
+    for (std::size_t ichannel = 0; ichannel < built.size(); ichannel++) {
+      DT_THROW_IF(loaded.get_key(ichannel) != built.get_key(ichannel), std::logic_error,
+                  "Wrong key of channel #" << ichannel << "!");
+      for (int icoordinate = 0; icoordinate < 3; icoordinate++) {
+        DT_THROW_IF(loaded.get_position(ichannel)[icoordinate] !=
+                        built.get_position(ichannel)[icoordinate],
+                    std::logic_error, "Wrong position of channel #" << ichannel << "!");
+      }
+      DT_THROW_IF(loaded.get_channel_index(built.get_key(ichannel)) != static_cast<int>(ichannel),
+                  std::logic_error, "Wrong index of channel #" << ichannel << "!");
+    }
+
+    // A table saved for another geometry is ignored:
+    snemo::asb::channel_map stale;
+    DT_THROW_IF(stale.load(path, digest + 1) || stale.is_valid(), std::logic_error,
+                "Loaded a table with a wrong digest!");
+
+    // The digest depends on the mapped categories:
+    DT_THROW_IF(snemo::asb::channel_map::compute_digest(geometry_manager, {"calorimeter_block"}) ==
+                    digest,
+                std::logic_error, "Digest does not depend on the categories!");
+
+    // Extents of the channel addresses: [module.side.column.row.part] for
+    // the calorimeter blocks:
+    const std::vector<std::size_t> calo_extents = loaded.get_address_extents(1302);
+    DT_THROW_IF(calo_extents.size() != snemo::asb::packed_gid::MAX_DEPTH ||
+                    calo_extents[1] != 2 || calo_extents[2] != 20 || calo_extents[3] != 13,
+                std::logic_error, "Wrong extents of the calorimeter channels!");
+    DT_THROW_IF(!loaded.get_address_extents(1).empty(), std::logic_error,
+                "Extents of a type without channel!");
+
+    // The calorimeter driver takes the layout of its per-channel timings
+    // from the map:
+    {
+      datatools::properties driver_config;
+      driver_config.store("signal_category", "calo");
+      driver_config.store("mode", "triangle");
+      driver_config.store_real_with_explicit_unit("channel.1.19.12.rise_time", 7.5 * CLHEP::ns);
+      driver_config.set_unit_symbol("channel.1.19.12.rise_time", "ns");
+      snemo::asb::calo_signal_generator_driver driver;
+      driver.set_geo_manager(geometry_manager);
+      driver.set_channel_map(loaded);
+      driver.initialize(driver_config);
+      DT_THROW_IF(driver.get_rise_time(geomtools::geom_id(1302, 0, 1, 19, 12, 0)) !=
+                          7.5 * CLHEP::ns ||
+                      driver.get_rise_time(geomtools::geom_id(1302, 0, 1, 19, 11, 0)) ==
+                          7.5 * CLHEP::ns,
+                  std::logic_error, "Wrong per-channel timings with a channel map!");
+      driver.tree_dump(std::clog, "Calorimeter driver with a channel map:");
+      driver.reset();
+    }
+
+    loaded.reset();
+    built.reset();
+    std::remove(path.c_str());
+    ::rmdir(directory.c_str());
+    ::rmdir((root + "/nested").c_str());
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
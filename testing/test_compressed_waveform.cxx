@@ -0,0 +1,97 @@
+// test_compressed_waveform.cxx
+// Standard libraries :
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/compressed_waveform.h>
+
+// Fill a waveform with baseline noise and a negative triangle pulse
+void fill_waveform(std::vector<uint16_t> &samples_, int baseline_, std::mt19937 &prng_) {
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::uniform_int_distribution<int> start(100, 800);
+  std::uniform_real_distribution<double> amplitude(50.0, 1500.0);
+  const int t0 = start(prng_);
+  const double a = amplitude(prng_);
+  for (std::size_t i = 0; i < samples_.size(); i++) {
+    const double t = static_cast<double>(i) - t0;
+    double value = baseline_ + noise(prng_);
+    if (t >= 0.0 && t < 10.0) {
+      value -= a * t / 10.0;
+    } else if (t >= 10.0 && t < 80.0) {
+      value -= a * (80.0 - t) / 70.0;
+    }
+    samples_[i] = static_cast<uint16_t>(std::lround(value));
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::compressed_waveform'!" << std::endl;
+
+    // A few waveforms are enough to check the round trips; the compression
+    // ratios and the decode throughput are measured by bench_compressed_waveform:
+    const std::size_t number_of_waveforms = 20;
+    const std::size_t number_of_samples = 1024;
+
+    for (const unsigned int adc_bits : {12u, 14u}) {
+      for (const unsigned int threshold : {0u, 3u}) {
+        const int baseline = 1 << (adc_bits - 1);
+        std::mt19937 prng(314159);
+        std::vector<uint16_t> samples(number_of_samples);
+        std::vector<uint16_t> decoded(number_of_samples);
+        snemo::asb::compressed_waveform waveform;
+        waveform.set_adc_bits(adc_bits);
+        waveform.set_threshold(threshold);
+        for (std::size_t iwf = 0; iwf < number_of_waveforms; iwf++) {
+          fill_waveform(samples, baseline, prng);
+          waveform.encode(samples, baseline);
+          waveform.decode(decoded);
+          for (std::size_t i = 0; i < number_of_samples; i++) {
+            const int error = static_cast<int>(decoded[i]) - samples[i];
+            const int deviation = static_cast<int>(samples[i]) - baseline;
+            // Lossless out of the suppression band, bounded error within:
+            DT_THROW_IF(std::abs(deviation) > static_cast<int>(threshold) && error != 0,
+                        std::logic_error, "Sample #" << i << " is not restored!");
+            DT_THROW_IF(std::abs(error) > static_cast<int>(threshold), std::logic_error,
+                        "Sample #" << i << " is not within the suppression threshold!");
+          }
+          if (iwf == 0) {
+            // Round-trip through properties:
+            datatools::properties store;
+            waveform.export_to(store, "waveform.");
+            snemo::asb::compressed_waveform loaded;
+            std::vector<uint16_t> reloaded;
+            loaded.import_from(store, "waveform.");
+            loaded.decode(reloaded);
+            DT_THROW_IF(reloaded != decoded, std::logic_error, "Properties round-trip failed!");
+          }
+        }
+      }
+    }
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
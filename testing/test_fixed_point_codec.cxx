@@ -0,0 +1,130 @@
+// test_fixed_point_codec.cxx
+// Standard libraries :
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/fixed_point_codec.h>
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/utils.h>
+
+// Fill a bank with random triangle signals
+void fill_bank(mctools::signal::signal_data &ssd_, const snemo::asb::shape_schema &schema_,
+               std::size_t number_of_signals_, std::mt19937 &prng_) {
+  std::uniform_real_distribution<double> time(0.0, 500.0);
+  std::uniform_real_distribution<double> amplitude(0.001, 1.5);
+  for (std::size_t isignal = 0; isignal < number_of_signals_; isignal++) {
+    mctools::signal::base_signal &signal = ssd_.add_signal("calo");
+    signal.set_hit_id(isignal);
+    signal.set_geom_id(geomtools::geom_id(1302, 0, isignal % 2, isignal % 20, isignal % 13, 1));
+    signal.set_category("calo");
+    signal.set_time_ref(0.0);
+    snemo::asb::triangle_shape_policy::build(signal, schema_, time(prng_) * CLHEP::ns,
+                                             8.0 * CLHEP::ns, 70.0 * CLHEP::ns,
+                                             amplitude(prng_) * CLHEP::volt);
+    signal.initialize_simple();
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::fixed_point_codec'!" << std::endl;
+
+    datatools::properties config;
+    config.store_real("time_resolution", 10.0);
+    config.store_real("amplitude_full_scale", 4.0);
+    snemo::asb::fixed_point_codec codec;
+    codec.initialize(config);
+    DT_THROW_IF(std::abs(codec.get_time_resolution() - 10.0 * CLHEP::picosecond) > 1e-12,
+                std::logic_error, "Wrong time resolution!");
+
+    // Scalar round trips and range checks:
+    int time_code = 0;
+    DT_THROW_IF(!codec.encode_time(123.456 * CLHEP::ns, time_code) || time_code != 12346,
+                std::logic_error, "Wrong time code!");
+    int16_t amplitude_code = 0;
+    DT_THROW_IF(!codec.encode_amplitude(-2.0 * CLHEP::volt, amplitude_code) ||
+                    std::abs(codec.decode_amplitude(amplitude_code) + 2.0 * CLHEP::volt) >
+                        0.5 * codec.get_amplitude_lsb(),
+                std::logic_error, "Wrong amplitude round trip!");
+    DT_THROW_IF(codec.encode_amplitude(4.1 * CLHEP::volt, amplitude_code), std::logic_error,
+                "Out-of-range amplitude was encoded!");
+
+    // Bank round trip against the double path:
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+    const std::size_t number_of_signals = 500;
+    std::mt19937 prng(314159);
+    mctools::signal::signal_data reference;
+    fill_bank(reference, schema, number_of_signals, prng);
+    prng.seed(314159);
+    mctools::signal::signal_data ssd;
+    fill_bank(ssd, schema, number_of_signals, prng);
+
+    const std::size_t double_bytes = snemo::asb::signal_utils::estimate_memory(ssd);
+    codec.encode(ssd);
+    const std::size_t fixed_bytes = snemo::asb::signal_utils::estimate_memory(ssd);
+    std::clog << "Bytes per signal  : " << double_bytes / number_of_signals << " -> "
+              << fixed_bytes / number_of_signals << std::endl;
+    DT_THROW_IF(!snemo::asb::fixed_point_codec::is_encoded(ssd), std::logic_error,
+                "Bank is not encoded!");
+    DT_THROW_IF(!ssd.get_signal("calo", 0).get_auxiliaries().is_integer(schema.t0_key),
+                std::logic_error, "Time was not encoded!");
+    DT_THROW_IF(snemo::asb::fixed_point_codec::decode(ssd) != number_of_signals,
+                std::logic_error, "Some signals were not decoded!");
+    DT_THROW_IF(snemo::asb::fixed_point_codec::is_encoded(ssd), std::logic_error,
+                "Bank is still encoded!");
+
+    double max_time_error = 0.0;
+    double max_amplitude_error = 0.0;
+    for (std::size_t isignal = 0; isignal < number_of_signals; isignal++) {
+      const datatools::properties &expected = reference.get_signal("calo", isignal).get_auxiliaries();
+      const datatools::properties &decoded = ssd.get_signal("calo", isignal).get_auxiliaries();
+      for (const auto &key : {schema.t0_key, schema.t1_key, schema.t2_key}) {
+        max_time_error =
+            std::max(max_time_error, std::abs(decoded.fetch_real(key) - expected.fetch_real(key)));
+      }
+      max_amplitude_error =
+          std::max(max_amplitude_error, std::abs(decoded.fetch_real(schema.amplitude_key) -
+                                                 expected.fetch_real(schema.amplitude_key)));
+    }
+    std::clog << "Max time error    : " << max_time_error / CLHEP::picosecond << " ps"
+              << std::endl;
+    std::clog << "Max amp. error    : " << max_amplitude_error / CLHEP::millivolt << " mV"
+              << std::endl;
+    DT_THROW_IF(max_time_error > 0.5 * codec.get_time_resolution() * (1.0 + 1e-9),
+                std::logic_error, "Time error exceeds the tolerance!");
+    DT_THROW_IF(max_amplitude_error > 0.5 * codec.get_amplitude_lsb() * (1.0 + 1e-9),
+                std::logic_error, "Amplitude error exceeds the tolerance!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,97 @@
+// test_packed_gid.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/utils.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+#include <geomtools/manager.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/packed_gid.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::packed_gid'!" << std::endl;
+
+    std::string geometry_config_filename =
+        "@falaise:config/snemo/demonstrator/geometry/4.0/manager.conf";
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-g" || arg == "--geometry") {
+        geometry_config_filename = argv_[++iarg];
+      }
+      iarg++;
+    }
+
+    // Special addresses:
+    geomtools::geom_id any_gid(1302, 0, 1, geomtools::geom_id::ANY_ADDRESS, 3);
+    geomtools::geom_id decoded_any_gid;
+    snemo::asb::packed_gid::decode(snemo::asb::packed_gid::encode(any_gid),
+                                   any_gid.get_depth(), decoded_any_gid);
+    DT_THROW_IF(decoded_any_gid != any_gid, std::logic_error, "Wildcard round-trip failed!");
+
+    // Round-trip of all the IDs of the SuperNEMO channels:
+    datatools::fetch_path_with_env(geometry_config_filename);
+    datatools::properties geometry_config;
+    geometry_config.read_configuration(geometry_config_filename);
+    geomtools::manager geometry_manager;
+    geometry_manager.initialize(geometry_config);
+
+    snemo::asb::packed_gid_codec codec;
+    codec.initialize(geometry_manager.get_id_mgr());
+
+    std::map<uint32_t, std::size_t> number_of_ids_per_type;
+    std::unordered_set<snemo::asb::packed_gid::key_type, snemo::asb::packed_gid::hash> keys;
+    const geomtools::geom_id *previous_gid = nullptr;
+    snemo::asb::packed_gid::key_type previous_key = snemo::asb::packed_gid::INVALID_KEY;
+    for (const auto &entry : geometry_manager.get_mapping().get_geom_infos()) {
+      const geomtools::geom_id &gid = entry.first;
+      if (!codec.has_type(gid.get_type())) continue;
+      const snemo::asb::packed_gid::key_type key = codec.encode(gid);
+      geomtools::geom_id decoded_gid;
+      codec.decode(key, decoded_gid);
+      DT_THROW_IF(decoded_gid != gid, std::logic_error,
+                  "Round-trip failed for " << gid << " (decoded as " << decoded_gid << ")!");
+      DT_THROW_IF(!keys.insert(key).second, std::logic_error, "Duplicate key for " << gid << "!");
+      // Keys follow the order of the geometry IDs within a type:
+      if (previous_gid != nullptr && previous_gid->get_type() == gid.get_type()) {
+        DT_THROW_IF(!(previous_key < key), std::logic_error,
+                    "Key order differs from the order of " << *previous_gid << " and " << gid
+                                                           << "!");
+      }
+      previous_gid = &gid;
+      previous_key = key;
+      number_of_ids_per_type[gid.get_type()]++;
+    }
+
+    for (const auto &entry : number_of_ids_per_type) {
+      std::clog << "Geometry type " << entry.first << " : " << entry.second
+                << " IDs round-tripped" << std::endl;
+    }
+    DT_THROW_IF(number_of_ids_per_type.empty(), std::logic_error, "No geometry ID was tested!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,175 @@
+// test_pipeline_runner.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/service_manager.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/pipeline_runner.h>
+
+// Return the content of a file
+std::string read_file(const std::string &filename_) {
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  DT_THROW_IF(!in, std::runtime_error, "Cannot open file '" << filename_ << "'!");
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Run the pipeline and return its report
+snemo::asb::pipeline_runner::report_type run_pipeline(
+    datatools::service_manager &services_, const datatools::properties &module_config_,
+    const std::string &input_filename_, const std::string &output_filename_,
+    std::size_t number_of_workers_, std::size_t queue_capacity_, std::size_t split_threshold_) {
+  snemo::asb::pipeline_runner runner;
+  runner.set_input_filename(input_filename_);
+  runner.set_output_filename(output_filename_);
+  runner.set_module_config(module_config_);
+  runner.set_service_manager(services_);
+  runner.set_number_of_workers(number_of_workers_);
+  runner.set_queue_capacity(queue_capacity_);
+  runner.set_write_buffer_capacity(2);
+  runner.set_split_threshold(split_threshold_);
+  runner.run();
+  runner.print_report(std::clog);
+  return runner.get_report();
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::pipeline_runner'!" << std::endl;
+
+    std::string geometry_config_filename =
+        "@falaise:config/snemo/demonstrator/geometry/4.0/manager.conf";
+    std::string input_filename;
+    if (std::getenv("FALAISE_ASB_TESTING_DIR") != nullptr) {
+      input_filename = std::string(std::getenv("FALAISE_ASB_TESTING_DIR")) +
+                       "/data/Se82_0nubb-source_strips_bulk_SD_10_events.brio";
+    }
+    std::size_t number_of_workers = 4;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-g" || arg == "--geometry") {
+        geometry_config_filename = argv_[++iarg];
+      } else if (arg == "-i" || arg == "--input") {
+        input_filename = argv_[++iarg];
+      } else if (arg == "-j" || arg == "--workers") {
+        number_of_workers = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+    DT_THROW_IF(input_filename.empty(), std::logic_error, "Missing input file!");
+    DT_THROW_IF(number_of_workers < 2, std::logic_error, "The test needs several workers!");
+
+    datatools::service_manager services("ASBServices", "Services of the ASB test");
+    datatools::properties geometry_service_config;
+    geometry_service_config.store("manager.configuration_file", geometry_config_filename);
+    services.load("geometry", "geomtools::geometry_service", geometry_service_config);
+    services.initialize();
+
+    // Two drivers, so that split events give two tasks:
+    datatools::properties module_config;
+    module_config.store("logging.priority", "fatal");
+    std::vector<std::string> drivers = {"calo", "scin"};
+    module_config.store("drivers", drivers);
+    module_config.store("driver.calo.type_id", "snemo::asb::calo_signal_generator_driver");
+    module_config.store("driver.calo.config.signal_category", "calo");
+    module_config.store("driver.calo.config.mode", "triangle");
+    module_config.store("driver.scin.type_id", "snemo::asb::scin_signal_generator_driver");
+    module_config.store("driver.scin.config.signal_category", "scin");
+    std::vector<std::string> scin_categories = {"xcalo", "gveto"};
+    module_config.store("driver.scin.config.categories", scin_categories);
+    module_config.store("driver.scin.config.mode", "triangle");
+
+    char root_template[] = "/tmp/test_pipeline_runner.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    // Text archives are free of file metadata, so that outputs can be compared byte by byte:
+    const std::string serial_filename = root + "/serial.xml";
+    const std::string parallel_filename = root + "/parallel.xml";
+    const std::string stream_filename = root + "/stream.xml";
+
+    // Reference: one worker, no split:
+    const snemo::asb::pipeline_runner::report_type serial_report =
+        run_pipeline(services, module_config, input_filename, serial_filename, 1, 16, 0);
+    DT_THROW_IF(serial_report.written_records != 10 || serial_report.split_records != 0,
+                std::logic_error, "Wrong serial run!");
+
+    // Several workers with a small queue capacity, every event being split in
+    // per-driver tasks: the records are written back in the original order and
+    // no more than one queue capacity of records is in flight:
+    const std::size_t queue_capacity = 2;
+    const snemo::asb::pipeline_runner::report_type parallel_report = run_pipeline(
+        services, module_config, input_filename, parallel_filename, number_of_workers,
+        queue_capacity, 1);
+    DT_THROW_IF(parallel_report.read_records != 10 || parallel_report.written_records != 10 ||
+                    parallel_report.failed_records != 0,
+                std::logic_error, "Wrong number of records in the parallel run!");
+    DT_THROW_IF(parallel_report.max_in_flight == 0 ||
+                    parallel_report.max_in_flight > queue_capacity ||
+                    parallel_report.input_max_occupancy > queue_capacity ||
+                    parallel_report.output_max_occupancy > queue_capacity,
+                std::logic_error,
+                "Records in flight exceed the queue capacity: " << parallel_report.max_in_flight
+                                                                << "!");
+    DT_THROW_IF(parallel_report.split_records == 0, std::logic_error, "No event was split!");
+    DT_THROW_IF(read_file(parallel_filename) != read_file(serial_filename), std::logic_error,
+                "Parallel output differs from the serial output!");
+
+    // Stream mode: the frames still open after the last event are written
+    // in a final record:
+    datatools::properties stream_config = module_config;
+    stream_config.store_boolean("stream_mode", true);
+    stream_config.store_real_with_explicit_unit("stream.window", 1.0 * CLHEP::microsecond);
+    stream_config.set_unit_symbol("stream.window", "us");
+    stream_config.store_real_with_explicit_unit("stream.event_period", 250.0 * CLHEP::ns);
+    stream_config.set_unit_symbol("stream.event_period", "ns");
+    stream_config.store_boolean("stream.random_spacing", false);
+    const snemo::asb::pipeline_runner::report_type stream_report = run_pipeline(
+        services, stream_config, input_filename, stream_filename, 1, queue_capacity, 0);
+    DT_THROW_IF(stream_report.written_records != stream_report.read_records + 1, std::logic_error,
+                "Missing final record of the stream!");
+    bool caught = false;
+    try {
+      run_pipeline(services, stream_config, input_filename, stream_filename, number_of_workers,
+                   queue_capacity, 0);
+    } catch (std::logic_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Stream mode was accepted with several workers!");
+
+    services.reset();
+    std::remove(serial_filename.c_str());
+    std::remove(parallel_filename.c_str());
+    std::remove(stream_filename.c_str());
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,162 @@
+// test_result_cache.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <sys/stat.h>
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/result_cache.h>
+#include <snemo/asb/shape_policies.h>
+
+// Return the size of a file, 0 if it does not exist
+std::size_t file_size(const std::string &path_) {
+  struct stat file_stat;
+  if (::stat(path_.c_str(), &file_stat) != 0) return 0;
+  return file_stat.st_size;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::result_cache'!" << std::endl;
+
+    char root_template[] = "/tmp/test_result_cache.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    // Nested directories are created with their parents:
+    const std::string directory = root + "/nested/cache";
+
+    snemo::asb::result_cache cache;
+    cache.set_directory(directory);
+    cache.set_max_size(1024 * 1024);
+    cache.initialize();
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+    mctools::signal::signal_data bank;
+    for (int isignal = 0; isignal < 3; isignal++) {
+      mctools::signal::base_signal &signal = bank.add_signal("calo");
+      signal.set_hit_id(isignal);
+      signal.set_geom_id(geomtools::geom_id(1302, 0, 0, isignal, 3, 1));
+      signal.set_category("calo");
+      signal.set_time_ref(0.0);
+      snemo::asb::triangle_shape_policy::build(signal, schema, isignal * 10.0 * CLHEP::ns,
+                                               8.0 * CLHEP::ns, 70.0 * CLHEP::ns,
+                                               50.0 * CLHEP::millivolt);
+    }
+    const std::vector<std::string> categories = {"calo"};
+    const std::string key = snemo::asb::result_cache::make_key("input", 1, 2);
+    DT_THROW_IF(key == snemo::asb::result_cache::make_key("input", 1, 3), std::logic_error,
+                "Distinct step hits share a key!");
+
+    // Miss on an empty cache:
+    mctools::signal::signal_data missed;
+    DT_THROW_IF(cache.load(key, categories, missed) || missed.has_signals("calo"),
+                std::logic_error, "Hit on an empty cache!");
+
+    // Hit after a store, with the same signals:
+    const std::string entry_path = directory + "/" + key + ".ssd.data";
+    cache.store(key, bank);
+    DT_THROW_IF(cache.get_size() != file_size(entry_path), std::logic_error,
+                "Wrong recorded cache size!");
+    mctools::signal::signal_data loaded;
+    DT_THROW_IF(!cache.load(key, categories, loaded), std::logic_error, "Missed a stored entry!");
+    DT_THROW_IF(loaded.get_number_of_signals("calo") != 3, std::logic_error,
+                "Wrong number of cached signals!");
+    for (int isignal = 0; isignal < 3; isignal++) {
+      DT_THROW_IF(loaded.get_signal("calo", isignal).get_geom_id() !=
+                      bank.get_signal("calo", isignal).get_geom_id(),
+                  std::logic_error, "Wrong cached signal!");
+    }
+
+    // A corrupted entry is a miss, and is replaced by the next store:
+    {
+      std::ofstream corrupted(entry_path.c_str(), std::ios::trunc);
+      corrupted << "not an archive";
+    }
+    mctools::signal::signal_data from_corrupted;
+    DT_THROW_IF(cache.load(key, categories, from_corrupted), std::logic_error,
+                "Hit on a corrupted entry!");
+    cache.store(key, bank);
+    mctools::signal::signal_data reloaded;
+    DT_THROW_IF(!cache.load(key, categories, reloaded), std::logic_error,
+                "Missed a replaced entry!");
+
+    DT_THROW_IF(cache.get_number_of_hits() != 2 || cache.get_number_of_misses() != 2,
+                std::logic_error, "Wrong cache statistics!");
+    cache.tree_dump(std::clog, "Result cache:");
+    cache.reset();
+
+    // The recorded size follows the stores and the evictions, and is picked
+    // up by the next job using the cache directory:
+    const std::string small_directory = directory + "/small";
+    const std::size_t entry_size = file_size(entry_path);
+    std::vector<std::string> small_paths;
+    std::size_t small_max_size = 0;
+    {
+      snemo::asb::result_cache small_cache;
+      small_cache.set_directory(small_directory);
+      small_cache.set_max_size(3 * entry_size + entry_size / 2);
+      small_cache.initialize();
+      small_max_size = small_cache.get_max_size();
+      for (uint64_t input_hash = 10; input_hash < 15; input_hash++) {
+        const std::string small_key = snemo::asb::result_cache::make_key("input", 1, input_hash);
+        small_cache.store(small_key, bank);
+        small_paths.push_back(small_directory + "/" + small_key + ".ssd.data");
+      }
+      small_cache.reset();
+    }
+    std::size_t kept_size = 0;
+    for (const auto &path : small_paths) {
+      kept_size += file_size(path);
+    }
+    snemo::asb::result_cache next_cache;
+    next_cache.set_directory(small_directory);
+    next_cache.set_max_size(small_max_size);
+    next_cache.initialize();
+    DT_THROW_IF(kept_size == 0 || kept_size > small_max_size || next_cache.get_size() != kept_size,
+                std::logic_error, "Wrong cache size after evictions!");
+    next_cache.reset();
+
+    for (const auto &path : small_paths) {
+      std::remove(path.c_str());
+    }
+    std::remove((small_directory + "/.lock").c_str());
+    ::rmdir(small_directory.c_str());
+    std::remove(entry_path.c_str());
+    std::remove((directory + "/.lock").c_str());
+    ::rmdir(directory.c_str());
+    ::rmdir((root + "/nested").c_str());
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
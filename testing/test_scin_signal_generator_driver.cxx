@@ -0,0 +1,138 @@
+// test_scin_signal_generator_driver.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/scin_signal_generator_driver.h>
+
+// Add a step hit to a simulated data
+void add_hit(mctools::simulated_data &sd_, const std::string &category_, int hit_id_,
+             const geomtools::geom_id &gid_, double time_, double energy_) {
+  mctools::base_step_hit &hit = sd_.add_step_hit(category_);
+  hit.set_hit_id(hit_id_);
+  hit.set_geom_id(gid_);
+  hit.set_time_start(time_);
+  hit.set_time_stop(time_ + 1.0 * CLHEP::ns);
+  hit.set_energy_deposit(energy_);
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::scin_signal_generator_driver'!"
+              << std::endl;
+
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "scin");
+    std::vector<std::string> categories = {"calo", "gveto"};
+    driver_config.store("categories", categories);
+    driver_config.store("mode", "triangle");
+    driver_config.store_real_with_explicit_unit("category.gveto.rise_time", 10.0 * CLHEP::ns);
+    driver_config.set_unit_symbol("category.gveto.rise_time", "ns");
+
+    snemo::asb::scin_signal_generator_driver ssgd;
+    ssgd.initialize(driver_config);
+    ssgd.tree_dump(std::clog, "Scintillator driver:");
+
+    // Two piled-up hits in a calo block, another calo block and a gamma veto block:
+    const geomtools::geom_id piled_up_gid(1302, 0, 1, 4, 7, 1);
+    mctools::simulated_data sd;
+    sd.add_step_hits("calo", 3);
+    sd.add_step_hits("gveto", 1);
+    add_hit(sd, "calo", 0, piled_up_gid, 20.0 * CLHEP::ns, 1.0 * CLHEP::MeV);
+    add_hit(sd, "calo", 1, geomtools::geom_id(1302, 0, 0, 2, 3, 1), 10.0 * CLHEP::ns,
+            0.5 * CLHEP::MeV);
+    add_hit(sd, "calo", 2, piled_up_gid, 25.0 * CLHEP::ns, 2.0 * CLHEP::MeV);
+    add_hit(sd, "gveto", 0, geomtools::geom_id(1252, 0, 1, 0, 5, 1), 15.0 * CLHEP::ns,
+            0.3 * CLHEP::MeV);
+
+    mctools::signal::signal_data ssd;
+    ssgd.process(sd, ssd);
+    DT_THROW_IF(ssd.get_number_of_signals("calo") != 2 || ssd.get_number_of_signals("gveto") != 1,
+                std::logic_error, "Wrong number of signals!");
+
+    // All categories share the time reference of the earliest hit:
+    for (const auto &category : categories) {
+      for (const auto &signal : ssd.get_signals(category)) {
+        DT_THROW_IF(signal.get().get_time_ref() != 10.0 * CLHEP::ns, std::logic_error,
+                    "Wrong time reference of a '" << category << "' signal!");
+      }
+    }
+
+    // The piled-up hits give a multi signal with one component per hit:
+    std::size_t number_of_multi_signals = 0;
+    for (const auto &handle : ssd.get_signals("calo")) {
+      const mctools::signal::base_signal &signal = handle.get();
+      if (signal.get_shape_type_id() != "mctools::signal::multi_signal_shape") {
+        DT_THROW_IF(signal.get_hit_id() != 1, std::logic_error, "Wrong single calo signal!");
+        continue;
+      }
+      number_of_multi_signals++;
+      DT_THROW_IF(signal.get_geom_id() != piled_up_gid || signal.get_hit_id() != 0,
+                  std::logic_error, "Wrong channel of the multi signal!");
+      std::vector<std::string> components;
+      signal.get_auxiliaries().fetch(mctools::signal::base_signal::shape_key("components"),
+                                     components);
+      DT_THROW_IF(components.size() != 2 || components[0] != "hit0" || components[1] != "hit2",
+                  std::logic_error, "Wrong components of the multi signal!");
+      for (const auto &component : components) {
+        const std::string key_key =
+            mctools::signal::base_signal::shape_key("components." + component + ".key");
+        DT_THROW_IF(!signal.get_auxiliaries().has_key(key_key), std::logic_error,
+                    "Missing key of component '" << component << "'!");
+      }
+    }
+    DT_THROW_IF(number_of_multi_signals != 1, std::logic_error, "Wrong number of multi signals!");
+
+    // Degraded mode: one triangle signal per channel:
+    ssgd.set_degraded_mode(true);
+    mctools::signal::signal_data degraded_ssd;
+    ssgd.process(sd, degraded_ssd);
+    ssgd.set_degraded_mode(false);
+    DT_THROW_IF(degraded_ssd.get_number_of_signals("calo") != 2 ||
+                    degraded_ssd.get_number_of_signals("gveto") != 1,
+                std::logic_error, "Degraded mode changed the number of channels!");
+    for (const auto &handle : degraded_ssd.get_signals("calo")) {
+      DT_THROW_IF(handle.get().get_shape_type_id() == "mctools::signal::multi_signal_shape",
+                  std::logic_error, "Degraded mode produced a multi signal!");
+    }
+
+    // An event without scintillator hits produces no signal:
+    mctools::simulated_data empty_sd;
+    mctools::signal::signal_data empty_ssd;
+    ssgd.process(empty_sd, empty_ssd);
+    DT_THROW_IF(empty_ssd.has_signals("calo") || empty_ssd.has_signals("gveto"),
+                std::logic_error, "Empty event produced some signals!");
+
+    ssgd.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
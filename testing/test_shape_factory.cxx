@@ -0,0 +1,158 @@
+// test_shape_factory.cxx
+// Standard libraries :
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+#include <mctools/simulated_data.h>
+// - Bayeux/mygsl:
+#include <mygsl/i_unary_function.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/calo_signal_generator_driver.h>
+#include <snemo/asb/shape_factory.h>
+#include <snemo/asb/shape_policies.h>
+
+// Fill a simulated data with random calorimeter step hits
+void fill_calo_hits(mctools::simulated_data &sd_, std::size_t number_of_hits_,
+                    std::mt19937 &prng_) {
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> column(0, 19);
+  std::uniform_int_distribution<int> row(0, 12);
+  std::uniform_real_distribution<double> time(0.0, 50.0);
+  std::uniform_real_distribution<double> energy(0.01, 3.0);
+  sd_.add_step_hits("calo", number_of_hits_);
+  for (std::size_t ihit = 0; ihit < number_of_hits_; ihit++) {
+    mctools::base_step_hit &hit = sd_.add_step_hit("calo");
+    hit.set_hit_id(ihit);
+    hit.set_geom_id(geomtools::geom_id(1302, 0, side(prng_), column(prng_), row(prng_), 1));
+    hit.set_time_start(time(prng_) * CLHEP::ns);
+    hit.set_time_stop(hit.get_time_start() + 1.0 * CLHEP::ns);
+    hit.set_energy_deposit(energy(prng_) * CLHEP::MeV);
+  }
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::shape_factory'!" << std::endl;
+
+    std::size_t number_of_events = 20;
+    std::size_t number_of_hits = 50;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-n" || arg == "--number") {
+        number_of_events = std::atoi(argv_[++iarg]);
+      } else if (arg == "-H" || arg == "--hits") {
+        number_of_hits = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    // Calorimeter signals to be shaped:
+    datatools::properties driver_config;
+    driver_config.store("logging.priority", "fatal");
+    driver_config.store("signal_category", "calo");
+    driver_config.store("mode", "triangle");
+    snemo::asb::calo_signal_generator_driver csgd;
+    csgd.initialize(driver_config);
+    std::mt19937 prng(314159);
+    std::vector<mctools::signal::signal_data> banks(number_of_events);
+    for (auto &ssd : banks) {
+      mctools::simulated_data sd;
+      fill_calo_hits(sd, number_of_hits, prng);
+      csgd.process(sd, ssd);
+    }
+    csgd.reset();
+
+    // Shared shape functors, with a cache small enough to be flushed:
+    snemo::asb::shape_factory factory;
+    factory.set_capacity(64);
+    factory.initialize_simple("calo", {"mctools::signal::triangle_signal_shape"});
+    std::size_t number_of_shapes = 0;
+    for (const auto &ssd : banks) {
+      for (const auto &signal : ssd.get_signals("calo")) {
+        if (signal.get().get_shape_type_id() != "mctools::signal::triangle_signal_shape") continue;
+        const mygsl::i_unary_function &shape = factory.get_shape(signal.get());
+        const mygsl::i_unary_function &same_shape = factory.get_shape(signal.get());
+        DT_THROW_IF(&shape != &same_shape, std::logic_error, "Identical shapes are not shared!");
+        number_of_shapes += 2;
+      }
+      DT_THROW_IF(factory.get_size() > factory.get_capacity(), std::logic_error,
+                  "Shape cache exceeds its capacity!");
+    }
+    const snemo::asb::shape_factory::stats_type &shape_stats = factory.get_stats();
+    std::clog << "Shared shapes     : " << shape_stats.misses << " functors for "
+              << number_of_shapes << " requests, " << shape_stats.flushes << " flushes"
+              << std::endl;
+    DT_THROW_IF(number_of_shapes == 0, std::logic_error, "No shape was requested!");
+    DT_THROW_IF(shape_stats.hits + shape_stats.misses != number_of_shapes, std::logic_error,
+                "Shape cache lost some requests!");
+    factory.reset();
+
+    // Without flush, there is exactly one functor per distinct set of rounded
+    // parameters (0.1 ns and 0.5 mV by default):
+    snemo::asb::shape_factory large_factory;
+    large_factory.initialize_simple("calo", {"mctools::signal::triangle_signal_shape"});
+    DT_THROW_IF(large_factory.get_parameter_quantum("t1") != 0.1 * CLHEP::ns ||
+                    large_factory.get_parameter_quantum("amplitude") != 0.5 * CLHEP::millivolt ||
+                    large_factory.get_parameter_quantum("polarity") != 0.0,
+                std::logic_error, "Wrong shape parameter quanta!");
+    std::set<std::vector<long long>> distinct_shapes;
+    std::size_t number_of_requests = 0;
+    for (const auto &ssd : banks) {
+      for (const auto &signal : ssd.get_signals("calo")) {
+        if (signal.get().get_shape_type_id() != "mctools::signal::triangle_signal_shape") continue;
+        const datatools::properties &aux = signal.get().get_auxiliaries();
+        std::vector<long long> steps;
+        for (const auto &name : snemo::asb::shape_schema::time_parameter_names()) {
+          const std::string key = mctools::signal::base_signal::shape_key(name);
+          steps.push_back(std::llround(aux.fetch_real(key) / (0.1 * CLHEP::ns)));
+        }
+        for (const auto &name : snemo::asb::shape_schema::amplitude_parameter_names()) {
+          const std::string key = mctools::signal::base_signal::shape_key(name);
+          steps.push_back(std::llround(aux.fetch_real(key) / (0.5 * CLHEP::millivolt)));
+        }
+        distinct_shapes.insert(steps);
+        large_factory.get_shape(signal.get());
+        number_of_requests++;
+      }
+    }
+    const snemo::asb::shape_factory::stats_type &large_stats = large_factory.get_stats();
+    DT_THROW_IF(large_stats.flushes != 0 || large_stats.misses != distinct_shapes.size() ||
+                    large_stats.hits != number_of_requests - distinct_shapes.size(),
+                std::logic_error,
+                "Wrong shape sharing: " << large_stats.hits << " hits and " << large_stats.misses
+                                        << " misses for " << distinct_shapes.size()
+                                        << " distinct shapes!");
+    large_factory.reset();
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,188 @@
+// test_shape_prototype_dictionary.cxx
+// Standard libraries :
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/io_factory.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/shape_prototype_dictionary.h>
+#include <snemo/asb/utils.h>
+
+// Fill a bank with triangle signals of some families of channels (two by default)
+void fill_bank(mctools::signal::signal_data &ssd_, const snemo::asb::shape_schema &schema_,
+               std::size_t number_of_signals_, std::size_t number_of_families_ = 2) {
+  for (std::size_t isignal = 0; isignal < number_of_signals_; isignal++) {
+    mctools::signal::base_signal &signal = ssd_.add_signal("calo");
+    signal.set_hit_id(isignal);
+    signal.set_geom_id(geomtools::geom_id(1302, 0, isignal % 2, isignal % 20, isignal % 13, 1));
+    signal.set_category("calo");
+    signal.set_time_ref(0.0);
+    const std::size_t family = isignal % number_of_families_;
+    const double rise_time =
+        (number_of_families_ == 2 ? (family ? 8.0 : 7.5) : 1.1 + 0.25 * family) * CLHEP::ns;
+    snemo::asb::triangle_shape_policy::build(signal, schema_, 0.37 * isignal * CLHEP::ns,
+                                             rise_time, 70.0 * CLHEP::ns,
+                                             (10.0 + isignal) * CLHEP::millivolt);
+    signal.initialize_simple();
+  }
+  return;
+}
+
+// Return the serialization of a bank in a file
+std::string serialize(const mctools::signal::signal_data &ssd_, const std::string &filename_) {
+  {
+    datatools::data_writer writer(filename_, datatools::using_multi_archives);
+    writer.store(ssd_);
+  }
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  DT_THROW_IF(!in, std::runtime_error, "Cannot open file '" << filename_ << "'!");
+  const std::string content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  std::remove(filename_.c_str());
+  return content;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::shape_prototype_dictionary'!" << std::endl;
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+    const std::size_t number_of_signals = 200;
+    mctools::signal::signal_data reference;
+    fill_bank(reference, schema, number_of_signals);
+    mctools::signal::signal_data ssd;
+    fill_bank(ssd, schema, number_of_signals);
+
+    const std::size_t full_bytes = snemo::asb::signal_utils::estimate_memory(ssd);
+    snemo::asb::shape_prototype_dictionary dictionary;
+    const std::size_t number_of_compacted = dictionary.compact(ssd);
+    const std::size_t compact_bytes = snemo::asb::signal_utils::estimate_memory(ssd);
+    std::clog << "Compacted signals : " << number_of_compacted << std::endl;
+    std::clog << "Prototypes        : " << dictionary.get_number_of_prototypes() << std::endl;
+    std::clog << "Bytes per signal  : " << full_bytes / number_of_signals << " -> "
+              << compact_bytes / number_of_signals << std::endl;
+    DT_THROW_IF(number_of_compacted != number_of_signals, std::logic_error,
+                "Some signals were not compacted!");
+    DT_THROW_IF(dictionary.get_number_of_prototypes() != 2, std::logic_error,
+                "Wrong number of prototypes!");
+    DT_THROW_IF(compact_bytes >= full_bytes, std::logic_error, "Compact signals are not smaller!");
+    DT_THROW_IF(!snemo::asb::shape_prototype_dictionary::is_compact(ssd.get_signal("calo", 0)),
+                std::logic_error, "Signal is not compact!");
+
+    // Expansion from the prototypes stored in the bank only:
+    DT_THROW_IF(snemo::asb::shape_prototype_dictionary::expand(ssd) != number_of_signals,
+                std::logic_error, "Some signals were not expanded!");
+    const std::string t1_key = mctools::signal::base_signal::shape_key("t1");
+    const std::string t2_key = mctools::signal::base_signal::shape_key("t2");
+    const std::string polarity_key = mctools::signal::base_signal::shape_key("polarity");
+    for (std::size_t isignal = 0; isignal < number_of_signals; isignal++) {
+      const mctools::signal::base_signal &expected = reference.get_signal("calo", isignal);
+      const mctools::signal::base_signal &signal = ssd.get_signal("calo", isignal);
+      DT_THROW_IF(signal.get_shape_type_id() != expected.get_shape_type_id(), std::logic_error,
+                  "Wrong shape type of signal #" << isignal << "!");
+      DT_THROW_IF(signal.get_auxiliaries().fetch_string(polarity_key) != schema.polarity,
+                  std::logic_error, "Wrong polarity of signal #" << isignal << "!");
+      for (const auto &key : {t1_key, t2_key}) {
+        const double delta = signal.get_auxiliaries().fetch_real(key) -
+                             expected.get_auxiliaries().fetch_real(key);
+        DT_THROW_IF(std::abs(delta) > 1.0 * CLHEP::picosecond, std::logic_error,
+                    "Wrong '" << key << "' of signal #" << isignal << "!");
+      }
+    }
+
+    // A bank only carries the prototypes it refers to:
+    snemo::asb::shape_prototype_dictionary run_dictionary;
+    mctools::signal::signal_data first_bank;
+    fill_bank(first_bank, schema, 100, 50);
+    run_dictionary.compact(first_bank);
+    mctools::signal::signal_data bank;
+    fill_bank(bank, schema, 10);
+    run_dictionary.compact(bank);
+    DT_THROW_IF(run_dictionary.get_number_of_prototypes() != 52, std::logic_error,
+                "Wrong number of run prototypes!");
+    std::vector<int> expected_ids;
+    for (const double rise_time : {7.5 * CLHEP::ns, 8.0 * CLHEP::ns}) {
+      expected_ids.push_back(run_dictionary.add_prototype(
+          snemo::asb::triangle_shape_policy::shape_type_id(), schema.polarity, rise_time,
+          70.0 * CLHEP::ns));
+    }
+    std::sort(expected_ids.begin(), expected_ids.end());
+    std::vector<int> bank_ids;
+    bank.get_auxiliaries().fetch("asb.shape_prototype.ids", bank_ids);
+    DT_THROW_IF(bank_ids != expected_ids, std::logic_error,
+                "Wrong prototypes stored in the bank!");
+    // Same bank, with all the prototypes of the run as formerly stored:
+    mctools::signal::signal_data bank_with_all;
+    fill_bank(bank_with_all, schema, 10);
+    run_dictionary.compact(bank_with_all);
+    run_dictionary.export_to(bank_with_all.grab_auxiliaries());
+    // Same bank, from a dictionary which has not seen the former signals, as
+    // in another worker or shard of the run:
+    snemo::asb::shape_prototype_dictionary other_dictionary;
+    mctools::signal::signal_data other_bank;
+    fill_bank(other_bank, schema, 10);
+    other_dictionary.compact(other_bank);
+
+    char root_template[] = "/tmp/test_shape_prototype_dictionary.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    const std::string bank_content = serialize(bank, root + "/bank.xml");
+    const std::size_t bank_size = bank_content.size();
+    const std::size_t bank_with_all_size = serialize(bank_with_all, root + "/all.xml").size();
+    DT_THROW_IF(serialize(other_bank, root + "/other.xml") != bank_content, std::logic_error,
+                "Dictionaries fed in another order produce another bank!");
+    ::rmdir(root.c_str());
+    std::clog << "Serialized bank   : " << bank_size << " bytes (with all the prototypes: "
+              << bank_with_all_size << ")" << std::endl;
+    DT_THROW_IF(bank_size >= bank_with_all_size, std::logic_error,
+                "Referenced prototypes only do not reduce the bank size!");
+
+    // Expansion from the stored prototypes, with sparse identifiers:
+    DT_THROW_IF(snemo::asb::shape_prototype_dictionary::expand(bank) != 10, std::logic_error,
+                "Some signals of the bank were not expanded!");
+    for (std::size_t isignal = 0; isignal < 10; isignal++) {
+      const double t1 = bank.get_signal("calo", isignal).get_auxiliaries().fetch_real(t1_key);
+      const double expected_t1 = reference.get_signal("calo", isignal).get_auxiliaries().fetch_real(
+          t1_key);
+      DT_THROW_IF(std::abs(t1 - expected_t1) > 1.0 * CLHEP::picosecond, std::logic_error,
+                  "Wrong 't1' of signal #" << isignal << " of the bank!");
+    }
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
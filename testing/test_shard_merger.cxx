@@ -0,0 +1,136 @@
+// test_shard_merger.cxx
+// Standard libraries :
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// POSIX:
+#include <unistd.h>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+#include <datatools/service_manager.h>
+#include <datatools/utils.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/pipeline_runner.h>
+#include <snemo/asb/shard_merger.h>
+
+// Return the content of a file
+std::string read_file(const std::string &filename_) {
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  DT_THROW_IF(!in, std::runtime_error, "Cannot open file '" << filename_ << "'!");
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Run the pipeline on a shard of the input
+void run_shard(datatools::service_manager &services_, const datatools::properties &module_config_,
+               const std::string &input_filename_, const std::string &output_filename_,
+               std::size_t shard_index_, std::size_t number_of_shards_) {
+  snemo::asb::pipeline_runner runner;
+  runner.set_input_filename(input_filename_);
+  runner.set_output_filename(output_filename_);
+  runner.set_module_config(module_config_);
+  runner.set_service_manager(services_);
+  runner.set_number_of_workers(2);
+  runner.set_shard(shard_index_, number_of_shards_);
+  runner.run();
+  runner.print_report(std::clog);
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::shard_merger'!" << std::endl;
+
+    std::string geometry_config_filename =
+        "@falaise:config/snemo/demonstrator/geometry/4.0/manager.conf";
+    std::string input_filename;
+    if (std::getenv("FALAISE_ASB_TESTING_DIR") != nullptr) {
+      input_filename = std::string(std::getenv("FALAISE_ASB_TESTING_DIR")) +
+                       "/data/Se82_0nubb-source_strips_bulk_SD_10_events.brio";
+    }
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-g" || arg == "--geometry") {
+        geometry_config_filename = argv_[++iarg];
+      } else if (arg == "-i" || arg == "--input") {
+        input_filename = argv_[++iarg];
+      }
+      iarg++;
+    }
+    DT_THROW_IF(input_filename.empty(), std::logic_error, "Missing input file!");
+
+    datatools::service_manager services("ASBServices", "Services of the ASB test");
+    datatools::properties geometry_service_config;
+    geometry_service_config.store("manager.configuration_file", geometry_config_filename);
+    services.load("geometry", "geomtools::geometry_service", geometry_service_config);
+    services.initialize();
+
+    datatools::properties module_config;
+    module_config.store("logging.priority", "fatal");
+    std::vector<std::string> drivers = {"calo"};
+    module_config.store("drivers", drivers);
+    module_config.store("driver.calo.type_id", "snemo::asb::calo_signal_generator_driver");
+    module_config.store("driver.calo.config.signal_category", "calo");
+    module_config.store("driver.calo.config.mode", "triangle");
+
+    char root_template[] = "/tmp/test_shard_merger.XXXXXX";
+    DT_THROW_IF(::mkdtemp(root_template) == nullptr, std::runtime_error,
+                "Cannot create a temporary directory!");
+    const std::string root(root_template);
+    // Text archives are free of file metadata, so that outputs can be compared byte by byte:
+    const std::string batch_filename = root + "/batch.xml";
+    const std::string merged_filename = root + "/merged.xml";
+    const std::size_t number_of_shards = 3;
+    std::vector<std::string> shard_filenames;
+
+    // Whole input at once:
+    run_shard(services, module_config, input_filename, batch_filename, 0, 1);
+
+    // Shards merged back in the original order:
+    snemo::asb::shard_merger merger;
+    for (std::size_t ishard = 0; ishard < number_of_shards; ishard++) {
+      shard_filenames.push_back(root + "/shard_" + std::to_string(ishard) + ".xml");
+      run_shard(services, module_config, input_filename, shard_filenames.back(), ishard,
+                number_of_shards);
+      merger.add_shard_filename(shard_filenames.back());
+    }
+    merger.set_output_filename(merged_filename);
+    const std::size_t merged_records = merger.merge();
+    DT_THROW_IF(merged_records != 10, std::logic_error,
+                "Wrong number of merged records: " << merged_records << "!");
+
+    DT_THROW_IF(read_file(merged_filename) != read_file(batch_filename), std::logic_error,
+                "Merged shards differ from the batch output!");
+
+    services.reset();
+    std::remove(batch_filename.c_str());
+    std::remove(merged_filename.c_str());
+    for (const auto &shard_filename : shard_filenames) {
+      std::remove(shard_filename.c_str());
+    }
+    ::rmdir(root.c_str());
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
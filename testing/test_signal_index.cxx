@@ -0,0 +1,159 @@
+// test_signal_index.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/fixed_point_codec.h>
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/signal_index.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::signal_index'!" << std::endl;
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+
+    // Random signals on a few channels, in random order:
+    std::mt19937 prng(314159);
+    std::uniform_int_distribution<int> column(0, 9);
+    std::uniform_real_distribution<double> time(0.0, 1000.0);
+    const std::size_t number_of_signals = 1000;
+    mctools::signal::signal_data ssd;
+    for (std::size_t isignal = 0; isignal < number_of_signals; isignal++) {
+      mctools::signal::base_signal &signal = ssd.add_signal("calo");
+      signal.set_hit_id(isignal);
+      signal.set_geom_id(geomtools::geom_id(1302, 0, 0, column(prng), 3, 1));
+      signal.set_category("calo");
+      signal.set_time_ref(100.0 * CLHEP::ns);
+      snemo::asb::triangle_shape_policy::build(signal, schema, time(prng) * CLHEP::ns,
+                                               8.0 * CLHEP::ns, 70.0 * CLHEP::ns,
+                                               50.0 * CLHEP::millivolt);
+      signal.initialize_simple();
+    }
+
+    snemo::asb::signal_index::build(ssd);
+    DT_THROW_IF(!snemo::asb::signal_index::is_indexed(ssd, "calo"), std::logic_error,
+                "Bank is not indexed!");
+    snemo::asb::signal_index index;
+    index.attach(ssd);
+
+    // Channel lookups against a linear scan:
+    const double tmin = 400.0 * CLHEP::ns;
+    const double tmax = 600.0 * CLHEP::ns;
+    std::size_t number_in_window = 0;
+    for (std::size_t isignal = 0; isignal < number_of_signals; isignal++) {
+      const double start_time =
+          snemo::asb::signal_index::compute_start_time(ssd.get_signal("calo", isignal));
+      if (start_time >= tmin && start_time < tmax) number_in_window++;
+    }
+    for (int icolumn = 0; icolumn <= 10; icolumn++) {
+      const geomtools::geom_id gid(1302, 0, 0, icolumn, 3, 1);
+      std::size_t expected = 0;
+      std::size_t expected_in_window = 0;
+      for (std::size_t isignal = 0; isignal < number_of_signals; isignal++) {
+        const mctools::signal::base_signal &signal = ssd.get_signal("calo", isignal);
+        const double start_time = snemo::asb::signal_index::compute_start_time(signal);
+        if (signal.get_geom_id() != gid) continue;
+        expected++;
+        if (start_time >= tmin && start_time < tmax) expected_in_window++;
+      }
+      const snemo::asb::signal_index::range_type range = index.find_channel("calo", gid);
+      DT_THROW_IF(range.size() != expected, std::logic_error,
+                  "Wrong number of signals on channel " << gid << "!");
+      for (std::size_t position = range.first; position < range.last; position++) {
+        DT_THROW_IF(ssd.get_signal("calo", position).get_geom_id() != gid, std::logic_error,
+                    "Wrong signal on channel " << gid << "!");
+        DT_THROW_IF(position > range.first && index.get_start_time("calo", position) <
+                                                  index.get_start_time("calo", position - 1),
+                    std::logic_error, "Signals of channel " << gid << " are not time-sorted!");
+      }
+      DT_THROW_IF(index.find_channel_window("calo", gid, tmin, tmax).size() != expected_in_window,
+                  std::logic_error, "Wrong number of signals in window on channel " << gid << "!");
+    }
+
+    // Time window over all channels:
+    const snemo::asb::signal_index::range_type window = index.find_window("calo", tmin, tmax);
+    std::clog << "Signals in window : " << window.size() << std::endl;
+    DT_THROW_IF(window.size() != number_in_window, std::logic_error,
+                "Wrong number of signals in window!");
+    for (std::size_t rank = window.first; rank < window.last; rank++) {
+      const double start_time = index.get_start_time("calo", index.get_position("calo", rank));
+      DT_THROW_IF(start_time < tmin || start_time >= tmax, std::logic_error,
+                  "Signal out of window!");
+    }
+
+    // The stored start times are those of the signals:
+    for (std::size_t position = 0; position < number_of_signals; position++) {
+      const mctools::signal::base_signal &signal = ssd.get_signal("calo", position);
+      DT_THROW_IF(index.get_start_time("calo", position) !=
+                      snemo::asb::signal_index::compute_start_time(signal),
+                  std::logic_error, "Wrong stored start time at position " << position << "!");
+    }
+
+    // An index with inconsistent start times is rejected:
+    const std::string start_times_key = "asb.index.calo.start_times";
+    std::vector<double> start_times;
+    ssd.get_auxiliaries().fetch(start_times_key, start_times);
+    std::vector<double> corrupted_start_times(start_times.rbegin(), start_times.rend());
+    ssd.grab_auxiliaries().erase(start_times_key);
+    ssd.grab_auxiliaries().store(start_times_key, corrupted_start_times);
+    bool rejected = false;
+    try {
+      index.attach(ssd);
+    } catch (std::logic_error &expected) {
+      rejected = true;
+    }
+    DT_THROW_IF(!rejected, std::logic_error, "Corrupted index was attached!");
+    ssd.grab_auxiliaries().erase(start_times_key);
+    ssd.grab_auxiliaries().store(start_times_key, start_times);
+
+    // Fixed-point encoded banks must be decoded first:
+    snemo::asb::fixed_point_codec codec;
+    codec.encode(ssd);
+    rejected = false;
+    try {
+      index.attach(ssd);
+    } catch (std::logic_error &expected) {
+      rejected = true;
+    }
+    DT_THROW_IF(!rejected, std::logic_error, "Encoded bank was attached!");
+    rejected = false;
+    try {
+      snemo::asb::signal_index::build(ssd);
+    } catch (std::logic_error &expected) {
+      rejected = true;
+    }
+    DT_THROW_IF(!rejected, std::logic_error, "Encoded bank was indexed!");
+    snemo::asb::fixed_point_codec::decode(ssd);
+    index.attach(ssd);
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
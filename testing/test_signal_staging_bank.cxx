@@ -0,0 +1,99 @@
+// test_signal_staging_bank.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/signal_staging_bank.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::signal_staging_bank'!" << std::endl;
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+
+    // Partial banks of two producers, with signals in no particular order:
+    auto add_signal = [&](mctools::signal::signal_data &bank_, const std::string &category_,
+                          int hit_id_, int column_, double t0_) {
+      mctools::signal::base_signal &signal = bank_.add_signal(category_);
+      signal.set_hit_id(hit_id_);
+      signal.set_geom_id(geomtools::geom_id(1302, 0, 0, column_, 3, 1));
+      signal.set_category(category_);
+      signal.set_time_ref(0.0);
+      snemo::asb::triangle_shape_policy::build(signal, schema, t0_, 8.0 * CLHEP::ns,
+                                               70.0 * CLHEP::ns, 50.0 * CLHEP::millivolt);
+      return;
+    };
+    mctools::signal::signal_data calo_partial;
+    add_signal(calo_partial, "calo", 2, 1, 30.0 * CLHEP::ns);
+    add_signal(calo_partial, "calo", 0, 7, 10.0 * CLHEP::ns);
+    add_signal(calo_partial, "calo", 1, 4, 20.0 * CLHEP::ns);
+    mctools::signal::signal_data mixed_partial;
+    add_signal(mixed_partial, "xcalo", 1, 2, 15.0 * CLHEP::ns);
+    add_signal(mixed_partial, "xcalo", 0, 9, 5.0 * CLHEP::ns);
+    // A signal without hit ID, as the multi signals of some drivers:
+    add_signal(mixed_partial, "calo", -1, 0, 0.0);
+
+    // Producers stage their signals in any order:
+    snemo::asb::signal_staging_bank staging(2);
+    DT_THROW_IF(staging.grab_producer(1).absorb(mixed_partial) != 3, std::logic_error,
+                "Wrong number of absorbed signals!");
+    DT_THROW_IF(staging.grab_producer(0).absorb(calo_partial) != 3, std::logic_error,
+                "Wrong number of absorbed signals!");
+    DT_THROW_IF(calo_partial.get_number_of_signals("calo") != 0, std::logic_error,
+                "Absorbed signals are left in the partial bank!");
+    DT_THROW_IF(staging.get_number_of_staged_signals() != 6, std::logic_error,
+                "Wrong number of staged signals!");
+
+    // The merge appends the signals in producer order, each producer keeping
+    // its own order, as if the producers had filled the bank one after the other:
+    mctools::signal::signal_data merged;
+    DT_THROW_IF(staging.merge(merged) != 6, std::logic_error, "Wrong number of merged signals!");
+    const int expected_calo_hit_ids[4] = {2, 0, 1, -1};
+    const int expected_calo_columns[4] = {1, 7, 4, 0};
+    for (int isignal = 0; isignal < 4; isignal++) {
+      const mctools::signal::base_signal &signal = merged.get_signal("calo", isignal);
+      DT_THROW_IF(signal.get_hit_id() != expected_calo_hit_ids[isignal] ||
+                      signal.get_geom_id().get(2) !=
+                          static_cast<uint32_t>(expected_calo_columns[isignal]),
+                  std::logic_error, "Wrong merged calo signal #" << isignal << "!");
+    }
+    const int expected_xcalo_hit_ids[2] = {1, 0};
+    const int expected_xcalo_columns[2] = {2, 9};
+    for (int isignal = 0; isignal < 2; isignal++) {
+      const mctools::signal::base_signal &signal = merged.get_signal("xcalo", isignal);
+      DT_THROW_IF(signal.get_hit_id() != expected_xcalo_hit_ids[isignal] ||
+                      signal.get_geom_id().get(2) !=
+                          static_cast<uint32_t>(expected_xcalo_columns[isignal]),
+                  std::logic_error, "Wrong merged xcalo signal #" << isignal << "!");
+    }
+    DT_THROW_IF(staging.get_number_of_staged_signals() != 0, std::logic_error,
+                "Merged signals are still staged!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
@@ -0,0 +1,138 @@
+// test_signal_stream_buffer.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/signal_stream_buffer.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::signal_stream_buffer'!" << std::endl;
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+    const geomtools::geom_id gid1(1302, 0, 0, 1, 3, 1);
+    const geomtools::geom_id gid2(1302, 0, 0, 2, 3, 1);
+
+    // A signal starting 5 ns after its time reference:
+    auto make_signal = [&](const geomtools::geom_id &gid_, int hit_id_) {
+      mctools::signal::base_signal signal;
+      signal.set_hit_id(hit_id_);
+      signal.set_geom_id(gid_);
+      signal.set_category("calo");
+      signal.set_time_ref(0.0);
+      snemo::asb::triangle_shape_policy::build(signal, schema, 5.0 * CLHEP::ns, 8.0 * CLHEP::ns,
+                                               70.0 * CLHEP::ns, 50.0 * CLHEP::millivolt);
+      return signal;
+    };
+
+    snemo::asb::signal_stream_buffer buffer;
+    buffer.set_window(100.0 * CLHEP::ns);
+    buffer.push(make_signal(gid1, 0), 10.0 * CLHEP::ns);   // frame 0
+    buffer.push(make_signal(gid2, 1), 150.0 * CLHEP::ns);  // frame 1
+    buffer.push(make_signal(gid1, 2), 120.0 * CLHEP::ns);  // frame 1
+    DT_THROW_IF(buffer.get_number_of_pulses() != 3, std::logic_error, "Wrong number of pulses!");
+
+    bool caught = false;
+    try {
+      buffer.set_window(50.0 * CLHEP::ns);
+    } catch (std::logic_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Window changed while signals are buffered!");
+
+    // No frame is closed within the first window:
+    mctools::signal::signal_data ssd0;
+    DT_THROW_IF(buffer.advance(50.0 * CLHEP::ns, ssd0) != 0 || ssd0.has_signals("calo"),
+                std::logic_error, "Signals emitted from an open frame!");
+
+    // Closing frame 0 emits the first signal only, with its absolute time reference:
+    mctools::signal::signal_data ssd1;
+    DT_THROW_IF(buffer.advance(130.0 * CLHEP::ns, ssd1) != 1, std::logic_error,
+                "Wrong number of signals emitted from frame 0!");
+    const mctools::signal::base_signal &first = ssd1.get_signal("calo", 0);
+    DT_THROW_IF(first.get_hit_id() != 0 || first.get_time_ref() != 10.0 * CLHEP::ns,
+                std::logic_error, "Wrong signal emitted from frame 0!");
+    DT_THROW_IF(first.get_auxiliaries().fetch_real("asb.stream.frame") != 0.0, std::logic_error,
+                "Wrong frame of the emitted signal!");
+    DT_THROW_IF(ssd1.get_auxiliaries().fetch_real("asb.stream.first_open_frame") != 1.0,
+                std::logic_error, "Wrong first open frame!");
+    DT_THROW_IF(buffer.get_number_of_pulses() != 2, std::logic_error,
+                "Emitted signals are still buffered!");
+
+    // The stream time never goes backward:
+    mctools::signal::signal_data ssd2;
+    DT_THROW_IF(buffer.advance(120.0 * CLHEP::ns, ssd2) != 0 ||
+                    buffer.get_stream_time() != 130.0 * CLHEP::ns,
+                std::logic_error, "Stream time went backward!");
+
+    // A late signal joins the first open frame; frames are emitted by
+    // channel, then by start time:
+    buffer.push(make_signal(gid1, 3), 20.0 * CLHEP::ns);
+    mctools::signal::signal_data ssd3;
+    DT_THROW_IF(buffer.advance(250.0 * CLHEP::ns, ssd3) != 3, std::logic_error,
+                "Wrong number of signals emitted from frame 1!");
+    const int expected_hit_ids[3] = {3, 2, 1};
+    for (int isignal = 0; isignal < 3; isignal++) {
+      const mctools::signal::base_signal &signal = ssd3.get_signal("calo", isignal);
+      DT_THROW_IF(signal.get_hit_id() != expected_hit_ids[isignal], std::logic_error,
+                  "Wrong emission order of frame 1!");
+      DT_THROW_IF(signal.get_auxiliaries().fetch_real("asb.stream.frame") != 1.0,
+                  std::logic_error, "Wrong frame of the emitted signal!");
+    }
+    DT_THROW_IF(buffer.get_number_of_pulses() != 0 || buffer.get_max_number_of_pulses() != 3,
+                std::logic_error, "Wrong buffer occupancy!");
+    DT_THROW_IF(buffer.get_number_of_emitted_frames() != 2, std::logic_error,
+                "Wrong number of emitted frames!");
+
+    // Frames far beyond the integer range keep their exact index:
+    buffer.reset();
+    const double late_time = 4.0e9 * 100.0 * CLHEP::ns;
+    buffer.push(make_signal(gid1, 4), late_time);
+    mctools::signal::signal_data ssd4;
+    DT_THROW_IF(buffer.advance(late_time + 200.0 * CLHEP::ns, ssd4) != 1, std::logic_error,
+                "Late frame was not emitted!");
+    DT_THROW_IF(ssd4.get_signal("calo", 0).get_auxiliaries().fetch_real("asb.stream.frame") !=
+                    4.0e9,
+                std::logic_error, "Wrong index of a late frame!");
+
+    // The flush closes all the open frames at the end of the stream:
+    buffer.push(make_signal(gid2, 5), late_time + 250.0 * CLHEP::ns);
+    buffer.push(make_signal(gid1, 6), late_time + 420.0 * CLHEP::ns);
+    mctools::signal::signal_data ssd5;
+    DT_THROW_IF(buffer.flush(ssd5) != 2 || buffer.get_number_of_pulses() != 0, std::logic_error,
+                "Open frames were not flushed!");
+    DT_THROW_IF(ssd5.get_auxiliaries().fetch_real("asb.stream.first_open_frame") != 4.0e9 + 5.0,
+                std::logic_error, "Wrong first open frame after the flush!");
+    mctools::signal::signal_data ssd6;
+    DT_THROW_IF(buffer.flush(ssd6) != 0 || ssd6.has_signals("calo"), std::logic_error,
+                "Signals flushed twice!");
+    buffer.tree_dump(std::clog, "Stream buffer:");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
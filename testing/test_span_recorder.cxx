@@ -0,0 +1,90 @@
+// test_span_recorder.cxx
+// Standard libraries :
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/span_recorder.h>
+
+// Record some spans in the calling thread
+void record_spans(snemo::asb::span_recorder &recorder_, std::size_t number_of_spans_) {
+  for (std::size_t ispan = 0; ispan < number_of_spans_; ispan++) {
+    snemo::asb::span_recorder::scope span(&recorder_, "span #" + std::to_string(ispan), "test");
+  }
+  return;
+}
+
+// Return the number of occurrences of a pattern in a text
+std::size_t count_occurrences(const std::string &text_, const std::string &pattern_) {
+  std::size_t count = 0;
+  for (std::size_t pos = text_.find(pattern_); pos != std::string::npos;
+       pos = text_.find(pattern_, pos + pattern_.size())) {
+    count++;
+  }
+  return count;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::span_recorder'!" << std::endl;
+
+    // A null recorder makes a scope a no-op:
+    { snemo::asb::span_recorder::scope span(nullptr, "ignored", "test"); }
+
+    // Successive recorders, possibly at the same address, used by the main
+    // thread which outlives them all: each one only sees its own spans.
+    const std::size_t number_of_threads = 3;
+    const std::size_t spans_per_thread = 5;
+    for (int irecorder = 0; irecorder < 4; irecorder++) {
+      snemo::asb::span_recorder recorder;
+      record_spans(recorder, spans_per_thread);
+      std::vector<std::thread> workers;
+      for (std::size_t ithread = 1; ithread < number_of_threads; ithread++) {
+        workers.emplace_back(record_spans, std::ref(recorder), spans_per_thread);
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+      DT_THROW_IF(recorder.get_number_of_spans() != number_of_threads * spans_per_thread,
+                  std::logic_error,
+                  "Recorder #" << irecorder << " has " << recorder.get_number_of_spans()
+                               << " spans!");
+
+      // One timeline track per thread:
+      std::ostringstream json;
+      recorder.write_json(json);
+      DT_THROW_IF(count_occurrences(json.str(), "\"thread_name\"") != number_of_threads,
+                  std::logic_error, "Wrong number of threads in the timeline!");
+      DT_THROW_IF(count_occurrences(json.str(), "\"ph\":\"X\"") !=
+                      number_of_threads * spans_per_thread,
+                  std::logic_error, "Wrong number of spans in the timeline!");
+
+      recorder.clear();
+      DT_THROW_IF(recorder.get_number_of_spans() != 0, std::logic_error,
+                  "Spans left after clear!");
+    }
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
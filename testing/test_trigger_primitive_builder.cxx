@@ -0,0 +1,179 @@
+// test_trigger_primitive_builder.cxx
+// Standard libraries :
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// - Bayeux/datatools:
+#include <datatools/clhep_units.h>
+#include <datatools/exception.h>
+#include <datatools/properties.h>
+// - Bayeux/geomtools:
+#include <geomtools/geom_id.h>
+// - Bayeux/mctools:
+#include <mctools/signal/base_signal.h>
+#include <mctools/signal/signal_data.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/packed_gid.h>
+#include <snemo/asb/shape_policies.h>
+#include <snemo/asb/trigger_primitive_builder.h>
+#include <snemo/asb/utils.h>
+
+// Add a triangle calorimeter signal
+void add_triangle(mctools::signal::signal_data &ssd_, const snemo::asb::shape_schema &schema_,
+                  const geomtools::geom_id &gid_, double t0_, double amplitude_) {
+  mctools::signal::base_signal &signal = ssd_.add_signal("calo");
+  signal.set_hit_id(ssd_.get_number_of_signals("calo") - 1);
+  signal.set_geom_id(gid_);
+  signal.set_category("calo");
+  signal.set_time_ref(0.0);
+  snemo::asb::triangle_shape_policy::build(signal, schema_, t0_, 10.0 * CLHEP::ns,
+                                           40.0 * CLHEP::ns, amplitude_);
+  return;
+}
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::trigger_primitive_builder'!" << std::endl;
+
+    snemo::asb::shape_schema schema;
+    schema.initialize(snemo::asb::triangle_shape_policy::shape_type_id());
+
+    // Two blocks in coincidence, one of them with two overlapping hits, and
+    // one block below threshold:
+    mctools::signal::signal_data ssd;
+    const geomtools::geom_id gid_a(1302, 0, 0, 3, 4, 1);
+    const geomtools::geom_id gid_b(1302, 0, 1, 7, 2, 1);
+    const geomtools::geom_id gid_c(1302, 0, 1, 8, 2, 1);
+    add_triangle(ssd, schema, gid_a, 0.0 * CLHEP::ns, 40.0 * CLHEP::millivolt);
+    add_triangle(ssd, schema, gid_a, 5.0 * CLHEP::ns, 40.0 * CLHEP::millivolt);
+    add_triangle(ssd, schema, gid_b, 20.0 * CLHEP::ns, 100.0 * CLHEP::millivolt);
+    add_triangle(ssd, schema, gid_c, 0.0 * CLHEP::ns, 10.0 * CLHEP::millivolt);
+
+    datatools::properties config;
+    config.store_real("threshold", 50.0);
+    config.store_real("coincidence_window", 30.0);
+    config.store_integer("multiplicity", 2);
+    snemo::asb::trigger_primitive_builder builder;
+    builder.initialize(config);
+    builder.build(ssd);
+
+    std::size_t crossing_channels = 0;
+    for (const auto &primitive : builder.get_primitives()) {
+      std::clog << "Channel " << primitive.gid << " : peak="
+                << primitive.peak_amplitude / CLHEP::millivolt << " mV";
+      if (primitive.crossed) {
+        crossing_channels++;
+        std::clog << " crossing=" << primitive.crossing_time / CLHEP::ns << " ns";
+      }
+      std::clog << std::endl;
+      if (primitive.gid == gid_a) {
+        // Sum of the two triangles: 40 mV x (t/10) + 40 mV x ((t-5)/10) reaches
+        // 50 mV at t = 8.75 ns; the peak is at t = 15 ns (35 mV + 40 mV).
+        DT_THROW_IF(!primitive.crossed || std::abs(primitive.crossing_time - 8.75 * CLHEP::ns) >
+                                              1e-9 * CLHEP::ns,
+                    std::logic_error, "Wrong crossing time of the piled-up channel!");
+        DT_THROW_IF(std::abs(primitive.peak_amplitude - 75.0 * CLHEP::millivolt) >
+                        1e-9 * CLHEP::millivolt,
+                    std::logic_error, "Wrong peak amplitude of the piled-up channel!");
+      } else if (primitive.gid == gid_b) {
+        DT_THROW_IF(!primitive.crossed || std::abs(primitive.crossing_time - 25.0 * CLHEP::ns) >
+                                              1e-9 * CLHEP::ns,
+                    std::logic_error, "Wrong crossing time!");
+      } else {
+        DT_THROW_IF(primitive.crossed, std::logic_error, "Unexpected threshold crossing!");
+      }
+    }
+    DT_THROW_IF(crossing_channels != 2, std::logic_error, "Wrong number of crossing channels!");
+    DT_THROW_IF(builder.get_max_coincidence() != 2, std::logic_error, "Wrong coincidence!");
+    DT_THROW_IF(!builder.is_accepted(), std::logic_error, "Event should be accepted!");
+
+    // A narrower window splits the coincidence:
+    builder.set_coincidence_window(10.0 * CLHEP::ns);
+    builder.build(ssd);
+    DT_THROW_IF(builder.get_max_coincidence() != 1 || builder.is_accepted(), std::logic_error,
+                "Event should be rejected!");
+
+    // Each crossing is stored with its channel:
+    datatools::properties summary;
+    builder.export_summary(summary);
+    summary.tree_dump(std::clog, "Trigger summary: ");
+    std::vector<std::string> crossing_gids;
+    summary.fetch("trigger.crossing_channels", crossing_gids);
+    DT_THROW_IF(crossing_gids.size() != 2 ||
+                    crossing_gids[0] !=
+                        snemo::asb::hash_utils::to_hex(snemo::asb::packed_gid::encode(gid_a)) ||
+                    crossing_gids[1] !=
+                        snemo::asb::hash_utils::to_hex(snemo::asb::packed_gid::encode(gid_b)),
+                std::logic_error, "Wrong crossing channels!");
+    DT_THROW_IF(summary.size("trigger.crossing_categories") != 2, std::logic_error,
+                "Wrong crossing categories!");
+
+    // An empty bank gives an empty summary:
+    builder.build(mctools::signal::signal_data());
+    datatools::properties empty_summary;
+    builder.export_summary(empty_summary);
+    DT_THROW_IF(empty_summary.fetch_integer("trigger.channels_above_threshold") != 0 ||
+                    empty_summary.has_key("trigger.crossing_channels") ||
+                    empty_summary.fetch_boolean("trigger.accept"),
+                std::logic_error, "Wrong empty summary!");
+
+    // The piled-up channel as a single multi signal gives the same primitive:
+    mctools::signal::signal_data multi_ssd;
+    std::vector<mctools::signal::base_signal> atomic_signals(2);
+    for (std::size_t ihit = 0; ihit < atomic_signals.size(); ihit++) {
+      mctools::signal::base_signal &atomic_signal = atomic_signals[ihit];
+      atomic_signal.set_hit_id(ihit);
+      atomic_signal.set_geom_id(gid_a);
+      atomic_signal.set_category("calo");
+      atomic_signal.set_time_ref(0.0);
+      snemo::asb::triangle_shape_policy::build(atomic_signal, schema, ihit * 5.0 * CLHEP::ns,
+                                               10.0 * CLHEP::ns, 40.0 * CLHEP::ns,
+                                               40.0 * CLHEP::millivolt);
+    }
+    snemo::asb::signal_utils::build_multi_signal({&atomic_signals[0], &atomic_signals[1]},
+                                                 multi_ssd.add_signal("calo"));
+    builder.build(multi_ssd);
+    DT_THROW_IF(builder.get_number_of_unresolved_signals() != 0 ||
+                    builder.get_primitives().size() != 1,
+                std::logic_error, "Unresolved multi signal!");
+    const auto &multi_primitive = builder.get_primitives().front();
+    DT_THROW_IF(!multi_primitive.crossed ||
+                    std::abs(multi_primitive.crossing_time - 8.75 * CLHEP::ns) >
+                        1e-9 * CLHEP::ns ||
+                    std::abs(multi_primitive.peak_amplitude - 75.0 * CLHEP::millivolt) >
+                        1e-9 * CLHEP::millivolt,
+                std::logic_error, "Wrong primitive of the multi signal!");
+    DT_THROW_IF(builder.is_accepted(), std::logic_error, "Multi signal should be rejected!");
+
+    // A multi signal with a component without triangle parameters is unresolved:
+    mctools::signal::base_signal opaque_signal = atomic_signals[1];
+    opaque_signal.grab_auxiliaries().erase_all_starting_with(
+        mctools::signal::base_signal::shape_parameter_prefix());
+    mctools::signal::signal_data opaque_ssd;
+    snemo::asb::signal_utils::build_multi_signal({&atomic_signals[0], &opaque_signal},
+                                                 opaque_ssd.add_signal("calo"));
+    builder.build(opaque_ssd);
+    DT_THROW_IF(builder.get_number_of_unresolved_signals() != 1 ||
+                    !builder.get_primitives().empty() || !builder.is_accepted(),
+                std::logic_error, "Multi signal should be unresolved!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}
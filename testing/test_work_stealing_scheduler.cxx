@@ -0,0 +1,147 @@
+// test_work_stealing_scheduler.cxx
+// Standard libraries :
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// - Bayeux/datatools:
+#include <datatools/exception.h>
+
+// Falaise:
+#include <falaise/falaise.h>
+
+// This project :
+#include <snemo/asb/work_stealing_scheduler.h>
+
+int main(int argc_, char **argv_) {
+  falaise::initialize(argc_, argv_);
+  int error_code = EXIT_SUCCESS;
+  try {
+    std::clog << "Test program for class 'snemo::asb::work_stealing_scheduler'!" << std::endl;
+
+    std::size_t number_of_workers = 4;
+    std::size_t number_of_events = 500;
+    int iarg = 1;
+    while (iarg < argc_) {
+      std::string arg = argv_[iarg];
+      if (arg == "-j" || arg == "--workers") {
+        number_of_workers = std::atoi(argv_[++iarg]);
+      } else if (arg == "-n" || arg == "--number") {
+        number_of_events = std::atoi(argv_[++iarg]);
+      }
+      iarg++;
+    }
+
+    // Mimic a stream of mostly small events with a few very large ones, the
+    // large ones being split in sub-tasks:
+    const std::size_t number_of_subtasks = 8;
+    std::atomic<std::size_t> done_events(0);
+    std::atomic<std::size_t> done_subtasks(0);
+    std::atomic<std::size_t> split_events(0);
+    snemo::asb::work_stealing_scheduler scheduler(number_of_workers);
+    scheduler.start();
+    for (std::size_t ievent = 0; ievent < number_of_events; ievent++) {
+      const bool large = (ievent % 50 == 0);
+      scheduler.submit([&, large](std::size_t worker_) {
+        DT_THROW_IF(scheduler.get_current_worker() != static_cast<int>(worker_),
+                    std::logic_error, "Unexpected worker index!");
+        if (large) {
+          snemo::asb::work_stealing_scheduler::task_group group;
+          for (std::size_t isub = 0; isub < number_of_subtasks; isub++) {
+            scheduler.submit(group, [&](std::size_t) {
+              for (volatile int k = 0; k < 200000; k++) {
+              }
+              done_subtasks++;
+            });
+          }
+          scheduler.wait(group);
+          DT_THROW_IF(group.get_number_of_pending_tasks() != 0, std::logic_error,
+                      "Group still has pending tasks!");
+          split_events++;
+        } else {
+          for (volatile int k = 0; k < 2000; k++) {
+          }
+        }
+        done_events++;
+      });
+    }
+    scheduler.stop();
+    scheduler.print_stats(std::clog);
+
+    DT_THROW_IF(done_events != number_of_events, std::logic_error,
+                "Missing events: " << done_events << "/" << number_of_events << "!");
+    DT_THROW_IF(done_subtasks != split_events * number_of_subtasks, std::logic_error,
+                "Missing sub-tasks!");
+    DT_THROW_IF(scheduler.get_current_worker() != -1, std::logic_error,
+                "Main thread is not a worker!");
+
+    // Exceptions thrown by tasks are reported when stopping:
+    scheduler.start();
+    scheduler.submit([](std::size_t) { DT_THROW(std::runtime_error, "Expected failure"); });
+    bool caught = false;
+    try {
+      scheduler.stop();
+    } catch (std::runtime_error &) {
+      caught = true;
+    }
+    DT_THROW_IF(!caught, std::logic_error, "Task failure was not reported!");
+
+    // A single worker waiting for a group while other tasks are submitted
+    // from outside must neither deadlock nor run them meanwhile:
+    snemo::asb::work_stealing_scheduler single(1);
+    std::atomic<bool> group_submitted(false);
+    std::atomic<bool> external_submitted(false);
+    std::atomic<std::size_t> done_external(0);
+    std::atomic<std::size_t> external_during_wait(0);
+    std::atomic<std::size_t> done_group(0);
+    bool group_failure_caught = false;
+    single.start();
+    single.submit([&](std::size_t) {
+      snemo::asb::work_stealing_scheduler::task_group group;
+      for (std::size_t isub = 0; isub < number_of_subtasks; isub++) {
+        single.submit(group, [&](std::size_t) { done_group++; });
+      }
+      single.submit(group, [](std::size_t) { DT_THROW(std::runtime_error, "Expected failure"); });
+      group_submitted = true;
+      while (!external_submitted) {
+        std::this_thread::yield();
+      }
+      const std::size_t done_before_wait = done_external;
+      try {
+        single.wait(group);
+      } catch (std::runtime_error &) {
+        group_failure_caught = true;
+      }
+      external_during_wait = done_external - done_before_wait;
+    });
+    std::thread external([&]() {
+      while (!group_submitted) {
+        std::this_thread::yield();
+      }
+      for (std::size_t itask = 0; itask < 10; itask++) {
+        single.submit([&](std::size_t) { done_external++; });
+      }
+      external_submitted = true;
+    });
+    external.join();
+    single.stop();
+    DT_THROW_IF(done_group != number_of_subtasks || done_external != 10, std::logic_error,
+                "Missing tasks with a single worker!");
+    DT_THROW_IF(external_during_wait != 0, std::logic_error,
+                "Unrelated tasks were run while waiting for a group!");
+    DT_THROW_IF(!group_failure_caught, std::logic_error,
+                "Group task failure was not reported by the wait!");
+  } catch (std::exception &error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    error_code = EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "error: "
+              << "Unexpected error!" << std::endl;
+    error_code = EXIT_FAILURE;
+  }
+  falaise::terminate();
+  return (error_code);
+}